@@ -131,8 +131,8 @@ foreach(oneflow_single_file ${oneflow_all_src})
   endif()
 
   if("${oneflow_single_file}" MATCHES "^${PROJECT_SOURCE_DIR}/oneflow/(core|user|xrt)/.*\\.cpp$")
-    if("${oneflow_single_file}" MATCHES "^${PROJECT_SOURCE_DIR}/oneflow/core/transport/transport_test_main\\.cpp$")
-      list(APPEND of_transport_test_cc ${oneflow_single_file})
+    if("${oneflow_single_file}" MATCHES "^${PROJECT_SOURCE_DIR}/oneflow/core/.*_test_main\\.cpp$")
+      list(APPEND of_test_main_cc ${oneflow_single_file})
     elseif("${oneflow_single_file}" MATCHES "^${PROJECT_SOURCE_DIR}/oneflow/(core|user|xrt)/.*_test\\.cpp$")
       # test file
       list(APPEND of_all_test_cc ${oneflow_single_file})
@@ -337,13 +337,13 @@ if(BUILD_TESTING)
   endif()
 endif()
 
-# build transport_test
-foreach(cc ${of_transport_test_cc})
-  get_filename_component(transport_test_name ${cc} NAME_WE)
-  string(CONCAT transport_test_exe_name ${transport_test_name} _exe)
-  oneflow_add_executable(${transport_test_exe_name} ${cc})
-  target_link_libraries(${transport_test_exe_name} ${of_libs} ${oneflow_third_party_libs})
-  set_target_properties(${transport_test_exe_name} PROPERTIES RUNTIME_OUTPUT_DIRECTORY "${PROJECT_BINARY_DIR}/bin")
+# build standalone test mains, e.g. transport_test, which run on several machines or processes
+foreach(cc ${of_test_main_cc})
+  get_filename_component(test_main_name ${cc} NAME_WE)
+  string(CONCAT test_main_exe_name ${test_main_name} _exe)
+  oneflow_add_executable(${test_main_exe_name} ${cc})
+  target_link_libraries(${test_main_exe_name} ${of_libs} ${oneflow_third_party_libs})
+  set_target_properties(${test_main_exe_name} PROPERTIES RUNTIME_OUTPUT_DIRECTORY "${PROJECT_BINARY_DIR}/bin")
 endforeach()
 
 
@@ -38,7 +38,9 @@ sockaddr_in GetSockAddr(const std::string& addr, uint16_t port) {
   return sa;
 }
 
-int SockListen(int listen_sockfd, uint16_t listen_port, int32_t total_machine_num) {
+constexpr size_t kStripeAlignSize = 4096;
+
+int SockListen(int listen_sockfd, uint16_t listen_port, int32_t backlog) {
   sockaddr_in sa = GetSockAddr("0.0.0.0", listen_port);
   int reuse = 1;
   int ret_setopt =
@@ -46,7 +48,7 @@ int SockListen(int listen_sockfd, uint16_t listen_port, int32_t total_machine_nu
   CHECK_EQ(ret_setopt, 0);
   int bind_result = bind(listen_sockfd, reinterpret_cast<sockaddr*>(&sa), sizeof(sa));
   if (bind_result == 0) {
-    PCHECK(listen(listen_sockfd, total_machine_num) == 0);
+    PCHECK(listen(listen_sockfd, backlog) == 0);
     LOG(INFO) << "CommNet:Epoll listening on "
               << "0.0.0.0:" + std::to_string(listen_port);
   } else {
@@ -55,16 +57,6 @@ int SockListen(int listen_sockfd, uint16_t listen_port, int32_t total_machine_nu
   return bind_result;
 }
 
-int64_t GetMachineId(const sockaddr_in& sa) {
-  char addr[INET_ADDRSTRLEN];
-  memset(addr, '\0', sizeof(addr));
-  PCHECK(inet_ntop(AF_INET, &(sa.sin_addr), addr, INET_ADDRSTRLEN));
-  for (int64_t i = 0; i < Global<ResourceDesc, ForSession>::Get()->TotalMachineNum(); ++i) {
-    if (Global<ResourceDesc, ForSession>::Get()->machine(i).addr() == addr) { return i; }
-  }
-  UNIMPLEMENTED();
-}
-
 std::string GenPortKey(int64_t machine_id) { return "EpollPort/" + std::to_string(machine_id); }
 void PushPort(int64_t machine_id, uint16_t port) {
   Global<CtrlClient>::Get()->PushKV(GenPortKey(machine_id), std::to_string(port));
@@ -77,6 +69,25 @@ uint16_t PullPort(int64_t machine_id) {
   return port;
 }
 
+// the connecting side tells which machine it is and which of the sockets to the peer this one
+// is, so several machines may share an address, e.g. processes on one host in tests
+struct SocketHandshake {
+  int64_t machine_id;
+  int32_t socket_idx;
+};
+
+void WriteSocketHandshake(int sockfd, int64_t machine_id, int32_t socket_idx) {
+  SocketHandshake handshake{};
+  handshake.machine_id = machine_id;
+  handshake.socket_idx = socket_idx;
+  PCHECK(write(sockfd, &handshake, sizeof(handshake)) == sizeof(handshake));
+}
+SocketHandshake ReadSocketHandshake(int sockfd) {
+  SocketHandshake handshake{};
+  PCHECK(read(sockfd, &handshake, sizeof(handshake)) == sizeof(handshake));
+  return handshake;
+}
+
 }  // namespace
 
 EpollCommNet::~EpollCommNet() {
@@ -86,8 +97,10 @@ EpollCommNet::~EpollCommNet() {
   }
   // TODO(chengcheng): change to OF_ENV_BARRIER
   OF_SESSION_BARRIER();
-  for (IOEventPoller* poller : pollers_) { delete poller; }
+  LogSocketStats();
+  // the helpers take back from the pollers the fds they close themselves
   for (auto& pair : sockfd2helper_) { delete pair.second; }
+  for (IOEventPoller* poller : pollers_) { delete poller; }
 }
 
 void EpollCommNet::RegisterMemoryDone() {
@@ -112,6 +125,39 @@ void EpollCommNet::SendSocketMsg(int64_t dst_machine_id, const SocketMsg& msg) {
   GetSocketHelper(dst_machine_id)->AsyncWrite(msg);
 }
 
+void EpollCommNet::SendRequestReadMsg(int64_t dst_machine_id, const RequestReadMsg& msg) {
+  const size_t byte_size = static_cast<const SocketMemDesc*>(msg.src_token)->byte_size;
+  const int64_t data_socket_num = machine_id2sockfds_.at(dst_machine_id).size() - 1;
+  int64_t part_num = 1;
+  size_t part_byte_size = byte_size;
+  if (data_socket_num > 1 && byte_size > 0 && byte_size >= stripe_min_byte_size_) {
+    part_byte_size = RoundUp((byte_size + data_socket_num - 1) / data_socket_num, kStripeAlignSize);
+    part_num = (byte_size + part_byte_size - 1) / part_byte_size;
+  }
+  const int64_t first_socket_idx = next_data_socket_idx_.fetch_add(part_num);
+  SocketMsg socket_msg;
+  socket_msg.msg_type = SocketMsgType::kRequestRead;
+  socket_msg.request_read_msg = msg;
+  socket_msg.request_read_msg.part_num = part_num;
+  FOR_RANGE(int64_t, i, 0, part_num) {
+    socket_msg.request_read_msg.offset = std::min(i * part_byte_size, byte_size);
+    socket_msg.request_read_msg.byte_size =
+        std::min((i + 1) * part_byte_size, byte_size) - socket_msg.request_read_msg.offset;
+    GetDataSocketHelper(dst_machine_id, first_socket_idx + i)->AsyncWrite(socket_msg);
+  }
+}
+
+void EpollCommNet::PartReadDone(void* read_id, int64_t part_num) {
+  if (part_num > 1) {
+    std::unique_lock<std::mutex> lck(read_id2done_part_num_mtx_);
+    int64_t* done_part_num = &read_id2done_part_num_[read_id];
+    *done_part_num += 1;
+    if (*done_part_num < part_num) { return; }
+    read_id2done_part_num_.erase(read_id);
+  }
+  ReadDone(read_id);
+}
+
 SocketMemDesc* EpollCommNet::NewMemDesc(void* ptr, size_t byte_size) {
   SocketMemDesc* mem_desc = new SocketMemDesc;
   mem_desc->mem_ptr = ptr;
@@ -137,7 +183,12 @@ void EpollCommNet::InitSockets() {
   int64_t this_machine_id = Global<MachineCtx>::Get()->this_machine_id();
   auto this_machine = Global<ResourceDesc, ForSession>::Get()->machine(this_machine_id);
   int64_t total_machine_num = Global<ResourceDesc, ForSession>::Get()->TotalMachineNum();
-  machine_id2sockfd_.assign(total_machine_num, -1);
+  const int32_t socket_num_per_peer =
+      Global<ResourceDesc, ForSession>::Get()->comm_net_socket_num_per_peer();
+  CHECK_GE(socket_num_per_peer, 1);
+  stripe_min_byte_size_ = Global<ResourceDesc, ForSession>::Get()->comm_net_stripe_min_byte_size();
+  next_data_socket_idx_ = 0;
+  machine_id2sockfds_.assign(total_machine_num, std::vector<int>(socket_num_per_peer, -1));
   sockfd2helper_.clear();
   size_t poller_idx = 0;
   auto NewSocketHelper = [&](int sockfd) {
@@ -149,14 +200,15 @@ void EpollCommNet::InitSockets() {
   // listen
   int listen_sockfd = socket(AF_INET, SOCK_STREAM, 0);
   int32_t this_listen_port = Global<EnvDesc>::Get()->data_port();
+  const int32_t backlog = total_machine_num * socket_num_per_peer;
   if (this_listen_port != -1) {
-    CHECK_EQ(SockListen(listen_sockfd, this_listen_port, total_machine_num), 0);
+    CHECK_EQ(SockListen(listen_sockfd, this_listen_port, backlog), 0);
     PushPort(this_machine_id,
              ((this_machine.data_port_agent() != -1) ? (this_machine.data_port_agent())
                                                      : (this_listen_port)));
   } else {
     for (this_listen_port = 1024; this_listen_port < GetMaxVal<uint16_t>(); ++this_listen_port) {
-      if (SockListen(listen_sockfd, this_listen_port, total_machine_num) == 0) {
+      if (SockListen(listen_sockfd, this_listen_port, backlog) == 0) {
         PushPort(this_machine_id, this_listen_port);
         break;
       }
@@ -174,39 +226,89 @@ void EpollCommNet::InitSockets() {
     uint16_t peer_port = PullPort(peer_id);
     auto peer_machine = Global<ResourceDesc, ForSession>::Get()->machine(peer_id);
     sockaddr_in peer_sockaddr = GetSockAddr(peer_machine.addr(), peer_port);
-    int sockfd = socket(AF_INET, SOCK_STREAM, 0);
-    const int val = 1;
-    PCHECK(setsockopt(sockfd, IPPROTO_TCP, TCP_NODELAY, (char*)&val, sizeof(int)) == 0);
-    PCHECK(connect(sockfd, reinterpret_cast<sockaddr*>(&peer_sockaddr), sizeof(peer_sockaddr))
-           == 0);
-    CHECK(sockfd2helper_.emplace(sockfd, NewSocketHelper(sockfd)).second);
-    machine_id2sockfd_[peer_id] = sockfd;
+    FOR_RANGE(int32_t, socket_idx, 0, socket_num_per_peer) {
+      int sockfd = socket(AF_INET, SOCK_STREAM, 0);
+      const int val = 1;
+      PCHECK(setsockopt(sockfd, IPPROTO_TCP, TCP_NODELAY, (char*)&val, sizeof(int)) == 0);
+      PCHECK(connect(sockfd, reinterpret_cast<sockaddr*>(&peer_sockaddr), sizeof(peer_sockaddr))
+             == 0);
+      WriteSocketHandshake(sockfd, this_machine_id, socket_idx);
+      CHECK(sockfd2helper_.emplace(sockfd, NewSocketHelper(sockfd)).second);
+      machine_id2sockfds_[peer_id][socket_idx] = sockfd;
+    }
   }
 
   // accept
-  FOR_RANGE(int32_t, idx, 0, src_machine_count) {
+  FOR_RANGE(int32_t, idx, 0, src_machine_count * socket_num_per_peer) {
     sockaddr_in peer_sockaddr;
     socklen_t len = sizeof(peer_sockaddr);
     int sockfd = accept(listen_sockfd, reinterpret_cast<sockaddr*>(&peer_sockaddr), &len);
     PCHECK(sockfd != -1);
+    const SocketHandshake handshake = ReadSocketHandshake(sockfd);
+    const int64_t peer_machine_id = handshake.machine_id;
+    const int32_t socket_idx = handshake.socket_idx;
+    CHECK_GE(peer_machine_id, 0);
+    CHECK_LT(peer_machine_id, this_machine_id);
+    CHECK_GE(socket_idx, 0);
+    CHECK_LT(socket_idx, socket_num_per_peer);
     CHECK(sockfd2helper_.emplace(sockfd, NewSocketHelper(sockfd)).second);
-    int64_t peer_machine_id = GetMachineId(peer_sockaddr);
-    machine_id2sockfd_[peer_machine_id] = sockfd;
+    CHECK_EQ(machine_id2sockfds_[peer_machine_id][socket_idx], -1);
+    machine_id2sockfds_[peer_machine_id][socket_idx] = sockfd;
   }
   PCHECK(close(listen_sockfd) == 0);
   ClearPort(this_machine_id);
 
   // useful log
   FOR_RANGE(int64_t, machine_id, 0, total_machine_num) {
-    LOG(INFO) << "machine " << machine_id << " sockfd " << machine_id2sockfd_[machine_id];
+    LOG(INFO) << "machine " << machine_id << " sockfd " << machine_id2sockfds_[machine_id][0]
+              << ", " << socket_num_per_peer << " sockets in total";
+  }
+}
+
+void EpollCommNet::LogSocketStats() const {
+  int64_t written_msg_cnt = 0;
+  int64_t write_syscall_cnt = 0;
+  int64_t read_msg_cnt = 0;
+  int64_t read_syscall_cnt = 0;
+  int64_t zero_copy_send_cnt = 0;
+  int64_t zero_copy_copied_cnt = 0;
+  int64_t waited_msg_cnt = 0;
+  for (const auto& pair : sockfd2helper_) {
+    written_msg_cnt += pair.second->write_helper()->written_msg_cnt();
+    write_syscall_cnt += pair.second->write_helper()->write_syscall_cnt();
+    read_msg_cnt += pair.second->read_helper()->read_msg_cnt();
+    read_syscall_cnt += pair.second->read_helper()->read_syscall_cnt();
+    zero_copy_send_cnt += pair.second->write_helper()->zero_copy_send_cnt();
+    zero_copy_copied_cnt += pair.second->write_helper()->zero_copy_copied_cnt();
+    waited_msg_cnt += pair.second->read_helper()->waited_msg_cnt();
+  }
+  auto MsgsPerSyscall = [](int64_t msg_cnt, int64_t syscall_cnt) {
+    return static_cast<double>(msg_cnt) / std::max<int64_t>(syscall_cnt, 1);
+  };
+  LOG(INFO) << "CommNet wrote " << written_msg_cnt << " msgs in " << write_syscall_cnt
+            << " syscalls (" << MsgsPerSyscall(written_msg_cnt, write_syscall_cnt)
+            << " msgs per syscall), read " << read_msg_cnt << " msgs in " << read_syscall_cnt
+            << " syscalls (" << MsgsPerSyscall(read_msg_cnt, read_syscall_cnt)
+            << " msgs per syscall)";
+  if (Global<ResourceDesc, ForSession>::Get()->comm_net_send_mode() != kCommNetSendCopy) {
+    LOG(INFO) << "CommNet sent " << zero_copy_send_cnt << " bodies without copy, "
+              << zero_copy_copied_cnt << " zero copy sendmsg calls were copied by the kernel, "
+              << waited_msg_cnt << " msgs waited for zero copy sends";
   }
 }
 
 SocketHelper* EpollCommNet::GetSocketHelper(int64_t machine_id) {
-  int sockfd = machine_id2sockfd_.at(machine_id);
+  int sockfd = machine_id2sockfds_.at(machine_id).front();
   return sockfd2helper_.at(sockfd);
 }
 
+SocketHelper* EpollCommNet::GetDataSocketHelper(int64_t machine_id, int64_t idx) {
+  const std::vector<int>& sockfds = machine_id2sockfds_.at(machine_id);
+  // with a single socket to the peer it carries everything
+  if (sockfds.size() == 1) { return sockfd2helper_.at(sockfds.front()); }
+  return sockfd2helper_.at(sockfds.at(1 + idx % (sockfds.size() - 1)));
+}
+
 void EpollCommNet::DoRead(void* read_id, int64_t src_machine_id, void* src_token, void* dst_token) {
   SocketMsg msg;
   msg.msg_type = SocketMsgType::kRequestWrite;
@@ -38,6 +38,9 @@ class EpollCommNet final : public CommNetIf<SocketMemDesc> {
   void SendActorMsg(int64_t dst_machine_id, const ActorMsg& msg) override;
   void SendSocketMsg(int64_t dst_machine_id, const SocketMsg& msg);
   void SendTransportMsg(int64_t dst_machine_id, const TransportMsg& msg);
+  // sends the whole src memory of msg, split over the data sockets if it is large
+  void SendRequestReadMsg(int64_t dst_machine_id, const RequestReadMsg& msg);
+  void PartReadDone(void* read_id, int64_t part_num);
 
  private:
   SocketMemDesc* NewMemDesc(void* ptr, size_t byte_size) override;
@@ -47,11 +50,18 @@ class EpollCommNet final : public CommNetIf<SocketMemDesc> {
   DEPRECATED EpollCommNet(const Plan& plan);
   void InitSockets();
   SocketHelper* GetSocketHelper(int64_t machine_id);
+  SocketHelper* GetDataSocketHelper(int64_t machine_id, int64_t idx);
+  void LogSocketStats() const;
   void DoRead(void* read_id, int64_t src_machine_id, void* src_token, void* dst_token) override;
 
   std::vector<IOEventPoller*> pollers_;
-  std::vector<int> machine_id2sockfd_;
+  // the first socket to a machine carries control msgs, the others regst bodies
+  std::vector<std::vector<int>> machine_id2sockfds_;
   HashMap<int, SocketHelper*> sockfd2helper_;
+  size_t stripe_min_byte_size_;
+  std::atomic<int64_t> next_data_socket_idx_;
+  std::mutex read_id2done_part_num_mtx_;
+  HashMap<void*, int64_t> read_id2done_part_num_;
 };
 
 }  // namespace oneflow
@@ -50,6 +50,29 @@ void IOEventPoller::AddFdWithOnlyReadHandler(int fd, std::function<void()> read_
   AddFd(fd, &read_handler, nullptr);
 }
 
+void IOEventPoller::SetErrorHandler(int fd, std::function<void()> error_handler) {
+  for (IOHandler* io_handler : io_handlers_) {
+    if (io_handler->fd == fd) {
+      io_handler->error_handler = error_handler;
+      return;
+    }
+  }
+  UNIMPLEMENTED() << "fd " << fd << " is not added";
+}
+
+void IOEventPoller::DelFd(int fd) {
+  auto prev_it = io_handlers_.before_begin();
+  for (auto it = io_handlers_.begin(); it != io_handlers_.end(); prev_it = it++) {
+    if ((*it)->fd == fd) {
+      PCHECK(epoll_ctl(epfd_, EPOLL_CTL_DEL, fd, nullptr) == 0);
+      delete *it;
+      io_handlers_.erase_after(prev_it);
+      return;
+    }
+  }
+  UNIMPLEMENTED() << "fd " << fd << " is not added";
+}
+
 void IOEventPoller::Start() { thread_ = std::thread(&IOEventPoller::EpollLoop, this); }
 
 void IOEventPoller::Stop() {
@@ -93,7 +116,10 @@ void IOEventPoller::EpollLoop() {
     const epoll_event* cur_event = ep_events_;
     for (int event_idx = 0; event_idx < event_num; ++event_idx, ++cur_event) {
       auto io_handler = static_cast<IOHandler*>(cur_event->data.ptr);
-      PCHECK(!(cur_event->events & EPOLLERR)) << "fd: " << io_handler->fd;
+      if (cur_event->events & EPOLLERR) {
+        PCHECK(static_cast<bool>(io_handler->error_handler)) << "fd: " << io_handler->fd;
+        io_handler->error_handler();
+      }
       if (io_handler->fd == break_epoll_loop_fd_) { return; }
       if (cur_event->events & EPOLLIN) {
         if (cur_event->events & EPOLLRDHUP) {
@@ -30,6 +30,11 @@ class IOEventPoller final {
 
   void AddFd(int fd, std::function<void()> read_handler, std::function<void()> write_handler);
   void AddFdWithOnlyReadHandler(int fd, std::function<void()> read_handler);
+  // without an error handler EPOLLERR on fd is fatal
+  void SetErrorHandler(int fd, std::function<void()> error_handler);
+  // The fds added are closed by the destructor, except the ones deleted, which the caller closes.
+  // Only while the poller is stopped.
+  void DelFd(int fd);
 
   void Start();
   void Stop();
@@ -43,6 +48,7 @@ class IOEventPoller final {
     }
     std::function<void()> read_handler;
     std::function<void()> write_handler;
+    std::function<void()> error_handler;
     int fd;
   };
 
@@ -24,6 +24,7 @@ SocketHelper::SocketHelper(int sockfd, IOEventPoller* poller) {
   write_helper_ = new SocketWriteHelper(sockfd, poller);
   poller->AddFd(sockfd, [this]() { read_helper_->NotifyMeSocketReadable(); },
                 [this]() { write_helper_->NotifyMeSocketWriteable(); });
+  poller->SetErrorHandler(sockfd, [this]() { write_helper_->NotifyMeSocketError(); });
 }
 
 SocketHelper::~SocketHelper() {
@@ -34,6 +34,9 @@ class SocketHelper final {
 
   void AsyncWrite(const SocketMsg& msg);
 
+  const SocketReadHelper* read_helper() const { return read_helper_; }
+  const SocketWriteHelper* write_helper() const { return write_helper_; }
+
  private:
   SocketReadHelper* read_helper_;
   SocketWriteHelper* write_helper_;
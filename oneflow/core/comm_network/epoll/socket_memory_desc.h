@@ -16,15 +16,53 @@ limitations under the License.
 #ifndef ONEFLOW_CORE_COMM_NETWORK_EPOLL_SOCKET_MEMORY_DESC_H_
 #define ONEFLOW_CORE_COMM_NETWORK_EPOLL_SOCKET_MEMORY_DESC_H_
 
-#include "oneflow/core/comm_network/epoll/socket_memory_desc.h"
+#include "oneflow/core/common/util.h"
 
 #ifdef OF_PLATFORM_POSIX
 
 namespace oneflow {
 
 struct SocketMemDesc {
+  SocketMemDesc() : mem_ptr(nullptr), byte_size(0), zero_copy_pending_cnt_(0) {}
+
   void* mem_ptr;
   size_t byte_size;
+
+  // A zero copy send keeps reading the memory after the syscall returns, the memory must not be
+  // handed back to its producer before every such send is done.
+  void IncreaseZeroCopyPendingCnt() {
+    std::unique_lock<std::mutex> lck(zero_copy_mtx_);
+    zero_copy_pending_cnt_ += 1;
+  }
+  void DecreaseZeroCopyPendingCnt() {
+    std::vector<std::function<void()>> callbacks;
+    {
+      std::unique_lock<std::mutex> lck(zero_copy_mtx_);
+      CHECK_GT(zero_copy_pending_cnt_, 0);
+      zero_copy_pending_cnt_ -= 1;
+      if (zero_copy_pending_cnt_ == 0) { callbacks.swap(zero_copy_done_callbacks_); }
+    }
+    for (const auto& callback : callbacks) { callback(); }
+  }
+  bool HasZeroCopyPending() {
+    std::unique_lock<std::mutex> lck(zero_copy_mtx_);
+    return zero_copy_pending_cnt_ > 0;
+  }
+  void CallWhenZeroCopyDone(std::function<void()> callback) {
+    {
+      std::unique_lock<std::mutex> lck(zero_copy_mtx_);
+      if (zero_copy_pending_cnt_ > 0) {
+        zero_copy_done_callbacks_.push_back(std::move(callback));
+        return;
+      }
+    }
+    callback();
+  }
+
+ private:
+  std::mutex zero_copy_mtx_;
+  int64_t zero_copy_pending_cnt_;
+  std::vector<std::function<void()>> zero_copy_done_callbacks_;
 };
 
 }  // namespace oneflow
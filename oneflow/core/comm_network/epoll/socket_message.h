@@ -29,6 +29,7 @@ limitations under the License.
 #include <sys/epoll.h>
 #include <sys/socket.h>
 #include <sys/types.h>
+#include <sys/uio.h>
 #include <unistd.h>
 #include "oneflow/core/actor/actor_message.h"
 #include "oneflow/core/transport/transport_message.h"
@@ -58,6 +59,10 @@ struct RequestReadMsg {
   void* src_token;
   void* dst_token;
   void* read_id;
+  // the body is byte_size bytes at offset of the memory, one of part_num parts of the read
+  size_t offset;
+  size_t byte_size;
+  int64_t part_num;
 };
 
 struct SocketMsg {
@@ -16,6 +16,8 @@ limitations under the License.
 #include "oneflow/core/comm_network/epoll/socket_read_helper.h"
 #include "oneflow/core/actor/actor_message_bus.h"
 #include "oneflow/core/comm_network/epoll/epoll_comm_network.h"
+#include "oneflow/core/job/resource_desc.h"
+#include "oneflow/core/job/global_for.h"
 #include "oneflow/core/transport/transport.h"
 
 #ifdef OF_PLATFORM_POSIX
@@ -24,12 +26,39 @@ limitations under the License.
 
 namespace oneflow {
 
+namespace {
+
+constexpr size_t kReadBufSize = 64 * 1024;
+
+SocketMemDesc* ReleasedMemDesc4ActorMsg(const ActorMsg& msg) {
+  // a regst msg without comm net token goes back to the producer, whose regst lives here
+  if (msg.msg_type() != ActorMsgType::kRegstMsg || msg.comm_net_token() != nullptr) {
+    return nullptr;
+  }
+  return static_cast<SocketMemDesc*>(msg.regst()->comm_net_token());
+}
+
+SocketMemDesc* ReleasedMemDesc4TransportMsg(const TransportMsg& msg) {
+  if (msg.type != TransportMsgType::kAck) { return nullptr; }
+  return static_cast<SocketMemDesc*>(msg.src_mem_token);
+}
+
+}  // namespace
+
 SocketReadHelper::~SocketReadHelper() {
   // do nothing
 }
 
 SocketReadHelper::SocketReadHelper(int sockfd) {
   sockfd_ = sockfd;
+  read_buf_.resize(kReadBufSize);
+  read_buf_begin_ = 0;
+  read_buf_end_ = 0;
+  wait_zero_copy_sends_ =
+      Global<ResourceDesc, ForSession>::Get()->comm_net_send_mode() != kCommNetSendCopy;
+  read_msg_cnt_ = 0;
+  read_syscall_cnt_ = 0;
+  waited_msg_cnt_ = 0;
   SwitchToMsgHeadReadHandle();
 }
 
@@ -37,8 +66,8 @@ void SocketReadHelper::NotifyMeSocketReadable() { ReadUntilSocketNotReadable();
 
 void SocketReadHelper::SwitchToMsgHeadReadHandle() {
   cur_read_handle_ = &SocketReadHelper::MsgHeadReadHandle;
-  read_ptr_ = reinterpret_cast<char*>(&cur_msg_);
-  read_size_ = sizeof(cur_msg_);
+  read_ptr_ = nullptr;
+  read_size_ = 0;
 }
 
 void SocketReadHelper::ReadUntilSocketNotReadable() {
@@ -46,24 +75,65 @@ void SocketReadHelper::ReadUntilSocketNotReadable() {
 }
 
 bool SocketReadHelper::MsgHeadReadHandle() {
-  return DoCurRead(&SocketReadHelper::SetStatusWhenMsgHeadDone);
+  if (read_buf_end_ - read_buf_begin_ >= sizeof(SocketMsg)) {
+    memcpy(&cur_msg_, read_buf_.data() + read_buf_begin_, sizeof(SocketMsg));
+    read_buf_begin_ += sizeof(SocketMsg);
+    read_msg_cnt_ += 1;
+    SetStatusWhenMsgHeadDone();
+    return true;
+  }
+  // move the partial head to the front and fill the rest of the buffer
+  std::copy(read_buf_.data() + read_buf_begin_, read_buf_.data() + read_buf_end_,
+            read_buf_.data());
+  read_buf_end_ -= read_buf_begin_;
+  read_buf_begin_ = 0;
+  iovec buf_iovec;
+  buf_iovec.iov_base = read_buf_.data() + read_buf_end_;
+  buf_iovec.iov_len = read_buf_.size() - read_buf_end_;
+  size_t n = 0;
+  if (!DoRead(&buf_iovec, 1, &n)) { return false; }
+  read_buf_end_ += n;
+  return true;
 }
 
 bool SocketReadHelper::MsgBodyReadHandle() {
-  return DoCurRead(&SocketReadHelper::SetStatusWhenMsgBodyDone);
+  if (read_buf_end_ > read_buf_begin_) {
+    const size_t n = std::min(read_size_, read_buf_end_ - read_buf_begin_);
+    memcpy(read_ptr_, read_buf_.data() + read_buf_begin_, n);
+    read_buf_begin_ += n;
+    read_ptr_ += n;
+    read_size_ -= n;
+  } else {
+    // the buffer is empty, read the rest of the body in place and the following heads into the
+    // buffer with the same syscall
+    iovec iovecs[2];
+    iovecs[0].iov_base = read_ptr_;
+    iovecs[0].iov_len = read_size_;
+    iovecs[1].iov_base = read_buf_.data();
+    iovecs[1].iov_len = read_buf_.size();
+    size_t n = 0;
+    if (!DoRead(iovecs, 2, &n)) { return false; }
+    read_buf_begin_ = 0;
+    read_buf_end_ = n > read_size_ ? n - read_size_ : 0;
+    n = std::min(n, read_size_);
+    read_ptr_ += n;
+    read_size_ -= n;
+  }
+  if (read_size_ == 0) { SetStatusWhenMsgBodyDone(); }
+  return true;
 }
 
-bool SocketReadHelper::DoCurRead(void (SocketReadHelper::*set_cur_read_done)()) {
-  ssize_t n = read(sockfd_, read_ptr_, read_size_);
+bool SocketReadHelper::DoRead(iovec* iovecs, int iovec_num, size_t* read_size) {
+  ssize_t n = readv(sockfd_, iovecs, iovec_num);
   const int val = 1;
   PCHECK(setsockopt(sockfd_, IPPROTO_TCP, TCP_QUICKACK, (char*)&val, sizeof(int)) == 0);
-  if (n == read_size_) {
-    (this->*set_cur_read_done)();
-    return true;
-  } else if (n >= 0) {
-    read_ptr_ += n;
-    read_size_ -= n;
+  if (n > 0) {
+    read_syscall_cnt_ += 1;
+    *read_size = n;
     return true;
+  } else if (n == 0) {
+    // peer closed
+    return false;
   } else {
     CHECK_EQ(n, -1);
     PCHECK(errno == EAGAIN || errno == EWOULDBLOCK);
@@ -83,39 +153,85 @@ void SocketReadHelper::SetStatusWhenMsgHeadDone() {
 
 void SocketReadHelper::SetStatusWhenMsgBodyDone() {
   if (cur_msg_.msg_type == SocketMsgType::kRequestRead) {
-    Global<EpollCommNet>::Get()->ReadDone(cur_msg_.request_read_msg.read_id);
+    Global<EpollCommNet>::Get()->PartReadDone(cur_msg_.request_read_msg.read_id,
+                                              cur_msg_.request_read_msg.part_num);
   }
   SwitchToMsgHeadReadHandle();
 }
 
 void SocketReadHelper::SetStatusWhenRequestWriteMsgHeadDone() {
-  SocketMsg msg_to_send;
-  msg_to_send.msg_type = SocketMsgType::kRequestRead;
-  msg_to_send.request_read_msg.src_token = cur_msg_.request_write_msg.src_token;
-  msg_to_send.request_read_msg.dst_token = cur_msg_.request_write_msg.dst_token;
-  msg_to_send.request_read_msg.read_id = cur_msg_.request_write_msg.read_id;
-  Global<EpollCommNet>::Get()->SendSocketMsg(cur_msg_.request_write_msg.dst_machine_id,
-                                             msg_to_send);
+  RequestReadMsg request_read_msg;
+  request_read_msg.src_token = cur_msg_.request_write_msg.src_token;
+  request_read_msg.dst_token = cur_msg_.request_write_msg.dst_token;
+  request_read_msg.read_id = cur_msg_.request_write_msg.read_id;
+  Global<EpollCommNet>::Get()->SendRequestReadMsg(cur_msg_.request_write_msg.dst_machine_id,
+                                                  request_read_msg);
   SwitchToMsgHeadReadHandle();
 }
 
 void SocketReadHelper::SetStatusWhenRequestReadMsgHeadDone() {
   auto mem_desc = static_cast<const SocketMemDesc*>(cur_msg_.request_read_msg.dst_token);
-  read_ptr_ = reinterpret_cast<char*>(mem_desc->mem_ptr);
-  read_size_ = mem_desc->byte_size;
-  cur_read_handle_ = &SocketReadHelper::MsgBodyReadHandle;
+  CHECK_LE(cur_msg_.request_read_msg.offset + cur_msg_.request_read_msg.byte_size,
+           mem_desc->byte_size);
+  read_ptr_ = reinterpret_cast<char*>(mem_desc->mem_ptr) + cur_msg_.request_read_msg.offset;
+  read_size_ = cur_msg_.request_read_msg.byte_size;
+  if (read_size_ == 0) {
+    SetStatusWhenMsgBodyDone();
+  } else {
+    cur_read_handle_ = &SocketReadHelper::MsgBodyReadHandle;
+  }
 }
 
 void SocketReadHelper::SetStatusWhenActorMsgHeadDone() {
-  Global<ActorMsgBus>::Get()->SendMsgWithoutCommNet(cur_msg_.actor_msg);
+  if (wait_zero_copy_sends_) {
+    const ActorMsg actor_msg = cur_msg_.actor_msg;
+    DeliverMsg(ReleasedMemDesc4ActorMsg(actor_msg),
+               [actor_msg]() { Global<ActorMsgBus>::Get()->SendMsgWithoutCommNet(actor_msg); });
+  } else {
+    Global<ActorMsgBus>::Get()->SendMsgWithoutCommNet(cur_msg_.actor_msg);
+  }
   SwitchToMsgHeadReadHandle();
 }
 
 void SocketReadHelper::SetStatusWhenTransportMsgHeadDone() {
-  Global<Transport>::Get()->EnqueueTransportMsg(cur_msg_.transport_msg);
+  if (wait_zero_copy_sends_) {
+    const TransportMsg transport_msg = cur_msg_.transport_msg;
+    DeliverMsg(ReleasedMemDesc4TransportMsg(transport_msg), [transport_msg]() {
+      Global<Transport>::Get()->EnqueueTransportMsg(transport_msg);
+    });
+  } else {
+    Global<Transport>::Get()->EnqueueTransportMsg(cur_msg_.transport_msg);
+  }
   SwitchToMsgHeadReadHandle();
 }
 
+void SocketReadHelper::DeliverMsg(SocketMemDesc* released_mem_desc,
+                                  std::function<void()> Deliver) {
+  {
+    std::unique_lock<std::mutex> lck(waiting_msgs_mtx_);
+    if (waiting_msgs_.empty()
+        && (released_mem_desc == nullptr || !released_mem_desc->HasZeroCopyPending())) {
+      Deliver();
+      return;
+    }
+    waiting_msgs_.emplace_back(released_mem_desc, std::move(Deliver));
+    waited_msg_cnt_ += 1;
+  }
+  if (released_mem_desc != nullptr) {
+    released_mem_desc->CallWhenZeroCopyDone(std::bind(&SocketReadHelper::DeliverReadyMsgs, this));
+  }
+}
+
+void SocketReadHelper::DeliverReadyMsgs() {
+  std::unique_lock<std::mutex> lck(waiting_msgs_mtx_);
+  while (!waiting_msgs_.empty()) {
+    SocketMemDesc* released_mem_desc = waiting_msgs_.front().first;
+    if (released_mem_desc != nullptr && released_mem_desc->HasZeroCopyPending()) { break; }
+    waiting_msgs_.front().second();
+    waiting_msgs_.pop_front();
+  }
+}
+
 }  // namespace oneflow
 
 #endif  // OF_PLATFORM_POSIX
@@ -16,6 +16,7 @@ limitations under the License.
 #ifndef ONEFLOW_CORE_COMM_NETWORK_EPOLL_SOCKET_READ_HELPER_H_
 #define ONEFLOW_CORE_COMM_NETWORK_EPOLL_SOCKET_READ_HELPER_H_
 
+#include "oneflow/core/comm_network/epoll/socket_memory_desc.h"
 #include "oneflow/core/comm_network/epoll/socket_message.h"
 
 #ifdef OF_PLATFORM_POSIX
@@ -32,6 +33,11 @@ class SocketReadHelper final {
 
   void NotifyMeSocketReadable();
 
+  // only valid after the poller stopped
+  int64_t read_msg_cnt() const { return read_msg_cnt_; }
+  int64_t read_syscall_cnt() const { return read_syscall_cnt_; }
+  int64_t waited_msg_cnt() const { return waited_msg_cnt_; }
+
  private:
   void SwitchToMsgHeadReadHandle();
   void ReadUntilSocketNotReadable();
@@ -39,7 +45,8 @@ class SocketReadHelper final {
   bool MsgHeadReadHandle();
   bool MsgBodyReadHandle();
 
-  bool DoCurRead(void (SocketReadHelper::*set_cur_read_done)());
+  // returns false if the socket is not readable
+  bool DoRead(iovec* iovecs, int iovec_num, size_t* read_size);
   void SetStatusWhenMsgHeadDone();
   void SetStatusWhenMsgBodyDone();
 
@@ -47,12 +54,31 @@ class SocketReadHelper final {
   OF_PP_FOR_EACH_TUPLE(MAKE_ENTRY, SOCKET_MSG_TYPE_SEQ);
 #undef MAKE_ENTRY
 
+  // released_mem_desc is memory of this machine the msg hands back, a zero copy send may still be
+  // reading it
+  void DeliverMsg(SocketMemDesc* released_mem_desc, std::function<void()> Deliver);
+  void DeliverReadyMsgs();
+
   int sockfd_;
 
   SocketMsg cur_msg_;
   bool (SocketReadHelper::*cur_read_handle_)();
   char* read_ptr_;
   size_t read_size_;
+
+  // heads arrive back to back, one read takes in as many as fit
+  std::vector<char> read_buf_;
+  size_t read_buf_begin_;
+  size_t read_buf_end_;
+
+  // msgs behind one that waits for zero copy sends wait too, so that they keep their order
+  bool wait_zero_copy_sends_;
+  std::mutex waiting_msgs_mtx_;
+  std::deque<std::pair<SocketMemDesc*, std::function<void()>>> waiting_msgs_;
+
+  int64_t read_msg_cnt_;
+  int64_t read_syscall_cnt_;
+  int64_t waited_msg_cnt_;
 };
 
 }  // namespace oneflow
@@ -14,14 +14,42 @@ See the License for the specific language governing permissions and
 limitations under the License.
 */
 #include "oneflow/core/comm_network/epoll/socket_write_helper.h"
-#include "oneflow/core/comm_network/epoll/socket_memory_desc.h"
+#include "oneflow/core/job/resource_desc.h"
+#include "oneflow/core/job/global_for.h"
 
 #ifdef OF_PLATFORM_POSIX
 
+#include <limits.h>
+#include <linux/errqueue.h>
+#include <linux/sockios.h>
 #include <sys/eventfd.h>
+#include <sys/ioctl.h>
+#include <sys/timerfd.h>
+
+// older headers lack the MSG_ZEROCOPY definitions, the values are part of the kernel abi
+#ifndef SO_ZEROCOPY
+#define SO_ZEROCOPY 60
+#endif
+#ifndef MSG_ZEROCOPY
+#define MSG_ZEROCOPY 0x4000000
+#endif
+#ifndef SO_EE_ORIGIN_ZEROCOPY
+#define SO_EE_ORIGIN_ZEROCOPY 5
+#endif
+#ifndef SO_EE_CODE_ZEROCOPY_COPIED
+#define SO_EE_CODE_ZEROCOPY_COPIED 1
+#endif
 
 namespace oneflow {
 
+namespace {
+
+constexpr size_t kMaxBatchMsgNum = 64;
+constexpr int kPipeByteSize = 1024 * 1024;
+constexpr long kAckTimerIntervalNs = 1000 * 1000;
+
+}  // namespace
+
 SocketWriteHelper::~SocketWriteHelper() {
   delete cur_msg_queue_;
   cur_msg_queue_ = nullptr;
@@ -30,19 +58,71 @@ SocketWriteHelper::~SocketWriteHelper() {
     delete pending_msg_queue_;
     pending_msg_queue_ = nullptr;
   }
+  if (send_mode_ == kCommNetSendVmsplice) {
+    PCHECK(close(pipe_fds_[0]) == 0);
+    PCHECK(close(pipe_fds_[1]) == 0);
+  }
+  if (ack_timer_fd_ != -1) {
+    // taken back from the poller, which would close it when deleted
+    poller_->DelFd(ack_timer_fd_);
+    PCHECK(close(ack_timer_fd_) == 0);
+  }
 }
 
 SocketWriteHelper::SocketWriteHelper(int sockfd, IOEventPoller* poller) {
   sockfd_ = sockfd;
+  poller_ = poller;
   queue_not_empty_fd_ = eventfd(0, 0);
   PCHECK(queue_not_empty_fd_ != -1);
   poller->AddFdWithOnlyReadHandler(queue_not_empty_fd_,
                                    std::bind(&SocketWriteHelper::ProcessQueueNotEmptyEvent, this));
   cur_msg_queue_ = new std::queue<SocketMsg>;
   pending_msg_queue_ = new std::queue<SocketMsg>;
+  // the iovecs point into batch_msgs_, which must never reallocate
+  batch_msgs_.reserve(kMaxBatchMsgNum);
+  batch_iovecs_.reserve(kMaxBatchMsgNum * 2);
+  batch_iovec_zero_copy_mem_descs_.reserve(kMaxBatchMsgNum * 2);
+  cur_iovec_idx_ = 0;
   cur_write_handle_ = &SocketWriteHelper::InitMsgWriteHandle;
-  write_ptr_ = nullptr;
-  write_size_ = 0;
+  send_mode_ = Global<ResourceDesc, ForSession>::Get()->comm_net_send_mode();
+  zero_copy_min_byte_size_ =
+      Global<ResourceDesc, ForSession>::Get()->comm_net_zero_copy_min_byte_size();
+  sent_byte_size_ = 0;
+  next_zero_copy_seq_ = 0;
+  pipe_fds_[0] = -1;
+  pipe_fds_[1] = -1;
+  pipe_byte_size_ = 0;
+  ack_timer_fd_ = -1;
+  is_ack_timer_armed_ = false;
+  written_msg_cnt_ = 0;
+  write_syscall_cnt_ = 0;
+  zero_copy_send_cnt_ = 0;
+  zero_copy_copied_cnt_ = 0;
+  if (send_mode_ == kCommNetSendMsgZeroCopy) { InitMsgZeroCopy(); }
+  if (send_mode_ == kCommNetSendVmsplice) {
+    InitVmsplice();
+    poller->AddFdWithOnlyReadHandler(ack_timer_fd_,
+                                     std::bind(&SocketWriteHelper::ProcessAckTimerEvent, this));
+  }
+}
+
+void SocketWriteHelper::InitMsgZeroCopy() {
+  const int val = 1;
+  if (setsockopt(sockfd_, SOL_SOCKET, SO_ZEROCOPY, &val, sizeof(val)) == 0) { return; }
+  LOG(WARNING) << "sockfd " << sockfd_ << " does not support MSG_ZEROCOPY (" << strerror(errno)
+               << "), use vmsplice instead";
+  send_mode_ = kCommNetSendVmsplice;
+}
+
+void SocketWriteHelper::InitVmsplice() {
+  PCHECK(pipe2(pipe_fds_, O_NONBLOCK | O_CLOEXEC) == 0);
+  // a larger pipe takes more pages per vmsplice, keep the default size if the limit forbids it
+  if (fcntl(pipe_fds_[1], F_SETPIPE_SZ, kPipeByteSize) == -1) {
+    LOG(WARNING) << "can not grow the vmsplice pipe to " << kPipeByteSize << " bytes ("
+                 << strerror(errno) << ")";
+  }
+  ack_timer_fd_ = timerfd_create(CLOCK_MONOTONIC, TFD_NONBLOCK | TFD_CLOEXEC);
+  PCHECK(ack_timer_fd_ != -1);
 }
 
 void SocketWriteHelper::AsyncWrite(const SocketMsg& msg) {
@@ -55,6 +135,39 @@ void SocketWriteHelper::AsyncWrite(const SocketMsg& msg) {
 
 void SocketWriteHelper::NotifyMeSocketWriteable() { WriteUntilMsgQueueEmptyOrSocketNotWriteable(); }
 
+void SocketWriteHelper::NotifyMeSocketError() {
+  // MSG_ZEROCOPY completions are queued on the error queue of the socket
+  while (true) {
+    char control[128];
+    msghdr msg_hdr;
+    memset(&msg_hdr, 0, sizeof(msg_hdr));
+    msg_hdr.msg_control = control;
+    msg_hdr.msg_controllen = sizeof(control);
+    if (recvmsg(sockfd_, &msg_hdr, MSG_ERRQUEUE) == -1) {
+      PCHECK(errno == EAGAIN || errno == EWOULDBLOCK);
+      break;
+    }
+    for (cmsghdr* cm = CMSG_FIRSTHDR(&msg_hdr); cm != nullptr; cm = CMSG_NXTHDR(&msg_hdr, cm)) {
+      if (!(cm->cmsg_level == SOL_IP && cm->cmsg_type == IP_RECVERR)
+          && !(cm->cmsg_level == SOL_IPV6 && cm->cmsg_type == IPV6_RECVERR)) {
+        continue;
+      }
+      const auto* err = reinterpret_cast<const sock_extended_err*>(CMSG_DATA(cm));
+      CHECK_EQ(err->ee_errno, 0) << "sockfd " << sockfd_ << ": " << strerror(err->ee_errno);
+      CHECK_EQ(err->ee_origin, SO_EE_ORIGIN_ZEROCOPY);
+      // the kernel copied the data anyway, e.g. on loopback
+      if (err->ee_code & SO_EE_CODE_ZEROCOPY_COPIED) {
+        zero_copy_copied_cnt_ += err->ee_data - err->ee_info + 1;
+      }
+      CompleteZeroCopySends(err->ee_info, err->ee_data);
+    }
+  }
+  int sock_err = 0;
+  socklen_t len = sizeof(sock_err);
+  PCHECK(getsockopt(sockfd_, SOL_SOCKET, SO_ERROR, &sock_err, &len) == 0);
+  CHECK_EQ(sock_err, 0) << "sockfd " << sockfd_ << ": " << strerror(sock_err);
+}
+
 void SocketWriteHelper::SendQueueNotEmptyEvent() {
   uint64_t event_num = 1;
   PCHECK(write(queue_not_empty_fd_, &event_num, 8) == 8);
@@ -78,70 +191,215 @@ bool SocketWriteHelper::InitMsgWriteHandle() {
     }
     if (cur_msg_queue_->empty()) { return false; }
   }
-  cur_msg_ = cur_msg_queue_->front();
-  cur_msg_queue_->pop();
-  write_ptr_ = reinterpret_cast<const char*>(&cur_msg_);
-  write_size_ = sizeof(cur_msg_);
-  cur_write_handle_ = &SocketWriteHelper::MsgHeadWriteHandle;
+  batch_msgs_.clear();
+  batch_iovecs_.clear();
+  batch_iovec_zero_copy_mem_descs_.clear();
+  cur_iovec_idx_ = 0;
+  while (!cur_msg_queue_->empty() && batch_msgs_.size() < kMaxBatchMsgNum) {
+    AppendMsgToBatch(cur_msg_queue_->front());
+    cur_msg_queue_->pop();
+  }
+  cur_write_handle_ = &SocketWriteHelper::BatchWriteHandle;
   return true;
 }
 
-bool SocketWriteHelper::MsgHeadWriteHandle() {
-  return DoCurWrite(&SocketWriteHelper::SetStatusWhenMsgHeadDone);
-}
-
-bool SocketWriteHelper::MsgBodyWriteHandle() {
-  return DoCurWrite(&SocketWriteHelper::SetStatusWhenMsgBodyDone);
+bool SocketWriteHelper::BatchWriteHandle() {
+  if (pipe_byte_size_ > 0) {
+    if (!SplicePipeToSocket()) { return false; }
+  } else {
+    if (!WriteIovecs()) { return false; }
+  }
+  if (cur_iovec_idx_ == batch_iovecs_.size() && pipe_byte_size_ == 0) {
+    written_msg_cnt_ += batch_msgs_.size();
+    cur_write_handle_ = &SocketWriteHelper::InitMsgWriteHandle;
+  }
+  return true;
 }
 
-bool SocketWriteHelper::DoCurWrite(void (SocketWriteHelper::*set_cur_write_done)()) {
-  ssize_t n = write(sockfd_, write_ptr_, write_size_);
-  if (n == write_size_) {
-    (this->*set_cur_write_done)();
-    return true;
-  } else if (n >= 0) {
-    write_ptr_ += n;
-    write_size_ -= n;
+bool SocketWriteHelper::WriteIovecs() {
+  // one syscall takes either only copied iovecs or only zero copy ones
+  const bool is_zero_copy = batch_iovec_zero_copy_mem_descs_.at(cur_iovec_idx_) != nullptr;
+  size_t end_iovec_idx = cur_iovec_idx_ + 1;
+  while (end_iovec_idx < batch_iovecs_.size()
+         && (batch_iovec_zero_copy_mem_descs_.at(end_iovec_idx) != nullptr) == is_zero_copy) {
+    end_iovec_idx += 1;
+  }
+  iovec* iovecs = batch_iovecs_.data() + cur_iovec_idx_;
+  const size_t iovec_num = std::min<size_t>(end_iovec_idx - cur_iovec_idx_, IOV_MAX);
+  if (is_zero_copy && send_mode_ == kCommNetSendVmsplice) {
+    ssize_t n = vmsplice(pipe_fds_[1], iovecs, iovec_num, SPLICE_F_NONBLOCK);
+    PCHECK(n > 0);
+    write_syscall_cnt_ += 1;
+    pipe_byte_size_ += n;
+    AdvanceIovecs(n, &pipe_mem_descs_);
     return true;
-  } else {
+  }
+  msghdr msg_hdr;
+  memset(&msg_hdr, 0, sizeof(msg_hdr));
+  msg_hdr.msg_iov = iovecs;
+  msg_hdr.msg_iovlen = iovec_num;
+  bool is_msg_zero_copy = is_zero_copy;
+  ssize_t n = sendmsg(sockfd_, &msg_hdr, is_msg_zero_copy ? MSG_ZEROCOPY : 0);
+  if (n == -1 && errno == ENOBUFS && is_msg_zero_copy) {
+    // too many zero copy sends in flight for the socket option memory, copy this one
+    is_msg_zero_copy = false;
+    n = sendmsg(sockfd_, &msg_hdr, 0);
+  }
+  if (n < 0) {
     CHECK_EQ(n, -1);
     PCHECK(errno == EAGAIN || errno == EWOULDBLOCK);
     return false;
   }
+  write_syscall_cnt_ += 1;
+  sent_byte_size_ += n;
+  if (is_msg_zero_copy) {
+    std::vector<SocketMemDesc*>* mem_descs = &zero_copy_seq2mem_descs_[next_zero_copy_seq_];
+    next_zero_copy_seq_ += 1;
+    AdvanceIovecs(n, mem_descs);
+  } else {
+    AdvanceIovecs(n, nullptr);
+  }
+  return true;
+}
+
+void SocketWriteHelper::AdvanceIovecs(size_t size,
+                                      std::vector<SocketMemDesc*>* zero_copy_mem_descs) {
+  while (size > 0) {
+    iovec* cur_iovec = &batch_iovecs_.at(cur_iovec_idx_);
+    SocketMemDesc* mem_desc = batch_iovec_zero_copy_mem_descs_.at(cur_iovec_idx_);
+    if (zero_copy_mem_descs != nullptr) {
+      // the kernel holds the pages of mem_desc until this syscall is completed
+      CHECK_NOTNULL(mem_desc)->IncreaseZeroCopyPendingCnt();
+      zero_copy_mem_descs->push_back(mem_desc);
+    }
+    if (size >= cur_iovec->iov_len) {
+      size -= cur_iovec->iov_len;
+      cur_iovec_idx_ += 1;
+      if (mem_desc != nullptr) { zero_copy_send_cnt_ += 1; }
+    } else {
+      cur_iovec->iov_base = static_cast<char*>(cur_iovec->iov_base) + size;
+      cur_iovec->iov_len -= size;
+      size = 0;
+    }
+  }
+}
+
+void SocketWriteHelper::CompleteZeroCopySends(uint32_t first_seq, uint32_t last_seq) {
+  // the range is inclusive and may wrap around
+  for (uint32_t seq = first_seq;; ++seq) {
+    auto it = zero_copy_seq2mem_descs_.find(seq);
+    CHECK(it != zero_copy_seq2mem_descs_.end()) << "sockfd " << sockfd_ << " seq " << seq;
+    for (SocketMemDesc* mem_desc : it->second) { mem_desc->DecreaseZeroCopyPendingCnt(); }
+    zero_copy_seq2mem_descs_.erase(it);
+    if (seq == last_seq) { break; }
+  }
+}
+
+bool SocketWriteHelper::SplicePipeToSocket() {
+  while (pipe_byte_size_ > 0) {
+    ssize_t n = splice(pipe_fds_[0], nullptr, sockfd_, nullptr, pipe_byte_size_,
+                       SPLICE_F_MOVE | SPLICE_F_NONBLOCK | SPLICE_F_MORE);
+    if (n < 0) {
+      CHECK_EQ(n, -1);
+      PCHECK(errno == EAGAIN || errno == EWOULDBLOCK);
+      return false;
+    }
+    write_syscall_cnt_ += 1;
+    pipe_byte_size_ -= n;
+    sent_byte_size_ += n;
+  }
+  for (SocketMemDesc* mem_desc : pipe_mem_descs_) {
+    unacked_mem_descs_.emplace_back(sent_byte_size_, mem_desc);
+  }
+  pipe_mem_descs_.clear();
+  ReleaseAckedMemDescs();
+  return true;
 }
 
-void SocketWriteHelper::SetStatusWhenMsgHeadDone() {
-  switch (cur_msg_.msg_type) {
+void SocketWriteHelper::ProcessAckTimerEvent() {
+  uint64_t expiration_num = 0;
+  if (read(ack_timer_fd_, &expiration_num, 8) == -1) { PCHECK(errno == EAGAIN); }
+  ReleaseAckedMemDescs();
+}
+
+void SocketWriteHelper::ReleaseAckedMemDescs() {
+  if (!unacked_mem_descs_.empty()) {
+    // SIOCOUTQ counts the bytes in the socket the peer has not acked yet
+    int unacked_byte_size = 0;
+    PCHECK(ioctl(sockfd_, SIOCOUTQ, &unacked_byte_size) == 0);
+    const uint64_t acked_byte_size = sent_byte_size_ - unacked_byte_size;
+    while (!unacked_mem_descs_.empty() && unacked_mem_descs_.front().first <= acked_byte_size) {
+      unacked_mem_descs_.front().second->DecreaseZeroCopyPendingCnt();
+      unacked_mem_descs_.pop_front();
+    }
+  }
+  // acks do not wake the poller, check on a timer while some bodies wait for them
+  SetAckTimer(!unacked_mem_descs_.empty());
+}
+
+void SocketWriteHelper::SetAckTimer(bool armed) {
+  if (armed == is_ack_timer_armed_) { return; }
+  itimerspec spec;
+  memset(&spec, 0, sizeof(spec));
+  if (armed) {
+    spec.it_value.tv_nsec = kAckTimerIntervalNs;
+    spec.it_interval.tv_nsec = kAckTimerIntervalNs;
+  }
+  PCHECK(timerfd_settime(ack_timer_fd_, 0, &spec, nullptr) == 0);
+  is_ack_timer_armed_ = armed;
+}
+
+void SocketWriteHelper::AppendMsgToBatch(const SocketMsg& msg) {
+  batch_msgs_.push_back(msg);
+  AppendIovec(&batch_msgs_.back(), sizeof(SocketMsg), nullptr);
+  switch (msg.msg_type) {
 #define MAKE_ENTRY(x, y) \
-  case SocketMsgType::k##x: return SetStatusWhen##x##MsgHeadDone();
+  case SocketMsgType::k##x: return Append##x##MsgBody(batch_msgs_.back());
     OF_PP_FOR_EACH_TUPLE(MAKE_ENTRY, SOCKET_MSG_TYPE_SEQ);
 #undef MAKE_ENTRY
     default: UNIMPLEMENTED();
   }
 }
 
-void SocketWriteHelper::SetStatusWhenMsgBodyDone() {
-  cur_write_handle_ = &SocketWriteHelper::InitMsgWriteHandle;
+void SocketWriteHelper::AppendIovec(const void* ptr, size_t size,
+                                    SocketMemDesc* zero_copy_mem_desc) {
+  if (size == 0) { return; }
+  if (!batch_iovecs_.empty() && zero_copy_mem_desc == nullptr
+      && batch_iovec_zero_copy_mem_descs_.back() == nullptr) {
+    // consecutive heads are adjacent in batch_msgs_ and share one iovec
+    iovec* last = &batch_iovecs_.back();
+    if (static_cast<const char*>(last->iov_base) + last->iov_len == ptr) {
+      last->iov_len += size;
+      return;
+    }
+  }
+  iovec cur_iovec;
+  cur_iovec.iov_base = const_cast<void*>(ptr);
+  cur_iovec.iov_len = size;
+  batch_iovecs_.push_back(cur_iovec);
+  batch_iovec_zero_copy_mem_descs_.push_back(zero_copy_mem_desc);
 }
 
-void SocketWriteHelper::SetStatusWhenRequestWriteMsgHeadDone() {
-  cur_write_handle_ = &SocketWriteHelper::InitMsgWriteHandle;
+void SocketWriteHelper::AppendRequestWriteMsgBody(const SocketMsg& msg) {
+  // do nothing
 }
 
-void SocketWriteHelper::SetStatusWhenRequestReadMsgHeadDone() {
-  const void* src_token = cur_msg_.request_read_msg.src_token;
-  auto src_mem_desc = static_cast<const SocketMemDesc*>(src_token);
-  write_ptr_ = reinterpret_cast<const char*>(src_mem_desc->mem_ptr);
-  write_size_ = src_mem_desc->byte_size;
-  cur_write_handle_ = &SocketWriteHelper::MsgBodyWriteHandle;
+void SocketWriteHelper::AppendRequestReadMsgBody(const SocketMsg& msg) {
+  auto src_mem_desc = static_cast<SocketMemDesc*>(msg.request_read_msg.src_token);
+  const size_t byte_size = msg.request_read_msg.byte_size;
+  CHECK_LE(msg.request_read_msg.offset + byte_size, src_mem_desc->byte_size);
+  const bool is_zero_copy =
+      send_mode_ != kCommNetSendCopy && byte_size >= zero_copy_min_byte_size_;
+  AppendIovec(static_cast<char*>(src_mem_desc->mem_ptr) + msg.request_read_msg.offset, byte_size,
+              is_zero_copy ? src_mem_desc : nullptr);
 }
 
-void SocketWriteHelper::SetStatusWhenActorMsgHeadDone() {
-  cur_write_handle_ = &SocketWriteHelper::InitMsgWriteHandle;
+void SocketWriteHelper::AppendActorMsgBody(const SocketMsg& msg) {
+  // do nothing
 }
 
-void SocketWriteHelper::SetStatusWhenTransportMsgHeadDone() {
-  cur_write_handle_ = &SocketWriteHelper::InitMsgWriteHandle;
+void SocketWriteHelper::AppendTransportMsgBody(const SocketMsg& msg) {
+  // do nothing
 }
 
 }  // namespace oneflow
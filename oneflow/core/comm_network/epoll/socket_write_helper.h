@@ -17,7 +17,9 @@ limitations under the License.
 #define ONEFLOW_CORE_COMM_NETWORK_EPOLL_SOCKET_WRITE_HELPER_H_
 
 #include "oneflow/core/comm_network/epoll/io_event_poller.h"
+#include "oneflow/core/comm_network/epoll/socket_memory_desc.h"
 #include "oneflow/core/comm_network/epoll/socket_message.h"
+#include "oneflow/core/job/resource.pb.h"
 
 #ifdef OF_PLATFORM_POSIX
 
@@ -29,11 +31,19 @@ class SocketWriteHelper final {
   SocketWriteHelper() = delete;
   ~SocketWriteHelper();
 
+  // deleted before poller
   SocketWriteHelper(int sockfd, IOEventPoller* poller);
 
   void AsyncWrite(const SocketMsg& msg);
 
   void NotifyMeSocketWriteable();
+  void NotifyMeSocketError();
+
+  // only valid after the poller stopped
+  int64_t written_msg_cnt() const { return written_msg_cnt_; }
+  int64_t write_syscall_cnt() const { return write_syscall_cnt_; }
+  int64_t zero_copy_send_cnt() const { return zero_copy_send_cnt_; }
+  int64_t zero_copy_copied_cnt() const { return zero_copy_copied_cnt_; }
 
  private:
   void SendQueueNotEmptyEvent();
@@ -41,18 +51,27 @@ class SocketWriteHelper final {
 
   void WriteUntilMsgQueueEmptyOrSocketNotWriteable();
   bool InitMsgWriteHandle();
-  bool MsgHeadWriteHandle();
-  bool MsgBodyWriteHandle();
-
-  bool DoCurWrite(void (SocketWriteHelper::*set_cur_write_done)());
-  void SetStatusWhenMsgHeadDone();
-  void SetStatusWhenMsgBodyDone();
-
-#define MAKE_ENTRY(x, y) void SetStatusWhen##x##MsgHeadDone();
+  bool BatchWriteHandle();
+  bool WriteIovecs();
+  void AdvanceIovecs(size_t size, std::vector<SocketMemDesc*>* zero_copy_mem_descs);
+
+  void AppendMsgToBatch(const SocketMsg& msg);
+  void AppendIovec(const void* ptr, size_t size, SocketMemDesc* zero_copy_mem_desc);
+
+  void InitMsgZeroCopy();
+  void InitVmsplice();
+  void CompleteZeroCopySends(uint32_t first_seq, uint32_t last_seq);
+  bool SplicePipeToSocket();
+  void ProcessAckTimerEvent();
+  void ReleaseAckedMemDescs();
+  void SetAckTimer(bool armed);
+
+#define MAKE_ENTRY(x, y) void Append##x##MsgBody(const SocketMsg& msg);
   OF_PP_FOR_EACH_TUPLE(MAKE_ENTRY, SOCKET_MSG_TYPE_SEQ);
 #undef MAKE_ENTRY
 
   int sockfd_;
+  IOEventPoller* poller_;
   int queue_not_empty_fd_;
 
   std::queue<SocketMsg>* cur_msg_queue_;
@@ -60,10 +79,36 @@ class SocketWriteHelper final {
   std::mutex pending_msg_queue_mtx_;
   std::queue<SocketMsg>* pending_msg_queue_;
 
-  SocketMsg cur_msg_;
+  // messages written together by one sendmsg, each head followed by its body if it has one
+  std::vector<SocketMsg> batch_msgs_;
+  std::vector<iovec> batch_iovecs_;
+  // the memory batch_iovecs_[i] is sent from without copy, nullptr if it is copied
+  std::vector<SocketMemDesc*> batch_iovec_zero_copy_mem_descs_;
+  size_t cur_iovec_idx_;
   bool (SocketWriteHelper::*cur_write_handle_)();
-  const char* write_ptr_;
-  size_t write_size_;
+
+  CommNetSendMode send_mode_;
+  size_t zero_copy_min_byte_size_;
+  // total bytes handed to the socket
+  uint64_t sent_byte_size_;
+
+  // kCommNetSendMsgZeroCopy: the kernel numbers the zero copy sendmsg calls of a socket from 0
+  uint32_t next_zero_copy_seq_;
+  HashMap<uint32_t, std::vector<SocketMemDesc*>> zero_copy_seq2mem_descs_;
+
+  // kCommNetSendVmsplice: pages go through the pipe into the socket, and are done with once the
+  // peer acked the bytes up to the stream offset they were spliced at
+  int pipe_fds_[2];
+  size_t pipe_byte_size_;
+  std::vector<SocketMemDesc*> pipe_mem_descs_;
+  std::deque<std::pair<uint64_t, SocketMemDesc*>> unacked_mem_descs_;
+  int ack_timer_fd_;
+  bool is_ack_timer_armed_;
+
+  int64_t written_msg_cnt_;
+  int64_t write_syscall_cnt_;
+  int64_t zero_copy_send_cnt_;
+  int64_t zero_copy_copied_cnt_;
 };
 
 }  // namespace oneflow
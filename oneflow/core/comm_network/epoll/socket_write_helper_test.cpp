@@ -0,0 +1,165 @@
+/*
+Copyright 2020 The OneFlow Authors. All rights reserved.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+*/
+#include <gtest/gtest.h>
+#include <dirent.h>
+#include <random>
+#include "oneflow/core/comm_network/epoll/socket_write_helper.h"
+#include "oneflow/core/common/blocking_counter.h"
+#include "oneflow/core/job/global_for.h"
+#include "oneflow/core/job/resource_desc.h"
+
+#ifdef OF_PLATFORM_POSIX
+
+namespace oneflow {
+
+namespace {
+
+// the two ends of a tcp connection over loopback
+void ConnectLoopback(int* send_fd, int* recv_fd) {
+  const int listen_fd = socket(AF_INET, SOCK_STREAM, 0);
+  PCHECK(listen_fd != -1);
+  sockaddr_in addr{};
+  addr.sin_family = AF_INET;
+  addr.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+  addr.sin_port = 0;
+  PCHECK(bind(listen_fd, reinterpret_cast<sockaddr*>(&addr), sizeof(addr)) == 0);
+  PCHECK(listen(listen_fd, 1) == 0);
+  socklen_t addr_len = sizeof(addr);
+  PCHECK(getsockname(listen_fd, reinterpret_cast<sockaddr*>(&addr), &addr_len) == 0);
+  *send_fd = socket(AF_INET, SOCK_STREAM, 0);
+  PCHECK(*send_fd != -1);
+  PCHECK(connect(*send_fd, reinterpret_cast<sockaddr*>(&addr), sizeof(addr)) == 0);
+  *recv_fd = accept(listen_fd, nullptr, nullptr);
+  PCHECK(*recv_fd != -1);
+  PCHECK(close(listen_fd) == 0);
+}
+
+int64_t OpenFdNum() {
+  DIR* dir = opendir("/proc/self/fd");
+  PCHECK(dir != nullptr);
+  int64_t num = 0;
+  while (readdir(dir) != nullptr) { num += 1; }
+  PCHECK(closedir(dir) == 0);
+  return num;
+}
+
+void ReadFully(int fd, void* ptr, size_t size) {
+  char* cur = static_cast<char*>(ptr);
+  while (size > 0) {
+    const ssize_t n = read(fd, cur, size);
+    PCHECK(n > 0);
+    cur += n;
+    size -= n;
+  }
+}
+
+// Sends a head only msg and a regst body of each size, the ones of at least 4096 bytes without
+// copy unless send_mode is kCommNetSendCopy, and checks the peer gets them all in order.
+void CheckSendMode(CommNetSendMode send_mode) {
+  Resource resource;
+  resource.set_machine_num(1);
+  resource.set_cpu_device_num(1);
+  resource.set_comm_net_send_mode(send_mode);
+  resource.set_comm_net_zero_copy_min_byte_size(4096);
+  Global<ResourceDesc, ForSession>::New(resource);
+  const std::vector<size_t> body_sizes{16, 4096, 100, 1 << 20, 0, 3 << 20, 8192};
+  std::mt19937 gen(0);
+  std::vector<std::vector<char>> bodies;
+  for (const size_t size : body_sizes) {
+    std::vector<char> body(size);
+    for (char& c : body) { c = static_cast<char>(gen()); }
+    bodies.push_back(body);
+  }
+  std::vector<SocketMemDesc> mem_descs(bodies.size());
+  FOR_RANGE(size_t, i, 0, bodies.size()) {
+    mem_descs.at(i).mem_ptr = bodies.at(i).data();
+    mem_descs.at(i).byte_size = bodies.at(i).size();
+  }
+  const int64_t open_fd_num = OpenFdNum();
+  int send_fd = -1;
+  int recv_fd = -1;
+  ConnectLoopback(&send_fd, &recv_fd);
+  {
+    IOEventPoller poller;
+    SocketWriteHelper* write_helper = new SocketWriteHelper(send_fd, &poller);
+    poller.AddFd(send_fd, []() {}, [write_helper]() { write_helper->NotifyMeSocketWriteable(); });
+    poller.SetErrorHandler(send_fd, [write_helper]() { write_helper->NotifyMeSocketError(); });
+    poller.Start();
+    FOR_RANGE(size_t, i, 0, bodies.size()) {
+      SocketMsg msg;
+      memset(&msg, 0, sizeof(msg));
+      msg.msg_type = SocketMsgType::kRequestWrite;
+      msg.request_write_msg.read_id = reinterpret_cast<void*>(i);
+      write_helper->AsyncWrite(msg);
+      memset(&msg, 0, sizeof(msg));
+      msg.msg_type = SocketMsgType::kRequestRead;
+      msg.request_read_msg.src_token = &mem_descs.at(i);
+      msg.request_read_msg.read_id = reinterpret_cast<void*>(i);
+      msg.request_read_msg.byte_size = bodies.at(i).size();
+      msg.request_read_msg.part_num = 1;
+      write_helper->AsyncWrite(msg);
+    }
+    FOR_RANGE(size_t, i, 0, bodies.size()) {
+      SocketMsg msg;
+      ReadFully(recv_fd, &msg, sizeof(msg));
+      ASSERT_TRUE(msg.msg_type == SocketMsgType::kRequestWrite);
+      ASSERT_EQ(msg.request_write_msg.read_id, reinterpret_cast<void*>(i));
+      ReadFully(recv_fd, &msg, sizeof(msg));
+      ASSERT_TRUE(msg.msg_type == SocketMsgType::kRequestRead);
+      ASSERT_EQ(msg.request_read_msg.read_id, reinterpret_cast<void*>(i));
+      ASSERT_EQ(msg.request_read_msg.byte_size, bodies.at(i).size());
+      std::vector<char> body(msg.request_read_msg.byte_size);
+      ReadFully(recv_fd, body.data(), body.size());
+      ASSERT_TRUE(body == bodies.at(i)) << i;
+    }
+    // the bodies sent without copy are handed back once the kernel is done with them
+    BlockingCounter done_cnt(mem_descs.size());
+    for (SocketMemDesc& mem_desc : mem_descs) {
+      mem_desc.CallWhenZeroCopyDone([&done_cnt]() { done_cnt.Decrease(); });
+    }
+    done_cnt.WaitUntilCntEqualZero();
+    poller.Stop();
+    ASSERT_EQ(write_helper->written_msg_cnt(), bodies.size() * 2);
+    const int64_t zero_copy_body_num =
+        std::count_if(body_sizes.begin(), body_sizes.end(), [](size_t s) { return s >= 4096; });
+    if (send_mode == kCommNetSendCopy) {
+      ASSERT_EQ(write_helper->zero_copy_send_cnt(), 0);
+      // the heads are batched with the bodies
+      ASSERT_LT(write_helper->write_syscall_cnt(), bodies.size() * 2);
+    } else {
+      ASSERT_EQ(write_helper->zero_copy_send_cnt(), zero_copy_body_num);
+    }
+    delete write_helper;
+  }
+  // send_fd is closed by the poller
+  PCHECK(close(recv_fd) == 0);
+  // and the pipe and the timer of vmsplice by the helper
+  ASSERT_EQ(OpenFdNum(), open_fd_num);
+  Global<ResourceDesc, ForSession>::Delete();
+}
+
+}  // namespace
+
+TEST(SocketWriteHelper, copy) { CheckSendMode(kCommNetSendCopy); }
+
+// falls back to vmsplice where the socket does not support MSG_ZEROCOPY
+TEST(SocketWriteHelper, msg_zero_copy) { CheckSendMode(kCommNetSendMsgZeroCopy); }
+
+TEST(SocketWriteHelper, vmsplice) { CheckSendMode(kCommNetSendVmsplice); }
+
+}  // namespace oneflow
+
+#endif  // OF_PLATFORM_POSIX
@@ -0,0 +1,346 @@
+/*
+Copyright 2020 The OneFlow Authors. All rights reserved.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+*/
+#ifndef ONEFLOW_CORE_COMMON_CPU_SIMD_H_
+#define ONEFLOW_CORE_COMMON_CPU_SIMD_H_
+
+#include <cmath>
+#include <cstdint>
+#include <cstring>
+#include <algorithm>
+#include <limits>
+
+#if !defined(__CUDACC__)
+#if defined(__AVX512F__)
+#define OF_CPU_SIMD_AVX512
+#endif
+#if defined(__AVX2__) && defined(__FMA__)
+#define OF_CPU_SIMD_AVX2
+#endif
+#endif
+
+#if defined(OF_CPU_SIMD_AVX512) || defined(OF_CPU_SIMD_AVX2)
+#include <immintrin.h>
+#endif
+
+namespace oneflow {
+
+namespace simd {
+
+// The instruction set is chosen at build time by CPU_SIMD_ISA in cmake. SimdVec<T> is the
+// widest vector of T the build supports. Without avx2 it is a plain array the compiler lowers to
+// whatever the default target has (sse2 on x86_64).
+
+template<typename T, int N>
+struct PortableVec {
+  static const int kWidth = N;
+  struct Reg {
+    T v[N];
+  };
+
+  static Reg Zero() { return Set1(T(0)); }
+  static Reg Set1(T x) {
+    Reg r;
+    for (int i = 0; i < N; ++i) { r.v[i] = x; }
+    return r;
+  }
+  static Reg Load(const T* ptr) {
+    Reg r;
+    for (int i = 0; i < N; ++i) { r.v[i] = ptr[i]; }
+    return r;
+  }
+  static void Store(T* ptr, const Reg& a) {
+    for (int i = 0; i < N; ++i) { ptr[i] = a.v[i]; }
+  }
+#define OF_PORTABLE_VEC_BINARY_OP(name, expr)   \
+  static Reg name(const Reg& a, const Reg& b) { \
+    Reg r;                                      \
+    for (int i = 0; i < N; ++i) {               \
+      const T x = a.v[i];                       \
+      const T y = b.v[i];                       \
+      r.v[i] = (expr);                          \
+    }                                           \
+    return r;                                   \
+  }
+  OF_PORTABLE_VEC_BINARY_OP(Add, x + y);
+  OF_PORTABLE_VEC_BINARY_OP(Sub, x - y);
+  OF_PORTABLE_VEC_BINARY_OP(Mul, x* y);
+  OF_PORTABLE_VEC_BINARY_OP(Div, x / y);
+  OF_PORTABLE_VEC_BINARY_OP(Max, x > y ? x : y);
+  OF_PORTABLE_VEC_BINARY_OP(Min, x < y ? x : y);
+#undef OF_PORTABLE_VEC_BINARY_OP
+  // a * b + c
+  static Reg Fma(const Reg& a, const Reg& b, const Reg& c) { return Add(Mul(a, b), c); }
+  static Reg Sqrt(const Reg& a) {
+    Reg r;
+    for (int i = 0; i < N; ++i) { r.v[i] = std::sqrt(a.v[i]); }
+    return r;
+  }
+  // a < b ? x : y, false when a or b is nan
+  static Reg IfLess(const Reg& a, const Reg& b, const Reg& x, const Reg& y) {
+    Reg r;
+    for (int i = 0; i < N; ++i) { r.v[i] = a.v[i] < b.v[i] ? x.v[i] : y.v[i]; }
+    return r;
+  }
+  // to the nearest integer, ties to even, for |a| below 2^22 with float and 2^51 with double
+  static Reg Round(const Reg& a) {
+    const T magic = T(1.5) * (T(1) * (int64_t(1) << (std::numeric_limits<T>::digits - 1)));
+    Reg r;
+    for (int i = 0; i < N; ++i) { r.v[i] = (a.v[i] + magic) - magic; }
+    return r;
+  }
+  // 2^n for integral n within the exponents of normal numbers, nan for nan
+  static Reg Pow2(const Reg& n) {
+    Reg r;
+    for (int i = 0; i < N; ++i) { r.v[i] = Pow2Lane(n.v[i]); }
+    return r;
+  }
+  // floor(log2(a)) and a / 2^floor(log2(a)) in [1, 2), for a positive normal a
+  static Reg Exponent(const Reg& a) {
+    Reg r;
+    for (int i = 0; i < N; ++i) { r.v[i] = ExponentLane(a.v[i]); }
+    return r;
+  }
+  static Reg Mantissa(const Reg& a) {
+    Reg r;
+    for (int i = 0; i < N; ++i) { r.v[i] = MantissaLane(a.v[i]); }
+    return r;
+  }
+  static T ReduceAdd(const Reg& a) {
+    T r = a.v[0];
+    for (int i = 1; i < N; ++i) { r += a.v[i]; }
+    return r;
+  }
+  static T ReduceMul(const Reg& a) {
+    T r = a.v[0];
+    for (int i = 1; i < N; ++i) { r *= a.v[i]; }
+    return r;
+  }
+  static T ReduceMax(const Reg& a) {
+    T r = a.v[0];
+    for (int i = 1; i < N; ++i) { r = r > a.v[i] ? r : a.v[i]; }
+    return r;
+  }
+  static T ReduceMin(const Reg& a) {
+    T r = a.v[0];
+    for (int i = 1; i < N; ++i) { r = r < a.v[i] ? r : a.v[i]; }
+    return r;
+  }
+
+ private:
+  static float Pow2Lane(float n) {
+    if (n != n) { return n; }
+    const int32_t bits = (static_cast<int32_t>(n) + 127) << 23;
+    float r;
+    std::memcpy(&r, &bits, sizeof(r));
+    return r;
+  }
+  static double Pow2Lane(double n) {
+    if (n != n) { return n; }
+    const int64_t bits = (static_cast<int64_t>(n) + 1023) << 52;
+    double r;
+    std::memcpy(&r, &bits, sizeof(r));
+    return r;
+  }
+  static float ExponentLane(float a) {
+    uint32_t bits;
+    std::memcpy(&bits, &a, sizeof(bits));
+    return static_cast<float>(static_cast<int32_t>((bits >> 23) & 0xff) - 127);
+  }
+  static double ExponentLane(double a) {
+    uint64_t bits;
+    std::memcpy(&bits, &a, sizeof(bits));
+    return static_cast<double>(static_cast<int64_t>((bits >> 52) & 0x7ff) - 1023);
+  }
+  static float MantissaLane(float a) {
+    uint32_t bits;
+    std::memcpy(&bits, &a, sizeof(bits));
+    bits = (bits & 0x007fffffU) | 0x3f800000U;
+    float r;
+    std::memcpy(&r, &bits, sizeof(r));
+    return r;
+  }
+  static double MantissaLane(double a) {
+    uint64_t bits;
+    std::memcpy(&bits, &a, sizeof(bits));
+    bits = (bits & 0x000fffffffffffffULL) | 0x3ff0000000000000ULL;
+    double r;
+    std::memcpy(&r, &bits, sizeof(r));
+    return r;
+  }
+};
+
+template<typename T>
+struct SimdVec final : public PortableVec<T, 32 / sizeof(T)> {};
+
+// Max(a, b) and Min(a, b) keep the operand order of BinaryFuncMax and BinaryFuncMin:
+// the result is b if either side is nan. Pow2, Exponent and Mantissa, which cpu_simd_math.h needs
+// for float, are not there for the avx vectors of double.
+
+#if defined(OF_CPU_SIMD_AVX512)
+
+template<>
+struct SimdVec<float> final {
+  static const int kWidth = 16;
+  using Reg = __m512;
+  static Reg Zero() { return _mm512_setzero_ps(); }
+  static Reg Set1(float x) { return _mm512_set1_ps(x); }
+  static Reg Load(const float* ptr) { return _mm512_loadu_ps(ptr); }
+  static void Store(float* ptr, Reg a) { _mm512_storeu_ps(ptr, a); }
+  static Reg Add(Reg a, Reg b) { return _mm512_add_ps(a, b); }
+  static Reg Sub(Reg a, Reg b) { return _mm512_sub_ps(a, b); }
+  static Reg Mul(Reg a, Reg b) { return _mm512_mul_ps(a, b); }
+  static Reg Div(Reg a, Reg b) { return _mm512_div_ps(a, b); }
+  static Reg Max(Reg a, Reg b) { return _mm512_max_ps(a, b); }
+  static Reg Min(Reg a, Reg b) { return _mm512_min_ps(a, b); }
+  static Reg Fma(Reg a, Reg b, Reg c) { return _mm512_fmadd_ps(a, b, c); }
+  static Reg Sqrt(Reg a) { return _mm512_sqrt_ps(a); }
+  static Reg IfLess(Reg a, Reg b, Reg x, Reg y) {
+    return _mm512_mask_blend_ps(_mm512_cmp_ps_mask(a, b, _CMP_LT_OQ), y, x);
+  }
+  static Reg Round(Reg a) {
+    return _mm512_roundscale_ps(a, _MM_FROUND_TO_NEAREST_INT | _MM_FROUND_NO_EXC);
+  }
+  static Reg Pow2(Reg n) {
+    const __m512i e = _mm512_add_epi32(_mm512_cvtps_epi32(n), _mm512_set1_epi32(127));
+    return _mm512_castsi512_ps(_mm512_slli_epi32(e, 23));
+  }
+  static Reg Exponent(Reg a) { return _mm512_getexp_ps(a); }
+  static Reg Mantissa(Reg a) { return _mm512_getmant_ps(a, _MM_MANT_NORM_1_2, _MM_MANT_SIGN_src); }
+  static float ReduceAdd(Reg a) { return _mm512_reduce_add_ps(a); }
+  static float ReduceMul(Reg a) { return _mm512_reduce_mul_ps(a); }
+  static float ReduceMax(Reg a) { return _mm512_reduce_max_ps(a); }
+  static float ReduceMin(Reg a) { return _mm512_reduce_min_ps(a); }
+};
+
+template<>
+struct SimdVec<double> final {
+  static const int kWidth = 8;
+  using Reg = __m512d;
+  static Reg Zero() { return _mm512_setzero_pd(); }
+  static Reg Set1(double x) { return _mm512_set1_pd(x); }
+  static Reg Load(const double* ptr) { return _mm512_loadu_pd(ptr); }
+  static void Store(double* ptr, Reg a) { _mm512_storeu_pd(ptr, a); }
+  static Reg Add(Reg a, Reg b) { return _mm512_add_pd(a, b); }
+  static Reg Sub(Reg a, Reg b) { return _mm512_sub_pd(a, b); }
+  static Reg Mul(Reg a, Reg b) { return _mm512_mul_pd(a, b); }
+  static Reg Div(Reg a, Reg b) { return _mm512_div_pd(a, b); }
+  static Reg Max(Reg a, Reg b) { return _mm512_max_pd(a, b); }
+  static Reg Min(Reg a, Reg b) { return _mm512_min_pd(a, b); }
+  static Reg Fma(Reg a, Reg b, Reg c) { return _mm512_fmadd_pd(a, b, c); }
+  static Reg Sqrt(Reg a) { return _mm512_sqrt_pd(a); }
+  static Reg IfLess(Reg a, Reg b, Reg x, Reg y) {
+    return _mm512_mask_blend_pd(_mm512_cmp_pd_mask(a, b, _CMP_LT_OQ), y, x);
+  }
+  static Reg Round(Reg a) {
+    return _mm512_roundscale_pd(a, _MM_FROUND_TO_NEAREST_INT | _MM_FROUND_NO_EXC);
+  }
+  static double ReduceAdd(Reg a) { return _mm512_reduce_add_pd(a); }
+  static double ReduceMul(Reg a) { return _mm512_reduce_mul_pd(a); }
+  static double ReduceMax(Reg a) { return _mm512_reduce_max_pd(a); }
+  static double ReduceMin(Reg a) { return _mm512_reduce_min_pd(a); }
+};
+
+#elif defined(OF_CPU_SIMD_AVX2)
+
+template<>
+struct SimdVec<float> final {
+  static const int kWidth = 8;
+  using Reg = __m256;
+  static Reg Zero() { return _mm256_setzero_ps(); }
+  static Reg Set1(float x) { return _mm256_set1_ps(x); }
+  static Reg Load(const float* ptr) { return _mm256_loadu_ps(ptr); }
+  static void Store(float* ptr, Reg a) { _mm256_storeu_ps(ptr, a); }
+  static Reg Add(Reg a, Reg b) { return _mm256_add_ps(a, b); }
+  static Reg Sub(Reg a, Reg b) { return _mm256_sub_ps(a, b); }
+  static Reg Mul(Reg a, Reg b) { return _mm256_mul_ps(a, b); }
+  static Reg Div(Reg a, Reg b) { return _mm256_div_ps(a, b); }
+  static Reg Max(Reg a, Reg b) { return _mm256_max_ps(a, b); }
+  static Reg Min(Reg a, Reg b) { return _mm256_min_ps(a, b); }
+  static Reg Fma(Reg a, Reg b, Reg c) { return _mm256_fmadd_ps(a, b, c); }
+  static Reg Sqrt(Reg a) { return _mm256_sqrt_ps(a); }
+  static Reg IfLess(Reg a, Reg b, Reg x, Reg y) {
+    return _mm256_blendv_ps(y, x, _mm256_cmp_ps(a, b, _CMP_LT_OQ));
+  }
+  static Reg Round(Reg a) {
+    return _mm256_round_ps(a, _MM_FROUND_TO_NEAREST_INT | _MM_FROUND_NO_EXC);
+  }
+  static Reg Pow2(Reg n) {
+    const __m256i e = _mm256_add_epi32(_mm256_cvtps_epi32(n), _mm256_set1_epi32(127));
+    return _mm256_castsi256_ps(_mm256_slli_epi32(e, 23));
+  }
+  static Reg Exponent(Reg a) {
+    const __m256i e = _mm256_srli_epi32(_mm256_castps_si256(a), 23);
+    return _mm256_cvtepi32_ps(_mm256_sub_epi32(e, _mm256_set1_epi32(127)));
+  }
+  static Reg Mantissa(Reg a) {
+    const __m256i m = _mm256_and_si256(_mm256_castps_si256(a), _mm256_set1_epi32(0x007fffff));
+    return _mm256_castsi256_ps(_mm256_or_si256(m, _mm256_set1_epi32(0x3f800000)));
+  }
+  static float ReduceAdd(Reg a) { return PortableVec<float, kWidth>::ReduceAdd(ToPortable(a)); }
+  static float ReduceMul(Reg a) { return PortableVec<float, kWidth>::ReduceMul(ToPortable(a)); }
+  static float ReduceMax(Reg a) { return PortableVec<float, kWidth>::ReduceMax(ToPortable(a)); }
+  static float ReduceMin(Reg a) { return PortableVec<float, kWidth>::ReduceMin(ToPortable(a)); }
+
+ private:
+  static PortableVec<float, kWidth>::Reg ToPortable(Reg a) {
+    PortableVec<float, kWidth>::Reg r;
+    Store(r.v, a);
+    return r;
+  }
+};
+
+template<>
+struct SimdVec<double> final {
+  static const int kWidth = 4;
+  using Reg = __m256d;
+  static Reg Zero() { return _mm256_setzero_pd(); }
+  static Reg Set1(double x) { return _mm256_set1_pd(x); }
+  static Reg Load(const double* ptr) { return _mm256_loadu_pd(ptr); }
+  static void Store(double* ptr, Reg a) { _mm256_storeu_pd(ptr, a); }
+  static Reg Add(Reg a, Reg b) { return _mm256_add_pd(a, b); }
+  static Reg Sub(Reg a, Reg b) { return _mm256_sub_pd(a, b); }
+  static Reg Mul(Reg a, Reg b) { return _mm256_mul_pd(a, b); }
+  static Reg Div(Reg a, Reg b) { return _mm256_div_pd(a, b); }
+  static Reg Max(Reg a, Reg b) { return _mm256_max_pd(a, b); }
+  static Reg Min(Reg a, Reg b) { return _mm256_min_pd(a, b); }
+  static Reg Fma(Reg a, Reg b, Reg c) { return _mm256_fmadd_pd(a, b, c); }
+  static Reg Sqrt(Reg a) { return _mm256_sqrt_pd(a); }
+  static Reg IfLess(Reg a, Reg b, Reg x, Reg y) {
+    return _mm256_blendv_pd(y, x, _mm256_cmp_pd(a, b, _CMP_LT_OQ));
+  }
+  static Reg Round(Reg a) {
+    return _mm256_round_pd(a, _MM_FROUND_TO_NEAREST_INT | _MM_FROUND_NO_EXC);
+  }
+  static double ReduceAdd(Reg a) { return PortableVec<double, kWidth>::ReduceAdd(ToPortable(a)); }
+  static double ReduceMul(Reg a) { return PortableVec<double, kWidth>::ReduceMul(ToPortable(a)); }
+  static double ReduceMax(Reg a) { return PortableVec<double, kWidth>::ReduceMax(ToPortable(a)); }
+  static double ReduceMin(Reg a) { return PortableVec<double, kWidth>::ReduceMin(ToPortable(a)); }
+
+ private:
+  static PortableVec<double, kWidth>::Reg ToPortable(Reg a) {
+    PortableVec<double, kWidth>::Reg r;
+    Store(r.v, a);
+    return r;
+  }
+};
+
+#endif
+
+}  // namespace simd
+
+}  // namespace oneflow
+
+#endif  // ONEFLOW_CORE_COMMON_CPU_SIMD_H_
@@ -0,0 +1,138 @@
+/*
+Copyright 2020 The OneFlow Authors. All rights reserved.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+*/
+#include "oneflow/core/common/cpu_simd_math.h"
+#include "oneflow/core/common/cpu_test_util.h"
+
+namespace oneflow {
+
+namespace simd {
+
+namespace {
+
+using test::BenchmarkMs;
+using V = SimdVec<float>;
+
+// the distance between exact and the next float away from zero
+double Ulp(double exact) {
+  float f = static_cast<float>(std::fabs(exact));
+  if (std::isinf(f)) { f = std::numeric_limits<float>::max(); }
+  return static_cast<double>(std::nextafter(f, std::numeric_limits<float>::infinity())) - f;
+}
+
+// every 509th float, both signs, inf, nan and zeros, with a tail shorter than V::kWidth
+std::vector<float> SampleFloats() {
+  std::vector<float> x;
+  for (uint64_t bits = 0; bits < (uint64_t(1) << 32); bits += 509) {
+    const uint32_t bits32 = static_cast<uint32_t>(bits);
+    float value;
+    std::memcpy(&value, &bits32, sizeof(value));
+    x.push_back(value);
+  }
+  for (const float value : {0.0f, -0.0f, std::numeric_limits<float>::infinity(),
+                            -std::numeric_limits<float>::infinity(),
+                            std::numeric_limits<float>::quiet_NaN(),
+                            std::numeric_limits<float>::denorm_min(), -1e-40f}) {
+    x.push_back(value);
+  }
+  return x;
+}
+
+// Compares Fn with Ref in double on the sample. The error is in ulp for x >= ulp_from and results
+// of at least FLT_MIN, absolute otherwise.
+template<typename F>
+void ExpectWithinUlp(const char* name, const F& Fn, double (*Ref)(double), double max_ulp,
+                     double max_abs = std::numeric_limits<float>::min(),
+                     double ulp_from = -std::numeric_limits<double>::infinity()) {
+  const std::vector<float> x = SampleFloats();
+  std::vector<float> y(x.size());
+  Transform(x.size(), x.data(), y.data(), Fn);
+  for (size_t i = 0; i < x.size(); ++i) {
+    const double exact = Ref(x[i]);
+    const double error = std::fabs(y[i] - exact);
+    if (std::isnan(exact)) {
+      ASSERT_TRUE(std::isnan(y[i])) << name << "(" << x[i] << ") = " << y[i];
+    } else if (std::isinf(exact) || std::isinf(y[i])) {
+      ASSERT_EQ(y[i], static_cast<float>(exact)) << name << "(" << x[i] << ")";
+    } else if (x[i] < ulp_from || std::fabs(exact) < std::numeric_limits<float>::min()) {
+      ASSERT_LE(error, max_abs) << name << "(" << x[i] << ") = " << y[i] << ", not " << exact;
+    } else {
+      ASSERT_LE(error / Ulp(exact), max_ulp)
+          << name << "(" << x[i] << ") = " << y[i] << ", not " << exact;
+    }
+  }
+}
+
+double Exp(double x) { return std::exp(x); }
+double Log(double x) { return std::log(x); }
+double Tanh(double x) { return std::tanh(x); }
+double Sigmoid(double x) { return 1 / (1 + std::exp(-x)); }
+double Erf(double x) { return std::erf(x); }
+double Gelu(double x) { return 0.5 * x * (1 + std::erf(x * std::sqrt(0.5))); }
+
+}  // namespace
+
+TEST(CpuSimdMath, exp) {
+  ExpectWithinUlp("exp", [](V::Reg x) -> V::Reg { return Math<float>::Exp(x); }, Exp, 1.3);
+}
+
+TEST(CpuSimdMath, log) {
+  ExpectWithinUlp("log", [](V::Reg x) -> V::Reg { return Math<float>::Log(x); }, Log, 2.8);
+}
+
+TEST(CpuSimdMath, tanh) {
+  ExpectWithinUlp("tanh", [](V::Reg x) -> V::Reg { return Math<float>::Tanh(x); }, Tanh, 6.7);
+}
+
+TEST(CpuSimdMath, sigmoid) {
+  ExpectWithinUlp(
+      "sigmoid", [](V::Reg x) -> V::Reg { return Math<float>::Sigmoid(x); }, Sigmoid, 3.2, 3e-39);
+}
+
+TEST(CpuSimdMath, erf) {
+  ExpectWithinUlp("erf", [](V::Reg x) -> V::Reg { return Math<float>::Erf(x); }, Erf, 8);
+}
+
+TEST(CpuSimdMath, gelu) {
+  ExpectWithinUlp(
+      "gelu", [](V::Reg x) -> V::Reg { return Math<float>::Gelu(x); }, Gelu, 7, 1.4e-6, -1);
+}
+
+// compares the polynomials with std::exp and std::tanh on each element, run with
+// --gtest_also_run_disabled_tests
+TEST(CpuSimdMath, DISABLED_benchmark) {
+  const int64_t n = 1 << 22;
+  std::vector<float> x(n);
+  std::vector<float> y(n);
+  for (int64_t i = 0; i < n; ++i) { x[i] = static_cast<float>(i % 2000) / 100 - 10; }
+  const double std_exp_ms = BenchmarkMs([&]() {
+    std::transform(x.begin(), x.end(), y.begin(), [](float v) { return std::exp(v); });
+  });
+  const double simd_exp_ms = BenchmarkMs([&]() {
+    Transform(n, x.data(), y.data(), [](V::Reg v) -> V::Reg { return Math<float>::Exp(v); });
+  });
+  const double std_tanh_ms = BenchmarkMs([&]() {
+    std::transform(x.begin(), x.end(), y.begin(), [](float v) { return std::tanh(v); });
+  });
+  const double simd_tanh_ms = BenchmarkMs([&]() {
+    Transform(n, x.data(), y.data(), [](V::Reg v) -> V::Reg { return Math<float>::Tanh(v); });
+  });
+  LOG(INFO) << n << " floats: exp " << std_exp_ms << "ms, simd exp " << simd_exp_ms
+            << "ms, tanh " << std_tanh_ms << "ms, simd tanh " << simd_tanh_ms << "ms";
+}
+
+}  // namespace simd
+
+}  // namespace oneflow
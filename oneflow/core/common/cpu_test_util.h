@@ -0,0 +1,89 @@
+/*
+Copyright 2020 The OneFlow Authors. All rights reserved.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+*/
+#ifndef ONEFLOW_CORE_COMMON_CPU_TEST_UTIL_H_
+#define ONEFLOW_CORE_COMMON_CPU_TEST_UTIL_H_
+
+#include <gtest/gtest.h>
+#include <chrono>
+#include <functional>
+#include <random>
+#include "oneflow/core/common/util.h"
+
+namespace oneflow {
+
+namespace test {
+
+// The data of the tests of the cpu kernels against naive versions, the same on every run.
+
+// uniform in [low, high)
+template<typename T>
+std::vector<T> RandomData(int64_t size, T low, T high) {
+  std::mt19937 gen(size);
+  std::uniform_real_distribution<T> dis(low, high);
+  std::vector<T> ret(size);
+  for (T& v : ret) { v = dis(gen); }
+  return ret;
+}
+
+// whole numbers uniform in [low, high], so that sums and products in any order are exact as long
+// as they fit in T
+template<typename T>
+std::vector<T> RandomIntData(int64_t size, int64_t low, int64_t high) {
+  std::mt19937 gen(size);
+  std::uniform_int_distribution<int64_t> dis(low, high);
+  std::vector<T> ret(size);
+  for (T& v : ret) { v = static_cast<T>(dis(gen)); }
+  return ret;
+}
+
+// Around 100 with a variance of 1/3, which a one pass sum of squares loses to rounding, for the
+// tests of the mean and variance of normalizations.
+template<typename T>
+std::vector<T> RandomDataFarFromZero(int64_t size) {
+  return RandomData<T>(size, 99, 101);
+}
+
+// the error relative to expected, absolute for expected within [-1, 1]
+template<typename T>
+void ExpectNear(const std::vector<T>& expected, const std::vector<T>& actual, double tolerance) {
+  ASSERT_EQ(expected.size(), actual.size());
+  FOR_RANGE(size_t, i, 0, expected.size()) {
+    ASSERT_NEAR(expected[i], actual[i], tolerance * std::max(1.0, std::abs(double(expected[i]))))
+        << i;
+  }
+}
+
+// runs Fn on [0, num) in two parts, as ParallelFor from two threads
+inline void TwoParts(int64_t num, const std::function<void(int64_t, int64_t)>& Fn) {
+  Fn(0, num / 2);
+  Fn(num / 2, num);
+}
+
+// the mean milliseconds of iters runs of Run, after one to warm up, for the disabled benchmarks
+inline double BenchmarkMs(const std::function<void()>& Run, int iters = 10) {
+  Run();
+  const auto start = std::chrono::steady_clock::now();
+  FOR_RANGE(int, i, 0, iters) { Run(); }
+  return std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start)
+             .count()
+         / iters;
+}
+
+}  // namespace test
+
+}  // namespace oneflow
+
+#endif  // ONEFLOW_CORE_COMMON_CPU_TEST_UTIL_H_
@@ -0,0 +1,225 @@
+/*
+Copyright 2020 The OneFlow Authors. All rights reserved.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+*/
+#ifndef ONEFLOW_CORE_COMMON_MPSC_RING_CHANNEL_H_
+#define ONEFLOW_CORE_COMMON_MPSC_RING_CHANNEL_H_
+
+#include "oneflow/core/common/util.h"
+#include "oneflow/core/common/channel.h"
+#include "oneflow/core/common/platform.h"
+
+#ifdef __linux__
+#include <linux/futex.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+#endif
+
+#ifdef OF_PLATFORM_IS_X86
+#include <immintrin.h>
+#endif
+
+namespace oneflow {
+
+// Lock-free channel with many senders and exactly one receiver.
+//
+// Senders claim a slot of the ring with a CAS on the enqueue position and publish the item by
+// bumping the slot's sequence number, so Send takes no lock while the ring has room. The receiver
+// spins for a while when the ring is empty and then parks itself on a futex; senders only issue
+// the wake syscall when the receiver is actually parked.
+//
+// Send never blocks, as two threads sending to each other's full rings would block forever: when
+// the ring is full, the item and the ones sent after it go to an overflow queue under a mutex,
+// until the receiver takes them. The receiver takes them once it has taken every item of the ring
+// claimed before them, so the items of one sender still arrive in order.
+template<typename T>
+class MpscRingChannel final {
+ public:
+  OF_DISALLOW_COPY_AND_MOVE(MpscRingChannel);
+  MpscRingChannel(size_t capacity, int64_t spin_count);
+  ~MpscRingChannel() = default;
+
+  ChannelStatus Send(const T& item);
+  ChannelStatus ReceiveMany(std::queue<T>* items);
+  void Close();
+
+  size_t capacity() const { return mask_ + 1; }
+
+ private:
+  struct Cell {
+    std::atomic<size_t> seq;
+    T item;
+  };
+  static constexpr int32_t kAwake = 0;
+  static constexpr int32_t kParked = 1;
+
+  bool TryPush(const T& item);
+  size_t PopAll(std::queue<T>* items);
+  size_t PopRing(std::queue<T>* items);
+  void WakeReceiverIfParked();
+  void Park();
+
+  static void CpuRelax() {
+#ifdef OF_PLATFORM_IS_X86
+    _mm_pause();
+#endif
+  }
+
+  std::unique_ptr<Cell[]> cells_;
+  size_t mask_;
+  int64_t spin_count_;
+  alignas(64) std::atomic<size_t> enqueue_pos_;
+  alignas(64) size_t dequeue_pos_;
+  alignas(64) std::atomic<int32_t> receiver_state_;
+  std::atomic<bool> is_closed_;
+  std::mutex overflow_mtx_;
+  std::queue<T> overflow_items_;
+  // the size of overflow_items_, read without the mutex
+  std::atomic<size_t> overflow_size_;
+};
+
+template<typename T>
+MpscRingChannel<T>::MpscRingChannel(size_t capacity, int64_t spin_count)
+    : spin_count_(spin_count),
+      enqueue_pos_(0),
+      dequeue_pos_(0),
+      receiver_state_(kAwake),
+      is_closed_(false),
+      overflow_size_(0) {
+  CHECK_GE(capacity, 2);
+  CHECK_EQ(capacity & (capacity - 1), 0) << "capacity must be a power of two";
+  CHECK_GE(spin_count, 0);
+  mask_ = capacity - 1;
+  cells_.reset(new Cell[capacity]);
+  FOR_RANGE(size_t, i, 0, capacity) { cells_[i].seq.store(i, std::memory_order_relaxed); }
+}
+
+template<typename T>
+bool MpscRingChannel<T>::TryPush(const T& item) {
+  size_t pos = enqueue_pos_.load(std::memory_order_relaxed);
+  Cell* cell = nullptr;
+  while (true) {
+    cell = &cells_[pos & mask_];
+    const size_t seq = cell->seq.load(std::memory_order_acquire);
+    const intptr_t diff = static_cast<intptr_t>(seq) - static_cast<intptr_t>(pos);
+    if (diff == 0) {
+      if (enqueue_pos_.compare_exchange_weak(pos, pos + 1, std::memory_order_relaxed)) { break; }
+    } else if (diff < 0) {
+      return false;
+    } else {
+      pos = enqueue_pos_.load(std::memory_order_relaxed);
+    }
+  }
+  cell->item = item;
+  cell->seq.store(pos + 1, std::memory_order_release);
+  return true;
+}
+
+template<typename T>
+size_t MpscRingChannel<T>::PopAll(std::queue<T>* items) {
+  size_t cnt = PopRing(items);
+  if (overflow_size_.load(std::memory_order_acquire) == 0) { return cnt; }
+  std::unique_lock<std::mutex> lck(overflow_mtx_);
+  // a sender claimed its slots of the ring before it pushed to overflow_items_ under the mutex
+  if (enqueue_pos_.load(std::memory_order_relaxed) != dequeue_pos_) { return cnt; }
+  cnt += overflow_items_.size();
+  while (!overflow_items_.empty()) {
+    items->push(std::move(overflow_items_.front()));
+    overflow_items_.pop();
+  }
+  overflow_size_.store(0, std::memory_order_release);
+  return cnt;
+}
+
+template<typename T>
+size_t MpscRingChannel<T>::PopRing(std::queue<T>* items) {
+  size_t cnt = 0;
+  while (true) {
+    Cell* cell = &cells_[dequeue_pos_ & mask_];
+    if (cell->seq.load(std::memory_order_acquire) != dequeue_pos_ + 1) { break; }
+    items->push(std::move(cell->item));
+    cell->seq.store(dequeue_pos_ + mask_ + 1, std::memory_order_release);
+    ++dequeue_pos_;
+    ++cnt;
+  }
+  return cnt;
+}
+
+template<typename T>
+void MpscRingChannel<T>::WakeReceiverIfParked() {
+  // pairs with the fence in ReceiveMany: either the receiver sees the published item or we see
+  // the parked state
+  std::atomic_thread_fence(std::memory_order_seq_cst);
+  if (receiver_state_.load(std::memory_order_relaxed) == kAwake) { return; }
+  if (receiver_state_.exchange(kAwake, std::memory_order_acq_rel) == kParked) {
+#ifdef __linux__
+    syscall(SYS_futex, reinterpret_cast<int32_t*>(&receiver_state_), FUTEX_WAKE_PRIVATE, 1,
+            nullptr, nullptr, 0);
+#endif
+  }
+}
+
+template<typename T>
+void MpscRingChannel<T>::Park() {
+#ifdef __linux__
+  syscall(SYS_futex, reinterpret_cast<int32_t*>(&receiver_state_), FUTEX_WAIT_PRIVATE, kParked,
+          nullptr, nullptr, 0);
+#else
+  std::this_thread::sleep_for(std::chrono::microseconds(50));
+#endif
+}
+
+template<typename T>
+ChannelStatus MpscRingChannel<T>::Send(const T& item) {
+  if (is_closed_.load(std::memory_order_acquire)) { return kChannelStatusErrorClosed; }
+  if (overflow_size_.load(std::memory_order_acquire) > 0 || !TryPush(item)) {
+    std::unique_lock<std::mutex> lck(overflow_mtx_);
+    overflow_items_.push(item);
+    overflow_size_.store(overflow_items_.size(), std::memory_order_release);
+  }
+  WakeReceiverIfParked();
+  return kChannelStatusSuccess;
+}
+
+template<typename T>
+ChannelStatus MpscRingChannel<T>::ReceiveMany(std::queue<T>* items) {
+  while (true) {
+    FOR_RANGE(int64_t, i, 0, spin_count_ + 1) {
+      if (PopAll(items) > 0) { return kChannelStatusSuccess; }
+      CpuRelax();
+    }
+    receiver_state_.store(kParked, std::memory_order_relaxed);
+    std::atomic_thread_fence(std::memory_order_seq_cst);
+    if (PopAll(items) > 0) {
+      receiver_state_.store(kAwake, std::memory_order_relaxed);
+      return kChannelStatusSuccess;
+    }
+    if (is_closed_.load(std::memory_order_acquire)) {
+      receiver_state_.store(kAwake, std::memory_order_relaxed);
+      return PopAll(items) > 0 ? kChannelStatusSuccess : kChannelStatusErrorClosed;
+    }
+    Park();
+    receiver_state_.store(kAwake, std::memory_order_relaxed);
+  }
+}
+
+template<typename T>
+void MpscRingChannel<T>::Close() {
+  is_closed_.store(true, std::memory_order_release);
+  WakeReceiverIfParked();
+}
+
+}  // namespace oneflow
+
+#endif  // ONEFLOW_CORE_COMMON_MPSC_RING_CHANNEL_H_
@@ -0,0 +1,99 @@
+/*
+Copyright 2020 The OneFlow Authors. All rights reserved.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+*/
+#include "oneflow/core/common/mpsc_ring_channel.h"
+#include "oneflow/core/common/range.h"
+
+namespace oneflow {
+
+namespace {
+
+void SendRange(MpscRingChannel<int64_t>* channel, int64_t sender_id, Range range) {
+  for (int64_t i = range.begin(); i < range.end(); ++i) {
+    ASSERT_EQ(channel->Send(sender_id * range.end() + i), kChannelStatusSuccess);
+  }
+}
+
+void TestManySenders(int64_t spin_count) {
+  // a small ring forces senders to wait on a full queue and the receiver to park on an empty one
+  MpscRingChannel<int64_t> channel(16, spin_count);
+  const int64_t sender_num = 8;
+  const int64_t range_num = 5000;
+  std::vector<std::thread> senders;
+  for (int64_t i = 0; i < sender_num; ++i) {
+    senders.push_back(std::thread(SendRange, &channel, i, Range(0, range_num)));
+  }
+  std::vector<int64_t> last_received(sender_num, -1);
+  int64_t received_cnt = 0;
+  std::queue<int64_t> items;
+  while (received_cnt < sender_num * range_num) {
+    ASSERT_EQ(channel.ReceiveMany(&items), kChannelStatusSuccess);
+    while (!items.empty()) {
+      const int64_t sender_id = items.front() / range_num;
+      const int64_t value = items.front() % range_num;
+      items.pop();
+      // items of one sender arrive in order
+      ASSERT_EQ(value, last_received.at(sender_id) + 1);
+      last_received.at(sender_id) = value;
+      ++received_cnt;
+    }
+  }
+  for (std::thread& sender : senders) { sender.join(); }
+  channel.Close();
+  ASSERT_EQ(channel.ReceiveMany(&items), kChannelStatusErrorClosed);
+  ASSERT_EQ(channel.Send(0), kChannelStatusErrorClosed);
+}
+
+}  // namespace
+
+TEST(MpscRingChannel, 8sender_spin) { TestManySenders(1024); }
+
+TEST(MpscRingChannel, 8sender_park) { TestManySenders(0); }
+
+TEST(MpscRingChannel, full_rings_do_not_block_senders) {
+  // each thread sends more than a ring holds to the other before it receives
+  MpscRingChannel<int64_t> channel0(4, 0);
+  MpscRingChannel<int64_t> channel1(4, 0);
+  const int64_t item_num = 1000;
+  const auto SendThenReceive = [item_num](MpscRingChannel<int64_t>* out,
+                                          MpscRingChannel<int64_t>* in) {
+    FOR_RANGE(int64_t, i, 0, item_num) { ASSERT_EQ(out->Send(i), kChannelStatusSuccess); }
+    std::queue<int64_t> items;
+    int64_t expected = 0;
+    while (expected < item_num) {
+      ASSERT_EQ(in->ReceiveMany(&items), kChannelStatusSuccess);
+      while (!items.empty()) {
+        ASSERT_EQ(items.front(), expected);
+        items.pop();
+        ++expected;
+      }
+    }
+  };
+  std::thread thread(SendThenReceive, &channel0, &channel1);
+  SendThenReceive(&channel1, &channel0);
+  thread.join();
+}
+
+TEST(MpscRingChannel, close_wakes_receiver) {
+  MpscRingChannel<int64_t> channel(4, 0);
+  std::queue<int64_t> items;
+  std::thread receiver(
+      [&]() { ASSERT_EQ(channel.ReceiveMany(&items), kChannelStatusErrorClosed); });
+  std::this_thread::sleep_for(std::chrono::milliseconds(10));
+  channel.Close();
+  receiver.join();
+}
+
+}  // namespace oneflow
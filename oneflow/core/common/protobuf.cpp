@@ -48,6 +48,17 @@ void PbMessage2TxtString(const PbMessage& proto, std::string* str) {
   google::protobuf::TextFormat::PrintToString(proto, str);
 }
 
+std::string PbMessage2DeterministicString(const PbMessage& proto) {
+  std::string str;
+  {
+    google::protobuf::io::StringOutputStream output_stream(&str);
+    google::protobuf::io::CodedOutputStream coded_stream(&output_stream);
+    coded_stream.SetSerializationDeterministic(true);
+    CHECK(proto.SerializeToCodedStream(&coded_stream));
+  }
+  return str;
+}
+
 bool TxtString2PbMessage(const std::string& proto_str, PbMessage* msg) {
   return google::protobuf::TextFormat::ParseFromString(proto_str, msg);
 }
@@ -70,6 +70,8 @@ void ParseProtoFromTextFile(const std::string& file_path, PbMessage* proto);
 void PrintProtoToTextFile(const PbMessage& proto, const std::string& file_path);
 std::string PbMessage2TxtString(const PbMessage& proto);
 void PbMessage2TxtString(const PbMessage& proto, std::string* str);
+// binary, with the entries of maps sorted by key, so that equal messages give equal strings
+std::string PbMessage2DeterministicString(const PbMessage& proto);
 bool TxtString2PbMessage(const std::string& proto_str, PbMessage* proto);
 
 // Does PbMessage have the field_name
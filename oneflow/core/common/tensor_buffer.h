@@ -20,6 +20,7 @@ limitations under the License.
 #include "oneflow/core/common/data_type.h"
 #include "oneflow/core/common/util.h"
 #include "oneflow/core/memory/memory_allocator.h"
+#include "oneflow/core/memory/host_mem_pool.h"
 
 namespace oneflow {
 
@@ -31,7 +32,19 @@ inline void CheckTensorBufferDataType(DataType val) {
 class TensorBuffer {
  public:
   struct Deleter {
-    void operator()(void* ptr) { MemoryAllocatorImpl::DeallocateUnPinnedHostMem(ptr); }
+    Deleter() : block_size(0) {}
+    explicit Deleter(size_t block_size) : block_size(block_size) {}
+    explicit Deleter(std::shared_ptr<void> holder) : block_size(0), holder(std::move(holder)) {}
+    void operator()(void* ptr) {
+      if (holder) {
+        holder.reset();
+      } else {
+        HostMemPool::Get()->Deallocate(ptr, block_size);
+      }
+    }
+    size_t block_size;
+    // set when the memory is borrowed, e.g. from a mapped file
+    std::shared_ptr<void> holder;
   };
   typedef std::unique_ptr<void, Deleter> BufferType;
 
@@ -79,10 +92,25 @@ class TensorBuffer {
   void reserve(size_t new_num_bytes) {
     if (new_num_bytes <= num_bytes_) { return; }
     data_.reset();
-    data_.reset(MemoryAllocatorImpl::AllocateUnPinnedHostMem(new_num_bytes));
+    size_t block_size = 0;
+    void* ptr = HostMemPool::Get()->Allocate(new_num_bytes, &block_size);
+    data_ = BufferType(ptr, Deleter(block_size));
     num_bytes_ = new_num_bytes;
   }
 
+  // Points at memory owned by holder instead of allocating, the memory must be writable and stay
+  // valid while holder is alive. Borrowed memory has no capacity, the next Resize allocates.
+  void Borrow(const Shape& new_shape, DataType new_type, void* ptr, std::shared_ptr<void> holder) {
+    CheckTensorBufferDataType(new_type);
+    CHECK(holder);
+    data_ = BufferType(ptr, Deleter(std::move(holder)));
+    num_bytes_ = 0;
+    shape_ = new_shape;
+    data_type_ = new_type;
+  }
+
+  bool is_borrowed() const { return data_ != nullptr && data_.get_deleter().holder != nullptr; }
+
   int64_t elem_cnt() const { return shape_.elem_cnt(); }
 
   size_t nbytes() const { return elem_cnt() * GetSizeOfDataType(data_type_); }
@@ -15,7 +15,10 @@ limitations under the License.
 */
 #include "oneflow/core/device/memory_copier.h"
 #include "oneflow/core/common/auto_registration_factory.h"
-#include "oneflow/core/common/nd_index_offset_helper.h"
+#include "oneflow/core/thread/thread_manager.h"
+#ifdef __SSE2__
+#include <emmintrin.h>
+#endif
 
 namespace oneflow {
 
@@ -75,28 +78,116 @@ MemoryCopyNdDesc GetDescInBytes(const MemoryCopyNdDesc& desc) {
   return desc_in_bytes;
 }
 
+// bytes one thread copies at least
+constexpr int64_t kCpuCopyParallelGrainSize = 1 << 20;
+// Copies of at least this many bytes, about the size of a last level cache, store their rows
+// around the caches, which would otherwise read the destination only to overwrite it and evict
+// the source still to be read.
+constexpr int64_t kCpuCopyNonTemporalMinSize = 16 << 20;
+constexpr int64_t kCacheLineSize = 64;
+
+// memcpy inlined for the rows of a few elements, such as slices of the last axis
+inline void CopyRow(unsigned char* dst, const unsigned char* src, int64_t count) {
+  switch (count) {
+    case 1: memcpy(dst, src, 1); break;
+    case 2: memcpy(dst, src, 2); break;
+    case 4: memcpy(dst, src, 4); break;
+    case 8: memcpy(dst, src, 8); break;
+    case 16: memcpy(dst, src, 16); break;
+    default: memcpy(dst, src, count);
+  }
+}
+
+// memcpy by non-temporal stores of the aligned cache lines of dst
+inline void StreamCopy(unsigned char* dst, const unsigned char* src, int64_t count) {
+#ifdef __SSE2__
+  const int64_t misalignment = reinterpret_cast<uintptr_t>(dst) % kCacheLineSize;
+  const int64_t head = std::min(count, misalignment == 0 ? 0 : kCacheLineSize - misalignment);
+  memcpy(dst, src, head);
+  int64_t i = head;
+  for (; i + kCacheLineSize <= count; i += kCacheLineSize) {
+    const __m128i* from = reinterpret_cast<const __m128i*>(src + i);
+    __m128i* to = reinterpret_cast<__m128i*>(dst + i);
+    const __m128i v0 = _mm_loadu_si128(from);
+    const __m128i v1 = _mm_loadu_si128(from + 1);
+    const __m128i v2 = _mm_loadu_si128(from + 2);
+    const __m128i v3 = _mm_loadu_si128(from + 3);
+    _mm_stream_si128(to, v0);
+    _mm_stream_si128(to + 1, v1);
+    _mm_stream_si128(to + 2, v2);
+    _mm_stream_si128(to + 3, v3);
+  }
+  memcpy(dst + i, src + i, count - i);
+#else
+  memcpy(dst, src, count);
+#endif
+}
+
+// orders the non-temporal stores of this thread before the ones after the copy
+inline void StreamCopyFence() {
+#ifdef __SSE2__
+  _mm_sfence();
+#endif
+}
+
 }  // namespace
 
-template<int32_t NDIMS>
 void CopyNDCpuImpl(DeviceCtx* ctx, void* dst, const void* src, const MemoryCopyNdDesc& desc) {
-  NdIndexOffsetHelper<int64_t, NDIMS> src_helper(desc.src_shape.dim_vec().data());
-  NdIndexOffsetHelper<int64_t, NDIMS> dst_helper(desc.dst_shape.dim_vec().data());
-  NdIndexOffsetHelper<int64_t, NDIMS> copy_helper(desc.extent.dim_vec().data());
-  FOR_RANGE(int64_t, i, 0, desc.extent.elem_cnt()) {
-    int64_t copy_idx[NDIMS];
-    int64_t src_idx[NDIMS];
-    int64_t dst_idx[NDIMS];
-    copy_helper.OffsetToNdIndex(i, copy_idx);
-    FOR_RANGE(int64_t, j, 0, NDIMS) {
-      src_idx[j] = desc.src_pos.At(j) + copy_idx[j];
-      dst_idx[j] = desc.dst_pos.At(j) + copy_idx[j];
-    }
-    const int64_t src_offset = src_helper.NdIndexToOffset(src_idx);
-    const int64_t dst_offset = dst_helper.NdIndexToOffset(dst_idx);
-    unsigned char* dst_ptr = reinterpret_cast<unsigned char*>(dst) + dst_offset;
-    const unsigned char* src_ptr = reinterpret_cast<const unsigned char*>(src) + src_offset;
-    *dst_ptr = *src_ptr;
+  const MemoryCopyNdDesc reduced = desc.CreateDimReducedDesc();
+  const int64_t num_axes = MemoryCopyNdDescGetNumAxes(reduced);
+  const int64_t num_outer_axes = num_axes - 1;
+  const int64_t row_size = reduced.extent.At(num_outer_axes);
+  const int64_t size = reduced.extent.elem_cnt();
+  // offsets of the first byte and the strides of the outer axes
+  int64_t dst_begin = reduced.dst_pos.At(num_outer_axes);
+  int64_t src_begin = reduced.src_pos.At(num_outer_axes);
+  DimVector dst_strides(num_outer_axes);
+  DimVector src_strides(num_outer_axes);
+  FOR_RANGE(int64_t, i, 0, num_outer_axes) {
+    dst_strides[i] = reduced.dst_shape.Count(i + 1);
+    src_strides[i] = reduced.src_shape.Count(i + 1);
+    dst_begin += reduced.dst_pos.At(i) * dst_strides[i];
+    src_begin += reduced.src_pos.At(i) * src_strides[i];
   }
+  const bool non_temporal = size >= kCpuCopyNonTemporalMinSize && row_size >= kCacheLineSize;
+  ParallelFor(size, kCpuCopyParallelGrainSize, [&](int64_t begin, int64_t end) {
+    // the row of begin, by its index along the outer axes, and the offsets of that row
+    DimVector row_idx(num_outer_axes);
+    int64_t dst_offset = dst_begin;
+    int64_t src_offset = src_begin;
+    int64_t remaining = begin / row_size;
+    for (int64_t i = num_outer_axes - 1; i >= 0; --i) {
+      row_idx[i] = remaining % reduced.extent.At(i);
+      remaining /= reduced.extent.At(i);
+      dst_offset += row_idx[i] * dst_strides[i];
+      src_offset += row_idx[i] * src_strides[i];
+    }
+    int64_t col = begin % row_size;
+    int64_t pos = begin;
+    while (pos < end) {
+      const int64_t count = std::min(row_size - col, end - pos);
+      unsigned char* dst_ptr = reinterpret_cast<unsigned char*>(dst) + dst_offset + col;
+      const unsigned char* src_ptr = reinterpret_cast<const unsigned char*>(src) + src_offset + col;
+      if (non_temporal) {
+        StreamCopy(dst_ptr, src_ptr, count);
+      } else {
+        CopyRow(dst_ptr, src_ptr, count);
+      }
+      pos += count;
+      col = 0;
+      // the next row, carrying into the outer axes
+      for (int64_t i = num_outer_axes - 1; i >= 0; --i) {
+        row_idx[i] += 1;
+        dst_offset += dst_strides[i];
+        src_offset += src_strides[i];
+        if (row_idx[i] < reduced.extent.At(i)) { break; }
+        row_idx[i] = 0;
+        dst_offset -= reduced.extent.At(i) * dst_strides[i];
+        src_offset -= reduced.extent.At(i) * src_strides[i];
+      }
+    }
+    if (non_temporal) { StreamCopyFence(); }
+  });
 }
 
 MemoryCopyNdDesc MemoryCopyNdDesc::CreateDimReducedDesc() const {
@@ -194,22 +285,14 @@ void MemoryCopier::CopyND(DeviceCtx* ctx, void* dst, const void* src,
   UNIMPLEMENTED();
 }
 
-void HostMemoryCopier::Copy1D(DeviceCtx* ctx, void* dst, const void* src, size_t count) const {
-  memcpy(dst, src, count);
+void HostMemoryCopier::Copy(DeviceCtx* ctx, void* dst, const void* src,
+                            const MemoryCopyNdDesc& desc) const {
+  CheckMemoryCopyNdDesc(desc);
+  CopyNDCpuImpl(ctx, dst, src, desc);
 }
 
-void HostMemoryCopier::CopyND(DeviceCtx* ctx, void* dst, const void* src,
-                              const MemoryCopyNdDesc& desc) const {
-  const int32_t num_axes = desc.src_shape.NumAxes();
-  if (num_axes == 4) {
-    CopyNDCpuImpl<4>(ctx, dst, src, desc);
-  } else if (num_axes == 5) {
-    CopyNDCpuImpl<5>(ctx, dst, src, desc);
-  } else if (num_axes == 6) {
-    CopyNDCpuImpl<6>(ctx, dst, src, desc);
-  } else {
-    UNIMPLEMENTED();
-  }
+void HostMemoryCopier::Copy1D(DeviceCtx* ctx, void* dst, const void* src, size_t count) const {
+  memcpy(dst, src, count);
 }
 
 #ifdef WITH_CUDA
@@ -320,11 +403,4 @@ SPECIALIZE_COPY_ELEM(int32_t)
 SPECIALIZE_COPY_ELEM(int64_t)
 SPECIALIZE_COPY_ELEM(int8_t)
 
-#define SPECIALIZE_COPY_ND_CPU_IMPL(NDIMS)                                        \
-  template void CopyNDCpuImpl<NDIMS>(DeviceCtx * ctx, void* dst, const void* src, \
-                                     const MemoryCopyNdDesc& desc);
-SPECIALIZE_COPY_ND_CPU_IMPL(4)
-SPECIALIZE_COPY_ND_CPU_IMPL(5)
-SPECIALIZE_COPY_ND_CPU_IMPL(6)
-
 }  // namespace oneflow
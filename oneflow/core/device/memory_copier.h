@@ -33,7 +33,8 @@ struct MemoryCopyNdDesc {
   MemoryCopyNdDesc CreateDimReducedDesc() const;
 };
 
-template<int32_t NDIMS>
+// Copies the contiguous rows of the innermost axis of the reduced desc by memcpy, iterating the
+// outer axes by strides, and splits large copies across the compute thread pool.
 void CopyNDCpuImpl(DeviceCtx* ctx, void* dst, const void* src, const MemoryCopyNdDesc& desc);
 #ifdef WITH_CUDA
 template<int32_t NDIMS>
@@ -68,9 +69,9 @@ class HostMemoryCopier final : public MemoryCopier {
   ~HostMemoryCopier() override = default;
 
  private:
+  void Copy(DeviceCtx* ctx, void* dst, const void* src,
+            const MemoryCopyNdDesc& desc) const override;
   void Copy1D(DeviceCtx* ctx, void* dst, const void* src, size_t count) const override;
-  void CopyND(DeviceCtx* ctx, void* dst, const void* src,
-              const MemoryCopyNdDesc& desc) const override;
 };
 
 #ifdef WITH_CUDA
@@ -0,0 +1,164 @@
+/*
+Copyright 2020 The OneFlow Authors. All rights reserved.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+*/
+#include <gtest/gtest.h>
+#include <chrono>
+#include "oneflow/core/device/memory_copier.h"
+
+namespace oneflow {
+
+namespace {
+
+// the copy of desc element by element, as CopyNDCpuImpl was
+template<typename T>
+void NaiveCopy(T* dst, const T* src, const MemoryCopyNdDesc& desc) {
+  const int64_t num_axes = desc.extent.NumAxes();
+  FOR_RANGE(int64_t, i, 0, desc.extent.elem_cnt()) {
+    int64_t remaining = i;
+    int64_t dst_offset = 0;
+    int64_t src_offset = 0;
+    for (int64_t axis = num_axes - 1; axis >= 0; --axis) {
+      const int64_t idx = remaining % desc.extent.At(axis);
+      remaining /= desc.extent.At(axis);
+      dst_offset += (desc.dst_pos.At(axis) + idx) * desc.dst_shape.Count(axis + 1);
+      src_offset += (desc.src_pos.At(axis) + idx) * desc.src_shape.Count(axis + 1);
+    }
+    dst[dst_offset] = src[src_offset];
+  }
+}
+
+// a random slice of a random shape, whole along some axes so that they are reduced
+MemoryCopyNdDesc RandomDesc(std::mt19937* gen, int64_t num_axes) {
+  DimVector dst_shape;
+  DimVector src_shape;
+  DimVector dst_pos;
+  DimVector src_pos;
+  DimVector extent;
+  FOR_RANGE(int64_t, i, 0, num_axes) {
+    const int64_t dim = 1 + (*gen)() % 7;
+    const bool whole = (*gen)() % 3 == 0;
+    dst_shape.push_back(whole ? dim : dim + (*gen)() % 3);
+    src_shape.push_back(whole ? dim : dim + (*gen)() % 3);
+    dst_pos.push_back(dst_shape.back() - dim == 0 ? 0 : (*gen)() % (dst_shape.back() - dim + 1));
+    src_pos.push_back(src_shape.back() - dim == 0 ? 0 : (*gen)() % (src_shape.back() - dim + 1));
+    extent.push_back(dim);
+  }
+  MemoryCopyNdDesc desc;
+  desc.dst_shape = Shape(dst_shape);
+  desc.src_shape = Shape(src_shape);
+  desc.dst_pos = NdIndex(dst_pos);
+  desc.src_pos = NdIndex(src_pos);
+  desc.extent = Shape(extent);
+  return desc;
+}
+
+}  // namespace
+
+TEST(HostMemoryCopier, random_slices) {
+  HostMemoryCopier host_copier;
+  const MemoryCopier& copier = host_copier;
+  std::mt19937 gen(0);
+  FOR_RANGE(int64_t, num_axes, 1, 7) {
+    FOR_RANGE(int64_t, trial, 0, 200) {
+      const MemoryCopyNdDesc desc = RandomDesc(&gen, num_axes);
+      std::vector<float> src(desc.src_shape.elem_cnt());
+      std::iota(src.begin(), src.end(), 1.0f);
+      std::vector<float> dst(desc.dst_shape.elem_cnt(), 0.0f);
+      std::vector<float> expected(dst.size(), 0.0f);
+      NaiveCopy(expected.data(), src.data(), desc);
+      copier.CopyElem<float>(nullptr, dst.data(), src.data(), desc);
+      ASSERT_EQ(dst, expected) << "extent " << desc.extent.ToString() << " src "
+                               << desc.src_shape.ToString() << " dst " << desc.dst_shape.ToString();
+    }
+  }
+}
+
+// rows of unaligned bytes, enough for the non-temporal stores
+TEST(HostMemoryCopier, large_rows) {
+  HostMemoryCopier host_copier;
+  const MemoryCopier& copier = host_copier;
+  const int64_t row_size = (9 << 20) + 5;
+  MemoryCopyNdDesc desc;
+  desc.src_shape = Shape({3, row_size});
+  desc.dst_shape = Shape({2, row_size + 7});
+  desc.src_pos = NdIndex({1, 3});
+  desc.dst_pos = NdIndex({0, 1});
+  desc.extent = Shape({2, row_size - 3});
+  std::vector<unsigned char> src(desc.src_shape.elem_cnt());
+  FOR_RANGE(size_t, i, 0, src.size()) { src[i] = static_cast<unsigned char>(i * 7 + i / 251); }
+  std::vector<unsigned char> dst(desc.dst_shape.elem_cnt(), 0);
+  std::vector<unsigned char> expected(dst.size(), 0);
+  NaiveCopy(expected.data(), src.data(), desc);
+  copier.Copy(nullptr, dst.data(), src.data(), desc);
+  ASSERT_TRUE(dst == expected);
+}
+
+// times splitting a 4-D tensor of 32MB into 4 slices along each axis and concatenating them
+// back, as the boxing between split parallel distributions does, run with
+// --gtest_also_run_disabled_tests
+TEST(HostMemoryCopier, DISABLED_benchmark) {
+  HostMemoryCopier host_copier;
+  const MemoryCopier& copier = host_copier;
+  const Shape shape({16, 32, 128, 128});
+  const int64_t num_slices = 4;
+  std::vector<float> tensor(shape.elem_cnt(), 1.0f);
+  std::vector<float> slices(shape.elem_cnt());
+  std::vector<float> concatenated(shape.elem_cnt());
+  const auto Time = [](const std::function<void()>& Run) {
+    Run();
+    const auto start = std::chrono::steady_clock::now();
+    Run();
+    return std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start)
+        .count();
+  };
+  const double memcpy_ms =
+      Time([&]() { memcpy(slices.data(), tensor.data(), tensor.size() * sizeof(float)); });
+  LOG(INFO) << shape.ToString() << " floats, memcpy " << memcpy_ms << "ms";
+  FOR_RANGE(int64_t, axis, 0, shape.NumAxes()) {
+    // slice i of tensor to slices[i * slice_size, (i + 1) * slice_size) and back
+    DimVector slice_dims = shape.dim_vec();
+    slice_dims[axis] /= num_slices;
+    const Shape slice_shape(slice_dims);
+    const int64_t slice_size = slice_shape.elem_cnt();
+    const auto Desc = [&](int64_t i, bool split) {
+      DimVector pos(shape.NumAxes(), 0);
+      pos[axis] = i * slice_dims[axis];
+      MemoryCopyNdDesc desc;
+      desc.dst_shape = split ? slice_shape : shape;
+      desc.src_shape = split ? shape : slice_shape;
+      desc.dst_pos = split ? NdIndex(DimVector(shape.NumAxes(), 0)) : NdIndex(pos);
+      desc.src_pos = split ? NdIndex(pos) : NdIndex(DimVector(shape.NumAxes(), 0));
+      desc.extent = slice_shape;
+      return desc;
+    };
+    const double split_ms = Time([&]() {
+      FOR_RANGE(int64_t, i, 0, num_slices) {
+        copier.CopyElem<float>(nullptr, slices.data() + i * slice_size, tensor.data(),
+                               Desc(i, true));
+      }
+    });
+    const double concat_ms = Time([&]() {
+      FOR_RANGE(int64_t, i, 0, num_slices) {
+        copier.CopyElem<float>(nullptr, concatenated.data(), slices.data() + i * slice_size,
+                               Desc(i, false));
+      }
+    });
+    ASSERT_TRUE(concatenated == tensor);
+    LOG(INFO) << "split along axis " << axis << " " << split_ms << "ms, concat " << concat_ms
+              << "ms";
+  }
+}
+
+}  // namespace oneflow
@@ -24,6 +24,11 @@ void MultiThreadLoopInOpKernel(size_t num, std::function<void(size_t i)> Callbac
   MultiThreadLoop(num, Callback);
 }
 
+void ParallelForInOpKernel(int64_t num, int64_t grain_size,
+                           const std::function<void(int64_t begin, int64_t end)>& DoEach) {
+  ParallelFor(num, grain_size, DoEach);
+}
+
 }  // namespace user_op
 
 }  // namespace oneflow
@@ -23,6 +23,8 @@ namespace oneflow {
 namespace user_op {
 
 void MultiThreadLoopInOpKernel(size_t num, std::function<void(size_t i)> Callback);
+void ParallelForInOpKernel(int64_t num, int64_t grain_size,
+                           const std::function<void(int64_t begin, int64_t end)>& DoEach);
 
 }  // namespace user_op
 
@@ -14,6 +14,7 @@ See the License for the specific language governing permissions and
 limitations under the License.
 */
 #include "oneflow/core/framework/op_kernel.h"
+#include "oneflow/core/framework/multi_thread.h"
 
 namespace oneflow {
 
@@ -29,6 +30,13 @@ void OpKernel::InferShape(KernelInferContext* ctx) const {
   }
 }
 
+void KernelComputeContext::ParallelFor(
+    int64_t num, int64_t grain_size,
+    const std::function<void(int64_t begin, int64_t end)>& DoEach) const {
+  CHECK_EQ(device_type(), DeviceType::kCPU);
+  ParallelForInOpKernel(num, grain_size, DoEach);
+}
+
 }  // namespace user_op
 
 }  // namespace oneflow
@@ -138,6 +138,11 @@ class KernelComputeContext {
   }
   const UserOpConfWrapper& user_op_conf() const { return user_op_conf_; }
 
+  // Calls DoEach on disjoint sub-ranges of [0, num) on the compute thread pool, each holding at
+  // least grain_size elements. Only for kernels on cpu.
+  void ParallelFor(int64_t num, int64_t grain_size,
+                   const std::function<void(int64_t begin, int64_t end)>& DoEach) const;
+
  protected:
   KernelComputeContext(UserOpConfWrapper&& conf) : user_op_conf_(conf) {}
   KernelComputeContext(const KernelComputeContext&) = delete;
@@ -31,13 +31,14 @@ using namespace boxing::collective;
 
 namespace {
 
-void NcclInitCollectiveNode(CollectiveBoxingGenericTaskNode* node,
-                            const ParallelDesc& parallel_desc, int64_t parallel_id,
-                            const std::string& name, const LogicalBlobId& lbi,
-                            const BlobDesc& logical_blob_desc, OpType op_type, int64_t root) {
+void InitCollectiveNode(CollectiveBoxingGenericTaskNode* node, const ParallelDesc& parallel_desc,
+                        int64_t parallel_id, const std::string& name, const LogicalBlobId& lbi,
+                        const BlobDesc& logical_blob_desc, OpType op_type, int64_t root,
+                        DeviceType device_type) {
+  CHECK(device_type == DeviceType::kGPU || device_type == DeviceType::kCPU);
   OperatorConf op_conf;
   op_conf.set_name(name);
-  op_conf.set_device_tag(CHECK_JUST(DeviceTag4DeviceType(DeviceType::kGPU)));
+  op_conf.set_device_tag(CHECK_JUST(DeviceTag4DeviceType(device_type)));
   CollectiveBoxingGenericOpConf* conf = op_conf.mutable_collective_boxing_generic_conf();
   *conf->mutable_lbi() = lbi;
   RankDesc* rank_desc = conf->mutable_rank_desc();
@@ -58,15 +59,26 @@ void NcclInitCollectiveNode(CollectiveBoxingGenericTaskNode* node,
   } else {
     CHECK_EQ(root, -1);
   }
-  op_desc->set_backend(Backend::kBackendNCCL);
+  op_desc->set_backend(device_type == DeviceType::kGPU ? Backend::kBackendNCCL
+                                                       : Backend::kBackendCPU);
   rank_desc->set_rank(parallel_id);
 
   const int64_t machine_id = CHECK_JUST(parallel_desc.MachineId4ParallelId(parallel_id));
   const int64_t device_id = CHECK_JUST(parallel_desc.DeviceId4ParallelId(parallel_id));
-  const int64_t thrd_id = Global<IDMgr>::Get()->GetGpuNcclThrdId(device_id);
+  const int64_t thrd_id = device_type == DeviceType::kGPU
+                              ? Global<IDMgr>::Get()->GetGpuNcclThrdId(device_id)
+                              : Global<IDMgr>::Get()->GetCpuDeviceThrdId(device_id);
   node->Init(machine_id, thrd_id, NewAreaId(), op_conf);
 }
 
+void NcclInitCollectiveNode(CollectiveBoxingGenericTaskNode* node,
+                            const ParallelDesc& parallel_desc, int64_t parallel_id,
+                            const std::string& name, const LogicalBlobId& lbi,
+                            const BlobDesc& logical_blob_desc, OpType op_type, int64_t root) {
+  InitCollectiveNode(node, parallel_desc, parallel_id, name, lbi, logical_blob_desc, op_type, root,
+                     DeviceType::kGPU);
+}
+
 int64_t FindRootParallelId(const ParallelDesc& multi_device, const ParallelDesc& sole_device) {
   CHECK_EQ(sole_device.parallel_num(), 1);
   const int64_t root_machine_id = CHECK_JUST(sole_device.MachineId4ParallelId(0));
@@ -443,6 +455,59 @@ class NcclCollectiveBoxingAll2AllSubTskGphBuilder final : public SubTskGphBuilde
   }
 };
 
+class CpuCollectiveBoxingSubTskGphBuilder final : public SubTskGphBuilder {
+ public:
+  OF_DISALLOW_COPY_AND_MOVE(CpuCollectiveBoxingSubTskGphBuilder);
+  CpuCollectiveBoxingSubTskGphBuilder() = default;
+  ~CpuCollectiveBoxingSubTskGphBuilder() override = default;
+
+  Maybe<SubTskGphBuilderStatus> Build(SubTskGphBuilderCtx* ctx,
+                                      const std::vector<CompTaskNode*>& sorted_src_comp_tasks,
+                                      const std::vector<CompTaskNode*>& sorted_dst_comp_tasks,
+                                      const ParallelDesc& src_parallel_desc,
+                                      const ParallelDesc& dst_parallel_desc,
+                                      const LogicalBlobId& lbi, const BlobDesc& logical_blob_desc,
+                                      const SbpParallel& src_sbp_parallel,
+                                      const SbpParallel& dst_sbp_parallel) const override {
+    // within one machine the naive boxing shares memory, collectives pay off across machines
+    if (!dst_parallel_desc.Equals(src_parallel_desc)
+        || SubTskGphBuilderUtil::BlobHasDynamicShape(logical_blob_desc)
+        || dst_parallel_desc.device_type() != DeviceType::kCPU
+        || dst_parallel_desc.sorted_machine_ids().size() <= 1) {
+      return Error::BoxingNotSupportedError();
+    }
+    const int64_t parallel_num = dst_parallel_desc.parallel_num();
+    const bool can_split = logical_blob_desc.shape().NumAxes() > 0
+                           && logical_blob_desc.shape().At(0) % parallel_num == 0;
+    OpType op_type = OpType::kOpTypeInvalid;
+    if (SubTskGphBuilderUtil::IsBoxingP2B(src_sbp_parallel, dst_sbp_parallel)) {
+      op_type = OpType::kOpTypeAllReduce;
+    } else if (SubTskGphBuilderUtil::IsBoxingP2S(src_sbp_parallel, dst_sbp_parallel)
+               && dst_sbp_parallel.split_parallel().axis() == 0 && can_split) {
+      op_type = OpType::kOpTypeReduceScatter;
+    } else if (SubTskGphBuilderUtil::IsBoxingS2B(src_sbp_parallel, dst_sbp_parallel)
+               && src_sbp_parallel.split_parallel().axis() == 0 && can_split) {
+      op_type = OpType::kOpTypeAllGather;
+    } else {
+      return Error::BoxingNotSupportedError();
+    }
+    const std::string op_name = "System-Boxing-CpuCollectiveBoxing-" + NewUniqueId();
+    FOR_RANGE(int64_t, i, 0, parallel_num) {
+      CompTaskNode* src_node = sorted_src_comp_tasks.at(i);
+      CompTaskNode* dst_node = sorted_dst_comp_tasks.at(i);
+      auto* collective_node = ctx->task_graph()->NewNode<CollectiveBoxingGenericTaskNode>();
+      InitCollectiveNode(collective_node, dst_parallel_desc, i, op_name, lbi, logical_blob_desc,
+                         op_type, -1, DeviceType::kCPU);
+      Connect<TaskNode>(src_node, ctx->task_graph()->NewEdge(), collective_node);
+      Connect<TaskNode>(collective_node, ctx->task_graph()->NewEdge(), dst_node);
+    }
+    return TRY(BuildSubTskGphBuilderStatus(
+        sorted_src_comp_tasks.front(), sorted_dst_comp_tasks.front(), src_parallel_desc,
+        dst_parallel_desc, src_sbp_parallel, dst_sbp_parallel, lbi, logical_blob_desc,
+        "CpuCollectiveBoxingSubTskGphBuilder", ""));
+  }
+};
+
 }  // namespace
 
 CollectiveBoxingSubTskGphBuilder::CollectiveBoxingSubTskGphBuilder() {
@@ -462,6 +527,9 @@ CollectiveBoxingSubTskGphBuilder::CollectiveBoxingSubTskGphBuilder() {
     LOG(WARNING) << "nccl_enable_all_to_all is unavailable unless NCCL_VERSION > 2.7.0";
 #endif
   }
+  if (collective_boxing_conf.cpu_enable_backend()) {
+    builders.emplace_back(new CpuCollectiveBoxingSubTskGphBuilder());
+  }
   chain_builder_.reset(new ChainSubTskGphBuilder(builders));
 }
 
@@ -19,6 +19,7 @@ limitations under the License.
 #include <stack>
 #include "oneflow/core/common/str_util.h"
 #include "oneflow/core/graph/node.h"
+#include "oneflow/core/graph/reachability_index.h"
 #include "oneflow/core/persistence/tee_persistent_log_stream.h"
 
 namespace oneflow {
@@ -606,19 +607,23 @@ Graph<NodeType, EdgeType>::MakePredicatorIsReachable(
     const std::function<void(NodeType*, const std::function<void(NodeType*)>&)>& ForEachInNode,
     const std::function<void(NodeType*, const std::function<void(NodeType*)>&)>& ForEachOutNode)
     const {
-  auto node2ancestor = std::make_shared<HashMap<const NodeType*, HashSet<const NodeType*>>>();
+  // the nodes numbered in the topological order
+  auto node2index = std::make_shared<HashMap<const NodeType*, int64_t>>();
+  std::vector<std::vector<int64_t>> in_nodes;
   TopoForEachNode(starts, ForEachInNode, ForEachOutNode, [&](NodeType* node) {
-    node2ancestor->emplace(node, HashSet<const NodeType*>());
+    node2index->emplace(node, in_nodes.size());
+    in_nodes.emplace_back();
     ForEachInNode(node, [&](NodeType* in_node) {
-      node2ancestor->at(node).insert(in_node);
-      node2ancestor->at(node).insert(node2ancestor->at(in_node).begin(),
-                                     node2ancestor->at(in_node).end());
+      in_nodes.back().push_back(node2index->at(in_node));
     });
   });
-  return [node2ancestor](const NodeType* src, const NodeType* dst) -> bool {
-    const auto it = node2ancestor->find(dst);
-    if (it == node2ancestor->end()) { return false; }
-    return it->second.find(src) != it->second.end();
+  auto reachability_index = std::make_shared<const ReachabilityIndex>(in_nodes);
+  return [node2index, reachability_index](const NodeType* src, const NodeType* dst) -> bool {
+    const auto src_it = node2index->find(src);
+    if (src_it == node2index->end()) { return false; }
+    const auto dst_it = node2index->find(dst);
+    if (dst_it == node2index->end()) { return false; }
+    return reachability_index->IsReachable(src_it->second, dst_it->second);
   };
 }
 
@@ -368,14 +368,75 @@ void OpNode::InitLbi2SbpParallel() {
   Update(op().output_bns());
 }
 
+void OpNode::CopyInferredFrom(const OpNode& prev_node) {
+  CHECK(op_ == prev_node.op_);
+  obn2blob_parallel_desc_ = prev_node.obn2blob_parallel_desc_;
+  for (const auto& pair : prev_node.bn2parallel_id2blob_desc_) {
+    auto* blob_descs = &bn2parallel_id2blob_desc_[pair.first];
+    for (const auto& blob_desc : pair.second) {
+      blob_descs->emplace_back(new BlobDesc(*blob_desc));
+    }
+  }
+  for (const auto& pair : prev_node.lbi2logical_blob_desc_) {
+    lbi2logical_blob_desc_[pair.first].reset(new BlobDesc(*pair.second));
+  }
+  lbi2sbp_parallel_ = prev_node.lbi2sbp_parallel_;
+  sbp_signature_conf_ = prev_node.sbp_signature_conf_;
+  is_mirrored_conf_ = prev_node.is_mirrored_conf_;
+}
+
+void OpNode::ConstructOwnOp() {
+  CHECK(is_op_shared_);
+  std::shared_ptr<Operator> own_op =
+      ConstructOp(op().op_conf(), parallel_desc().device_type(), &GlobalJobDesc());
+  *own_op->mut_blob_last_used_signature() = op().blob_last_used_signature();
+  op_ = own_op;
+  is_op_shared_ = false;
+}
+
+bool OpNode::HasSameOutputsAs(const OpNode& prev_node) const {
+  if (!(parallel_desc() == prev_node.parallel_desc())) { return false; }
+  const auto& obns = op().output_bns();
+  const auto& prev_obns = prev_node.op().output_bns();
+  if (obns.size() != prev_obns.size() || !std::equal(obns.begin(), obns.end(), prev_obns.begin())) {
+    return false;
+  }
+  for (const std::string& obn : obns) {
+    const LogicalBlobId& lbi = op().BnInOp2Lbi(obn);
+    if (lbi != prev_node.op().BnInOp2Lbi(obn)) { return false; }
+    if (!(LogicalBlobDesc4Lbi(lbi) == prev_node.LogicalBlobDesc4Lbi(lbi))) { return false; }
+    if (!(SbpParallel4Lbi(lbi) == prev_node.SbpParallel4Lbi(lbi))) { return false; }
+    if (!(BlobParallelDesc4Obn(obn) == prev_node.BlobParallelDesc4Obn(obn))) { return false; }
+    if (!PbMd().Equals(*CHECK_JUST(op().BatchAxis4BnInOp(obn)),
+                       *CHECK_JUST(prev_node.op().BatchAxis4BnInOp(obn)))) {
+      return false;
+    }
+    if (!PbMd().Equals(*CHECK_JUST(op().OptMirroredParallel4BnInOp(obn)),
+                       *CHECK_JUST(prev_node.op().OptMirroredParallel4BnInOp(obn)))) {
+      return false;
+    }
+  }
+  return true;
+}
+
 Maybe<OpGraph> OpGraph::New(const Job& job) {
   const auto& op_graph = std::make_shared<OpGraph>();
   JUST(op_graph->Init(job));
   return op_graph;
 }
 
-Maybe<void> OpGraph::Init(const Job& job) {
-  InitNodes(job);
+Maybe<OpGraph> OpGraph::New(const Job& job, const OpGraph* prev_op_graph) {
+  CHECK(prev_op_graph == nullptr || prev_op_graph->keeps_op_confs_);
+  const auto& op_graph = std::make_shared<OpGraph>();
+  op_graph->keeps_op_confs_ = true;
+  JUST(op_graph->Init(job, prev_op_graph));
+  return op_graph;
+}
+
+Maybe<void> OpGraph::Init(const Job& job) { return Init(job, nullptr); }
+
+Maybe<void> OpGraph::Init(const Job& job, const OpGraph* prev_op_graph) {
+  InitNodes(job, prev_op_graph);
   ForEachNode([&](OpNode* node) {
     CHECK(op_name2op_node_.emplace(node->op().op_name(), node).second)
         << "op_name: " << node->op().op_name();
@@ -386,7 +447,7 @@ Maybe<void> OpGraph::Init(const Job& job) {
   ForEachNode([](OpNode* node) { node->InitLbi2SourceNode(); });
   InferBlobLastUsed();
   InferTimeShape();
-  JUST(InferLogicalBlobDesc(job));
+  JUST(InferLogicalBlobDesc(job, prev_op_graph));
   ForEachEdge([](OpEdge* edge) { edge->InitDistributeHierarchyInfo(); });
   return Maybe<void>::Ok();
 }
@@ -402,12 +463,33 @@ void OpGraph::CheckIsDAG() const {
   CHECK(!FindFirstNontrivialSCC(ForEachIn, ForEachOut));
 }
 
-void OpGraph::InitNodes(const Job& job) {
+void OpGraph::InitNodes(const Job& job, const OpGraph* prev_op_graph) {
   auto ParallelConf4OpName = MakeGetterParallelConf4OpName(job.placement());
   for (const auto& op_conf : job.net().op()) {
     op_names_.push_back(op_conf.name());
-    OpNode* node = new OpNode(ParallelDesc(*ParallelConf4OpName(op_conf.name())), op_conf);
+    const ParallelDesc parallel_desc(*ParallelConf4OpName(op_conf.name()));
+    std::string serialized_op_conf;
+    if (keeps_op_confs_) { serialized_op_conf = PbMessage2DeterministicString(op_conf); }
+    // the node of the op in prev_op_graph, if the op and its placement are unchanged
+    const OpNode* prev_node = nullptr;
+    if (prev_op_graph != nullptr) {
+      const auto it = prev_op_graph->op_name2serialized_op_conf_.find(op_conf.name());
+      if (it != prev_op_graph->op_name2serialized_op_conf_.end()
+          && it->second == serialized_op_conf) {
+        prev_node = prev_op_graph->op_name2op_node_.at(op_conf.name());
+        if (!(prev_node->parallel_desc() == parallel_desc)) { prev_node = nullptr; }
+      }
+    }
+    OpNode* node = nullptr;
+    if (prev_node != nullptr) {
+      node = new OpNode(parallel_desc, prev_node->op_);
+    } else {
+      node = new OpNode(parallel_desc, op_conf);
+    }
     AddAllocatedNode(node);
+    if (keeps_op_confs_) {
+      op_name2serialized_op_conf_.emplace(op_conf.name(), std::move(serialized_op_conf));
+    }
   }
 }
 
@@ -457,13 +539,22 @@ void OpGraph::InitProducerOpName2CtrlConsumerOpNames(const Job& job) {
 void OpGraph::InferBlobLastUsed() const {
   HashSet<LogicalBlobId> visisted_lbi;
   for (auto iter = op_names_.rbegin(); iter != op_names_.rend(); iter++) {
-    Operator* op = op_name2op_node_.at(*iter)->mut_op();
-    auto* map = op->mut_blob_last_used_signature()->mutable_bn_in_op2blob_last_used();
+    OpNode* op_node = op_name2op_node_.at(*iter);
+    BlobLastUsedSignature blob_last_used_signature;
+    auto* map = blob_last_used_signature.mutable_bn_in_op2blob_last_used();
     const auto InferLastUsed = [&](const std::string& bn_in_op) {
-      (*map)[bn_in_op] = visisted_lbi.insert(op->BnInOp2Lbi(bn_in_op)).second;
+      (*map)[bn_in_op] = visisted_lbi.insert(op_node->op().BnInOp2Lbi(bn_in_op)).second;
     };
-    for (const auto& obn : op->output_bns()) { InferLastUsed(obn); }
-    for (const auto& ibn : op->input_bns()) { InferLastUsed(ibn); }
+    for (const auto& obn : op_node->op().output_bns()) { InferLastUsed(obn); }
+    for (const auto& ibn : op_node->op().input_bns()) { InferLastUsed(ibn); }
+    // an Operator shared with an earlier graph is left as it is there
+    if (op_node->is_op_shared_) {
+      if (PbMd().Equals(op_node->op().blob_last_used_signature(), blob_last_used_signature)) {
+        continue;
+      }
+      op_node->ConstructOwnOp();
+    }
+    *op_node->mut_op()->mut_blob_last_used_signature() = blob_last_used_signature;
   }
 }
 
@@ -560,14 +651,52 @@ const OpNode* OpGraph::OpNode4OpName(const std::string& op_name) const {
   return op_node_it->second;
 }
 
-Maybe<void> OpGraph::InferLogicalBlobDesc(const Job& job) const {
+Maybe<void> OpGraph::InferLogicalBlobDesc(const Job& job, const OpGraph* prev_op_graph) const {
   JobParallelViewConf job_parallel_view_conf(job.job_parallel_view_conf());
   HashMap<OpBlobArg, std::vector<OpBlobArg>> oba2sbp_identical_obas;
   for (const auto& pair : job.helper().identical_sbp_oba_pairs().pair()) {
     oba2sbp_identical_obas[pair.first()].push_back(pair.second());
     oba2sbp_identical_obas[pair.second()].push_back(pair.first());
   }
+  // the nodes whose consumers may get other blobs than from their nodes in prev_op_graph
+  HashSet<const OpNode*> output_changed_nodes;
+  int64_t reused_node_cnt = 0;
   JUST(TopoForEachNodeWithErrorCaptured([&](OpNode* op_node) -> Maybe<void> {
+    bool is_mirrored_conf = false;
+    {
+      const auto& op_name2is_mirrored = job_parallel_view_conf.op_name2is_mirrored_parallel_view();
+      const auto& iter = op_name2is_mirrored.find(op_node->op().op_name());
+      if (iter != op_name2is_mirrored.end()) { is_mirrored_conf = iter->second; }
+    }
+    SbpSignature sbp_sig_conf;
+    {
+      const auto& op_name2sbp_sig_conf = job_parallel_view_conf.op_name2sbp_signature_conf();
+      const auto& iter = op_name2sbp_sig_conf.find(op_node->op().op_name());
+      if (iter != op_name2sbp_sig_conf.end()) { sbp_sig_conf = iter->second; }
+    }
+    const OpNode* prev_node = nullptr;
+    if (prev_op_graph != nullptr) {
+      const auto& iter = prev_op_graph->op_name2op_node_.find(op_node->op().op_name());
+      if (iter != prev_op_graph->op_name2op_node_.end()) { prev_node = iter->second; }
+    }
+    if (op_node->is_op_shared_) {
+      bool is_input_changed = false;
+      for (const std::string& ibn : op_node->op().input_bns()) {
+        if (output_changed_nodes.find(op_node->MutSrcNode4Ibn(ibn)) != output_changed_nodes.end()) {
+          is_input_changed = true;
+          break;
+        }
+      }
+      if (!is_input_changed && prev_node->is_mirrored_conf_ == is_mirrored_conf
+          && prev_node->sbp_signature_conf_ == sbp_sig_conf) {
+        op_node->CopyInferredFrom(*prev_node);
+        UpdateJobParallelViewConf(*op_node, oba2sbp_identical_obas, &job_parallel_view_conf);
+        reused_node_cnt += 1;
+        return Maybe<void>::Ok();
+      }
+      // inferred by an Operator of its own, leaving the one of prev_node as it is
+      op_node->ConstructOwnOp();
+    }
     // Infer ParallelSignature
     JUST(op_node->mut_op()->InferParallelSignatureIf());
     // Infer batch_axis
@@ -584,21 +713,11 @@ Maybe<void> OpGraph::InferLogicalBlobDesc(const Job& job) const {
     };
     JUST(op_node->mut_op()->InferBatchAxisIf(LogicalBlobDesc4Ibn, BatchAxis4Ibn));
     // Infer mirrored_signature
-    bool is_mirrored_conf = false;
-    {
-      const auto& op_name2is_mirrored = job_parallel_view_conf.op_name2is_mirrored_parallel_view();
-      const auto& iter = op_name2is_mirrored.find(op_node->op().op_name());
-      if (iter != op_name2is_mirrored.end()) { is_mirrored_conf = iter->second; }
-    }
     JUST(InferOpNodeMirroredSignature(op_node, is_mirrored_conf));
     // Infer sbp_signature
-    SbpSignature sbp_sig_conf;
-    {
-      const auto& op_name2sbp_sig_conf = job_parallel_view_conf.op_name2sbp_signature_conf();
-      const auto& iter = op_name2sbp_sig_conf.find(op_node->op().op_name());
-      if (iter != op_name2sbp_sig_conf.end()) { sbp_sig_conf = iter->second; }
-    }
     InferOpNodeSbpSignature(op_node, sbp_sig_conf);
+    op_node->is_mirrored_conf_ = is_mirrored_conf;
+    op_node->sbp_signature_conf_ = sbp_sig_conf;
     op_node->InferBlobParallelDesc();
     UpdateJobParallelViewConf(*op_node, oba2sbp_identical_obas, &job_parallel_view_conf);
     // Infer logical_blob_desc
@@ -608,8 +727,16 @@ Maybe<void> OpGraph::InferLogicalBlobDesc(const Job& job) const {
         [&](const std::string& bn_in_op) -> Maybe<const BlobDesc&> {
           return op_node->LogicalBlobDesc4Lbi(op_node->op().BnInOp2Lbi(bn_in_op));
         }));
+    if (prev_op_graph != nullptr
+        && (prev_node == nullptr || !op_node->HasSameOutputsAs(*prev_node))) {
+      output_changed_nodes.insert(op_node);
+    }
     return Maybe<void>::Ok();
   }));
+  if (prev_op_graph != nullptr) {
+    VLOG(1) << "OpGraph of " << node_num() << " ops, " << node_num() - reused_node_cnt
+            << " of them inferred again";
+  }
   return Maybe<void>::Ok();
 }
 
@@ -799,6 +926,7 @@ std::list<OpNode*> OpGraph::DataOrCtrlSourceNodes() const {
 }
 
 void OpGraph::DumpLogicalBlobDesc(Job* job) const {
+  IncreaseJobEditCnt();
   auto* helper = job->mutable_helper();
   ForEachNode([&](const OpNode* node) {
     for (const auto& obn : node->op().output_bns()) {
@@ -810,6 +938,7 @@ void OpGraph::DumpLogicalBlobDesc(Job* job) const {
 }
 
 void OpGraph::DumpSbpSignature(Job* job) const {
+  IncreaseJobEditCnt();
   ForEachNode([&](const OpNode* node) {
     (*job->mutable_job_parallel_view_conf()
           ->mutable_op_name2sbp_signature_conf())[node->op().op_name()] = node->sbp_signature();
@@ -817,6 +946,7 @@ void OpGraph::DumpSbpSignature(Job* job) const {
 }
 
 void OpGraph::DumpOpTimeShape(Job* job) const {
+  IncreaseJobEditCnt();
   ForEachNode([&](OpNode* op_node) {
     auto* op_time_shape =
         &(*job->mutable_helper()->mutable_op_name2op_time_shape())[op_node->op().op_name()];
@@ -831,6 +961,7 @@ void OpGraph::DumpOpTimeShape(Job* job) const {
 }
 
 void OpGraph::DumpBatchAxisLbi(Job* job) const {
+  IncreaseJobEditCnt();
   auto* lbn2batch_axis = job->mutable_helper()->mutable_lbn2batch_axis();
   ForEachNode([&](OpNode* op_node) {
     for (const auto& obn : op_node->op().output_bns()) {
@@ -34,7 +34,16 @@ class OpNode final : public Node<OpNode, OpEdge> {
   explicit OpNode(const ParallelDesc& parallel_desc, const OperatorConf& op_conf)
       : parallel_desc_(parallel_desc),
         op_(ConstructOp(op_conf, parallel_desc.device_type(), &GlobalJobDesc())),
-        ibns_(op_->input_bns().begin(), op_->input_bns().end()) {}
+        ibns_(op_->input_bns().begin(), op_->input_bns().end()),
+        is_op_shared_(false),
+        is_mirrored_conf_(false) {}
+  // the node of an op unchanged since an earlier graph, sharing its Operator
+  explicit OpNode(const ParallelDesc& parallel_desc, std::shared_ptr<Operator> op)
+      : parallel_desc_(parallel_desc),
+        op_(std::move(op)),
+        ibns_(op_->input_bns().begin(), op_->input_bns().end()),
+        is_op_shared_(true),
+        is_mirrored_conf_(false) {}
   ~OpNode() = default;
 
   // Getters
@@ -89,6 +98,14 @@ class OpNode final : public Node<OpNode, OpEdge> {
   void InitInputBlobFastestTimeShape();
   void InitLbi2SbpParallel();
   void InitLbi2MirroredParallel();
+  // copies the inference results of prev_node, the node of the same Operator in an earlier graph
+  void CopyInferredFrom(const OpNode& prev_node);
+  // replaces the Operator shared with a node of an earlier graph by one of its own, with the same
+  // blob last used signature
+  void ConstructOwnOp();
+  // whether the consumers of this node get the same blobs from it as from prev_node, the node of
+  // the same op name in an earlier graph
+  bool HasSameOutputsAs(const OpNode& prev_node) const;
 
   ParallelDesc parallel_desc_;
   HashMap<std::string, ParallelDesc> obn2blob_parallel_desc_;
@@ -100,6 +117,11 @@ class OpNode final : public Node<OpNode, OpEdge> {
   HashMap<LogicalBlobId, OpNode*> lbi2source_node_;
   std::unique_ptr<Shape> input_blob_fastest_time_shape_;
   HashMap<LogicalBlobId, SbpParallel> lbi2sbp_parallel_;
+  // whether op_ is the Operator of a node of an earlier graph, which is not to be mutated
+  bool is_op_shared_;
+  // the confs the sbp and mirrored signatures are inferred with
+  SbpSignature sbp_signature_conf_;
+  bool is_mirrored_conf_;
 };
 
 class OpEdge final : public Edge<OpNode, OpEdge> {
@@ -139,6 +161,11 @@ class OpGraph final : public Graph<OpNode, OpEdge> {
   ~OpGraph() override = default;
 
   static Maybe<OpGraph> New(const Job& job);
+  // The graph of job, changed from the one prev_op_graph was built of, by this function too. The
+  // nodes of the ops whose confs, placements and inputs are unchanged share their Operators with
+  // prev_op_graph and copy its inference results, only the others are inferred again. prev_op_graph
+  // is left as it is, and the graph is the same as one built of job from scratch.
+  static Maybe<OpGraph> New(const Job& job, const OpGraph* prev_op_graph);
 
   Maybe<void> ForEachOpNode(const std::function<Maybe<void>(const OpNode&)>& DoEach) const;
 
@@ -172,9 +199,10 @@ class OpGraph final : public Graph<OpNode, OpEdge> {
   void DumpBatchAxisLbi(Job* job) const;
 
   Maybe<void> Init(const Job& job);
+  Maybe<void> Init(const Job& job, const OpGraph* prev_op_graph);
 
  private:
-  void InitNodes(const Job& job);
+  void InitNodes(const Job& job, const OpGraph* prev_op_graph);
   void InitEdges();
   void InitProducerOpName2CtrlConsumerOpNames(const Job& job);
   void CheckIsDAG() const;
@@ -183,7 +211,7 @@ class OpGraph final : public Graph<OpNode, OpEdge> {
   void InferOpNodeSbpSignature(OpNode* op_node, const SbpSignature& sbp_sig_conf) const;
   Maybe<void> InferOpNodeMirroredSignature(OpNode* op_node, bool is_mirrored_conf) const;
   Maybe<void> InferOpNodeLogicalBlobDesc(OpNode* op_node) const;
-  Maybe<void> InferLogicalBlobDesc(const Job& job) const;
+  Maybe<void> InferLogicalBlobDesc(const Job& job, const OpGraph* prev_op_graph) const;
   bool IsBatchAxisBlob(const std::string& op_name, const LogicalBlobId& lbi) const;
   std::string GetOpNameKey(const std::string& op_name, const LogicalBlobId& lbi) const;
   LogicalBlobId GetLogicalBlobIdKey(const std::string& op_name, const LogicalBlobId& lbi) const;
@@ -194,6 +222,10 @@ class OpGraph final : public Graph<OpNode, OpEdge> {
   HashMap<std::string, OpNode*> op_name2op_node_;
   std::list<std::string> op_names_;
   HashMap<std::string, HashSet<std::string>> producer_op_name2ctrl_consumer_op_names_;
+  // whether the serialized confs of the ops in the job are kept, to find the ones unchanged in a
+  // later version of it
+  bool keeps_op_confs_ = false;
+  HashMap<std::string, std::string> op_name2serialized_op_conf_;
 };
 
 }  // namespace oneflow
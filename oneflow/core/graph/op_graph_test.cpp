@@ -0,0 +1,180 @@
+/*
+Copyright 2020 The OneFlow Authors. All rights reserved.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+*/
+#include <gtest/gtest.h>
+#include "oneflow/core/graph/op_graph.h"
+#include "oneflow/core/job/env_desc.h"
+#include "oneflow/core/job/global_for.h"
+#include "oneflow/core/job/job_builder.h"
+#include "oneflow/core/job/job_desc.h"
+#include "oneflow/core/job/resource_desc.h"
+
+namespace oneflow {
+
+namespace {
+
+void NewGlobals() {
+  EnvProto env_proto;
+  auto* machine = env_proto.add_machine();
+  machine->set_id(0);
+  machine->set_addr("127.0.0.1");
+  env_proto.set_ctrl_port(9527);
+  Global<EnvDesc>::New(env_proto);
+  Resource resource;
+  resource.set_machine_num(1);
+  resource.set_cpu_device_num(2);
+  Global<ResourceDesc, ForSession>::New(resource);
+}
+
+void DeleteGlobals() {
+  Global<ResourceDesc, ForSession>::Delete();
+  Global<EnvDesc>::Delete();
+}
+
+ParallelConf CpuParallelConf(const std::string& device_name) {
+  ParallelConf parallel_conf;
+  parallel_conf.set_device_tag("cpu");
+  parallel_conf.add_device_name(device_name);
+  return parallel_conf;
+}
+
+OperatorConf MakeIdentityOpConf(const std::string& name, const std::string& in) {
+  OperatorConf op_conf;
+  op_conf.set_name(name);
+  op_conf.mutable_identity_conf()->set_in(in);
+  op_conf.mutable_identity_conf()->set_out("out");
+  return op_conf;
+}
+
+OperatorConf MakeVariableOpConf(const std::string& name, const std::vector<int64_t>& shape) {
+  OperatorConf op_conf;
+  op_conf.set_name(name);
+  auto* variable_conf = op_conf.mutable_variable_conf();
+  variable_conf->set_tick("tick/out");
+  variable_conf->set_out("out");
+  for (const int64_t dim : shape) { variable_conf->mutable_shape()->add_dim(dim); }
+  variable_conf->set_data_type(DataType::kFloat);
+  variable_conf->mutable_initializer()->mutable_constant_conf()->set_value(0);
+  variable_conf->mutable_split_axis()->set_value(0);
+  return op_conf;
+}
+
+// tick -> var -> id0 -> id1 -> id2, with var and the identities on two devices
+Job ChainJob() {
+  Job job;
+  job.mutable_job_conf()->set_job_name("chain");
+  job.mutable_job_conf()->mutable_predict_conf();
+  JobBuilder job_builder(&job);
+  OperatorConf tick_op_conf;
+  tick_op_conf.set_name("tick");
+  tick_op_conf.mutable_source_tick_conf()->set_out("out");
+  job_builder.AddOps(CpuParallelConf("0:0"), {tick_op_conf});
+  job_builder.AddOps(CpuParallelConf("0:0-1"), {MakeVariableOpConf("var", {8, 4}),
+                                                MakeIdentityOpConf("id0", "var/out"),
+                                                MakeIdentityOpConf("id1", "id0/out"),
+                                                MakeIdentityOpConf("id2", "id1/out")});
+  return job;
+}
+
+// the inference results of the nodes of op_graph, by op name
+HashMap<std::string, std::string> InferredStr4OpName(const OpGraph& op_graph) {
+  HashMap<std::string, std::string> ret;
+  op_graph.ForEachNode([&](OpNode* op_node) {
+    const Operator& op = op_node->op();
+    std::string str = op_node->parallel_desc().parallel_conf().DebugString()
+                      + op_node->sbp_signature().DebugString()
+                      + op.blob_last_used_signature().DebugString();
+    if (op_node->out_blob_time_shape() != nullptr) {
+      str += op_node->out_blob_time_shape()->DebugStr();
+    }
+    for (const std::string& obn : op.output_bns()) {
+      const LogicalBlobId& lbi = op.BnInOp2Lbi(obn);
+      BlobDescProto blob_desc;
+      op_node->LogicalBlobDesc4Lbi(lbi).ToProto(&blob_desc);
+      str += obn + blob_desc.DebugString()
+             + CHECK_JUST(op_node->BatchAxis4Lbi(lbi))->DebugString()
+             + op_node->BlobParallelDesc4Obn(obn).parallel_conf().DebugString();
+    }
+    CHECK(ret.emplace(op.op_name(), str).second);
+  });
+  return ret;
+}
+
+// Builds the graph of job from the one of prev_job, and checks it against the graph built of job
+// from scratch, and prev_op_graph against the one of prev_job.
+std::shared_ptr<OpGraph> CheckNewOpGraph(const Job& job, const Job& prev_job,
+                                         const OpGraph* prev_op_graph) {
+  const auto& op_graph = CHECK_JUST(OpGraph::New(job, prev_op_graph));
+  EXPECT_EQ(InferredStr4OpName(*op_graph), InferredStr4OpName(OpGraph(job)));
+  if (prev_op_graph != nullptr) {
+    EXPECT_EQ(InferredStr4OpName(*prev_op_graph), InferredStr4OpName(OpGraph(prev_job)));
+  }
+  return op_graph;
+}
+
+}  // namespace
+
+TEST(OpGraph, new_from_prev_op_graph) {
+  NewGlobals();
+  {
+    JobConfigProto job_conf;
+    job_conf.set_job_name("chain");
+    job_conf.mutable_predict_conf();
+    GlobalJobDescScope scope(job_conf, 0);
+    Job job = ChainJob();
+    std::shared_ptr<OpGraph> op_graph = CheckNewOpGraph(job, job, nullptr);
+    // unchanged, with every Operator shared
+    {
+      const std::shared_ptr<OpGraph> prev_op_graph = op_graph;
+      op_graph = CheckNewOpGraph(job, job, prev_op_graph.get());
+      op_graph->ForEachNode([&](OpNode* op_node) {
+        ASSERT_EQ(&op_node->op(), &prev_op_graph->OpNode4OpName(op_node->op().op_name())->op());
+      });
+    }
+    const std::vector<std::function<void(JobBuilder*)>> edits{
+        // the shape of a variable, so the ops after it are inferred again
+        [](JobBuilder* job_builder) {
+          job_builder->MutOpsOnlyOnce({MakeVariableOpConf("var", {6, 4})});
+        },
+        // an op consuming a blob, which is not the last use of it any more
+        [](JobBuilder* job_builder) {
+          job_builder->AddOps(CpuParallelConf("0:0-1"), {MakeIdentityOpConf("id3", "id0/out")});
+        },
+        // the sbp signature of an op, and the sbp of the op consuming its blob
+        [](JobBuilder* job_builder) {
+          SbpSignature sbp_signature;
+          auto* bn_in_op2sbp_parallel = sbp_signature.mutable_bn_in_op2sbp_parallel();
+          (*bn_in_op2sbp_parallel)["in"].mutable_split_parallel()->set_axis(1);
+          (*bn_in_op2sbp_parallel)["out"].mutable_split_parallel()->set_axis(1);
+          job_builder->AddSbpSignature4OpName("id1", sbp_signature);
+        },
+        // the placement of an op
+        [](JobBuilder* job_builder) {
+          job_builder->MutParallelConfOnlyOnce("id2", CpuParallelConf("0:1"));
+        },
+        // an op removed
+        [](JobBuilder* job_builder) { job_builder->DelOps(std::vector<std::string>{"id3"}); },
+    };
+    for (const auto& Edit : edits) {
+      const Job prev_job = job;
+      JobBuilder job_builder(&job);
+      Edit(&job_builder);
+      op_graph = CheckNewOpGraph(job, prev_job, op_graph.get());
+    }
+  }
+  DeleteGlobals();
+}
+
+}  // namespace oneflow
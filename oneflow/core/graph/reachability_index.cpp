@@ -0,0 +1,158 @@
+/*
+Copyright 2020 The OneFlow Authors. All rights reserved.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+*/
+#include "oneflow/core/graph/reachability_index.h"
+
+namespace oneflow {
+
+namespace {
+
+// the words of the bitset of node i, for the nodes before it
+int64_t AncestorBitsetWordNum(int64_t i) { return (i + 63) / 64; }
+
+}  // namespace
+
+ReachabilityIndex::ReachabilityIndex(const std::vector<std::vector<int64_t>>& in_nodes)
+    : node_num_(in_nodes.size()) {
+  if (node_num_ <= kReachabilityIndexMaxDenseNodeNum) {
+    InitAncestorBitsets(in_nodes);
+  } else {
+    InitIntervalLabels(in_nodes);
+  }
+}
+
+void ReachabilityIndex::InitAncestorBitsets(const std::vector<std::vector<int64_t>>& in_nodes) {
+  ancestor_bitset_offsets_.resize(node_num_);
+  int64_t word_num = 0;
+  FOR_RANGE(int64_t, i, 0, node_num_) {
+    ancestor_bitset_offsets_[i] = word_num;
+    word_num += AncestorBitsetWordNum(i);
+  }
+  ancestor_bitsets_.assign(word_num, 0);
+  FOR_RANGE(int64_t, i, 0, node_num_) {
+    uint64_t* bitset = ancestor_bitsets_.data() + ancestor_bitset_offsets_[i];
+    for (const int64_t in_node : in_nodes[i]) {
+      CHECK_LT(in_node, i);
+      // the bitset of the in-node is a prefix of the one of node i
+      const uint64_t* in_bitset = ancestor_bitsets_.data() + ancestor_bitset_offsets_[in_node];
+      FOR_RANGE(int64_t, w, 0, AncestorBitsetWordNum(in_node)) { bitset[w] |= in_bitset[w]; }
+      bitset[in_node / 64] |= uint64_t(1) << (in_node % 64);
+    }
+  }
+}
+
+void ReachabilityIndex::InitIntervalLabels(const std::vector<std::vector<int64_t>>& in_nodes) {
+  out_node_offsets_.assign(node_num_ + 1, 0);
+  FOR_RANGE(int64_t, i, 0, node_num_) {
+    for (const int64_t in_node : in_nodes[i]) {
+      CHECK_LT(in_node, i);
+      out_node_offsets_[in_node + 1] += 1;
+    }
+  }
+  FOR_RANGE(int64_t, i, 0, node_num_) { out_node_offsets_[i + 1] += out_node_offsets_[i]; }
+  out_nodes_.resize(out_node_offsets_[node_num_]);
+  std::vector<int64_t> out_node_cnts(node_num_, 0);
+  FOR_RANGE(int64_t, i, 0, node_num_) {
+    for (const int64_t in_node : in_nodes[i]) {
+      out_nodes_[out_node_offsets_[in_node] + out_node_cnts[in_node]] = i;
+      out_node_cnts[in_node] += 1;
+    }
+  }
+  std::vector<int64_t> roots;
+  FOR_RANGE(int64_t, i, 0, node_num_) {
+    if (in_nodes[i].empty()) { roots.push_back(i); }
+  }
+  interval_begins_.resize(kReachabilityIndexLabelNum * node_num_);
+  ranks_.resize(kReachabilityIndexLabelNum * node_num_);
+  // a depth first search from the roots for each label, visiting the out-nodes forward for even
+  // labels and backward for odd ones. The rank of a node is its post order, and its interval
+  // begins at the least rank of the nodes reachable from it, all ranked before it.
+  FOR_RANGE(int64_t, k, 0, kReachabilityIndexLabelNum) {
+    const bool backward = k % 2 == 1;
+    int64_t* interval_begins = interval_begins_.data() + k * node_num_;
+    int64_t* ranks = ranks_.data() + k * node_num_;
+    std::vector<bool> visited(node_num_, false);
+    // the nodes on the path and the number of their out-nodes seen
+    std::vector<std::pair<int64_t, int64_t>> stack;
+    int64_t rank = 0;
+    FOR_RANGE(size_t, r, 0, roots.size()) {
+      const int64_t root = backward ? roots[roots.size() - 1 - r] : roots[r];
+      visited[root] = true;
+      stack.emplace_back(root, 0);
+      while (!stack.empty()) {
+        const int64_t node = stack.back().first;
+        const int64_t out_begin = out_node_offsets_[node];
+        const int64_t out_num = out_node_offsets_[node + 1] - out_begin;
+        if (stack.back().second < out_num) {
+          const int64_t j = stack.back().second;
+          stack.back().second += 1;
+          const int64_t out = out_nodes_[out_begin + (backward ? out_num - 1 - j : j)];
+          if (!visited[out]) {
+            visited[out] = true;
+            stack.emplace_back(out, 0);
+          }
+        } else {
+          ranks[node] = rank;
+          interval_begins[node] = rank;
+          rank += 1;
+          FOR_RANGE(int64_t, j, out_begin, out_begin + out_num) {
+            interval_begins[node] = std::min(interval_begins[node], interval_begins[out_nodes_[j]]);
+          }
+          stack.pop_back();
+        }
+      }
+    }
+    CHECK_EQ(rank, node_num_);
+  }
+}
+
+bool ReachabilityIndex::LabelsContain(int64_t node, int64_t dst) const {
+  FOR_RANGE(int64_t, k, 0, kReachabilityIndexLabelNum) {
+    const int64_t offset = k * node_num_;
+    if (interval_begins_[offset + node] > interval_begins_[offset + dst]
+        || ranks_[offset + node] < ranks_[offset + dst]) {
+      return false;
+    }
+  }
+  return true;
+}
+
+bool ReachabilityIndex::IsReachable(int64_t src, int64_t dst) const {
+  CHECK_GE(src, 0);
+  CHECK_LT(dst, node_num_);
+  // the nodes reachable from src are after it in the order
+  if (src >= dst) { return false; }
+  if (node_num_ <= kReachabilityIndexMaxDenseNodeNum) {
+    const uint64_t word = ancestor_bitsets_[ancestor_bitset_offsets_[dst] + src / 64];
+    return (word >> (src % 64)) & 1;
+  }
+  if (!LabelsContain(src, dst)) { return false; }
+  std::vector<int64_t> stack{src};
+  HashSet<int64_t> visited{src};
+  while (!stack.empty()) {
+    const int64_t node = stack.back();
+    stack.pop_back();
+    FOR_RANGE(int64_t, j, out_node_offsets_[node], out_node_offsets_[node + 1]) {
+      const int64_t out = out_nodes_[j];
+      if (out == dst) { return true; }
+      if (out < dst && LabelsContain(out, dst) && visited.insert(out).second) {
+        stack.push_back(out);
+      }
+    }
+  }
+  return false;
+}
+
+}  // namespace oneflow
@@ -0,0 +1,60 @@
+/*
+Copyright 2020 The OneFlow Authors. All rights reserved.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+*/
+#ifndef ONEFLOW_CORE_GRAPH_REACHABILITY_INDEX_H_
+#define ONEFLOW_CORE_GRAPH_REACHABILITY_INDEX_H_
+
+#include "oneflow/core/common/util.h"
+
+namespace oneflow {
+
+constexpr int64_t kReachabilityIndexMaxDenseNodeNum = 16384;
+constexpr int64_t kReachabilityIndexLabelNum = 2;
+
+// Answers whether there is a path from one node of a DAG to another, of the nodes numbered in a
+// topological order. Up to kReachabilityIndexMaxDenseNodeNum nodes, each keeps a bitset of its
+// ancestors, the ones before it in the order, ORed from the bitsets of its in-nodes a word at a
+// time. Larger graphs keep for each node kReachabilityIndexLabelNum intervals of post-order
+// ranks, containing the intervals of every node reachable from it, and a query searches from src
+// only through the nodes whose intervals contain those of dst.
+class ReachabilityIndex final {
+ public:
+  OF_DISALLOW_COPY_AND_MOVE(ReachabilityIndex);
+  // in_nodes[i] are the in-nodes of node i, all less than i
+  explicit ReachabilityIndex(const std::vector<std::vector<int64_t>>& in_nodes);
+  ~ReachabilityIndex() = default;
+
+  // false for src == dst
+  bool IsReachable(int64_t src, int64_t dst) const;
+
+ private:
+  void InitAncestorBitsets(const std::vector<std::vector<int64_t>>& in_nodes);
+  void InitIntervalLabels(const std::vector<std::vector<int64_t>>& in_nodes);
+  bool LabelsContain(int64_t node, int64_t dst) const;
+
+  int64_t node_num_;
+  // bits [0, i) of node i from ancestor_bitset_offsets_[i]
+  std::vector<int64_t> ancestor_bitset_offsets_;
+  std::vector<uint64_t> ancestor_bitsets_;
+  // label k of node i is [interval_begins_[k * node_num_ + i], ranks_[k * node_num_ + i]]
+  std::vector<int64_t> interval_begins_;
+  std::vector<int64_t> ranks_;
+  std::vector<int64_t> out_node_offsets_;
+  std::vector<int64_t> out_nodes_;
+};
+
+}  // namespace oneflow
+
+#endif  // ONEFLOW_CORE_GRAPH_REACHABILITY_INDEX_H_
@@ -0,0 +1,123 @@
+/*
+Copyright 2020 The OneFlow Authors. All rights reserved.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+*/
+#include <gtest/gtest.h>
+#include <chrono>
+#include "oneflow/core/graph/reachability_index.h"
+
+namespace oneflow {
+
+namespace {
+
+// each node after the first few has 1 to max_in_num in-nodes, mostly among the window nodes
+// before it, so that there are long paths as in the graphs of jobs
+std::vector<std::vector<int64_t>> RandomDag(int64_t node_num, int64_t max_in_num, int64_t window,
+                                            int64_t seed) {
+  std::mt19937 gen(seed);
+  std::vector<std::vector<int64_t>> in_nodes(node_num);
+  FOR_RANGE(int64_t, i, 0, node_num) {
+    if (gen() % 10 == 0) { continue; }
+    const int64_t in_num = std::min<int64_t>(i, 1 + gen() % max_in_num);
+    FOR_RANGE(int64_t, j, 0, in_num) {
+      const int64_t range = gen() % 20 == 0 ? i : std::min(i, window);
+      in_nodes[i].push_back(i - 1 - gen() % range);
+    }
+  }
+  return in_nodes;
+}
+
+// the nodes reachable from src, by a sweep in the topological order
+std::vector<bool> Descendants(const std::vector<std::vector<int64_t>>& in_nodes, int64_t src) {
+  std::vector<bool> reachable(in_nodes.size(), false);
+  FOR_RANGE(int64_t, i, src + 1, in_nodes.size()) {
+    for (const int64_t in_node : in_nodes[i]) {
+      if (in_node == src || reachable[in_node]) { reachable[i] = true; }
+    }
+  }
+  return reachable;
+}
+
+void TestReachability(const std::vector<std::vector<int64_t>>& in_nodes, int64_t src_num) {
+  const ReachabilityIndex index(in_nodes);
+  const int64_t node_num = in_nodes.size();
+  std::mt19937 gen(node_num);
+  FOR_RANGE(int64_t, s, 0, src_num) {
+    const int64_t src = gen() % node_num;
+    const std::vector<bool> expected = Descendants(in_nodes, src);
+    FOR_RANGE(int64_t, dst, 0, node_num) {
+      ASSERT_EQ(index.IsReachable(src, dst), expected[dst])
+          << "src " << src << " dst " << dst << " of " << node_num;
+    }
+  }
+}
+
+}  // namespace
+
+TEST(ReachabilityIndex, ancestor_bitsets) {
+  for (const int64_t node_num : {int64_t(1), int64_t(2), int64_t(63), int64_t(64), int64_t(65),
+                                 int64_t(1000), kReachabilityIndexMaxDenseNodeNum}) {
+    TestReachability(RandomDag(node_num, 3, 10, node_num), 30);
+  }
+}
+
+TEST(ReachabilityIndex, interval_labels) {
+  TestReachability(RandomDag(kReachabilityIndexMaxDenseNodeNum + 1, 3, 10, 0), 30);
+  TestReachability(RandomDag(3 * kReachabilityIndexMaxDenseNodeNum, 2, 200, 1), 10);
+}
+
+// times building the index of DAGs and 10k queries, against the ancestor hash sets
+// Graph::MakePredicatorIsReachable kept before for the graphs they fit in memory, run with
+// --gtest_also_run_disabled_tests
+TEST(ReachabilityIndex, DISABLED_benchmark) {
+  const auto Time = [](const std::function<void()>& Run) {
+    const auto start = std::chrono::steady_clock::now();
+    Run();
+    return std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start)
+        .count();
+  };
+  std::mt19937 gen(0);
+  for (const int64_t node_num : {1000, 5000, 16384, 50000, 200000}) {
+    const std::vector<std::vector<int64_t>> in_nodes = RandomDag(node_num, 2, 20, 0);
+    std::vector<std::pair<int64_t, int64_t>> queries;
+    FOR_RANGE(int64_t, i, 0, 10000) { queries.emplace_back(gen() % node_num, gen() % node_num); }
+    int64_t reachable_cnt = 0;
+    const double index_ms = Time([&]() {
+      const ReachabilityIndex index(in_nodes);
+      for (const auto& query : queries) {
+        reachable_cnt += index.IsReachable(query.first, query.second);
+      }
+    });
+    LOG(INFO) << node_num << " nodes, " << reachable_cnt << " of " << queries.size()
+              << " reachable: reachability index " << index_ms << "ms";
+    if (node_num > 5000) { continue; }
+    int64_t hash_set_reachable_cnt = 0;
+    const double hash_set_ms = Time([&]() {
+      std::vector<HashSet<int64_t>> ancestors(node_num);
+      FOR_RANGE(int64_t, i, 0, node_num) {
+        for (const int64_t in_node : in_nodes[i]) {
+          ancestors[i].insert(in_node);
+          ancestors[i].insert(ancestors[in_node].begin(), ancestors[in_node].end());
+        }
+      }
+      for (const auto& query : queries) {
+        hash_set_reachable_cnt += ancestors[query.second].count(query.first);
+      }
+    });
+    ASSERT_EQ(reachable_cnt, hash_set_reachable_cnt);
+    LOG(INFO) << node_num << " nodes: ancestor hash sets " << hash_set_ms << "ms";
+  }
+}
+
+}  // namespace oneflow
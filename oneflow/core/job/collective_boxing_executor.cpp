@@ -14,6 +14,7 @@ See the License for the specific language governing permissions and
 limitations under the License.
 */
 #include "oneflow/core/job/collective_boxing_executor.h"
+#include "oneflow/core/job/cpu_collective_boxing_executor_backend.h"
 #include "oneflow/core/device/nccl_util.h"
 #include "oneflow/core/graph/boxing/collective_boxing_util.h"
 #include "oneflow/core/job/resource_desc.h"
@@ -75,8 +76,6 @@ int64_t GetAlignedRequestSize(const RequestDesc* request) {
 
 }  // namespace
 
-#ifdef WITH_CUDA
-
 void CollectiveBoxingExecutorBackend::GroupRequests(
     const std::vector<const RequestDesc*>& requests,
     std::vector<std::vector<const RequestDesc*>>* groups) {
@@ -85,6 +84,77 @@ void CollectiveBoxingExecutorBackend::GroupRequests(
   }
 }
 
+void CollectiveBoxingExecutorBackend::GroupRequestsByFusionConf(
+    const std::vector<const RequestDesc*>& requests, const CollectiveBoxingConf& conf,
+    int64_t fusion_threshold, bool fuse_all_reduce_into_buffer,
+    std::vector<std::vector<const RequestDesc*>>* groups) {
+  std::vector<const RequestDesc*> group;
+  int64_t group_size = 0;
+  auto IsOpFusionEnabled = [&](const RequestDesc* request) -> bool {
+    const OpType op_type = request->op_desc().op_type();
+    if (op_type == OpType::kOpTypeAllReduce) {
+      return conf.nccl_fusion_all_reduce();
+    } else if (op_type == OpType::kOpTypeAllGather) {
+      return conf.nccl_fusion_all_gather();
+    } else if (op_type == OpType::kOpTypeReduceScatter) {
+      return conf.nccl_fusion_reduce_scatter();
+    } else if (op_type == OpType::kOpTypeReduce) {
+      return conf.nccl_fusion_reduce();
+    } else if (op_type == OpType::kOpTypeBroadcast) {
+      return conf.nccl_fusion_broadcast();
+    } else if (op_type == OpType::kOpTypeAll2All) {
+      return false;
+    } else {
+      UNIMPLEMENTED();
+      return false;
+    }
+  };
+  auto CanFuse = [&](const RequestDesc* lhs, const RequestDesc* rhs) -> bool {
+    if (lhs->device_set() != rhs->device_set()) { return false; }
+    if (!IsOpFusionEnabled(lhs) || !IsOpFusionEnabled(rhs)) { return false; }
+    if (lhs->op_desc().op_type() != rhs->op_desc().op_type()) { return false; }
+    const OpType op_type = lhs->op_desc().op_type();
+    if (op_type == OpType::kOpTypeAllReduce) {
+      if (fuse_all_reduce_into_buffer) {
+        CHECK(lhs->op_desc().has_reduce_method());
+        CHECK(rhs->op_desc().has_reduce_method());
+        return lhs->op_desc().reduce_method() == rhs->op_desc().reduce_method()
+               && lhs->op_desc().data_type() == rhs->op_desc().data_type();
+      } else {
+        return true;
+      }
+    } else if (op_type == OpType::kOpTypeReduce || op_type == OpType::kOpTypeBroadcast
+               || op_type == OpType::kOpTypeReduceScatter || op_type == OpType::kOpTypeAllGather) {
+      return true;
+    } else if (op_type == OpType::kOpTypeAll2All) {
+      return false;
+    } else {
+      UNIMPLEMENTED();
+      return false;
+    }
+  };
+
+  for (const RequestDesc* request : requests) {
+    const int64_t size = GetAlignedRequestSize(request);
+    if (group.empty() || !CanFuse(group.back(), request) || group_size + size > fusion_threshold
+        || group.size() >= conf.nccl_fusion_max_ops()) {
+      if (!group.empty()) {
+        groups->emplace_back();
+        groups->back().swap(group);
+        group_size = 0;
+      }
+    }
+    group.push_back(request);
+    group_size += size;
+  }
+  if (!group.empty()) {
+    groups->emplace_back();
+    groups->back().swap(group);
+  }
+}
+
+#ifdef WITH_CUDA
+
 class NcclCollectiveBoxingExecutorBackend : public CollectiveBoxingExecutorBackend {
  public:
   OF_DISALLOW_COPY_AND_MOVE(NcclCollectiveBoxingExecutorBackend)
@@ -204,69 +274,8 @@ NcclCollectiveBoxingExecutorBackend::~NcclCollectiveBoxingExecutorBackend() {
 void NcclCollectiveBoxingExecutorBackend::GroupRequests(
     const std::vector<const RequestDesc*>& requests,
     std::vector<std::vector<const RequestDesc*>>* groups) {
-  std::vector<const RequestDesc*> group;
-  int64_t group_size = 0;
-  auto IsOpFusionEnabled = [&](const RequestDesc* request) -> bool {
-    const OpType op_type = request->op_desc().op_type();
-    if (op_type == OpType::kOpTypeAllReduce) {
-      return collective_boxing_conf_.nccl_fusion_all_reduce();
-    } else if (op_type == OpType::kOpTypeAllGather) {
-      return collective_boxing_conf_.nccl_fusion_all_gather();
-    } else if (op_type == OpType::kOpTypeReduceScatter) {
-      return collective_boxing_conf_.nccl_fusion_reduce_scatter();
-    } else if (op_type == OpType::kOpTypeReduce) {
-      return collective_boxing_conf_.nccl_fusion_reduce();
-    } else if (op_type == OpType::kOpTypeBroadcast) {
-      return collective_boxing_conf_.nccl_fusion_broadcast();
-    } else if (op_type == OpType::kOpTypeAll2All) {
-      return false;
-    } else {
-      UNIMPLEMENTED();
-      return false;
-    }
-  };
-  auto CanFuse = [&](const RequestDesc* lhs, const RequestDesc* rhs) -> bool {
-    if (lhs->device_set() != rhs->device_set()) { return false; }
-    if (!IsOpFusionEnabled(lhs) || !IsOpFusionEnabled(rhs)) { return false; }
-    if (lhs->op_desc().op_type() != rhs->op_desc().op_type()) { return false; }
-    const OpType op_type = lhs->op_desc().op_type();
-    if (op_type == OpType::kOpTypeAllReduce) {
-      if (collective_boxing_conf_.nccl_fusion_all_reduce_use_buffer()) {
-        CHECK(lhs->op_desc().has_reduce_method());
-        CHECK(rhs->op_desc().has_reduce_method());
-        return lhs->op_desc().reduce_method() == rhs->op_desc().reduce_method()
-               && lhs->op_desc().data_type() == rhs->op_desc().data_type();
-      } else {
-        return true;
-      }
-    } else if (op_type == OpType::kOpTypeReduce || op_type == OpType::kOpTypeBroadcast
-               || op_type == OpType::kOpTypeReduceScatter || op_type == OpType::kOpTypeAllGather) {
-      return true;
-    } else if (op_type == OpType::kOpTypeAll2All) {
-      return false;
-    } else {
-      UNIMPLEMENTED();
-      return false;
-    }
-  };
-
-  for (const RequestDesc* request : requests) {
-    const int64_t size = GetAlignedRequestSize(request);
-    if (group.empty() || !CanFuse(group.back(), request) || group_size + size > fusion_threshold_
-        || group.size() >= collective_boxing_conf_.nccl_fusion_max_ops()) {
-      if (!group.empty()) {
-        groups->emplace_back();
-        groups->back().swap(group);
-        group_size = 0;
-      }
-    }
-    group.push_back(request);
-    group_size += size;
-  }
-  if (!group.empty()) {
-    groups->emplace_back();
-    groups->back().swap(group);
-  }
+  GroupRequestsByFusionConf(requests, collective_boxing_conf_, fusion_threshold_,
+                            collective_boxing_conf_.nccl_fusion_all_reduce_use_buffer(), groups);
 }
 
 void NcclCollectiveBoxingExecutorBackend::ExecuteGroup(
@@ -506,6 +515,11 @@ CollectiveBoxingExecutor::CollectiveBoxingExecutor(const Plan& plan)
           .first;
   it->second->Init(collective_boxing_plan_);
 #endif
+  auto cpu_it =
+      backends_
+          .emplace(Backend::kBackendCPU, std::make_unique<CpuCollectiveBoxingExecutorBackend>())
+          .first;
+  cpu_it->second->Init(collective_boxing_plan_);
   Init();
   DumpSummary();
 }
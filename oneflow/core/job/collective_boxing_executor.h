@@ -18,6 +18,7 @@ limitations under the License.
 
 #include "oneflow/core/common/util.h"
 #include "oneflow/core/job/plan.pb.h"
+#include "oneflow/core/job/resource.pb.h"
 #include "oneflow/core/common/maybe.h"
 #include "oneflow/core/device/device_context.h"
 
@@ -44,6 +45,15 @@ class CollectiveBoxingExecutorBackend {
                              std::vector<std::vector<const RequestDesc*>>* groups);
   virtual void ExecuteGroup(const std::vector<const RequestDesc*>& group,
                             const std::vector<std::map<int64_t, RuntimeRequestInfo>>& ranks) = 0;
+
+ protected:
+  // Fuses consecutive requests as allowed by the nccl_fusion_* options of conf, a group holds at
+  // most fusion_threshold bytes. All reduce requests fused into one buffer must also agree on the
+  // reduce method and the data type.
+  static void GroupRequestsByFusionConf(const std::vector<const RequestDesc*>& requests,
+                                        const CollectiveBoxingConf& conf, int64_t fusion_threshold,
+                                        bool fuse_all_reduce_into_buffer,
+                                        std::vector<std::vector<const RequestDesc*>>* groups);
 };
 
 class CollectiveBoxingExecutor final {
@@ -0,0 +1,657 @@
+/*
+Copyright 2020 The OneFlow Authors. All rights reserved.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+*/
+#include "oneflow/core/job/cpu_collective_boxing_executor_backend.h"
+#include "oneflow/core/common/balanced_splitter.h"
+#include "oneflow/core/common/blocking_counter.h"
+#include "oneflow/core/common/channel.h"
+#include "oneflow/core/common/data_type_seq.h"
+#include "oneflow/core/job/global_for.h"
+#include "oneflow/core/job/machine_context.h"
+#include "oneflow/core/job/resource_desc.h"
+#include "oneflow/core/transport/transport.h"
+
+namespace oneflow {
+
+namespace boxing {
+
+namespace collective {
+
+namespace {
+
+// keeps the tokens of collective boxing apart from those of other Transport users
+constexpr uint64_t kTokenTag = static_cast<uint64_t>(1) << 63;
+
+struct TransferDesc {
+  bool is_send;
+  int64_t peer;
+  void* ptr;
+  int64_t size;
+};
+
+TransferDesc SendTo(int64_t peer, const void* ptr, int64_t size) {
+  return TransferDesc{true, peer, const_cast<void*>(ptr), size};
+}
+
+TransferDesc RecvFrom(int64_t peer, void* ptr, int64_t size) {
+  return TransferDesc{false, peer, ptr, size};
+}
+
+template<typename T>
+void SumTo(T* dst, const T* src, int64_t elem_cnt) {
+  FOR_RANGE(int64_t, i, 0, elem_cnt) { dst[i] += src[i]; }
+}
+
+void ReduceTo(DataType data_type, void* dst, const void* src, int64_t elem_cnt) {
+  switch (data_type) {
+#define REDUCE_TO_ENTRY(type_cpp, type_proto)                                                   \
+  case type_proto:                                                                             \
+    SumTo<type_cpp>(static_cast<type_cpp*>(dst), static_cast<const type_cpp*>(src), elem_cnt); \
+    break;
+    OF_PP_FOR_EACH_TUPLE(REDUCE_TO_ENTRY, ARITHMETIC_DATA_TYPE_SEQ)
+#undef REDUCE_TO_ENTRY
+    default: UNIMPLEMENTED();
+  }
+}
+
+void CopyIfNeeded(void* dst, const void* src, int64_t size) {
+  if (dst != src && size > 0) { std::memcpy(dst, src, size); }
+}
+
+int64_t GetRequestSize(const RequestDesc* request) {
+  return Shape(request->op_desc().shape()).elem_cnt()
+         * GetSizeOfDataType(request->op_desc().data_type());
+}
+
+bool IsPowerOfTwo(int64_t x) { return x > 0 && (x & (x - 1)) == 0; }
+
+int64_t Mod(int64_t x, int64_t n) { return ((x % n) + n) % n; }
+
+}  // namespace
+
+// Pairs sends and receives between ranks of this process by token, the later of the two copies.
+class CpuCollectiveBoxingExecutorBackend::LocalExchange final {
+ public:
+  OF_DISALLOW_COPY_AND_MOVE(LocalExchange);
+  LocalExchange() = default;
+  ~LocalExchange() { CHECK(token2pending_.empty()); }
+
+  void Send(uint64_t token, const void* ptr, int64_t size, std::function<void()> callback) {
+    Match(token, Pending{true, const_cast<void*>(ptr), size, std::move(callback)});
+  }
+  void Receive(uint64_t token, void* ptr, int64_t size, std::function<void()> callback) {
+    Match(token, Pending{false, ptr, size, std::move(callback)});
+  }
+
+ private:
+  struct Pending {
+    bool is_send;
+    void* ptr;
+    int64_t size;
+    std::function<void()> callback;
+  };
+
+  void Match(uint64_t token, Pending pending) {
+    Pending peer;
+    {
+      std::unique_lock<std::mutex> lock(mutex_);
+      auto it = token2pending_.find(token);
+      if (it == token2pending_.end()) {
+        CHECK(token2pending_.emplace(token, std::move(pending)).second);
+        return;
+      }
+      peer = std::move(it->second);
+      token2pending_.erase(it);
+    }
+    CHECK_NE(peer.is_send, pending.is_send);
+    const Pending& send = pending.is_send ? pending : peer;
+    const Pending& recv = pending.is_send ? peer : pending;
+    CHECK_EQ(send.size, recv.size);
+    std::memcpy(recv.ptr, send.ptr, send.size);
+    send.callback();
+    recv.callback();
+  }
+
+  std::mutex mutex_;
+  HashMap<uint64_t, Pending> token2pending_;
+};
+
+class CpuCollectiveBoxingExecutorBackend::RankWorker final {
+ public:
+  OF_DISALLOW_COPY_AND_MOVE(RankWorker);
+  RankWorker(const DeviceSet& device_set, int64_t rank, int64_t ring_threshold,
+             LocalExchange* local_exchange);
+  ~RankWorker();
+
+  void Enqueue(const std::vector<const RequestDesc*>& group,
+               const std::vector<RuntimeRequestInfo>& request_infos);
+
+ private:
+  void ExecuteGroup(const std::vector<const RequestDesc*>& group,
+                    const std::vector<RuntimeRequestInfo>& request_infos);
+  void ExecuteRequest(const OpDesc& op_desc, const RuntimeRequestInfo& request_info);
+
+  // every rank holds the whole buf, all reduce leaves the sum in everyone's buf, reduce only in
+  // root's, broadcast copies root's buf to the others
+  void AllReduce(char* buf, int64_t elem_cnt, DataType data_type);
+  void Reduce(char* buf, int64_t elem_cnt, DataType data_type, int64_t root);
+  void Broadcast(char* buf, int64_t elem_cnt, DataType data_type, int64_t root);
+  // buf is split into num_ranks_ balanced chunks, reduce scatter leaves the sum of chunk rank_ in
+  // it and all gather starts with every rank holding its own chunk
+  void ReduceScatter(char* buf, int64_t elem_cnt, DataType data_type);
+  void AllGather(char* buf, int64_t elem_cnt, DataType data_type);
+
+  // the building blocks above run among members, idx is the position of this rank in it
+  void RingReduceScatter(const std::vector<int64_t>& members, int64_t idx, char* buf,
+                         int64_t elem_cnt, DataType data_type);
+  void RingAllGather(const std::vector<int64_t>& members, int64_t idx, char* buf,
+                     int64_t elem_cnt, DataType data_type);
+  void HalvingReduceScatter(const std::vector<int64_t>& members, int64_t idx, char* buf,
+                            int64_t elem_cnt, DataType data_type);
+  void DoublingAllGather(const std::vector<int64_t>& members, int64_t idx, char* buf,
+                         int64_t elem_cnt, DataType data_type);
+  void HalvingDoublingAllReduce(char* buf, int64_t elem_cnt, DataType data_type);
+
+  bool UseRing(int64_t size) const { return size >= ring_threshold_; }
+  void DoTransfers(const std::vector<TransferDesc>& transfers);
+  uint64_t GetToken(int64_t src_rank, int64_t dst_rank, int64_t seq) const;
+  char* ScratchBuffer(int64_t size);
+  char* WorkBuffer(int64_t size);
+
+  const int64_t rank_;
+  const int64_t num_ranks_;
+  const int64_t this_machine_id_;
+  const int64_t ring_threshold_;
+  const size_t device_set_hash_;
+  LocalExchange* local_exchange_;
+  std::vector<int64_t> all_ranks_;
+  std::vector<int64_t> rank2machine_id_;
+  // tokens of a pair of ranks are numbered in the order both sides issue the transfers
+  std::vector<int64_t> dst_rank2send_cnt_;
+  std::vector<int64_t> src_rank2recv_cnt_;
+  std::vector<char> scratch_buffer_;
+  std::vector<char> work_buffer_;
+  Channel<std::function<void()>> task_channel_;
+  std::thread thread_;
+};
+
+CpuCollectiveBoxingExecutorBackend::RankWorker::RankWorker(const DeviceSet& device_set,
+                                                           int64_t rank, int64_t ring_threshold,
+                                                           LocalExchange* local_exchange)
+    : rank_(rank),
+      num_ranks_(device_set.device_size()),
+      this_machine_id_(Global<MachineCtx>::Get()->this_machine_id()),
+      ring_threshold_(ring_threshold),
+      device_set_hash_(std::hash<DeviceSet>()(device_set)),
+      local_exchange_(local_exchange) {
+  FOR_RANGE(int64_t, i, 0, num_ranks_) {
+    const DeviceDesc& device_desc = device_set.device(i);
+    CHECK_EQ(device_desc.device_type(), DeviceType::kCPU);
+    all_ranks_.push_back(i);
+    rank2machine_id_.push_back(device_desc.machine_id());
+    if (device_desc.machine_id() != this_machine_id_) {
+      CHECK(Global<Transport>::Get() != nullptr) << "cpu collective boxing needs Transport";
+    }
+  }
+  CHECK_EQ(rank2machine_id_.at(rank_), this_machine_id_);
+  dst_rank2send_cnt_.assign(num_ranks_, 0);
+  src_rank2recv_cnt_.assign(num_ranks_, 0);
+  thread_ = std::thread([this]() {
+    std::function<void()> task;
+    while (task_channel_.Receive(&task) == kChannelStatusSuccess) { task(); }
+  });
+}
+
+CpuCollectiveBoxingExecutorBackend::RankWorker::~RankWorker() {
+  task_channel_.Close();
+  thread_.join();
+}
+
+void CpuCollectiveBoxingExecutorBackend::RankWorker::Enqueue(
+    const std::vector<const RequestDesc*>& group,
+    const std::vector<RuntimeRequestInfo>& request_infos) {
+  const ChannelStatus status =
+      task_channel_.Send([this, group, request_infos]() { ExecuteGroup(group, request_infos); });
+  CHECK_EQ(status, kChannelStatusSuccess);
+}
+
+void CpuCollectiveBoxingExecutorBackend::RankWorker::ExecuteGroup(
+    const std::vector<const RequestDesc*>& group,
+    const std::vector<RuntimeRequestInfo>& request_infos) {
+  CHECK_EQ(group.size(), request_infos.size());
+  if (group.size() > 1 && group.front()->op_desc().op_type() == OpType::kOpTypeAllReduce) {
+    // GroupRequests only fuses all reduce requests of the same data type, they are reduced in
+    // one buffer
+    const DataType data_type = group.front()->op_desc().data_type();
+    int64_t fused_size = 0;
+    for (const RequestDesc* request : group) {
+      CHECK_EQ(request->op_desc().data_type(), data_type);
+      CHECK_EQ(request->op_desc().reduce_method(), ReduceMethod::kReduceMethodSum);
+      fused_size += GetRequestSize(request);
+    }
+    char* fusion_buffer = WorkBuffer(fused_size);
+    int64_t offset = 0;
+    FOR_RANGE(int64_t, i, 0, group.size()) {
+      const int64_t size = GetRequestSize(group.at(i));
+      CopyIfNeeded(fusion_buffer + offset, request_infos.at(i).send_buff, size);
+      offset += size;
+    }
+    AllReduce(fusion_buffer, fused_size / GetSizeOfDataType(data_type), data_type);
+    offset = 0;
+    FOR_RANGE(int64_t, i, 0, group.size()) {
+      const int64_t size = GetRequestSize(group.at(i));
+      CopyIfNeeded(request_infos.at(i).recv_buff, fusion_buffer + offset, size);
+      offset += size;
+    }
+  } else {
+    FOR_RANGE(int64_t, i, 0, group.size()) {
+      ExecuteRequest(group.at(i)->op_desc(), request_infos.at(i));
+    }
+  }
+  for (const RuntimeRequestInfo& request_info : request_infos) {
+    request_info.callback(Maybe<void>::Ok());
+  }
+}
+
+void CpuCollectiveBoxingExecutorBackend::RankWorker::ExecuteRequest(
+    const OpDesc& op_desc, const RuntimeRequestInfo& request_info) {
+  const OpType op_type = op_desc.op_type();
+  const DataType data_type = op_desc.data_type();
+  const int64_t elem_cnt = Shape(op_desc.shape()).elem_cnt();
+  const int64_t size = elem_cnt * GetSizeOfDataType(data_type);
+  if (op_type == OpType::kOpTypeAllReduce || op_type == OpType::kOpTypeReduceScatter
+      || op_type == OpType::kOpTypeReduce) {
+    CHECK_EQ(op_desc.reduce_method(), ReduceMethod::kReduceMethodSum);
+  }
+  if (op_type == OpType::kOpTypeAllReduce) {
+    CopyIfNeeded(request_info.recv_buff, request_info.send_buff, size);
+    AllReduce(static_cast<char*>(request_info.recv_buff), elem_cnt, data_type);
+  } else if (op_type == OpType::kOpTypeReduceScatter) {
+    CHECK_EQ(elem_cnt % num_ranks_, 0);
+    const int64_t chunk_size = size / num_ranks_;
+    char* buf = WorkBuffer(size);
+    CopyIfNeeded(buf, request_info.send_buff, size);
+    ReduceScatter(buf, elem_cnt, data_type);
+    CopyIfNeeded(request_info.recv_buff, buf + rank_ * chunk_size, chunk_size);
+  } else if (op_type == OpType::kOpTypeAllGather) {
+    CHECK_EQ(elem_cnt % num_ranks_, 0);
+    const int64_t chunk_size = size / num_ranks_;
+    char* buf = static_cast<char*>(request_info.recv_buff);
+    CopyIfNeeded(buf + rank_ * chunk_size, request_info.send_buff, chunk_size);
+    AllGather(buf, elem_cnt, data_type);
+  } else if (op_type == OpType::kOpTypeBroadcast) {
+    if (rank_ == op_desc.root()) {
+      CopyIfNeeded(request_info.recv_buff, request_info.send_buff, size);
+    }
+    Broadcast(static_cast<char*>(request_info.recv_buff), elem_cnt, data_type, op_desc.root());
+  } else if (op_type == OpType::kOpTypeReduce) {
+    // only root has an output, the others reduce in the work buffer
+    char* buf = rank_ == op_desc.root() ? static_cast<char*>(request_info.recv_buff)
+                                        : WorkBuffer(size);
+    CopyIfNeeded(buf, request_info.send_buff, size);
+    Reduce(buf, elem_cnt, data_type, op_desc.root());
+  } else {
+    UNIMPLEMENTED();
+  }
+}
+
+void CpuCollectiveBoxingExecutorBackend::RankWorker::AllReduce(char* buf, int64_t elem_cnt,
+                                                               DataType data_type) {
+  if (num_ranks_ == 1) { return; }
+  if (UseRing(elem_cnt * GetSizeOfDataType(data_type))) {
+    RingReduceScatter(all_ranks_, rank_, buf, elem_cnt, data_type);
+    RingAllGather(all_ranks_, rank_, buf, elem_cnt, data_type);
+  } else {
+    HalvingDoublingAllReduce(buf, elem_cnt, data_type);
+  }
+}
+
+void CpuCollectiveBoxingExecutorBackend::RankWorker::Reduce(char* buf, int64_t elem_cnt,
+                                                            DataType data_type, int64_t root) {
+  if (num_ranks_ == 1) { return; }
+  const int64_t size_of_data_type = GetSizeOfDataType(data_type);
+  const int64_t size = elem_cnt * size_of_data_type;
+  if (UseRing(size)) {
+    // reduce scatter around the ring, then root gathers the reduced chunks
+    RingReduceScatter(all_ranks_, rank_, buf, elem_cnt, data_type);
+    const BalancedSplitter splitter(elem_cnt, num_ranks_);
+    std::vector<TransferDesc> transfers;
+    if (rank_ == root) {
+      FOR_RANGE(int64_t, i, 0, num_ranks_) {
+        if (i == root) { continue; }
+        const Range range = splitter.At(i);
+        transfers.push_back(RecvFrom(i, buf + range.begin() * size_of_data_type,
+                                     range.size() * size_of_data_type));
+      }
+    } else {
+      const Range range = splitter.At(rank_);
+      transfers.push_back(
+          SendTo(root, buf + range.begin() * size_of_data_type, range.size() * size_of_data_type));
+    }
+    DoTransfers(transfers);
+  } else {
+    // binomial tree towards root
+    const int64_t relative_rank = Mod(rank_ - root, num_ranks_);
+    char* recv_buf = ScratchBuffer(size);
+    for (int64_t mask = 1; mask < num_ranks_; mask <<= 1) {
+      if ((relative_rank & mask) != 0) {
+        DoTransfers({SendTo(Mod(relative_rank - mask + root, num_ranks_), buf, size)});
+        break;
+      }
+      if (relative_rank + mask < num_ranks_) {
+        DoTransfers({RecvFrom(Mod(relative_rank + mask + root, num_ranks_), recv_buf, size)});
+        ReduceTo(data_type, buf, recv_buf, elem_cnt);
+      }
+    }
+  }
+}
+
+void CpuCollectiveBoxingExecutorBackend::RankWorker::Broadcast(char* buf, int64_t elem_cnt,
+                                                               DataType data_type, int64_t root) {
+  if (num_ranks_ == 1) { return; }
+  const int64_t size_of_data_type = GetSizeOfDataType(data_type);
+  const int64_t size = elem_cnt * size_of_data_type;
+  if (UseRing(size)) {
+    // root scatters the chunks, then an all gather around the ring
+    const BalancedSplitter splitter(elem_cnt, num_ranks_);
+    std::vector<TransferDesc> transfers;
+    if (rank_ == root) {
+      FOR_RANGE(int64_t, i, 0, num_ranks_) {
+        if (i == root) { continue; }
+        const Range range = splitter.At(i);
+        transfers.push_back(
+            SendTo(i, buf + range.begin() * size_of_data_type, range.size() * size_of_data_type));
+      }
+    } else {
+      const Range range = splitter.At(rank_);
+      transfers.push_back(RecvFrom(root, buf + range.begin() * size_of_data_type,
+                                   range.size() * size_of_data_type));
+    }
+    DoTransfers(transfers);
+    RingAllGather(all_ranks_, rank_, buf, elem_cnt, data_type);
+  } else {
+    // binomial tree from root
+    const int64_t relative_rank = Mod(rank_ - root, num_ranks_);
+    int64_t mask = 1;
+    while (mask < num_ranks_) {
+      if ((relative_rank & mask) != 0) {
+        DoTransfers({RecvFrom(Mod(relative_rank - mask + root, num_ranks_), buf, size)});
+        break;
+      }
+      mask <<= 1;
+    }
+    for (mask >>= 1; mask > 0; mask >>= 1) {
+      if (relative_rank + mask < num_ranks_) {
+        DoTransfers({SendTo(Mod(relative_rank + mask + root, num_ranks_), buf, size)});
+      }
+    }
+  }
+}
+
+void CpuCollectiveBoxingExecutorBackend::RankWorker::ReduceScatter(char* buf, int64_t elem_cnt,
+                                                                   DataType data_type) {
+  if (num_ranks_ == 1) { return; }
+  if (UseRing(elem_cnt * GetSizeOfDataType(data_type)) || !IsPowerOfTwo(num_ranks_)) {
+    RingReduceScatter(all_ranks_, rank_, buf, elem_cnt, data_type);
+  } else {
+    HalvingReduceScatter(all_ranks_, rank_, buf, elem_cnt, data_type);
+  }
+}
+
+void CpuCollectiveBoxingExecutorBackend::RankWorker::AllGather(char* buf, int64_t elem_cnt,
+                                                               DataType data_type) {
+  if (num_ranks_ == 1) { return; }
+  if (UseRing(elem_cnt * GetSizeOfDataType(data_type)) || !IsPowerOfTwo(num_ranks_)) {
+    RingAllGather(all_ranks_, rank_, buf, elem_cnt, data_type);
+  } else {
+    DoublingAllGather(all_ranks_, rank_, buf, elem_cnt, data_type);
+  }
+}
+
+void CpuCollectiveBoxingExecutorBackend::RankWorker::RingReduceScatter(
+    const std::vector<int64_t>& members, int64_t idx, char* buf, int64_t elem_cnt,
+    DataType data_type) {
+  const int64_t num = members.size();
+  const int64_t size_of_data_type = GetSizeOfDataType(data_type);
+  const BalancedSplitter splitter(elem_cnt, num);
+  const int64_t next = members.at(Mod(idx + 1, num));
+  const int64_t prev = members.at(Mod(idx - 1, num));
+  char* recv_buf = ScratchBuffer(splitter.At(0).size() * size_of_data_type);
+  // at step s chunk idx - s - 1 goes on and chunk idx - s - 2 arrives, so after num - 1 steps
+  // this rank holds the sum of chunk idx
+  FOR_RANGE(int64_t, step, 0, num - 1) {
+    const Range send_range = splitter.At(Mod(idx - step - 1, num));
+    const Range recv_range = splitter.At(Mod(idx - step - 2, num));
+    DoTransfers({SendTo(next, buf + send_range.begin() * size_of_data_type,
+                        send_range.size() * size_of_data_type),
+                 RecvFrom(prev, recv_buf, recv_range.size() * size_of_data_type)});
+    ReduceTo(data_type, buf + recv_range.begin() * size_of_data_type, recv_buf, recv_range.size());
+  }
+}
+
+void CpuCollectiveBoxingExecutorBackend::RankWorker::RingAllGather(
+    const std::vector<int64_t>& members, int64_t idx, char* buf, int64_t elem_cnt,
+    DataType data_type) {
+  const int64_t num = members.size();
+  const int64_t size_of_data_type = GetSizeOfDataType(data_type);
+  const BalancedSplitter splitter(elem_cnt, num);
+  const int64_t next = members.at(Mod(idx + 1, num));
+  const int64_t prev = members.at(Mod(idx - 1, num));
+  FOR_RANGE(int64_t, step, 0, num - 1) {
+    const Range send_range = splitter.At(Mod(idx - step, num));
+    const Range recv_range = splitter.At(Mod(idx - step - 1, num));
+    DoTransfers({SendTo(next, buf + send_range.begin() * size_of_data_type,
+                        send_range.size() * size_of_data_type),
+                 RecvFrom(prev, buf + recv_range.begin() * size_of_data_type,
+                          recv_range.size() * size_of_data_type)});
+  }
+}
+
+void CpuCollectiveBoxingExecutorBackend::RankWorker::HalvingReduceScatter(
+    const std::vector<int64_t>& members, int64_t idx, char* buf, int64_t elem_cnt,
+    DataType data_type) {
+  const int64_t num = members.size();
+  CHECK(IsPowerOfTwo(num));
+  const int64_t size_of_data_type = GetSizeOfDataType(data_type);
+  const BalancedSplitter splitter(elem_cnt, num);
+  // this rank keeps the half of [first, first + 2 * distance) chunks its own chunk is in
+  int64_t first = 0;
+  for (int64_t distance = num / 2; distance > 0; distance /= 2) {
+    const bool keep_lower = (idx & distance) == 0;
+    const Range lower = splitter.At(first, first + distance - 1);
+    const Range upper = splitter.At(first + distance, first + 2 * distance - 1);
+    const Range& keep = keep_lower ? lower : upper;
+    const Range& give = keep_lower ? upper : lower;
+    const int64_t peer = members.at(idx ^ distance);
+    char* recv_buf = ScratchBuffer(keep.size() * size_of_data_type);
+    DoTransfers({SendTo(peer, buf + give.begin() * size_of_data_type,
+                        give.size() * size_of_data_type),
+                 RecvFrom(peer, recv_buf, keep.size() * size_of_data_type)});
+    ReduceTo(data_type, buf + keep.begin() * size_of_data_type, recv_buf, keep.size());
+    if (!keep_lower) { first += distance; }
+  }
+}
+
+void CpuCollectiveBoxingExecutorBackend::RankWorker::DoublingAllGather(
+    const std::vector<int64_t>& members, int64_t idx, char* buf, int64_t elem_cnt,
+    DataType data_type) {
+  const int64_t num = members.size();
+  CHECK(IsPowerOfTwo(num));
+  const int64_t size_of_data_type = GetSizeOfDataType(data_type);
+  const BalancedSplitter splitter(elem_cnt, num);
+  for (int64_t distance = 1; distance < num; distance *= 2) {
+    const int64_t peer_idx = idx ^ distance;
+    const int64_t first = idx / distance * distance;
+    const int64_t peer_first = peer_idx / distance * distance;
+    const Range own = splitter.At(first, first + distance - 1);
+    const Range peer_own = splitter.At(peer_first, peer_first + distance - 1);
+    const int64_t peer = members.at(peer_idx);
+    DoTransfers(
+        {SendTo(peer, buf + own.begin() * size_of_data_type, own.size() * size_of_data_type),
+         RecvFrom(peer, buf + peer_own.begin() * size_of_data_type,
+                  peer_own.size() * size_of_data_type)});
+  }
+}
+
+void CpuCollectiveBoxingExecutorBackend::RankWorker::HalvingDoublingAllReduce(
+    char* buf, int64_t elem_cnt, DataType data_type) {
+  const int64_t size = elem_cnt * GetSizeOfDataType(data_type);
+  int64_t pow2_num = 1;
+  while (pow2_num * 2 <= num_ranks_) { pow2_num *= 2; }
+  const int64_t rest_num = num_ranks_ - pow2_num;
+  // the first 2 * rest_num ranks fold in pairs so that a power of two ranks remain, the even rank
+  // of a pair sits out and gets the result from the odd one at last
+  const bool is_folded = rank_ < 2 * rest_num;
+  int64_t idx = -1;
+  if (is_folded) {
+    if (rank_ % 2 == 0) {
+      DoTransfers({SendTo(rank_ + 1, buf, size)});
+    } else {
+      char* recv_buf = ScratchBuffer(size);
+      DoTransfers({RecvFrom(rank_ - 1, recv_buf, size)});
+      ReduceTo(data_type, buf, recv_buf, elem_cnt);
+      idx = rank_ / 2;
+    }
+  } else {
+    idx = rank_ - rest_num;
+  }
+  if (idx != -1) {
+    std::vector<int64_t> members(pow2_num);
+    FOR_RANGE(int64_t, i, 0, pow2_num) { members[i] = i < rest_num ? 2 * i + 1 : i + rest_num; }
+    HalvingReduceScatter(members, idx, buf, elem_cnt, data_type);
+    DoublingAllGather(members, idx, buf, elem_cnt, data_type);
+  }
+  if (is_folded) {
+    if (rank_ % 2 == 0) {
+      DoTransfers({RecvFrom(rank_ + 1, buf, size)});
+    } else {
+      DoTransfers({SendTo(rank_ - 1, buf, size)});
+    }
+  }
+}
+
+void CpuCollectiveBoxingExecutorBackend::RankWorker::DoTransfers(
+    const std::vector<TransferDesc>& transfers) {
+  // both sides of a transfer skip it when it is empty
+  const int64_t transfer_cnt =
+      std::count_if(transfers.cbegin(), transfers.cend(),
+                    [](const TransferDesc& transfer) { return transfer.size > 0; });
+  if (transfer_cnt == 0) { return; }
+  BlockingCounter bc(transfer_cnt);
+  auto Callback = [&bc]() { bc.Decrease(); };
+  for (const TransferDesc& transfer : transfers) {
+    if (transfer.size == 0) { continue; }
+    CHECK_NE(transfer.peer, rank_);
+    const int64_t peer_machine_id = rank2machine_id_.at(transfer.peer);
+    if (transfer.is_send) {
+      const uint64_t token =
+          GetToken(rank_, transfer.peer, dst_rank2send_cnt_.at(transfer.peer)++);
+      if (peer_machine_id == this_machine_id_) {
+        local_exchange_->Send(token, transfer.ptr, transfer.size, Callback);
+      } else {
+        Global<Transport>::Get()->Send(token, peer_machine_id, transfer.ptr, transfer.size,
+                                       Callback);
+      }
+    } else {
+      const uint64_t token =
+          GetToken(transfer.peer, rank_, src_rank2recv_cnt_.at(transfer.peer)++);
+      if (peer_machine_id == this_machine_id_) {
+        local_exchange_->Receive(token, transfer.ptr, transfer.size, Callback);
+      } else {
+        Global<Transport>::Get()->Receive(token, peer_machine_id, transfer.ptr, transfer.size,
+                                          Callback);
+      }
+    }
+  }
+  bc.WaitUntilCntEqualZero();
+}
+
+uint64_t CpuCollectiveBoxingExecutorBackend::RankWorker::GetToken(int64_t src_rank,
+                                                                  int64_t dst_rank,
+                                                                  int64_t seq) const {
+  size_t hash = device_set_hash_;
+  HashCombine(&hash, std::hash<int64_t>()(src_rank));
+  HashCombine(&hash, std::hash<int64_t>()(dst_rank));
+  HashCombine(&hash, std::hash<int64_t>()(seq));
+  return static_cast<uint64_t>(hash) | kTokenTag;
+}
+
+char* CpuCollectiveBoxingExecutorBackend::RankWorker::ScratchBuffer(int64_t size) {
+  if (scratch_buffer_.size() < size) { scratch_buffer_.resize(size); }
+  return scratch_buffer_.data();
+}
+
+char* CpuCollectiveBoxingExecutorBackend::RankWorker::WorkBuffer(int64_t size) {
+  if (work_buffer_.size() < size) { work_buffer_.resize(size); }
+  return work_buffer_.data();
+}
+
+CpuCollectiveBoxingExecutorBackend::CpuCollectiveBoxingExecutorBackend()
+    : collective_boxing_conf_(Global<ResourceDesc, ForSession>::Get()->collective_boxing_conf()),
+      local_exchange_(new LocalExchange()) {
+  CHECK_GE(collective_boxing_conf_.nccl_fusion_threshold_mb(), 0);
+  fusion_threshold_ = collective_boxing_conf_.nccl_fusion_threshold_mb() * 1024 * 1024;
+  CHECK_GE(collective_boxing_conf_.cpu_ring_threshold_kb(), 0);
+  ring_threshold_ = collective_boxing_conf_.cpu_ring_threshold_kb() * 1024;
+}
+
+CpuCollectiveBoxingExecutorBackend::~CpuCollectiveBoxingExecutorBackend() = default;
+
+void CpuCollectiveBoxingExecutorBackend::Init(const CollectiveBoxingPlan& collective_boxing_plan) {
+  const int64_t this_machine_id = Global<MachineCtx>::Get()->this_machine_id();
+  for (const auto& job_id7request_set : collective_boxing_plan.job_id2request_set()) {
+    for (const RequestDesc& request : job_id7request_set.second.request()) {
+      if (request.op_desc().backend() != Backend::kBackendCPU) { continue; }
+      const DeviceSet& device_set = request.device_set();
+      FOR_RANGE(int64_t, rank, 0, device_set.device_size()) {
+        if (device_set.device(rank).machine_id() != this_machine_id) { continue; }
+        auto& rank2worker = device_set2rank2worker_[device_set];
+        if (rank2worker.count(rank) > 0) { continue; }
+        rank2worker.emplace(rank, std::make_unique<RankWorker>(device_set, rank, ring_threshold_,
+                                                               local_exchange_.get()));
+      }
+    }
+  }
+}
+
+void CpuCollectiveBoxingExecutorBackend::GroupRequests(
+    const std::vector<const RequestDesc*>& requests,
+    std::vector<std::vector<const RequestDesc*>>* groups) {
+  GroupRequestsByFusionConf(requests, collective_boxing_conf_, fusion_threshold_, true, groups);
+}
+
+void CpuCollectiveBoxingExecutorBackend::ExecuteGroup(
+    const std::vector<const RequestDesc*>& group,
+    const std::vector<std::map<int64_t, RuntimeRequestInfo>>& ranks) {
+  CHECK_EQ(group.size(), ranks.size());
+  if (group.empty()) { return; }
+  std::map<int64_t, std::vector<RuntimeRequestInfo>> rank2request_infos;
+  for (const auto& rank2request_info : ranks) {
+    for (const auto& rank7request_info : rank2request_info) {
+      rank2request_infos[rank7request_info.first].push_back(rank7request_info.second);
+    }
+  }
+  auto& rank2worker = device_set2rank2worker_.at(group.front()->device_set());
+  for (const auto& rank7request_infos : rank2request_infos) {
+    CHECK_EQ(rank7request_infos.second.size(), group.size());
+    rank2worker.at(rank7request_infos.first)->Enqueue(group, rank7request_infos.second);
+  }
+}
+
+}  // namespace collective
+
+}  // namespace boxing
+
+}  // namespace oneflow
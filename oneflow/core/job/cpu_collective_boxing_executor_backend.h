@@ -0,0 +1,67 @@
+/*
+Copyright 2020 The OneFlow Authors. All rights reserved.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+*/
+#ifndef ONEFLOW_CORE_JOB_CPU_COLLECTIVE_BOXING_EXECUTOR_BACKEND_H_
+#define ONEFLOW_CORE_JOB_CPU_COLLECTIVE_BOXING_EXECUTOR_BACKEND_H_
+
+#include "oneflow/core/job/collective_boxing_executor.h"
+#include "oneflow/core/graph/boxing/collective_boxing_util.h"
+
+namespace oneflow {
+
+namespace boxing {
+
+namespace collective {
+
+// Executes requests between cpu devices. Every local rank of a device set owns a worker thread
+// which runs the groups of that device set in order, so all ranks of a group meet in the same
+// collective. Ranks on other machines are reached through Global<Transport>, ranks in this
+// process exchange data in memory.
+//
+// All reduce uses a ring (reduce scatter then all gather) for requests of at least
+// cpu_ring_threshold_kb and recursive halving doubling below it, reduce scatter and all gather
+// use a ring, or recursive halving / doubling for small requests on a power of two ranks.
+// Broadcast and reduce use binomial trees for small requests and scatter / gather around a ring
+// for large ones.
+class CpuCollectiveBoxingExecutorBackend final : public CollectiveBoxingExecutorBackend {
+ public:
+  OF_DISALLOW_COPY_AND_MOVE(CpuCollectiveBoxingExecutorBackend);
+  CpuCollectiveBoxingExecutorBackend();
+  ~CpuCollectiveBoxingExecutorBackend() override;
+
+ private:
+  class LocalExchange;
+  class RankWorker;
+
+  void Init(const CollectiveBoxingPlan& collective_boxing_plan) override;
+  void GroupRequests(const std::vector<const RequestDesc*>& requests,
+                     std::vector<std::vector<const RequestDesc*>>* groups) override;
+  void ExecuteGroup(const std::vector<const RequestDesc*>& group,
+                    const std::vector<std::map<int64_t, RuntimeRequestInfo>>& ranks) override;
+
+  const CollectiveBoxingConf collective_boxing_conf_;
+  int64_t fusion_threshold_;
+  int64_t ring_threshold_;
+  std::unique_ptr<LocalExchange> local_exchange_;
+  HashMap<DeviceSet, std::map<int64_t, std::unique_ptr<RankWorker>>> device_set2rank2worker_;
+};
+
+}  // namespace collective
+
+}  // namespace boxing
+
+}  // namespace oneflow
+
+#endif  // ONEFLOW_CORE_JOB_CPU_COLLECTIVE_BOXING_EXECUTOR_BACKEND_H_
@@ -0,0 +1,285 @@
+/*
+Copyright 2020 The OneFlow Authors. All rights reserved.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+*/
+#include "oneflow/core/common/maybe.h"
+#include "oneflow/core/common/blocking_counter.h"
+#include "oneflow/core/job/machine_context.h"
+#include "oneflow/core/job/env.pb.h"
+#include "oneflow/core/job/env_desc.h"
+#include "oneflow/core/control/ctrl_client.h"
+#include "oneflow/core/control/ctrl_server.h"
+#include "oneflow/core/job/resource_desc.h"
+#include "oneflow/core/job/global_for.h"
+#include "oneflow/core/job/cpu_collective_boxing_executor_backend.h"
+#include "oneflow/core/transport/transport.h"
+
+#include <sys/wait.h>
+#include <unistd.h>
+
+namespace oneflow {
+
+namespace boxing {
+
+namespace collective {
+
+namespace {
+
+// every process plays one machine on localhost and owns kDevicesPerMachine cpu devices, so ranks
+// talk both through Transport and within the process
+constexpr int64_t kDevicesPerMachine = 2;
+
+EnvProto GetEnvProto(int64_t machine_num, int64_t this_machine_id, int32_t ctrl_port) {
+  EnvProto ret;
+  FOR_RANGE(int64_t, i, 0, machine_num) {
+    auto* machine = ret.add_machine();
+    machine->set_id(i);
+    machine->set_addr("127.0.0.1");
+    machine->set_ctrl_port_agent(ctrl_port + i);
+  }
+  ret.set_ctrl_port(ctrl_port + this_machine_id);
+  return ret;
+}
+
+Resource GetResource(int64_t machine_num, int64_t ring_threshold_kb) {
+  Resource ret;
+  ret.set_machine_num(machine_num);
+  ret.set_gpu_device_num(0);
+  ret.set_cpu_device_num(kDevicesPerMachine);
+  ret.set_comm_net_worker_num(1);
+  ret.mutable_collective_boxing_conf()->set_cpu_enable_backend(true);
+  ret.mutable_collective_boxing_conf()->set_cpu_ring_threshold_kb(ring_threshold_kb);
+  return ret;
+}
+
+RequestDesc GetRequestDesc(const std::string& name, OpType op_type, int64_t elem_cnt,
+                           int64_t root, int64_t machine_num, int64_t order) {
+  RequestDesc request;
+  OpDesc* op_desc = request.mutable_op_desc();
+  op_desc->set_name(name);
+  op_desc->set_op_type(op_type);
+  if (op_type == OpType::kOpTypeAllReduce || op_type == OpType::kOpTypeReduceScatter
+      || op_type == OpType::kOpTypeReduce) {
+    op_desc->set_reduce_method(ReduceMethod::kReduceMethodSum);
+  }
+  if (root != -1) { op_desc->set_root(root); }
+  op_desc->set_data_type(DataType::kFloat);
+  op_desc->mutable_shape()->add_dim(elem_cnt);
+  op_desc->set_num_ranks(machine_num * kDevicesPerMachine);
+  op_desc->set_backend(Backend::kBackendCPU);
+  FOR_RANGE(int64_t, machine_id, 0, machine_num) {
+    FOR_RANGE(int64_t, device_id, 0, kDevicesPerMachine) {
+      DeviceDesc* device_desc = request.mutable_device_set()->add_device();
+      device_desc->set_machine_id(machine_id);
+      device_desc->set_device_type(DeviceType::kCPU);
+      device_desc->set_device_id(device_id);
+    }
+  }
+  request.set_order(order);
+  request.set_dependency_depth(0);
+  return request;
+}
+
+float GetInput(int64_t rank, int64_t i) { return static_cast<float>(rank * 3 + i % 11); }
+
+void CheckOutput(const OpDesc& op_desc, int64_t rank, const std::vector<float>& out) {
+  const int64_t num_ranks = op_desc.num_ranks();
+  const int64_t elem_cnt = Shape(op_desc.shape()).elem_cnt();
+  auto Sum = [&](int64_t i) {
+    float sum = 0;
+    FOR_RANGE(int64_t, r, 0, num_ranks) { sum += GetInput(r, i); }
+    return sum;
+  };
+  const OpType op_type = op_desc.op_type();
+  if (op_type == OpType::kOpTypeAllReduce) {
+    FOR_RANGE(int64_t, i, 0, elem_cnt) { CHECK_EQ(out.at(i), Sum(i)) << op_desc.name(); }
+  } else if (op_type == OpType::kOpTypeReduceScatter) {
+    const int64_t chunk_elem_cnt = elem_cnt / num_ranks;
+    FOR_RANGE(int64_t, i, 0, chunk_elem_cnt) {
+      CHECK_EQ(out.at(i), Sum(rank * chunk_elem_cnt + i)) << op_desc.name();
+    }
+  } else if (op_type == OpType::kOpTypeAllGather) {
+    const int64_t chunk_elem_cnt = elem_cnt / num_ranks;
+    FOR_RANGE(int64_t, i, 0, elem_cnt) {
+      CHECK_EQ(out.at(i), GetInput(i / chunk_elem_cnt, i % chunk_elem_cnt)) << op_desc.name();
+    }
+  } else if (op_type == OpType::kOpTypeBroadcast) {
+    FOR_RANGE(int64_t, i, 0, elem_cnt) {
+      CHECK_EQ(out.at(i), GetInput(op_desc.root(), i)) << op_desc.name();
+    }
+  } else if (op_type == OpType::kOpTypeReduce) {
+    if (rank != op_desc.root()) { return; }
+    FOR_RANGE(int64_t, i, 0, elem_cnt) { CHECK_EQ(out.at(i), Sum(i)) << op_desc.name(); }
+  } else {
+    UNIMPLEMENTED();
+  }
+}
+
+// runs every op type on sizes around the ring threshold, the small all reduces at last are fused
+void TestCollectives(int64_t machine_num) {
+  const int64_t this_machine_id = Global<MachineCtx>::Get()->this_machine_id();
+  const int64_t num_ranks = machine_num * kDevicesPerMachine;
+  CollectiveBoxingPlan plan;
+  RequestSet* request_set = &(*plan.mutable_job_id2request_set())[0];
+  int64_t order = 0;
+  for (const int64_t elem_cnt : {1, 7, 1000, 100000}) {
+    const std::string suffix = "-" + std::to_string(elem_cnt);
+    *request_set->add_request() = GetRequestDesc("all_reduce" + suffix, OpType::kOpTypeAllReduce,
+                                                 elem_cnt, -1, machine_num, order++);
+    *request_set->add_request() =
+        GetRequestDesc("reduce_scatter" + suffix, OpType::kOpTypeReduceScatter,
+                       elem_cnt * num_ranks, -1, machine_num, order++);
+    *request_set->add_request() = GetRequestDesc("all_gather" + suffix, OpType::kOpTypeAllGather,
+                                                 elem_cnt * num_ranks, -1, machine_num, order++);
+    *request_set->add_request() =
+        GetRequestDesc("broadcast" + suffix, OpType::kOpTypeBroadcast, elem_cnt,
+                       elem_cnt % num_ranks, machine_num, order++);
+    *request_set->add_request() =
+        GetRequestDesc("reduce" + suffix, OpType::kOpTypeReduce, elem_cnt,
+                       num_ranks - 1 - elem_cnt % num_ranks, machine_num, order++);
+  }
+  const int64_t fused_begin = request_set->request_size();
+  FOR_RANGE(int64_t, i, 0, 4) {
+    *request_set->add_request() =
+        GetRequestDesc("fused_all_reduce-" + std::to_string(i), OpType::kOpTypeAllReduce,
+                       13 + i * 100, -1, machine_num, order++);
+  }
+
+  std::unique_ptr<CollectiveBoxingExecutorBackend> backend(
+      new CpuCollectiveBoxingExecutorBackend());
+  backend->Init(plan);
+  std::vector<std::vector<const RequestDesc*>> groups;
+  std::vector<const RequestDesc*> fused_requests;
+  FOR_RANGE(int64_t, i, 0, request_set->request_size()) {
+    const RequestDesc* request = &request_set->request(i);
+    if (i < fused_begin) {
+      groups.push_back({request});
+    } else {
+      fused_requests.push_back(request);
+    }
+  }
+  backend->GroupRequests(fused_requests, &groups);
+  CHECK_EQ(groups.size(), fused_begin + 1);
+
+  for (const auto& group : groups) {
+    std::vector<std::map<int64_t, RuntimeRequestInfo>> ranks(group.size());
+    std::vector<std::vector<std::vector<float>>> request2rank2in(group.size());
+    std::vector<std::vector<std::vector<float>>> request2rank2out(group.size());
+    BlockingCounter bc(group.size() * kDevicesPerMachine);
+    FOR_RANGE(int64_t, i, 0, group.size()) {
+      RankDesc rank_desc;
+      *rank_desc.mutable_op_desc() = group.at(i)->op_desc();
+      request2rank2in.at(i).resize(num_ranks);
+      request2rank2out.at(i).resize(num_ranks);
+      FOR_RANGE(int64_t, device_id, 0, kDevicesPerMachine) {
+        const int64_t rank = this_machine_id * kDevicesPerMachine + device_id;
+        rank_desc.set_rank(rank);
+        RuntimeRequestInfo request_info{};
+        if (GenericOpHasInput(rank_desc)) {
+          std::vector<float>& in = request2rank2in.at(i).at(rank);
+          in.resize(GenericOpGetInputShape(rank_desc).elem_cnt());
+          FOR_RANGE(int64_t, j, 0, in.size()) { in.at(j) = GetInput(rank, j); }
+          request_info.send_buff = in.data();
+        }
+        if (GenericOpHasOutput(rank_desc)) {
+          std::vector<float>& out = request2rank2out.at(i).at(rank);
+          out.assign(GenericOpGetOutputShape(rank_desc).elem_cnt(), -1);
+          request_info.recv_buff = out.data();
+        }
+        request_info.callback = [&bc](const Maybe<void>& status) {
+          CHECK(status.IsOk());
+          bc.Decrease();
+        };
+        ranks.at(i).emplace(rank, request_info);
+      }
+    }
+    backend->ExecuteGroup(group, ranks);
+    bc.WaitUntilCntEqualZero();
+    FOR_RANGE(int64_t, i, 0, group.size()) {
+      for (const auto& rank7request_info : ranks.at(i)) {
+        const int64_t rank = rank7request_info.first;
+        CheckOutput(group.at(i)->op_desc(), rank, request2rank2out.at(i).at(rank));
+      }
+    }
+  }
+}
+
+Maybe<void> TestCpuCollectiveBoxing(int64_t machine_num, int64_t this_machine_id,
+                                    int32_t ctrl_port, int64_t ring_threshold_kb) {
+  EnvProto env_proto = GetEnvProto(machine_num, this_machine_id, ctrl_port);
+  Global<EnvDesc>::New(env_proto);
+  Global<CtrlServer>::New();
+  Global<CtrlClient>::New();
+  Global<MachineCtx>::New(this_machine_id);
+  Global<ResourceDesc, ForEnv>::New(GetResource(machine_num, ring_threshold_kb));
+  Global<ResourceDesc, ForSession>::New(GetResource(machine_num, ring_threshold_kb));
+  Global<EpollCommNet>::New();
+  Global<Transport>::New();
+  OF_ENV_BARRIER();
+
+  TestCollectives(machine_num);
+
+  OF_ENV_BARRIER();
+  Global<Transport>::Delete();
+  Global<EpollCommNet>::Delete();
+  Global<ResourceDesc, ForSession>::Delete();
+  Global<ResourceDesc, ForEnv>::Delete();
+  Global<MachineCtx>::Delete();
+  Global<CtrlClient>::Delete();
+  Global<CtrlServer>::Delete();
+  Global<EnvDesc>::Delete();
+  return Maybe<void>::Ok();
+}
+
+}  // namespace
+
+}  // namespace collective
+
+}  // namespace boxing
+
+}  // namespace oneflow
+
+/*
+ * Forks one process per machine on localhost, e.g.
+ *     ./cpu_collective_boxing_test_main_exe -machine_num=3 -ctrl_port=12243
+ * A ring threshold of 1KB runs both the ring and the halving doubling / tree algorithms.
+ */
+DEFINE_int32(machine_num, 3, "number of processes, each of them acts as a machine.");
+DEFINE_int32(ctrl_port, 12243, "the control port of machine 0, machine i uses ctrl_port + i.");
+DEFINE_int32(ring_threshold_kb, 1, "cpu_ring_threshold_kb of CollectiveBoxingConf.");
+
+int main(int argc, char* argv[]) {
+  using namespace oneflow::boxing::collective;
+  gflags::ParseCommandLineFlags(&argc, &argv, true);
+  std::vector<pid_t> pids;
+  FOR_RANGE(int32_t, machine_id, 0, FLAGS_machine_num) {
+    const pid_t pid = fork();
+    PCHECK(pid != -1);
+    if (pid == 0) {
+      CHECK_JUST(TestCpuCollectiveBoxing(FLAGS_machine_num, machine_id, FLAGS_ctrl_port,
+                                         FLAGS_ring_threshold_kb));
+      return 0;
+    }
+    pids.push_back(pid);
+  }
+  int failed_cnt = 0;
+  for (const pid_t pid : pids) {
+    int status = 0;
+    PCHECK(waitpid(pid, &status, 0) == pid);
+    if (!WIFEXITED(status) || WEXITSTATUS(status) != 0) { failed_cnt += 1; }
+  }
+  std::cout << (failed_cnt == 0 ? "All Done!" : std::to_string(failed_cnt) + " machines failed")
+            << std::endl;
+  return failed_cnt == 0 ? 0 : 1;
+}
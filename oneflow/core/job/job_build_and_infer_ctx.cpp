@@ -934,7 +934,8 @@ Maybe<void> LazyJobBuildAndInferCtx::Complete() {
   auto scope = std::make_unique<GlobalJobDescScope>(mut_job()->job_conf(), job_id());
   JobPassCtx job_pass_ctx(GlobalJobDesc());
   auto DoPass = [&](const std::string& pass_name) -> Maybe<void> {
-    return JobPass4Name(pass_name)(mut_job(), &job_pass_ctx);
+    return TimeJobPass(pass_name, job(), &job_pass_ctx,
+                       [&]() { return JobPass4Name(pass_name)(mut_job(), &job_pass_ctx); });
   };
   if (GlobalJobDesc().Bool("__is_user_function__")) {
     JUST(DoPass("CompleteOfrecordDecoder"));
@@ -968,7 +969,8 @@ Maybe<void> EagerJobBuildAndInferCtx::Complete() {
   auto scope = std::make_unique<GlobalJobDescScope>(mut_job()->job_conf(), job_id());
   JobPassCtx job_pass_ctx(GlobalJobDesc());
   auto DoPass = [&](const std::string& pass_name) -> Maybe<void> {
-    return JobPass4Name(pass_name)(mut_job(), &job_pass_ctx);
+    return TimeJobPass(pass_name, job(), &job_pass_ctx,
+                       [&]() { return JobPass4Name(pass_name)(mut_job(), &job_pass_ctx); });
   };
   JUST(DoPass("AutoTrainStep"));
   JUST(DoPass("AutoLearningRate"));
@@ -13,12 +13,26 @@ WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
 See the License for the specific language governing permissions and
 limitations under the License.
 */
+#include <atomic>
 #include "oneflow/core/job/job_builder.h"
 #include "oneflow/core/common/util.h"
 #include "oneflow/core/operator/operator.h"
 
 namespace oneflow {
 
+namespace {
+
+std::atomic<int64_t>* MutJobEditCnt() {
+  static std::atomic<int64_t> job_edit_cnt(0);
+  return &job_edit_cnt;
+}
+
+}  // namespace
+
+int64_t JobEditCnt() { return MutJobEditCnt()->load(); }
+
+void IncreaseJobEditCnt() { MutJobEditCnt()->fetch_add(1); }
+
 std::function<const ParallelConf*(const std::string&)> MakeGetterParallelConf4OpName(
     const Placement& placement) {
   auto op_name2parallel_conf = std::make_shared<HashMap<std::string, const ParallelConf*>>();
@@ -66,6 +80,7 @@ JobBuilder::JobBuilder(Job* job) : job_(job) {
 }
 
 OperatorConf* JobBuilder::MutableOpConf4OpName(const std::string& op_name) {
+  IncreaseJobEditCnt();
   const auto& it = op_name2op_conf_.find(op_name);
   CHECK(it != op_name2op_conf_.end());
   return it->second;
@@ -84,6 +99,7 @@ const ParallelConf& JobBuilder::ParallelConf4Lbi(const LogicalBlobId& lbi) const
 void JobBuilder::AddOps(const ParallelConf& parallel_conf,
                         const std::vector<OperatorConf>& op_confs) {
   if (op_confs.empty()) { return; }
+  IncreaseJobEditCnt();
   auto* placemnt_group = job_->mutable_placement()->add_placement_group();
   *placemnt_group->mutable_parallel_conf() = parallel_conf;
   for (const auto& op_conf : op_confs) {
@@ -109,6 +125,7 @@ PlacementGroup* JobBuilder::FindPlacementGroup(const std::string& op_name) const
 
 void JobBuilder::MutParallelConfOnlyOnce(const std::string& op_name,
                                          const ParallelConf& parallel_conf) {
+  IncreaseJobEditCnt();
   CHECK(modified_parallel_conf_op_names_.emplace(op_name).second);
   PlacementGroup* placement_group = FindPlacementGroup(op_name);
   {
@@ -126,6 +143,7 @@ void JobBuilder::RemoveOpByName(const std::string& op_name) {
 }
 
 void JobBuilder::RemoveOpByName(const std::unordered_set<std::string>& removing_names) {
+  IncreaseJobEditCnt();
   // Update net
   DLNetConf net = job_->net();
   job_->mutable_net()->clear_op();
@@ -188,6 +206,7 @@ void JobBuilder::DelOps(const std::vector<OperatorConf>& op_confs) {
 }
 
 void JobBuilder::MutOpsOnlyOnce(const std::vector<OperatorConf>& op_confs) {
+  IncreaseJobEditCnt();
   for (const auto& op_conf : op_confs) {
     CHECK(modified_op_conf_op_names_.emplace(op_conf.name()).second);
     op_name2op_conf_.at(op_conf.name())->CopyFrom(op_conf);
@@ -229,6 +248,7 @@ void JobBuilder::AddParallelConf4OpName(const std::string& op_name,
                                         const ParallelConf& parallel_conf) {
   bool update = (op_name2parallel_conf_.count(op_name) == 0);
   if (update) {
+    IncreaseJobEditCnt();
     // update `op_name2parallel_conf_`
     PlacementGroup* group = job_->mutable_placement()->add_placement_group();
     group->mutable_op_set()->add_op_name(op_name);
@@ -238,12 +258,14 @@ void JobBuilder::AddParallelConf4OpName(const std::string& op_name,
 }
 
 SbpParallel* JobBuilder::MutSbpParallel4Oba(const OpBlobArg& oba) const {
+  IncreaseJobEditCnt();
   auto* sbp_sig = &(
       *job_->mutable_job_parallel_view_conf()->mutable_op_name2sbp_signature_conf())[oba.op_name()];
   return &(*sbp_sig->mutable_bn_in_op2sbp_parallel())[oba.bn_in_op()];
 }
 
 void JobBuilder::BindIdenticalSbpOpBlobArgPair(const OpBlobArg& first, const OpBlobArg& second) {
+  IncreaseJobEditCnt();
   auto* pair = job_->mutable_helper()->mutable_identical_sbp_oba_pairs()->mutable_pair()->Add();
   *pair->mutable_first() = first;
   *pair->mutable_second() = second;
@@ -257,6 +279,7 @@ const SbpSignature& JobBuilder::SbpSignature4OpName(const std::string& op_name)
 
 void JobBuilder::AddSbpSignature4OpName(const std::string& op_name,
                                         const SbpSignature& sbp_signature) {
+  IncreaseJobEditCnt();
   const auto& it = op_name2sbp_signature_conf_.find(op_name);
   if (it != op_name2sbp_signature_conf_.end()) {
     *(it->second) = sbp_signature;
@@ -278,6 +301,7 @@ const OpTimeShape& JobBuilder::TimeShape4OpName(const std::string& op_name) cons
 void JobBuilder::AddTimeShape4OpName(const std::string& op_name, const OpTimeShape& time_shape) {
   bool update = (op_name2time_shapes_.count(op_name) == 0);
   if (update) {
+    IncreaseJobEditCnt();
     auto* time_shape_conf = job_->mutable_helper()->mutable_op_name2op_time_shape();
     (*time_shape_conf)[op_name] = time_shape;
     op_name2time_shapes_[op_name] = &((*time_shape_conf)[op_name]);
@@ -294,6 +318,7 @@ void JobBuilder::AddBatchAxis4Lbn(const std::string& lbn, const OptInt64& axis)
   bool update =
       (lbn2batch_axis_.count(lbn) == 0) || (lbn2batch_axis_[lbn]->value() != axis.value());
   if (update) {
+    IncreaseJobEditCnt();
     auto* batch_axis = job_->mutable_helper()->mutable_lbn2batch_axis();
     (*batch_axis)[lbn] = axis;
     lbn2batch_axis_[lbn] = &((*batch_axis)[lbn]);
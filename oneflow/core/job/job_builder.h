@@ -26,6 +26,11 @@ const static std::string kProducedLbi2ConsumedDiffLbi = "produced_lbi2consumed_d
 std::function<const ParallelConf*(const std::string&)> MakeGetterParallelConf4OpName(
     const Placement& placement);
 
+// The number of edits made to Jobs, by JobBuilders and by the other editors of Jobs, which report
+// theirs with IncreaseJobEditCnt. A Job is unchanged since a moment the count is unchanged since.
+int64_t JobEditCnt();
+void IncreaseJobEditCnt();
+
 class SbpParallel;
 class LogicalBlobId;
 class Operator;
@@ -37,12 +42,19 @@ class JobBuilder final {
   ~JobBuilder() = default;
 
   const Job& job() const { return *job_; }
-  JobHelperConf* mutable_helper() { return job_->mutable_helper(); }
+  // The edits through the pointers below are counted in JobEditCnt when the pointers are taken, so
+  // a pass makes them before it gets the OpGraph of the job again.
+  JobHelperConf* mutable_helper() {
+    IncreaseJobEditCnt();
+    return job_->mutable_helper();
+  }
   JobParallelViewConf* mutable_job_parallel_view_conf() {
+    IncreaseJobEditCnt();
     return job_->mutable_job_parallel_view_conf();
   }
 
   const OperatorConf& OpConf4OpName(const std::string& op_name) const;
+  // counted in JobEditCnt as mutable_helper is
   OperatorConf* MutableOpConf4OpName(const std::string& op_name);
 
   void AddOps(const ParallelConf& parallel_conf, const std::vector<OperatorConf>& op_confs);
@@ -48,9 +48,27 @@ class ResourceDesc final {
   bool thread_enable_local_message_queue() const {
     return resource_.thread_enable_local_message_queue();
   }
+  bool thread_enable_lock_free_message_queue() const {
+    return resource_.thread_enable_lock_free_message_queue();
+  }
+  size_t thread_lock_free_message_queue_capacity() const {
+    return resource_.thread_lock_free_message_queue_capacity();
+  }
+  int64_t thread_lock_free_message_queue_spin_count() const {
+    return resource_.thread_lock_free_message_queue_spin_count();
+  }
   bool enable_thread_local_cache() const { return resource_.enable_thread_local_cache(); }
   size_t thread_local_cache_max_size() const { return resource_.thread_local_cache_max_size(); }
   int32_t ComputeThreadPoolSize() const;
+  int32_t CpuKernelMaxParallelism() const { return resource_.cpu_kernel_max_parallelism(); }
+  CommNetSendMode comm_net_send_mode() const { return resource_.comm_net_send_mode(); }
+  size_t comm_net_zero_copy_min_byte_size() const {
+    return resource_.comm_net_zero_copy_min_byte_size();
+  }
+  int32_t comm_net_socket_num_per_peer() const { return resource_.comm_net_socket_num_per_peer(); }
+  size_t comm_net_stripe_min_byte_size() const {
+    return resource_.comm_net_stripe_min_byte_size();
+  }
   bool enable_debug_mode() const;
   CollectiveBoxingConf collective_boxing_conf() const;
 
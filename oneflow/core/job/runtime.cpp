@@ -18,6 +18,7 @@ limitations under the License.
 #include "oneflow/core/comm_network/epoll/epoll_comm_network.h"
 #include "oneflow/core/comm_network/ibverbs/ibverbs_comm_network.h"
 #include "oneflow/core/control/ctrl_client.h"
+#include "oneflow/core/job/job_set.pb.h"
 #include "oneflow/core/job/machine_context.h"
 #include "oneflow/core/job/resource_desc.h"
 #include "oneflow/core/job/global_for.h"
@@ -27,10 +28,13 @@ limitations under the License.
 #include "oneflow/core/graph/task_node.h"
 #include "oneflow/core/device/cuda_util.h"
 #include "oneflow/core/memory/memory_allocator.h"
+#include "oneflow/core/memory/host_mem_pool.h"
+#include "oneflow/core/persistence/async_snapshot_writer.h"
 #include "oneflow/core/register/register_manager.h"
 #include "oneflow/user/summary/events_writer.h"
 #include "oneflow/core/job/collective_boxing_executor.h"
 #include "oneflow/core/job/collective_boxing_device_ctx_poller.h"
+#include "oneflow/core/transport/transport.h"
 
 namespace oneflow {
 
@@ -92,10 +96,18 @@ Runtime::~Runtime() {
   Global<RuntimeCtx>::Get()->WaitUntilCntEqualZero("running_actor_cnt");
   OF_SESSION_BARRIER();
   DeleteAllGlobal();
+  const HostMemPoolStats stats = HostMemPool::Get()->GetStats();
+  LOG(INFO) << "TensorBuffer host memory pool: " << stats.hit_cnt << "/" << stats.allocate_cnt
+            << " allocations cached, " << stats.cached_bytes << " bytes cached, "
+            << stats.system_bytes_high_water_mark << " bytes held at most";
 }
 
 void Runtime::NewAllGlobal(const Plan& plan, size_t total_piece_num, bool is_experiment_phase) {
   Global<RuntimeCtx>::New(total_piece_num, is_experiment_phase);
+  const ResourceDesc* resource_desc = Global<ResourceDesc, ForSession>::Get();
+  HostMemPool::Get()->set_max_cached_bytes(resource_desc->enable_thread_local_cache()
+                                                ? resource_desc->thread_local_cache_max_size()
+                                                : 0);
   if (Global<MachineCtx>::Get()->IsThisMachineMaster()
       && Global<RuntimeCtx>::Get()->NeedCollectActEvent()) {
     Global<ActEventLogger>::New(is_experiment_phase);
@@ -121,6 +133,8 @@ void Runtime::NewAllGlobal(const Plan& plan, size_t total_piece_num, bool is_exp
     } else {
       Global<CommNet>::SetAllocated(Global<EpollCommNet>::Get());
     }
+    // the cpu collective boxing backend talks to other machines through Transport
+    if (resource_desc->collective_boxing_conf().cpu_enable_backend()) { Global<Transport>::New(); }
 #endif
   }
   Global<boxing::collective::CollectiveBoxingExecutor>::New(plan);
@@ -131,12 +145,19 @@ void Runtime::NewAllGlobal(const Plan& plan, size_t total_piece_num, bool is_exp
   Global<boxing::collective::CollectiveBoxingDeviceCtxPoller>::New();
   Global<RuntimeJobDescs>::New(plan.job_confs().job_id2job_conf());
   Global<summary::EventsWriter>::New();
+  const IOConf* io_conf = Global<const IOConf>::Get();
+  if (io_conf->enable_async_checkpoint()) {
+    Global<AsyncSnapshotWriter>::New(io_conf->async_checkpoint_writer_num(),
+                                     io_conf->async_checkpoint_staging_byte());
+  }
 }
 
 void Runtime::DeleteAllGlobal() {
   Global<RuntimeJobDescs>::Delete();
   Global<boxing::collective::CollectiveBoxingDeviceCtxPoller>::Delete();
   Global<ThreadMgr>::Delete();
+  // waits for the snapshot files still being written
+  Global<AsyncSnapshotWriter>::Delete();
   Global<ActorMsgBus>::Delete();
   Global<RegstMgr>::Delete();
   Global<MemoryAllocator>::Delete();
@@ -145,6 +166,9 @@ void Runtime::DeleteAllGlobal() {
   // should be called after Global<Transport>::Delete()
   if (Global<ResourceDesc, ForSession>::Get()->TotalMachineNum() > 1) {
 #ifdef OF_PLATFORM_POSIX
+    if (Global<ResourceDesc, ForSession>::Get()->collective_boxing_conf().cpu_enable_backend()) {
+      Global<Transport>::Delete();
+    }
     if (Global<ResourceDesc, ForSession>::Get()->use_rdma()) {
 #ifdef WITH_RDMA
       CHECK(Global<EpollCommNet>::Get() != static_cast<EpollCommNet*>(Global<CommNet>::Get()));
@@ -34,7 +34,7 @@ class AutoTrainStep final : public JobPass {
 
   Maybe<void> Apply(Job* job, JobPassCtx* ctx) const override {
     if (!IsEnabled(*ctx)) { return Maybe<void>::Ok(); }
-    const OpGraph op_graph(*job);
+    const OpGraph& op_graph = JUST(ctx->OpGraph4Job(*job));
     return Apply(op_graph, job);
   }
 };
@@ -152,6 +152,8 @@ class CompleteOfrecordDecoder final : public JobPass {
   Maybe<void> Apply(Job* job, JobPassCtx* ctx) const override { return Apply(job); }
 
   Maybe<void> Apply(Job* job) const {
+    // edits the job without JobBuilder
+    IncreaseJobEditCnt();
     SplitDecodeOps(job);
     AddRecordLoadOps(job);
     return Maybe<void>::Ok();
@@ -50,7 +50,7 @@ class CudnnFusedNormalizationAddReluPass final : public JobPass {
 
   Maybe<void> Apply(Job* job, JobPassCtx* ctx) const override {
     if (!IsEnabled(*ctx)) { return Maybe<void>::Ok(); }
-    const OpGraph op_graph(*job);
+    const OpGraph& op_graph = JUST(ctx->OpGraph4Job(*job));
     JobBuilder job_builder(job);
     return Apply(op_graph, &job_builder);
   }
@@ -38,7 +38,7 @@ class DumpTimeShapeAndBlobParallelConfPass final : public JobPass {
   }
 
   Maybe<void> Apply(Job* job, JobPassCtx* ctx) const override {
-    const OpGraph op_graph(*job);
+    const OpGraph& op_graph = JUST(ctx->OpGraph4Job(*job));
     return Apply(op_graph, job);
   }
 };
@@ -110,7 +110,7 @@ void FilterModelLbi2DiffLbi(const OpGraph& op_graph,
 
 Maybe<void> GenerateBackwardAndOptimizerOpConfs::Apply(Job* job, JobPassCtx* ctx) const {
   if (!IsEnabled(*ctx)) { return Maybe<void>::Ok(); }
-  const OpGraph op_graph(*job);
+  const OpGraph& op_graph = JUST(ctx->OpGraph4Job(*job));
   JobBuilder job_builder(job);
   LogicalBlobId total_loss_instance_num;
   HashMap<LogicalBlobId, LogicalBlobId> lbi2diff_lbi;
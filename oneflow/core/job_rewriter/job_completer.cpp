@@ -38,16 +38,30 @@ void CheckOpGraph(const OpGraph& op_graph) {
   });
 }
 
-void WithOpGraphAndMutJob(Job* job, const std::function<void(const OpGraph&, Job*)>& Handler) {
-  OpGraph op_graph(*job);
-  Handler(op_graph, job);
+void WithOpGraphAndMutJob(const std::string& pass_name, Job* job, JobPassCtx* ctx,
+                          const std::function<void(const OpGraph&, Job*)>& Handler) {
+  CHECK_JUST(TimeJobPass(pass_name, *job, ctx, [&]() -> Maybe<void> {
+    const OpGraph& op_graph = JUST(ctx->OpGraph4Job(*job));
+    Handler(op_graph, job);
+    // Handler edits the job without JobBuilder
+    IncreaseJobEditCnt();
+    return Maybe<void>::Ok();
+  }));
 }
 
-void WithOpGraphAndMutJobBuilder(Job* job,
+void WithOpGraphAndMutJobBuilder(const std::string& pass_name, Job* job, JobPassCtx* ctx,
                                  const std::function<void(const OpGraph&, JobBuilder*)>& Handler) {
-  OpGraph op_graph(*job);
-  JobBuilder job_builder(job);
-  Handler(op_graph, &job_builder);
+  CHECK_JUST(TimeJobPass(pass_name, *job, ctx, [&]() -> Maybe<void> {
+    const OpGraph& op_graph = JUST(ctx->OpGraph4Job(*job));
+    JobBuilder job_builder(job);
+    Handler(op_graph, &job_builder);
+    return Maybe<void>::Ok();
+  }));
+}
+
+void DoPass(const std::string& pass_name, Job* job, JobPassCtx* ctx) {
+  CHECK_JUST(
+      TimeJobPass(pass_name, *job, ctx, [&]() { return JobPass4Name(pass_name)(job, ctx); }));
 }
 
 void SetCtrlInOpName4VariableOp(const OpGraph& op_graph, JobBuilder* job_builder) {
@@ -94,30 +108,36 @@ void SetCtrlInOpName4VariableOp(const OpGraph& op_graph, JobBuilder* job_builder
 }  // namespace
 
 void JobCompleter::Complete(Job* job) const {
+  // the OpGraph of each pass is kept in job_pass_ctx for the next to build its own from, inferring
+  // again only the ops changed by the pass and the ones they feed other blobs
   JobPassCtx job_pass_ctx(GlobalJobDesc());
-  JobPass4Name("DumpTimeShapeAndBlobParallelConfPass")(job, &job_pass_ctx);
-  WithOpGraphAndMutJobBuilder(job, &GroupBoxingByDstParallel);
+  DoPass("DumpTimeShapeAndBlobParallelConfPass", job, &job_pass_ctx);
+  WithOpGraphAndMutJobBuilder("GroupBoxingByDstParallel", job, &job_pass_ctx,
+                              &GroupBoxingByDstParallel);
   if (GlobalJobDesc().enable_keep_header_only()) {
-    WithOpGraphAndMutJobBuilder(job, &AddKeepHeaderOnlyOp);
+    WithOpGraphAndMutJobBuilder("AddKeepHeaderOnlyOp", job, &job_pass_ctx, &AddKeepHeaderOnlyOp);
   }
-  WithOpGraphAndMutJobBuilder(job, &SetCtrlInOpName4VariableOp);
+  WithOpGraphAndMutJobBuilder("SetCtrlInOpName4VariableOp", job, &job_pass_ctx,
+                              &SetCtrlInOpName4VariableOp);
   // complete tick ops
-  WithOpGraphAndMutJobBuilder(job, &AutoSourceTick);
-  WithOpGraphAndMutJobBuilder(job, &AddTickForTimeShape);
-  WithOpGraphAndMutJobBuilder(job, &AutoSinkTick);
+  WithOpGraphAndMutJobBuilder("AutoSourceTick", job, &job_pass_ctx, &AutoSourceTick);
+  WithOpGraphAndMutJobBuilder("AddTickForTimeShape", job, &job_pass_ctx, &AddTickForTimeShape);
+  WithOpGraphAndMutJobBuilder("AutoSinkTick", job, &job_pass_ctx, &AutoSinkTick);
   AddGlobalTotalJobCriticalSection(*job);
-  WithOpGraphAndMutJobBuilder(job, &AddGlobalInputCriticalSections);
-  WithOpGraphAndMutJobBuilder(job, &AddGlobalOutputCriticalSections);
-  JobPass4Name("DumpTimeShapeAndBlobParallelConfPass")(job, &job_pass_ctx);
+  WithOpGraphAndMutJobBuilder("AddGlobalInputCriticalSections", job, &job_pass_ctx,
+                              &AddGlobalInputCriticalSections);
+  WithOpGraphAndMutJobBuilder("AddGlobalOutputCriticalSections", job, &job_pass_ctx,
+                              &AddGlobalOutputCriticalSections);
+  DoPass("DumpTimeShapeAndBlobParallelConfPass", job, &job_pass_ctx);
   if (XrtCompilationEnabled(GlobalJobDesc())) {
 #ifdef OF_WITH_XRT
-    WithOpGraphAndMutJob(job, &RebuildXrtCompiledJob);
+    WithOpGraphAndMutJob("RebuildXrtCompiledJob", job, &job_pass_ctx, &RebuildXrtCompiledJob);
 #else
     LOG(WARNING) << "It will not use XLA or TensorRT since WITH_XLA or "
                     "WITH_TENSORRT was not enabled when compiling the project.";
 #endif  // OF_WITH_XRT
   }
-  CheckOpGraph(OpGraph(*job));
+  CheckOpGraph(CHECK_JUST(job_pass_ctx.OpGraph4Job(*job)));
 }
 
 }  // namespace oneflow
@@ -40,4 +40,29 @@ const JobPass& JobPass4Name(const std::string& pass_name) {
   return *iter->second;
 }
 
+Maybe<void> TimeJobPass(const std::string& pass_name, const Job& job, JobPassCtx* ctx,
+                        const std::function<Maybe<void>()>& DoPass) {
+  const double start = GetCurTime();
+  const int64_t op_num = job.net().op_size();
+  const Maybe<void>& maybe_ok = DoPass();
+  // Not to miss the edits the pass left out of JobEditCnt, as ones through the pointers of a
+  // JobBuilder made after the count, the next pass compares its job with the graph op by op.
+  ctx->ExpireOpGraph();
+  JUST(maybe_ok);
+  VLOG(1) << "job " << job.job_conf().job_name() << " pass " << pass_name << ": "
+          << (GetCurTime() - start) / 1e6 << "ms, ops " << op_num << " -> " << job.net().op_size();
+  return Maybe<void>::Ok();
+}
+
+Maybe<const OpGraph&> JobPassCtx::OpGraph4Job(const Job& job) {
+  const int64_t job_edit_cnt = JobEditCnt();
+  if (!op_graph_ || op_graph_job_ != &job || op_graph_job_edit_cnt_ != job_edit_cnt) {
+    // op_graph_ is kept on errors, and is built again by the next call
+    op_graph_ = JUST(OpGraph::New(job, op_graph_.get()));
+    op_graph_job_ = &job;
+    op_graph_job_edit_cnt_ = job_edit_cnt;
+  }
+  return *op_graph_;
+}
+
 }  // namespace oneflow
@@ -45,7 +45,8 @@ class JobPassCtx {
  public:
   JobPassCtx(const JobPassCtx&) = delete;
   JobPassCtx(JobPassCtx&&) = delete;
-  JobPassCtx(const JobDesc& job_desc) : job_desc_(&job_desc) {}
+  JobPassCtx(const JobDesc& job_desc)
+      : job_desc_(&job_desc), op_graph_job_(nullptr), op_graph_job_edit_cnt_(0) {}
   ~JobPassCtx() = default;
 
   const JobDesc& job_desc() const { return *job_desc_; }
@@ -88,9 +89,21 @@ class JobPassCtx {
     return Maybe<void>::Ok();
   }
 
+  // The OpGraph of job, the one returned before in the same pass if no Job is edited since, as
+  // JobEditCnt tells. Otherwise only the ops changed since the graph returned before and the ones
+  // they feed other blobs are inferred again. It is valid until the next call.
+  Maybe<const OpGraph&> OpGraph4Job(const Job& job);
+  // Called by TimeJobPass after each pass. The graph returned before is not returned again, even
+  // for a JobEditCnt unchanged, but the next OpGraph4Job builds its graph from it.
+  void ExpireOpGraph() { op_graph_job_ = nullptr; }
+
  private:
   const JobDesc* job_desc_;
   HashMap<std::string, std::unique_ptr<JobPassState>> key2state_;
+  std::shared_ptr<OpGraph> op_graph_;
+  // the job op_graph_ is built of, and JobEditCnt() then
+  const Job* op_graph_job_;
+  int64_t op_graph_job_edit_cnt_;
 };
 
 #define REGISTER_JOB_PASS(pass_name, pass_type) COMMAND(RegisterJobPass(pass_name, new pass_type))
@@ -98,6 +111,10 @@ class JobPassCtx {
 void RegisterJobPass(const std::string& pass_name, const JobPass* pass);
 bool HasJobPass(const std::string& pass_name);
 const JobPass& JobPass4Name(const std::string& pass_name);
+// runs DoPass, which rewrites job, and logs its time and the numbers of ops before and after, then
+// expires the OpGraph of ctx
+Maybe<void> TimeJobPass(const std::string& pass_name, const Job& job, JobPassCtx* ctx,
+                        const std::function<Maybe<void>()>& DoPass);
 
 }  // namespace oneflow
 
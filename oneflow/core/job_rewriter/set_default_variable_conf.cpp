@@ -24,7 +24,7 @@ namespace {
 class SetDefaultVariableConf final : public JobPass {
  public:
   Maybe<void> Apply(Job* job, JobPassCtx* ctx) const override {
-    const OpGraph op_graph(*job);
+    const OpGraph& op_graph = JUST(ctx->OpGraph4Job(*job));
     JobBuilder job_builder(job);
     return Apply(op_graph, &job_builder);
   }
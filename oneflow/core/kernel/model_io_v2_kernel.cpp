@@ -124,16 +124,6 @@ std::string SyncReadStringFromBlob(DeviceCtx* ctx, const Blob* blob) {
   return std::string(content.data(), content.size());
 }
 
-std::string GetTmpPartKey(const std::string& base, const int64_t parallel_id,
-                          const int64_t parallel_num) {
-  return "tmp-part-" + std::to_string(parallel_id) + "-" + std::to_string(parallel_num) + "-"
-         + base;
-}
-
-std::string GetTmpPartKey(const std::string& base, const ParallelContext& parallel_ctx) {
-  return GetTmpPartKey(base, parallel_ctx.parallel_id(), parallel_ctx.parallel_num());
-}
-
 void HostSliceCopy(Blob* dst, const TensorSliceView& dst_slice, const Blob* src,
                    const TensorSliceView& src_slice) {
   CpuDeviceCtx cpu_device_ctx;
@@ -313,14 +303,12 @@ class ModelSaveV2Kernel final : public KernelIf<device_type> {
   ~ModelSaveV2Kernel() override = default;
 
  private:
-  void VirtualKernelInit() override { counter_.reset(new int64_t(0)); }
   void Forward(const KernelCtx& ctx,
                std::function<Blob*(const std::string&)> BnInOp2Blob) const override {
     ForwardDataContent(ctx, BnInOp2Blob);
   }
   void ForwardDataContent(const KernelCtx& ctx,
                           std::function<Blob*(const std::string&)> BnInOp2Blob) const override {
-    *counter_ += 1;
     const ModelSaveV2OpConf& conf = this->op_conf().model_save_v2_conf();
     const Blob* path_blob = BnInOp2Blob("path");
     Blob* in_blob = BnInOp2Blob("in");
@@ -328,7 +316,6 @@ class ModelSaveV2Kernel final : public KernelIf<device_type> {
     const VariableOpConf& original_variable_conf = conf.original_variable_conf();
     const Shape logical_blob_shape(original_variable_conf.shape());
     const bool is_broadcast = ShapeView(logical_blob_shape) == in_blob->shape();
-    const DataType data_type = original_variable_conf.data_type();
     if (is_broadcast && parallel_ctx.parallel_id() != 0) { return; }
     const std::string snapshot_path =
         SyncReadStringFromBlob<device_type>(ctx.device_ctx, path_blob);
@@ -336,28 +323,13 @@ class ModelSaveV2Kernel final : public KernelIf<device_type> {
     SnapshotWriter writer(snapshot_path);
     const std::string var_lbn =
         GenLogicalBlobName(conf.variable_op_name(), original_variable_conf.out());
-    const std::string key = is_broadcast ? var_lbn : GetTmpPartKey(var_lbn, parallel_ctx);
-    writer.Write(key, in_accessor.host_blob());
-    if (!is_broadcast) {
-      const int64_t parallel_num = parallel_ctx.parallel_num();
-      Global<CtrlClient>::Get()->Barrier(
-          snapshot_path + "-" + var_lbn + "-Counter-" + std::to_string(*counter_), parallel_num);
-      if (parallel_ctx.parallel_id() != 0) { return; }
-      TensorSliceView total_slice(logical_blob_shape);
-      OnDemandHostBlob total_blob(logical_blob_shape, data_type);
-      SnapshotReader reader(snapshot_path);
-      FOR_RANGE(int64_t, i, 0, parallel_num) {
-        const TensorSliceView part_slice = GetPartSlice(this->kernel_conf(), i);
-        const std::string part_key = GetTmpPartKey(var_lbn, i, parallel_num);
-        OnDemandHostBlob part_blob(part_slice.shape(), data_type);
-        reader.Read(part_key, part_blob.blob());
-        HostSliceCopy(total_blob.blob(), total_slice, part_blob.blob(), part_slice);
-        SnapshotFS()->RecursivelyDeleteDir(Dirname(JoinPath(snapshot_path, part_key)));
-      }
-      writer.Write(var_lbn, total_blob.blob());
+    if (is_broadcast) {
+      writer.Write(var_lbn, in_accessor.host_blob());
+    } else {
+      writer.WriteShard(var_lbn, parallel_ctx.parallel_id(), parallel_ctx.parallel_num(),
+                        GetPartSlice(this->kernel_conf()), in_accessor.host_blob());
     }
   }
-  std::unique_ptr<int64_t> counter_;
 };
 
 ADD_DEVICE_TYPE_KERNEL_CREATOR(OperatorConf::kModelSaveV2Conf, ModelSaveV2Kernel);
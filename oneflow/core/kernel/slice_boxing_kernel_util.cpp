@@ -14,13 +14,16 @@ See the License for the specific language governing permissions and
 limitations under the License.
 */
 #include "oneflow/core/kernel/slice_boxing_kernel_util.h"
+#include "oneflow/core/thread/thread_manager.h"
 
 namespace oneflow {
 
 template<typename T>
 struct SliceBoxingKernelUtil<DeviceType::kCPU, T> {
   static void Add(DeviceCtx* ctx, int64_t n, const T* a, const T* b, T* out) {
-    for (int64_t i = 0; i < n; ++i) { out[i] = a[i] + b[i]; }
+    ParallelFor(n, kParallelForGrainSize, [=](int64_t begin, int64_t end) {
+      for (int64_t i = begin; i < end; ++i) { out[i] = a[i] + b[i]; }
+    });
   }
 };
 
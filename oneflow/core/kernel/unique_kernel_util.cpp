@@ -14,6 +14,8 @@ See the License for the specific language governing permissions and
 limitations under the License.
 */
 #include "oneflow/core/kernel/unique_kernel_util.h"
+#include "oneflow/core/kernel/util/host_concurrent_hash_table.h"
+#include "oneflow/core/thread/thread_manager.h"
 
 namespace oneflow {
 
@@ -27,31 +29,31 @@ struct UniqueKernelUtil<DeviceType::kCPU, KEY, IDX> {
   static void UniqueWithCounts(DeviceCtx* ctx, int64_t n, const KEY* in, IDX* num_unique,
                                KEY* unique_out, IDX* idx_out, IDX* count, void* workspace,
                                int64_t workspace_size_in_bytes) {
-    HashMap<KEY, IDX> map;
-    FOR_RANGE(int64_t, i, 0, n) {
-      KEY in_i = in[i];
-      auto it = map.find(in_i);
-      if (it == map.end()) {
-        IDX idx = map.size();
-        if (count != nullptr) { count[idx] = 1; }
-        idx_out[i] = idx;
-        unique_out[idx] = in_i;
-        map[in_i] = idx;
-      } else {
-        IDX idx = it->second;
-        if (count != nullptr) { count[idx] += 1; }
-        idx_out[i] = idx;
-      }
-    }
-    *num_unique = map.size();
+    HostConcurrentHashTable<KEY> table(n, in, workspace, workspace_size_in_bytes);
+    ParallelFor(table.capacity(), kParallelForGrainSize,
+                [&](int64_t begin, int64_t end) { table.Clear(begin, end); });
+    ParallelFor(n, kParallelForGrainSize,
+                [&](int64_t begin, int64_t end) { table.Insert(begin, end, count != nullptr); });
+    ParallelFor(table.num_chunks(), 1,
+                [&](int64_t begin, int64_t end) { table.CountUnique(begin, end); });
+    *num_unique = table.ScanChunks();
+    ParallelFor(table.num_chunks(), 1, [&](int64_t begin, int64_t end) {
+      table.ForEachUnique(begin, end, [&](int64_t i, int64_t rank) {
+        unique_out[rank] = in[i];
+        if (count != nullptr) { count[rank] = table.Count(i); }
+      });
+    });
+    ParallelFor(n, kParallelForGrainSize, [&](int64_t begin, int64_t end) {
+      FOR_RANGE(int64_t, i, begin, end) { idx_out[i] = table.Rank(i); }
+    });
   }
   static void GetUniqueWorkspaceSizeInBytes(DeviceCtx* ctx, int64_t n,
                                             int64_t* workspace_size_in_bytes) {
-    *workspace_size_in_bytes = 1;
+    *workspace_size_in_bytes = HostConcurrentHashTable<KEY>::WorkspaceSizeInBytes(n);
   }
   static void GetUniqueWithCountsWorkspaceSizeInBytes(DeviceCtx* ctx, int64_t n,
                                                       int64_t* workspace_size_in_bytes) {
-    *workspace_size_in_bytes = 1;
+    *workspace_size_in_bytes = HostConcurrentHashTable<KEY>::WorkspaceSizeInBytes(n);
   }
 };
 
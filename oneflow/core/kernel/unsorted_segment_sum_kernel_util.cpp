@@ -14,6 +14,7 @@ See the License for the specific language governing permissions and
 limitations under the License.
 */
 #include "oneflow/core/kernel/unsorted_segment_sum_kernel_util.h"
+#include "oneflow/core/thread/thread_manager.h"
 
 namespace oneflow {
 
@@ -30,17 +31,27 @@ void UnsortedSegmentSumKernelUtil<DeviceType::kCPU, T, K>::UnsortedSegmentSum(
     DeviceCtx* ctx, const K* segment_ids, const T* data, int64_t num_segment_ids,
     int64_t num_segments, int64_t outer_dim_size, int64_t inner_dim_size, int64_t segment_id_offset,
     T* out) {
-  FOR_RANGE(int64_t, outer_idx, 0, outer_dim_size) {
-    FOR_RANGE(int64_t, i, 0, num_segment_ids) {
-      CHECK_GE(segment_ids[i], 0);
-      const int64_t idx = segment_ids[i] - segment_id_offset;
-      T* to = out + outer_idx * num_segments * inner_dim_size + idx * inner_dim_size;
-      if (idx >= 0 && idx < num_segments) {
-        const T* from = data + outer_idx * num_segment_ids * inner_dim_size + i * inner_dim_size;
-        std::transform(from, from + inner_dim_size, to, to, std::plus<T>());
+  FOR_RANGE(int64_t, i, 0, num_segment_ids) { CHECK_GE(segment_ids[i], 0); }
+  // different segment ids may hit the same output row, so the work is split along the columns
+  // (outer_idx, inner_idx) instead of the segment ids
+  const int64_t grain_size = 4096;
+  ParallelFor(outer_dim_size * inner_dim_size, grain_size, [&](int64_t begin, int64_t end) {
+    while (begin < end) {
+      const int64_t outer_idx = begin / inner_dim_size;
+      const int64_t inner_begin = begin - outer_idx * inner_dim_size;
+      const int64_t inner_end = std::min(inner_dim_size, inner_begin + end - begin);
+      FOR_RANGE(int64_t, i, 0, num_segment_ids) {
+        const int64_t idx = segment_ids[i] - segment_id_offset;
+        if (idx >= 0 && idx < num_segments) {
+          T* to = out + outer_idx * num_segments * inner_dim_size + idx * inner_dim_size;
+          const T* from = data + outer_idx * num_segment_ids * inner_dim_size + i * inner_dim_size;
+          std::transform(from + inner_begin, from + inner_end, to + inner_begin, to + inner_begin,
+                         std::plus<T>());
+        }
       }
+      begin += inner_end - inner_begin;
     }
-  }
+  });
 }
 #define INITIATE_UNSORTED_SEGMENT_SUM_KERNEL_UTIL_CPU(in_type_pair, index_type_pair)             \
   template struct UnsortedSegmentSumKernelUtil<DeviceType::kCPU, OF_PP_PAIR_FIRST(in_type_pair), \
@@ -0,0 +1,143 @@
+/*
+Copyright 2020 The OneFlow Authors. All rights reserved.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+*/
+#include "oneflow/core/kernel/util/host_concurrent_hash_table.h"
+#include "oneflow/core/common/data_type.h"
+
+namespace oneflow {
+
+namespace {
+
+constexpr int64_t kMinCapacity = 16;
+// keys are ranked in chunks of at least kMinChunkSize, with at most kMaxNumChunks chunks
+constexpr int64_t kMinChunkSize = 4096;
+constexpr int64_t kMaxNumChunks = 1024;
+
+template<typename K>
+typename std::enable_if<std::is_integral<K>::value, uint64_t>::type KeyBits(K key) {
+  return static_cast<uint64_t>(static_cast<int64_t>(key));
+}
+
+// -0.0 == 0.0, so both hash as 0
+template<typename K>
+typename std::enable_if<std::is_floating_point<K>::value, uint64_t>::type KeyBits(K key) {
+  if (key == 0) { return 0; }
+  const double value = key;
+  uint64_t bits;
+  std::memcpy(&bits, &value, sizeof(bits));
+  return bits;
+}
+
+// the finalizer of splitmix64, so that keys differing only in high bits spread over the slots
+template<typename K>
+uint64_t Hash(K key) {
+  uint64_t x = KeyBits(key);
+  x = (x ^ (x >> 30)) * 0xbf58476d1ce4e5b9ULL;
+  x = (x ^ (x >> 27)) * 0x94d049bb133111ebULL;
+  return x ^ (x >> 31);
+}
+
+}  // namespace
+
+template<typename K>
+HostConcurrentHashTable<K>::HostConcurrentHashTable(int64_t num_keys, const K* keys,
+                                                    void* workspace,
+                                                    int64_t workspace_size_in_bytes)
+    : num_keys_(num_keys),
+      keys_(keys),
+      capacity_(Capacity(num_keys)),
+      num_chunks_(NumChunks(num_keys)) {
+  CHECK_GE(num_keys, 0);
+  CHECK_LE(WorkspaceSizeInBytes(num_keys), workspace_size_in_bytes);
+  chunk_size_ = RoundUp(num_keys, num_chunks_) / num_chunks_;
+  slots_ = reinterpret_cast<Slot*>(workspace);
+  key_slots_ = reinterpret_cast<int64_t*>(slots_ + capacity_);
+  chunk_offsets_ = key_slots_ + num_keys;
+}
+
+template<typename K>
+int64_t HostConcurrentHashTable<K>::WorkspaceSizeInBytes(int64_t num_keys) {
+  return Capacity(num_keys) * sizeof(Slot) + (num_keys + NumChunks(num_keys)) * sizeof(int64_t);
+}
+
+template<typename K>
+int64_t HostConcurrentHashTable<K>::Capacity(int64_t num_keys) {
+  int64_t capacity = kMinCapacity;
+  while (capacity < 2 * num_keys) { capacity *= 2; }
+  return capacity;
+}
+
+template<typename K>
+int64_t HostConcurrentHashTable<K>::NumChunks(int64_t num_keys) {
+  return std::max<int64_t>(std::min(num_keys / kMinChunkSize, kMaxNumChunks), 1);
+}
+
+template<typename K>
+void HostConcurrentHashTable<K>::Clear(int64_t slot_begin, int64_t slot_end) {
+  FOR_RANGE(int64_t, i, slot_begin, slot_end) { new (slots_ + i) Slot(); }
+}
+
+template<typename K>
+void HostConcurrentHashTable<K>::Insert(int64_t key_begin, int64_t key_end, bool count) {
+  const int64_t mask = capacity_ - 1;
+  FOR_RANGE(int64_t, i, key_begin, key_end) {
+    const K key = keys_[i];
+    int64_t slot = static_cast<int64_t>(Hash(key)) & mask;
+    while (true) {
+      std::atomic<int64_t>& first = slots_[slot].first;
+      int64_t cur = first.load(std::memory_order_relaxed);
+      // on failure the CAS loads the index another thread has put in
+      if (cur == 0 && first.compare_exchange_strong(cur, i + 1)) { break; }
+      if (keys_[cur - 1] == key) {
+        while (cur > i + 1 && !first.compare_exchange_weak(cur, i + 1)) {}
+        break;
+      }
+      slot = (slot + 1) & mask;
+    }
+    key_slots_[i] = slot;
+    if (count) { slots_[slot].count.fetch_add(1, std::memory_order_relaxed); }
+  }
+}
+
+template<typename K>
+void HostConcurrentHashTable<K>::CountUnique(int64_t chunk_begin, int64_t chunk_end) {
+  FOR_RANGE(int64_t, chunk, chunk_begin, chunk_end) {
+    int64_t num_unique = 0;
+    FOR_RANGE(int64_t, i, ChunkBegin(chunk), ChunkBegin(chunk + 1)) {
+      if (slots_[key_slots_[i]].first.load(std::memory_order_relaxed) == i + 1) {
+        num_unique += 1;
+      }
+    }
+    chunk_offsets_[chunk] = num_unique;
+  }
+}
+
+template<typename K>
+int64_t HostConcurrentHashTable<K>::ScanChunks() {
+  int64_t num_unique = 0;
+  FOR_RANGE(int64_t, chunk, 0, num_chunks_) {
+    const int64_t chunk_num_unique = chunk_offsets_[chunk];
+    chunk_offsets_[chunk] = num_unique;
+    num_unique += chunk_num_unique;
+  }
+  return num_unique;
+}
+
+#define INSTANTIATE_HOST_CONCURRENT_HASH_TABLE(type_cpp, type_proto) \
+  template class HostConcurrentHashTable<type_cpp>;
+OF_PP_FOR_EACH_TUPLE(INSTANTIATE_HOST_CONCURRENT_HASH_TABLE, ARITHMETIC_DATA_TYPE_SEQ);
+#undef INSTANTIATE_HOST_CONCURRENT_HASH_TABLE
+
+}  // namespace oneflow
@@ -0,0 +1,111 @@
+/*
+Copyright 2020 The OneFlow Authors. All rights reserved.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+*/
+#ifndef ONEFLOW_CORE_KERNEL_UTIL_HOST_CONCURRENT_HASH_TABLE_H_
+#define ONEFLOW_CORE_KERNEL_UTIL_HOST_CONCURRENT_HASH_TABLE_H_
+
+#include <atomic>
+#include "oneflow/core/common/util.h"
+
+namespace oneflow {
+
+// An open addressing hash table that many threads fill at once, to find the distinct keys of an
+// array. It lives in memory given by the caller, e.g. the workspace of a kernel, and its capacity
+// is a power of two of at least twice the number of keys, so probing only masks the hash.
+// A slot holds the index of a key in the array rather than the key: inserting is one CAS of that
+// index into an empty slot, and keys of any type compare with == as they would in a HashMap.
+// A slot keeps the smallest index its key appears at, so the ranks of the keys in order of first
+// appearance, and whatever is numbered by them, do not depend on the threads.
+//
+// Use is in steps over ranges, so callers may spread each step over threads, and every step has
+// to be finished before the next one begins:
+//  1. Clear(slot_begin, slot_end) over [0, capacity())
+//  2. Insert(key_begin, key_end, count) over [0, num_keys)
+//  3. CountUnique(chunk_begin, chunk_end) over [0, num_chunks())
+//  4. ScanChunks() on one thread, which returns the number of distinct keys
+//  5. ForEachUnique(chunk_begin, chunk_end, Fn) over [0, num_chunks()), which calls
+//     Fn(key_index, rank) at the first appearance of each key
+//  6. Rank(key_index), and Count(key_index) when step 2 counted
+template<typename K>
+class HostConcurrentHashTable final {
+ public:
+  OF_DISALLOW_COPY_AND_MOVE(HostConcurrentHashTable);
+  HostConcurrentHashTable(int64_t num_keys, const K* keys, void* workspace,
+                          int64_t workspace_size_in_bytes);
+  ~HostConcurrentHashTable() = default;
+
+  static int64_t WorkspaceSizeInBytes(int64_t num_keys);
+
+  int64_t capacity() const { return capacity_; }
+  int64_t num_chunks() const { return num_chunks_; }
+
+  void Clear(int64_t slot_begin, int64_t slot_end);
+  void Insert(int64_t key_begin, int64_t key_end, bool count);
+  void CountUnique(int64_t chunk_begin, int64_t chunk_end);
+  int64_t ScanChunks();
+  template<typename F>
+  void ForEachUnique(int64_t chunk_begin, int64_t chunk_end, const F& Fn);
+  int64_t Rank(int64_t key_index) const {
+    return -slots_[key_slots_[key_index]].first.load(std::memory_order_relaxed) - 1;
+  }
+  int64_t Count(int64_t key_index) const {
+    return slots_[key_slots_[key_index]].count.load(std::memory_order_relaxed);
+  }
+
+ private:
+  // first is 0 when the slot is empty, the smallest index of its key plus 1 after step 2, and
+  // minus the rank of its key minus 1 after step 5
+  struct Slot {
+    Slot() : first(0), count(0) {}
+    std::atomic<int64_t> first;
+    std::atomic<int64_t> count;
+  };
+
+  static int64_t Capacity(int64_t num_keys);
+  static int64_t NumChunks(int64_t num_keys);
+  int64_t ChunkBegin(int64_t chunk) const { return std::min(chunk * chunk_size_, num_keys_); }
+
+  int64_t num_keys_;
+  const K* keys_;
+  int64_t capacity_;
+  int64_t num_chunks_;
+  int64_t chunk_size_;
+  Slot* slots_;
+  // the slot of each key
+  int64_t* key_slots_;
+  // the number of distinct keys first appearing in each chunk, then the rank of the first one
+  int64_t* chunk_offsets_;
+};
+
+template<typename K>
+template<typename F>
+void HostConcurrentHashTable<K>::ForEachUnique(int64_t chunk_begin, int64_t chunk_end,
+                                               const F& Fn) {
+  FOR_RANGE(int64_t, chunk, chunk_begin, chunk_end) {
+    int64_t rank = chunk_offsets_[chunk];
+    FOR_RANGE(int64_t, i, ChunkBegin(chunk), ChunkBegin(chunk + 1)) {
+      std::atomic<int64_t>& first = slots_[key_slots_[i]].first;
+      // keys that appeared before hold i + 1 or an already stored rank, both differ from i + 1
+      if (first.load(std::memory_order_relaxed) != i + 1) { continue; }
+      Fn(i, rank);
+      first.store(-rank - 1, std::memory_order_relaxed);
+      rank += 1;
+    }
+  }
+}
+
+}  // namespace oneflow
+
+#endif  // ONEFLOW_CORE_KERNEL_UTIL_HOST_CONCURRENT_HASH_TABLE_H_
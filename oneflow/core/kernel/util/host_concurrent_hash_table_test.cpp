@@ -0,0 +1,155 @@
+/*
+Copyright 2020 The OneFlow Authors. All rights reserved.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+*/
+#include <gtest/gtest.h>
+#include <chrono>
+#include <thread>
+#include "oneflow/core/kernel/util/host_concurrent_hash_table.h"
+
+namespace oneflow {
+
+namespace {
+
+// runs Fn on [0, num) split over num_threads threads
+void RunOnThreads(int64_t num_threads, int64_t num,
+                  const std::function<void(int64_t, int64_t)>& Fn) {
+  std::vector<std::thread> threads;
+  FOR_RANGE(int64_t, t, 0, num_threads) {
+    threads.emplace_back(Fn, num * t / num_threads, num * (t + 1) / num_threads);
+  }
+  for (std::thread& thread : threads) { thread.join(); }
+}
+
+template<typename K>
+struct UniqueResult {
+  std::vector<K> unique;
+  std::vector<int64_t> idx;
+  std::vector<int64_t> count;
+};
+
+template<typename K>
+UniqueResult<K> ConcurrentUnique(const std::vector<K>& keys, int64_t num_threads) {
+  const int64_t n = keys.size();
+  const int64_t workspace_size = HostConcurrentHashTable<K>::WorkspaceSizeInBytes(n);
+  std::vector<int64_t> workspace(RoundUp(workspace_size, sizeof(int64_t)) / sizeof(int64_t));
+  HostConcurrentHashTable<K> table(n, keys.data(), workspace.data(), workspace_size);
+  RunOnThreads(num_threads, table.capacity(),
+               [&](int64_t begin, int64_t end) { table.Clear(begin, end); });
+  RunOnThreads(num_threads, n, [&](int64_t begin, int64_t end) { table.Insert(begin, end, true); });
+  RunOnThreads(num_threads, table.num_chunks(),
+               [&](int64_t begin, int64_t end) { table.CountUnique(begin, end); });
+  UniqueResult<K> result;
+  const int64_t num_unique = table.ScanChunks();
+  result.unique.resize(num_unique);
+  result.count.resize(num_unique);
+  RunOnThreads(num_threads, table.num_chunks(), [&](int64_t begin, int64_t end) {
+    table.ForEachUnique(begin, end, [&](int64_t i, int64_t rank) {
+      result.unique[rank] = keys[i];
+      result.count[rank] = table.Count(i);
+    });
+  });
+  result.idx.resize(n);
+  RunOnThreads(num_threads, n, [&](int64_t begin, int64_t end) {
+    FOR_RANGE(int64_t, i, begin, end) { result.idx[i] = table.Rank(i); }
+  });
+  return result;
+}
+
+// one key at a time with a std::unordered_map, as the unique kernel used to be
+template<typename K>
+UniqueResult<K> SerialUnique(const std::vector<K>& keys) {
+  std::unordered_map<K, int64_t> map;
+  UniqueResult<K> result;
+  for (const K key : keys) {
+    auto it = map.find(key);
+    if (it == map.end()) {
+      it = map.emplace(key, result.unique.size()).first;
+      result.unique.push_back(key);
+      result.count.push_back(0);
+    }
+    result.idx.push_back(it->second);
+    result.count[it->second] += 1;
+  }
+  return result;
+}
+
+template<typename K>
+void TestUnique(const std::vector<K>& keys) {
+  const UniqueResult<K> expected = SerialUnique<K>(keys);
+  for (const int64_t num_threads : {1, 3, 8}) {
+    const UniqueResult<K> actual = ConcurrentUnique<K>(keys, num_threads);
+    ASSERT_EQ(expected.unique.size(), actual.unique.size());
+    FOR_RANGE(size_t, i, 0, expected.unique.size()) {
+      ASSERT_EQ(expected.unique[i], actual.unique[i]);
+    }
+    ASSERT_EQ(expected.idx, actual.idx);
+    ASSERT_EQ(expected.count, actual.count);
+  }
+}
+
+template<typename K>
+std::vector<K> RandomKeys(int64_t n, int64_t num_distinct) {
+  std::mt19937 gen(n);
+  std::uniform_int_distribution<int64_t> dis(-num_distinct / 2, num_distinct - num_distinct / 2);
+  std::vector<K> keys(n);
+  for (K& key : keys) { key = static_cast<K>(dis(gen)); }
+  return keys;
+}
+
+}  // namespace
+
+TEST(HostConcurrentHashTable, unique) {
+  TestUnique<int64_t>({});
+  TestUnique<int64_t>({7});
+  for (const int64_t n : {100, 10000, 100000}) {
+    for (const int64_t num_distinct : {1, 50, 5000, 1000000}) {
+      TestUnique<int64_t>(RandomKeys<int64_t>(n, num_distinct));
+      TestUnique<int32_t>(RandomKeys<int32_t>(n, num_distinct));
+      TestUnique<float>(RandomKeys<float>(n, num_distinct));
+    }
+  }
+  TestUnique<int8_t>(RandomKeys<int8_t>(50000, 200));
+  // keys differing only in high bits
+  std::vector<int64_t> keys;
+  FOR_RANGE(int64_t, i, 0, 10000) { keys.push_back((i % 1000) << 40); }
+  TestUnique<int64_t>(keys);
+}
+
+TEST(HostConcurrentHashTable, float_zeros) {
+  const UniqueResult<double> result = ConcurrentUnique<double>({0.0, -0.0, 1.0, 0.0}, 2);
+  ASSERT_EQ(result.unique.size(), 2);
+  ASSERT_EQ(result.idx, std::vector<int64_t>({0, 0, 1, 0}));
+  ASSERT_EQ(result.count, std::vector<int64_t>({3, 1}));
+}
+
+// compares the table with a std::unordered_map, run with --gtest_also_run_disabled_tests
+TEST(HostConcurrentHashTable, DISABLED_benchmark) {
+  const std::vector<int64_t> keys = RandomKeys<int64_t>(1 << 22, 1 << 20);
+  const auto Time = [](const std::function<void()>& Run) {
+    Run();
+    const auto start = std::chrono::steady_clock::now();
+    Run();
+    return std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start)
+        .count();
+  };
+  const int64_t num_threads = std::thread::hardware_concurrency();
+  const double serial_ms = Time([&]() { SerialUnique<int64_t>(keys); });
+  const double one_thread_ms = Time([&]() { ConcurrentUnique<int64_t>(keys, 1); });
+  const double threads_ms = Time([&]() { ConcurrentUnique<int64_t>(keys, num_threads); });
+  LOG(INFO) << "unique of 4M keys: unordered_map " << serial_ms << "ms, table on 1 thread "
+            << one_thread_ms << "ms, on " << num_threads << " threads " << threads_ms << "ms";
+}
+
+}  // namespace oneflow
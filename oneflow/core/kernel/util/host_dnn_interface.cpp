@@ -14,6 +14,8 @@ See the License for the specific language governing permissions and
 limitations under the License.
 */
 #include "oneflow/core/kernel/util/host_dnn_interface.h"
+#include "oneflow/core/common/cpu_simd_math.h"
+#include "oneflow/core/thread/thread_manager.h"
 
 namespace oneflow {
 
@@ -21,38 +23,52 @@ namespace {
 
 template<typename T>
 static void ReluImpl(DeviceCtx* ctx, const int64_t n, const T* x, T* y) {
-  T zero = GetZeroVal<T>();
-  for (int64_t i = 0; i != n; ++i) { y[i] = std::max(x[i], zero); }
+  using V = simd::SimdVec<T>;
+  ParallelFor(n, kParallelForGrainSize, [&](int64_t begin, int64_t end) {
+    simd::Transform(end - begin, x + begin, y + begin,
+                    [](typename V::Reg v) { return V::Max(V::Zero(), v); });
+  });
 }
 
 template<typename T>
 static void ReluBackwardImpl(DeviceCtx* ctx, const int64_t n, const T* x, const T* y, const T* dy,
                              T* dx) {
   T zero = GetZeroVal<T>();
-  for (int64_t i = 0; i != n; ++i) { dx[i] = (y[i] > zero) * dy[i]; }
+  ParallelFor(n, kParallelForGrainSize, [&](int64_t begin, int64_t end) {
+    for (int64_t i = begin; i != end; ++i) { dx[i] = (y[i] > zero) * dy[i]; }
+  });
 }
 
 template<typename T>
 static void SigmoidImpl(DeviceCtx* ctx, int64_t n, const T* x, T* y) {
-  T half = static_cast<T>(0.5);
-  for (int64_t i = 0; i != n; ++i) { y[i] = half * std::tanh(half * x[i]) + half; }
+  ParallelFor(n, kParallelForGrainSize, [&](int64_t begin, int64_t end) {
+    simd::Transform(end - begin, x + begin, y + begin,
+                    [](typename simd::Math<T>::Reg v) { return simd::Math<T>::Sigmoid(v); });
+  });
 }
 
 template<typename T>
 static void SigmoidBackwardImpl(DeviceCtx* ctx, const int64_t n, const T* x, const T* y,
                                 const T* dy, T* dx) {
-  for (int64_t i = 0; i != n; ++i) { dx[i] = y[i] * (1 - y[i]) * dy[i]; }
+  ParallelFor(n, kParallelForGrainSize, [&](int64_t begin, int64_t end) {
+    for (int64_t i = begin; i != end; ++i) { dx[i] = y[i] * (1 - y[i]) * dy[i]; }
+  });
 }
 
 template<typename T>
 static void TanHImpl(DeviceCtx* ctx, int64_t n, const T* x, T* y) {
-  for (int64_t i = 0; i != n; ++i) { y[i] = std::tanh(x[i]); }
+  ParallelFor(n, kParallelForGrainSize, [&](int64_t begin, int64_t end) {
+    simd::Transform(end - begin, x + begin, y + begin,
+                    [](typename simd::Math<T>::Reg v) { return simd::Math<T>::Tanh(v); });
+  });
 }
 
 template<typename T>
 static void TanHBackwardImpl(DeviceCtx* ctx, const int64_t n, const T* x, const T* y, const T* dy,
                              T* dx) {
-  for (int64_t i = 0; i != n; ++i) { dx[i] = (1 - y[i] * y[i]) * dy[i]; }
+  ParallelFor(n, kParallelForGrainSize, [&](int64_t begin, int64_t end) {
+    for (int64_t i = begin; i != end; ++i) { dx[i] = (1 - y[i] * y[i]) * dy[i]; }
+  });
 }
 
 }  // namespace
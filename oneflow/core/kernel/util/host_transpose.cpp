@@ -0,0 +1,296 @@
+/*
+Copyright 2020 The OneFlow Authors. All rights reserved.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+*/
+#include "oneflow/core/kernel/util/host_transpose.h"
+#include "oneflow/core/common/cpu_simd.h"
+#include "oneflow/core/common/data_type.h"
+
+namespace oneflow {
+
+namespace {
+
+// a tile of both sides stays in L1
+constexpr int64_t kTileSize = 32;
+
+constexpr int64_t kCopyTaskSize = 32768;
+
+// moves a kSize x kSize block, x[i * x_stride + j] to y[j * y_stride + i]
+template<size_t elem_size>
+struct MicroKernel {
+  static const int64_t kSize = 8;
+  template<typename T>
+  static void Run(const T* x, int64_t x_stride, T* y, int64_t y_stride) {
+    for (int64_t j = 0; j < kSize; ++j) {
+      for (int64_t i = 0; i < kSize; ++i) { y[j * y_stride + i] = x[i * x_stride + j]; }
+    }
+  }
+};
+
+#if defined(OF_CPU_SIMD_AVX2)
+
+template<>
+struct MicroKernel<4> {
+  static const int64_t kSize = 8;
+  template<typename T>
+  static void Run(const T* x, int64_t x_stride, T* y, int64_t y_stride) {
+    const float* src = reinterpret_cast<const float*>(x);
+    float* dst = reinterpret_cast<float*>(y);
+    const __m256 r0 = _mm256_loadu_ps(src + 0 * x_stride);
+    const __m256 r1 = _mm256_loadu_ps(src + 1 * x_stride);
+    const __m256 r2 = _mm256_loadu_ps(src + 2 * x_stride);
+    const __m256 r3 = _mm256_loadu_ps(src + 3 * x_stride);
+    const __m256 r4 = _mm256_loadu_ps(src + 4 * x_stride);
+    const __m256 r5 = _mm256_loadu_ps(src + 5 * x_stride);
+    const __m256 r6 = _mm256_loadu_ps(src + 6 * x_stride);
+    const __m256 r7 = _mm256_loadu_ps(src + 7 * x_stride);
+    const __m256 t0 = _mm256_unpacklo_ps(r0, r1);
+    const __m256 t1 = _mm256_unpackhi_ps(r0, r1);
+    const __m256 t2 = _mm256_unpacklo_ps(r2, r3);
+    const __m256 t3 = _mm256_unpackhi_ps(r2, r3);
+    const __m256 t4 = _mm256_unpacklo_ps(r4, r5);
+    const __m256 t5 = _mm256_unpackhi_ps(r4, r5);
+    const __m256 t6 = _mm256_unpacklo_ps(r6, r7);
+    const __m256 t7 = _mm256_unpackhi_ps(r6, r7);
+    const __m256 u0 = _mm256_shuffle_ps(t0, t2, _MM_SHUFFLE(1, 0, 1, 0));
+    const __m256 u1 = _mm256_shuffle_ps(t0, t2, _MM_SHUFFLE(3, 2, 3, 2));
+    const __m256 u2 = _mm256_shuffle_ps(t1, t3, _MM_SHUFFLE(1, 0, 1, 0));
+    const __m256 u3 = _mm256_shuffle_ps(t1, t3, _MM_SHUFFLE(3, 2, 3, 2));
+    const __m256 u4 = _mm256_shuffle_ps(t4, t6, _MM_SHUFFLE(1, 0, 1, 0));
+    const __m256 u5 = _mm256_shuffle_ps(t4, t6, _MM_SHUFFLE(3, 2, 3, 2));
+    const __m256 u6 = _mm256_shuffle_ps(t5, t7, _MM_SHUFFLE(1, 0, 1, 0));
+    const __m256 u7 = _mm256_shuffle_ps(t5, t7, _MM_SHUFFLE(3, 2, 3, 2));
+    _mm256_storeu_ps(dst + 0 * y_stride, _mm256_permute2f128_ps(u0, u4, 0x20));
+    _mm256_storeu_ps(dst + 1 * y_stride, _mm256_permute2f128_ps(u1, u5, 0x20));
+    _mm256_storeu_ps(dst + 2 * y_stride, _mm256_permute2f128_ps(u2, u6, 0x20));
+    _mm256_storeu_ps(dst + 3 * y_stride, _mm256_permute2f128_ps(u3, u7, 0x20));
+    _mm256_storeu_ps(dst + 4 * y_stride, _mm256_permute2f128_ps(u0, u4, 0x31));
+    _mm256_storeu_ps(dst + 5 * y_stride, _mm256_permute2f128_ps(u1, u5, 0x31));
+    _mm256_storeu_ps(dst + 6 * y_stride, _mm256_permute2f128_ps(u2, u6, 0x31));
+    _mm256_storeu_ps(dst + 7 * y_stride, _mm256_permute2f128_ps(u3, u7, 0x31));
+  }
+};
+
+template<>
+struct MicroKernel<8> {
+  static const int64_t kSize = 4;
+  template<typename T>
+  static void Run(const T* x, int64_t x_stride, T* y, int64_t y_stride) {
+    const double* src = reinterpret_cast<const double*>(x);
+    double* dst = reinterpret_cast<double*>(y);
+    const __m256d r0 = _mm256_loadu_pd(src + 0 * x_stride);
+    const __m256d r1 = _mm256_loadu_pd(src + 1 * x_stride);
+    const __m256d r2 = _mm256_loadu_pd(src + 2 * x_stride);
+    const __m256d r3 = _mm256_loadu_pd(src + 3 * x_stride);
+    const __m256d t0 = _mm256_unpacklo_pd(r0, r1);
+    const __m256d t1 = _mm256_unpackhi_pd(r0, r1);
+    const __m256d t2 = _mm256_unpacklo_pd(r2, r3);
+    const __m256d t3 = _mm256_unpackhi_pd(r2, r3);
+    _mm256_storeu_pd(dst + 0 * y_stride, _mm256_permute2f128_pd(t0, t2, 0x20));
+    _mm256_storeu_pd(dst + 1 * y_stride, _mm256_permute2f128_pd(t1, t3, 0x20));
+    _mm256_storeu_pd(dst + 2 * y_stride, _mm256_permute2f128_pd(t0, t2, 0x31));
+    _mm256_storeu_pd(dst + 3 * y_stride, _mm256_permute2f128_pd(t1, t3, 0x31));
+  }
+};
+
+#endif  // OF_CPU_SIMD_AVX2
+
+// moves rows [row_begin, row_end) by cols [col_begin, col_end) of x
+template<typename T>
+void TransposeTile(const T* x, int64_t x_row_stride, T* y, int64_t y_col_stride,
+                   int64_t row_begin, int64_t row_end, int64_t col_begin, int64_t col_end) {
+  using Micro = MicroKernel<sizeof(T)>;
+  constexpr int64_t kSize = Micro::kSize;
+  int64_t i = row_begin;
+  for (; i + kSize <= row_end; i += kSize) {
+    int64_t j = col_begin;
+    for (; j + kSize <= col_end; j += kSize) {
+      Micro::Run(x + i * x_row_stride + j, x_row_stride, y + j * y_col_stride + i, y_col_stride);
+    }
+    for (; j < col_end; ++j) {
+      for (int64_t k = i; k < i + kSize; ++k) { y[j * y_col_stride + k] = x[k * x_row_stride + j]; }
+    }
+  }
+  if (i < row_end) {
+    for (int64_t j = col_begin; j < col_end; ++j) {
+      for (int64_t k = i; k < row_end; ++k) { y[j * y_col_stride + k] = x[k * x_row_stride + j]; }
+    }
+  }
+}
+
+}  // namespace
+
+HostTransposePlan::HostTransposePlan(int32_t num_axis, const int64_t* x_dims,
+                                     const int32_t* permutation)
+    : num_outer_(1),
+      row_size_(1),
+      rows_(0),
+      cols_(0),
+      x_row_stride_(0),
+      y_col_stride_(0),
+      row_tiles_(0),
+      col_tiles_(0) {
+  elem_cnt_ = 1;
+  FOR_RANGE(int32_t, i, 0, num_axis) { elem_cnt_ *= x_dims[i]; }
+  // drop axes of size 1
+  std::vector<int32_t> squeezed_axis(num_axis, -1);
+  std::vector<int64_t> squeezed_dims;
+  FOR_RANGE(int32_t, i, 0, num_axis) {
+    if (x_dims[i] != 1) {
+      squeezed_axis[i] = squeezed_dims.size();
+      squeezed_dims.push_back(x_dims[i]);
+    }
+  }
+  std::vector<int32_t> squeezed_permutation;
+  FOR_RANGE(int32_t, i, 0, num_axis) {
+    if (x_dims[permutation[i]] != 1) {
+      squeezed_permutation.push_back(squeezed_axis[permutation[i]]);
+    }
+  }
+  // merge runs of x axes that stay in order in y, each run becomes one axis
+  std::vector<int32_t> run_begins;
+  std::vector<int64_t> run_dims;
+  FOR_RANGE(size_t, i, 0, squeezed_permutation.size()) {
+    const int32_t axis = squeezed_permutation[i];
+    if (i > 0 && axis == squeezed_permutation[i - 1] + 1) {
+      run_dims.back() *= squeezed_dims[axis];
+    } else {
+      run_begins.push_back(axis);
+      run_dims.push_back(squeezed_dims[axis]);
+    }
+  }
+  const int64_t num_runs = run_begins.size();
+  // the merged x axes are the runs ordered as they are in x
+  std::vector<int32_t> runs_in_x_order(num_runs);
+  FOR_RANGE(int64_t, i, 0, num_runs) { runs_in_x_order[i] = i; }
+  std::sort(runs_in_x_order.begin(), runs_in_x_order.end(),
+            [&](int32_t lhs, int32_t rhs) { return run_begins[lhs] < run_begins[rhs]; });
+  std::vector<int64_t> dims(num_runs);
+  std::vector<int32_t> merged_permutation(num_runs);
+  FOR_RANGE(int64_t, i, 0, num_runs) {
+    dims[i] = run_dims[runs_in_x_order[i]];
+    merged_permutation[runs_in_x_order[i]] = i;
+  }
+  std::vector<int64_t> x_strides(num_runs);
+  std::vector<int64_t> y_strides(num_runs);
+  int64_t x_stride = 1;
+  int64_t y_stride = 1;
+  for (int64_t i = num_runs - 1; i >= 0; --i) {
+    x_strides[i] = x_stride;
+    x_stride *= dims[i];
+    y_strides[merged_permutation[i]] = y_stride;
+    y_stride *= dims[merged_permutation[i]];
+  }
+
+  if (num_runs <= 1 || elem_cnt_ == 0) {
+    kind_ = kCopy;
+    elem_cnt_per_task_ = kCopyTaskSize;
+    num_tasks_ = RoundUp(elem_cnt_, kCopyTaskSize) / kCopyTaskSize;
+    return;
+  }
+  const int32_t last = num_runs - 1;
+  const int32_t y_last = merged_permutation[last];
+  FOR_RANGE(int32_t, i, 0, num_runs) {
+    if (i == last || (y_last != last && i == y_last)) { continue; }
+    outer_dims_.push_back(dims[i]);
+    outer_x_strides_.push_back(x_strides[i]);
+    outer_y_strides_.push_back(y_strides[i]);
+    num_outer_ *= dims[i];
+  }
+  if (y_last == last) {
+    kind_ = kCopyRows;
+    row_size_ = dims[last];
+    elem_cnt_per_task_ = row_size_;
+    num_tasks_ = num_outer_;
+  } else {
+    kind_ = kTiles;
+    rows_ = dims[y_last];
+    cols_ = dims[last];
+    x_row_stride_ = x_strides[y_last];
+    y_col_stride_ = y_strides[last];
+    row_tiles_ = RoundUp(rows_, kTileSize) / kTileSize;
+    col_tiles_ = RoundUp(cols_, kTileSize) / kTileSize;
+    elem_cnt_per_task_ = std::min(rows_, kTileSize) * std::min(cols_, kTileSize);
+    num_tasks_ = num_outer_ * row_tiles_ * col_tiles_;
+  }
+}
+
+void HostTransposePlan::OuterOffset(int64_t outer_index, int64_t* x_offset,
+                                    int64_t* y_offset) const {
+  *x_offset = 0;
+  *y_offset = 0;
+  for (int64_t i = outer_dims_.size() - 1; i >= 0; --i) {
+    const int64_t index = outer_index % outer_dims_[i];
+    outer_index /= outer_dims_[i];
+    *x_offset += index * outer_x_strides_[i];
+    *y_offset += index * outer_y_strides_[i];
+  }
+}
+
+template<typename T>
+void HostTransposePlan::Run(int64_t task_begin, int64_t task_end, const T* x, T* y) const {
+  if (kind_ == kCopy) {
+    const int64_t begin = task_begin * kCopyTaskSize;
+    const int64_t end = std::min(elem_cnt_, task_end * kCopyTaskSize);
+    if (end > begin) { memcpy(y + begin, x + begin, (end - begin) * sizeof(T)); }
+  } else if (kind_ == kCopyRows) {
+    // the rows are in x order, so x moves on by one row and y follows the index
+    std::vector<int64_t> index(outer_dims_.size());
+    int64_t rest = task_begin;
+    int64_t x_offset = 0;
+    int64_t y_offset = 0;
+    for (int64_t i = outer_dims_.size() - 1; i >= 0; --i) {
+      index[i] = rest % outer_dims_[i];
+      rest /= outer_dims_[i];
+      x_offset += index[i] * outer_x_strides_[i];
+      y_offset += index[i] * outer_y_strides_[i];
+    }
+    FOR_RANGE(int64_t, row, task_begin, task_end) {
+      memcpy(y + y_offset, x + x_offset, row_size_ * sizeof(T));
+      x_offset += row_size_;
+      for (int64_t i = outer_dims_.size() - 1; i >= 0; --i) {
+        ++index[i];
+        y_offset += outer_y_strides_[i];
+        if (index[i] < outer_dims_[i]) { break; }
+        index[i] = 0;
+        y_offset -= outer_y_strides_[i] * outer_dims_[i];
+      }
+    }
+  } else {
+    const int64_t tiles_per_outer = row_tiles_ * col_tiles_;
+    int64_t outer_index = -1;
+    int64_t x_offset = 0;
+    int64_t y_offset = 0;
+    FOR_RANGE(int64_t, task, task_begin, task_end) {
+      if (task / tiles_per_outer != outer_index) {
+        outer_index = task / tiles_per_outer;
+        OuterOffset(outer_index, &x_offset, &y_offset);
+      }
+      const int64_t tile = task % tiles_per_outer;
+      const int64_t row_begin = tile / col_tiles_ * kTileSize;
+      const int64_t col_begin = tile % col_tiles_ * kTileSize;
+      TransposeTile<T>(x + x_offset, x_row_stride_, y + y_offset, y_col_stride_, row_begin,
+                       std::min(rows_, row_begin + kTileSize), col_begin,
+                       std::min(cols_, col_begin + kTileSize));
+    }
+  }
+}
+
+#define INSTANTIATE_HOST_TRANSPOSE_PLAN_RUN(type_cpp, type_proto)                     \
+  template void HostTransposePlan::Run<type_cpp>(int64_t task_begin, int64_t task_end, \
+                                                 const type_cpp* x, type_cpp* y) const;
+OF_PP_FOR_EACH_TUPLE(INSTANTIATE_HOST_TRANSPOSE_PLAN_RUN, ARITHMETIC_DATA_TYPE_SEQ)
+#undef INSTANTIATE_HOST_TRANSPOSE_PLAN_RUN
+
+}  // namespace oneflow
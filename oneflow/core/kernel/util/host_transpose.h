@@ -0,0 +1,72 @@
+/*
+Copyright 2020 The OneFlow Authors. All rights reserved.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+*/
+#ifndef ONEFLOW_CORE_KERNEL_UTIL_HOST_TRANSPOSE_H_
+#define ONEFLOW_CORE_KERNEL_UTIL_HOST_TRANSPOSE_H_
+
+#include "oneflow/core/common/util.h"
+
+namespace oneflow {
+
+// How to move x into y where axis i of y is axis permutation[i] of x. Axes of size 1 are dropped
+// and axes that stay next to each other are merged, then the transpose is one of
+//  - a copy, when nothing moves,
+//  - a copy of rows, when the last axis stays last,
+//  - a 2-D transpose of tiles between the last axis of x and the last axis of y, for each index
+//    of the other axes. Batched matrices and NCHW <-> NHWC end up here.
+// The work is cut into tasks of about the same size, Run handles tasks [task_begin, task_end) so
+// callers may spread them over threads.
+class HostTransposePlan final {
+ public:
+  OF_DISALLOW_COPY_AND_MOVE(HostTransposePlan);
+  HostTransposePlan(int32_t num_axis, const int64_t* x_dims, const int32_t* permutation);
+  ~HostTransposePlan() = default;
+
+  int64_t num_tasks() const { return num_tasks_; }
+  int64_t elem_cnt_per_task() const { return elem_cnt_per_task_; }
+
+  template<typename T>
+  void Run(int64_t task_begin, int64_t task_end, const T* x, T* y) const;
+
+ private:
+  enum Kind { kCopy, kCopyRows, kTiles };
+
+  // offsets of the outer_index-th index of the outer axes
+  void OuterOffset(int64_t outer_index, int64_t* x_offset, int64_t* y_offset) const;
+
+  Kind kind_;
+  int64_t elem_cnt_;
+  int64_t num_tasks_;
+  int64_t elem_cnt_per_task_;
+  // the axes that are walked, with their strides in x and y
+  std::vector<int64_t> outer_dims_;
+  std::vector<int64_t> outer_x_strides_;
+  std::vector<int64_t> outer_y_strides_;
+  int64_t num_outer_;
+  // kCopyRows copies rows of row_size_ elements, kCopy a range of them
+  int64_t row_size_;
+  // kTiles moves rows x rows_ by cols_ tiles, x[row * x_row_stride_ + col] to
+  // y[col * y_col_stride_ + row]
+  int64_t rows_;
+  int64_t cols_;
+  int64_t x_row_stride_;
+  int64_t y_col_stride_;
+  int64_t row_tiles_;
+  int64_t col_tiles_;
+};
+
+}  // namespace oneflow
+
+#endif  // ONEFLOW_CORE_KERNEL_UTIL_HOST_TRANSPOSE_H_
@@ -0,0 +1,133 @@
+/*
+Copyright 2020 The OneFlow Authors. All rights reserved.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+*/
+#include <gtest/gtest.h>
+#include <chrono>
+#include "oneflow/core/kernel/util/host_transpose.h"
+
+namespace oneflow {
+
+namespace {
+
+// an element at a time, as the transpose used to be
+template<typename T>
+void NaiveTranspose(const std::vector<int64_t>& x_dims, const std::vector<int32_t>& permutation,
+                    const T* x, T* y) {
+  const int64_t num_axis = x_dims.size();
+  std::vector<int64_t> x_strides(num_axis);
+  int64_t elem_cnt = 1;
+  for (int64_t i = num_axis - 1; i >= 0; --i) {
+    x_strides[i] = elem_cnt;
+    elem_cnt *= x_dims[i];
+  }
+  std::vector<int64_t> y_index(num_axis, 0);
+  FOR_RANGE(int64_t, y_offset, 0, elem_cnt) {
+    int64_t x_offset = 0;
+    FOR_RANGE(int64_t, i, 0, num_axis) { x_offset += y_index[i] * x_strides[permutation[i]]; }
+    y[y_offset] = x[x_offset];
+    for (int64_t i = num_axis - 1; i >= 0; --i) {
+      if (++y_index[i] < x_dims[permutation[i]]) { break; }
+      y_index[i] = 0;
+    }
+  }
+}
+
+int64_t ElemCnt(const std::vector<int64_t>& dims) {
+  int64_t elem_cnt = 1;
+  for (int64_t dim : dims) { elem_cnt *= dim; }
+  return elem_cnt;
+}
+
+template<typename T>
+void TestTranspose(const std::vector<int64_t>& x_dims, const std::vector<int32_t>& permutation) {
+  const int64_t elem_cnt = ElemCnt(x_dims);
+  std::vector<T> x(elem_cnt);
+  FOR_RANGE(int64_t, i, 0, elem_cnt) { x[i] = static_cast<T>(i % 127); }
+  std::vector<T> expected(elem_cnt);
+  NaiveTranspose<T>(x_dims, permutation, x.data(), expected.data());
+  std::vector<T> y(elem_cnt, -1);
+  const HostTransposePlan plan(x_dims.size(), x_dims.data(), permutation.data());
+  // in three parts, as from several threads
+  const int64_t num_tasks = plan.num_tasks();
+  plan.Run<T>(0, num_tasks / 3, x.data(), y.data());
+  plan.Run<T>(num_tasks / 3, num_tasks / 2, x.data(), y.data());
+  plan.Run<T>(num_tasks / 2, num_tasks, x.data(), y.data());
+  ASSERT_EQ(expected, y);
+}
+
+template<typename T>
+void TestAllPermutations(const std::vector<int64_t>& x_dims) {
+  std::vector<int32_t> permutation(x_dims.size());
+  FOR_RANGE(size_t, i, 0, permutation.size()) { permutation[i] = i; }
+  do {
+    TestTranspose<T>(x_dims, permutation);
+  } while (std::next_permutation(permutation.begin(), permutation.end()));
+}
+
+}  // namespace
+
+TEST(HostTransposePlan, all_permutations) {
+  // sizes with and without a remainder after the micro kernels and the tiles, and axes of 1
+  for (const std::vector<int64_t>& x_dims :
+       std::vector<std::vector<int64_t>>{{5}, {64, 64}, {37, 45}, {2, 3, 4, 5}, {3, 1, 33, 17},
+                                         {1, 1}, {2, 0, 3}, {4, 9, 1, 8, 3}}) {
+    TestAllPermutations<float>(x_dims);
+    TestAllPermutations<double>(x_dims);
+    TestAllPermutations<int8_t>(x_dims);
+    TestAllPermutations<int32_t>(x_dims);
+    TestAllPermutations<int64_t>(x_dims);
+  }
+}
+
+// compares with the element at a time transpose on one thread over common permutations, run
+// with --gtest_also_run_disabled_tests
+TEST(HostTransposePlan, DISABLED_benchmark) {
+  const std::vector<std::pair<std::vector<int64_t>, std::vector<int32_t>>> cases{
+      {{4096, 4096}, {1, 0}},                    // matrix
+      {{64, 512, 512}, {0, 2, 1}},               // batched matrices
+      {{32, 64, 112, 112}, {0, 2, 3, 1}},        // NCHW to NHWC
+      {{32, 112, 112, 64}, {0, 3, 1, 2}},        // NHWC to NCHW
+      {{32, 3, 224, 224}, {0, 2, 3, 1}},         // an image batch to NHWC
+      {{64, 128, 16, 64}, {0, 2, 1, 3}},         // attention heads
+      {{16, 32, 16, 32, 16}, {4, 2, 0, 3, 1}}};  // no pattern
+  for (const auto& pair : cases) {
+    const std::vector<int64_t>& x_dims = pair.first;
+    const std::vector<int32_t>& permutation = pair.second;
+    const int64_t elem_cnt = ElemCnt(x_dims);
+    std::vector<float> x(elem_cnt, 1);
+    std::vector<float> y(elem_cnt);
+    const auto Time = [](const std::function<void()>& Run) {
+      Run();
+      const auto start = std::chrono::steady_clock::now();
+      const int iters = 5;
+      FOR_RANGE(int, i, 0, iters) { Run(); }
+      return std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start)
+                 .count()
+             / iters;
+    };
+    const double naive_ms =
+        Time([&]() { NaiveTranspose<float>(x_dims, permutation, x.data(), y.data()); });
+    const HostTransposePlan plan(x_dims.size(), x_dims.data(), permutation.data());
+    const double plan_ms =
+        Time([&]() { plan.Run<float>(0, plan.num_tasks(), x.data(), y.data()); });
+    const double gb = 2.0 * elem_cnt * sizeof(float) / (1024 * 1024 * 1024);
+    std::string permutation_str;
+    for (int32_t axis : permutation) { permutation_str += std::to_string(axis); }
+    LOG(INFO) << "permutation " << permutation_str << " of " << elem_cnt << " floats: naive "
+              << naive_ms << "ms, tiled " << plan_ms << "ms (" << gb / (plan_ms / 1000) << " GB/s)";
+  }
+}
+
+}  // namespace oneflow
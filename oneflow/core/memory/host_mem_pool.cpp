@@ -0,0 +1,267 @@
+/*
+Copyright 2020 The OneFlow Authors. All rights reserved.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+*/
+#include "oneflow/core/memory/host_mem_pool.h"
+#include "oneflow/core/memory/memory_allocator.h"
+
+namespace oneflow {
+
+namespace {
+
+constexpr int kMinBlockSizeShift = 10;
+constexpr int kMaxBlockSizeShift = 26;
+constexpr int kNumSizeClassesPerShift = 4;
+constexpr int kNumSizeClasses =
+    (kMaxBlockSizeShift - kMinBlockSizeShift) * kNumSizeClassesPerShift + 1;
+// larger blocks skip the thread cache and go to the central cache directly
+constexpr size_t kMaxThreadCachedBlockSize = 256 * 1024;
+constexpr size_t kThreadCacheBytesPerClass = 512 * 1024;
+constexpr int64_t kMaxThreadCacheBlocksPerClass = 64;
+constexpr size_t kDefaultMaxCachedBytes = 64 * 1024 * 1024;
+
+enum ThreadCacheState { kThreadCacheNotCreated = 0, kThreadCacheAlive, kThreadCacheDestroyed };
+
+int64_t IncreaseOwnedCounter(std::atomic<int64_t>* counter, int64_t delta) {
+  // only the owner thread writes, so load + store is enough
+  const int64_t val = counter->load(std::memory_order_relaxed) + delta;
+  counter->store(val, std::memory_order_relaxed);
+  return val;
+}
+
+}  // namespace
+
+constexpr size_t HostMemPool::kMinBlockSize;
+constexpr size_t HostMemPool::kMaxPooledBlockSize;
+static_assert(HostMemPool::kMinBlockSize == (1 << kMinBlockSizeShift), "");
+static_assert(HostMemPool::kMaxPooledBlockSize == (1 << kMaxBlockSizeShift), "");
+
+struct HostMemPool::ThreadCache final {
+  explicit ThreadCache(HostMemPool* pool)
+      : pool(pool), free_lists(kNumSizeClasses), allocate_cnt(0), hit_cnt(0) {
+    pool->RegisterThreadCache(this);
+  }
+  ~ThreadCache() {
+    FOR_RANGE(int, size_class, 0, kNumSizeClasses) {
+      std::vector<void*>* free_list = &free_lists.at(size_class);
+      pool->ReleaseToCentral(size_class, free_list, free_list->size());
+    }
+    pool->UnregisterThreadCache(this);
+  }
+
+  HostMemPool* pool;
+  std::vector<std::vector<void*>> free_lists;
+  // written by the owner thread only, read by GetStats
+  std::atomic<int64_t> allocate_cnt;
+  std::atomic<int64_t> hit_cnt;
+};
+
+HostMemPool* HostMemPool::Get() {
+  // never deleted, blocks may be freed by static or thread_local destructors
+  static HostMemPool* pool = new HostMemPool();
+  return pool;
+}
+
+HostMemPool::HostMemPool()
+    : max_cached_bytes_(kDefaultMaxCachedBytes),
+      central_free_lists_(kNumSizeClasses),
+      cached_bytes_(0),
+      system_bytes_(0),
+      system_bytes_high_water_mark_(0),
+      retired_allocate_cnt_(0),
+      retired_hit_cnt_(0) {}
+
+int HostMemPool::SizeClass(size_t num_bytes) {
+  if (num_bytes <= kMinBlockSize) { return 0; }
+  // 2^shift <= num_bytes - 1 < 2^(shift + 1)
+  const int shift = 63 - __builtin_clzll(num_bytes - 1);
+  const int sub_class = ((num_bytes - 1) >> (shift - 2)) & (kNumSizeClassesPerShift - 1);
+  return (shift - kMinBlockSizeShift) * kNumSizeClassesPerShift + sub_class + 1;
+}
+
+size_t HostMemPool::ClassBlockSize(int size_class) {
+  if (size_class == 0) { return kMinBlockSize; }
+  const int shift = kMinBlockSizeShift + (size_class - 1) / kNumSizeClassesPerShift;
+  const int sub_class = (size_class - 1) % kNumSizeClassesPerShift;
+  const size_t base = static_cast<size_t>(1) << shift;
+  return base + (sub_class + 1) * (base >> 2);
+}
+
+int64_t HostMemPool::ThreadCacheCapacity(int size_class) {
+  const size_t block_size = ClassBlockSize(size_class);
+  if (block_size > kMaxThreadCachedBlockSize) { return 0; }
+  return std::min<int64_t>(std::max<int64_t>(kThreadCacheBytesPerClass / block_size, 2),
+                           kMaxThreadCacheBlocksPerClass);
+}
+
+HostMemPool::ThreadCache* HostMemPool::GetThreadCache() {
+  // both are trivially destructible, so they stay valid while other thread_local objects holding
+  // blocks are destroyed
+  static thread_local ThreadCache* cache = nullptr;
+  static thread_local int state = kThreadCacheNotCreated;
+  if (state == kThreadCacheAlive) { return cache; }
+  // a thread that is exiting uses the central cache only
+  if (state == kThreadCacheDestroyed) { return nullptr; }
+  struct ThreadCacheDeleter final {
+    ~ThreadCacheDeleter() {
+      state = kThreadCacheDestroyed;
+      delete cache;
+      cache = nullptr;
+    }
+  };
+  static thread_local ThreadCacheDeleter deleter;
+  cache = new ThreadCache(Get());
+  state = kThreadCacheAlive;
+  return cache;
+}
+
+void* HostMemPool::Allocate(size_t num_bytes, size_t* block_size) {
+  if (num_bytes > kMaxPooledBlockSize) {
+    *block_size = num_bytes;
+    return AllocateFromSystem(num_bytes);
+  }
+  // sizes are rounded up even when caching is disabled, the cap may be raised later
+  const int size_class = SizeClass(num_bytes);
+  *block_size = ClassBlockSize(size_class);
+  ThreadCache* cache = GetThreadCache();
+  const int64_t capacity = ThreadCacheCapacity(size_class);
+  if (cache == nullptr || capacity == 0) {
+    std::vector<void*> blocks;
+    if (cache != nullptr) { IncreaseOwnedCounter(&cache->allocate_cnt, 1); }
+    if (FetchFromCentral(size_class, 1, &blocks) > 0) {
+      if (cache != nullptr) { IncreaseOwnedCounter(&cache->hit_cnt, 1); }
+      cached_bytes_.fetch_sub(*block_size);
+      return blocks.back();
+    }
+    return AllocateFromSystem(*block_size);
+  }
+  IncreaseOwnedCounter(&cache->allocate_cnt, 1);
+  std::vector<void*>* free_list = &cache->free_lists.at(size_class);
+  if (free_list->empty()) { FetchFromCentral(size_class, capacity / 2, free_list); }
+  if (free_list->empty()) { return AllocateFromSystem(*block_size); }
+  void* ptr = free_list->back();
+  free_list->pop_back();
+  cached_bytes_.fetch_sub(*block_size);
+  IncreaseOwnedCounter(&cache->hit_cnt, 1);
+  return ptr;
+}
+
+void HostMemPool::Deallocate(void* ptr, size_t block_size) {
+  if (ptr == nullptr) { return; }
+  if (block_size > kMaxPooledBlockSize || !TryCacheBytes(block_size)) {
+    DeallocateToSystem(ptr, block_size);
+    return;
+  }
+  const int size_class = SizeClass(block_size);
+  CHECK_EQ(ClassBlockSize(size_class), block_size);
+  ThreadCache* cache = GetThreadCache();
+  const int64_t capacity = ThreadCacheCapacity(size_class);
+  if (cache == nullptr || capacity == 0) {
+    std::vector<void*> blocks{ptr};
+    ReleaseToCentral(size_class, &blocks, 1);
+    return;
+  }
+  std::vector<void*>* free_list = &cache->free_lists.at(size_class);
+  free_list->push_back(ptr);
+  if (free_list->size() > capacity) {
+    ReleaseToCentral(size_class, free_list, free_list->size() - capacity / 2);
+  }
+}
+
+void* HostMemPool::AllocateFromSystem(size_t block_size) {
+  void* ptr = MemoryAllocatorImpl::AllocateUnPinnedHostMem(block_size);
+  const int64_t system_bytes = system_bytes_.fetch_add(block_size) + block_size;
+  int64_t high_water_mark = system_bytes_high_water_mark_.load();
+  while (system_bytes > high_water_mark
+         && !system_bytes_high_water_mark_.compare_exchange_weak(high_water_mark, system_bytes)) {}
+  return ptr;
+}
+
+void HostMemPool::DeallocateToSystem(void* ptr, size_t block_size) {
+  MemoryAllocatorImpl::DeallocateUnPinnedHostMem(ptr);
+  system_bytes_.fetch_sub(block_size);
+}
+
+bool HostMemPool::TryCacheBytes(int64_t block_size) {
+  const int64_t max_cached = max_cached_bytes();
+  if (cached_bytes_.fetch_add(block_size) + block_size <= max_cached) { return true; }
+  cached_bytes_.fetch_sub(block_size);
+  return false;
+}
+
+int64_t HostMemPool::FetchFromCentral(int size_class, int64_t n, std::vector<void*>* blocks) {
+  CentralFreeList* central = &central_free_lists_.at(size_class);
+  std::unique_lock<std::mutex> lock(central->mutex);
+  const int64_t fetched = std::min<int64_t>(n, central->blocks.size());
+  blocks->insert(blocks->end(), central->blocks.end() - fetched, central->blocks.end());
+  central->blocks.resize(central->blocks.size() - fetched);
+  return fetched;
+}
+
+void HostMemPool::ReleaseToCentral(int size_class, std::vector<void*>* blocks, int64_t n) {
+  CHECK_LE(n, blocks->size());
+  {
+    CentralFreeList* central = &central_free_lists_.at(size_class);
+    std::unique_lock<std::mutex> lock(central->mutex);
+    central->blocks.insert(central->blocks.end(), blocks->end() - n, blocks->end());
+  }
+  blocks->resize(blocks->size() - n);
+}
+
+void HostMemPool::set_max_cached_bytes(size_t max_cached_bytes) {
+  max_cached_bytes_.store(max_cached_bytes);
+  FOR_RANGE(int, size_class, 0, kNumSizeClasses) {
+    const int64_t block_size = ClassBlockSize(size_class);
+    std::vector<void*> trimmed;
+    {
+      CentralFreeList* central = &central_free_lists_.at(size_class);
+      std::unique_lock<std::mutex> lock(central->mutex);
+      while (!central->blocks.empty() && cached_bytes_.load() > max_cached_bytes) {
+        trimmed.push_back(central->blocks.back());
+        central->blocks.pop_back();
+        cached_bytes_.fetch_sub(block_size);
+      }
+    }
+    for (void* ptr : trimmed) { DeallocateToSystem(ptr, block_size); }
+  }
+}
+
+void HostMemPool::RegisterThreadCache(ThreadCache* cache) {
+  std::unique_lock<std::mutex> lock(thread_caches_mutex_);
+  CHECK(thread_caches_.emplace(cache).second);
+}
+
+void HostMemPool::UnregisterThreadCache(ThreadCache* cache) {
+  std::unique_lock<std::mutex> lock(thread_caches_mutex_);
+  CHECK_EQ(thread_caches_.erase(cache), 1);
+  retired_allocate_cnt_ += cache->allocate_cnt.load();
+  retired_hit_cnt_ += cache->hit_cnt.load();
+}
+
+HostMemPoolStats HostMemPool::GetStats() const {
+  HostMemPoolStats stats;
+  std::unique_lock<std::mutex> lock(thread_caches_mutex_);
+  stats.allocate_cnt = retired_allocate_cnt_.load();
+  stats.hit_cnt = retired_hit_cnt_.load();
+  stats.cached_bytes = cached_bytes_.load();
+  for (const ThreadCache* cache : thread_caches_) {
+    stats.allocate_cnt += cache->allocate_cnt.load(std::memory_order_relaxed);
+    stats.hit_cnt += cache->hit_cnt.load(std::memory_order_relaxed);
+  }
+  stats.system_bytes = system_bytes_.load();
+  stats.system_bytes_high_water_mark = system_bytes_high_water_mark_.load();
+  return stats;
+}
+
+}  // namespace oneflow
@@ -0,0 +1,103 @@
+/*
+Copyright 2020 The OneFlow Authors. All rights reserved.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+*/
+#ifndef ONEFLOW_CORE_MEMORY_HOST_MEM_POOL_H_
+#define ONEFLOW_CORE_MEMORY_HOST_MEM_POOL_H_
+
+#include "oneflow/core/common/util.h"
+
+namespace oneflow {
+
+struct HostMemPoolStats {
+  int64_t allocate_cnt;
+  // allocations served by a cached block instead of the system allocator
+  int64_t hit_cnt;
+  int64_t cached_bytes;
+  // bytes held from the system allocator, in use or cached
+  int64_t system_bytes;
+  int64_t system_bytes_high_water_mark;
+};
+
+// Size-classed pool of unpinned host memory, used for TensorBuffer payloads.
+//
+// Requested sizes are rounded up to one of four classes per power of two. Every thread keeps a
+// small cache of free blocks per class and exchanges them in batches with a central cache, so
+// the common allocate/free pair touches no lock. Blocks are often freed on another thread than
+// the one that allocated them (decoder vs consumer), which the central cache absorbs. The central
+// cache and the thread caches together hold at most max_cached_bytes, a block freed beyond it is
+// returned to the system. Blocks larger than kMaxPooledBlockSize are not pooled.
+class HostMemPool final {
+ public:
+  OF_DISALLOW_COPY_AND_MOVE(HostMemPool);
+  ~HostMemPool() = delete;
+
+  static HostMemPool* Get();
+
+  // Returns a block of at least num_bytes, *block_size is set to its actual size.
+  void* Allocate(size_t num_bytes, size_t* block_size);
+  // block_size must be the one Allocate returned
+  void Deallocate(void* ptr, size_t block_size);
+
+  // 0 disables caching. The blocks of the central cache beyond a lower cap are returned to the
+  // system at once, the ones of the thread caches as they are freed again.
+  void set_max_cached_bytes(size_t max_cached_bytes);
+  size_t max_cached_bytes() const { return max_cached_bytes_.load(std::memory_order_relaxed); }
+  HostMemPoolStats GetStats() const;
+
+  static constexpr size_t kMinBlockSize = 1024;
+  static constexpr size_t kMaxPooledBlockSize = 64 * 1024 * 1024;
+
+ private:
+  struct ThreadCache;
+  struct CentralFreeList {
+    std::mutex mutex;
+    std::vector<void*> blocks;
+  };
+  friend struct ThreadCache;
+
+  HostMemPool();
+  static int SizeClass(size_t num_bytes);
+  static size_t ClassBlockSize(int size_class);
+  static int64_t ThreadCacheCapacity(int size_class);
+  static ThreadCache* GetThreadCache();
+
+  void* AllocateFromSystem(size_t block_size);
+  void DeallocateToSystem(void* ptr, size_t block_size);
+  // counts a freed block in cached_bytes_, unless that would exceed max_cached_bytes
+  bool TryCacheBytes(int64_t block_size);
+  // Move cached blocks between the central cache and a thread cache, and so leave cached_bytes_
+  // as it is. FetchFromCentral moves up to n blocks and returns the number moved,
+  // ReleaseToCentral the last n of blocks.
+  int64_t FetchFromCentral(int size_class, int64_t n, std::vector<void*>* blocks);
+  void ReleaseToCentral(int size_class, std::vector<void*>* blocks, int64_t n);
+  void RegisterThreadCache(ThreadCache* cache);
+  void UnregisterThreadCache(ThreadCache* cache);
+
+  std::atomic<size_t> max_cached_bytes_;
+  std::vector<CentralFreeList> central_free_lists_;
+  // the bytes of the blocks in the central cache and in the thread caches
+  std::atomic<int64_t> cached_bytes_;
+  std::atomic<int64_t> system_bytes_;
+  std::atomic<int64_t> system_bytes_high_water_mark_;
+  // stats of exited threads
+  std::atomic<int64_t> retired_allocate_cnt_;
+  std::atomic<int64_t> retired_hit_cnt_;
+  mutable std::mutex thread_caches_mutex_;
+  HashSet<ThreadCache*> thread_caches_;
+};
+
+}  // namespace oneflow
+
+#endif  // ONEFLOW_CORE_MEMORY_HOST_MEM_POOL_H_
@@ -0,0 +1,123 @@
+/*
+Copyright 2020 The OneFlow Authors. All rights reserved.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+*/
+#include "oneflow/core/memory/host_mem_pool.h"
+#include <gtest/gtest.h>
+
+namespace oneflow {
+
+namespace test {
+
+TEST(HostMemPool, block_size) {
+  HostMemPool* pool = HostMemPool::Get();
+  for (size_t num_bytes : {1, 1024, 1025, 2048, 2049, 5000, 150528, 64 * 1024 * 1024}) {
+    size_t block_size = 0;
+    void* ptr = pool->Allocate(num_bytes, &block_size);
+    ASSERT_GE(block_size, num_bytes);
+    ASSERT_LE(block_size, std::max<size_t>(num_bytes * 5 / 4, HostMemPool::kMinBlockSize));
+    memset(ptr, 0, block_size);
+    pool->Deallocate(ptr, block_size);
+  }
+  size_t block_size = 0;
+  void* ptr = pool->Allocate(HostMemPool::kMaxPooledBlockSize + 1, &block_size);
+  ASSERT_EQ(block_size, HostMemPool::kMaxPooledBlockSize + 1);
+  pool->Deallocate(ptr, block_size);
+}
+
+TEST(HostMemPool, reuse) {
+  HostMemPool* pool = HostMemPool::Get();
+  size_t block_size = 0;
+  void* ptr = pool->Allocate(3000, &block_size);
+  pool->Deallocate(ptr, block_size);
+  const HostMemPoolStats before = pool->GetStats();
+  ptr = pool->Allocate(2900, &block_size);
+  const HostMemPoolStats after = pool->GetStats();
+  ASSERT_EQ(after.allocate_cnt - before.allocate_cnt, 1);
+  ASSERT_EQ(after.hit_cnt - before.hit_cnt, 1);
+  pool->Deallocate(ptr, block_size);
+}
+
+TEST(HostMemPool, free_on_other_thread) {
+  HostMemPool* pool = HostMemPool::Get();
+  const int64_t num = 10000;
+  const size_t num_bytes = 100 * 1024;
+  std::vector<std::pair<void*, size_t>> blocks(num);
+  // empties the central cache, which earlier tests may have filled up to the cap
+  const size_t max_cached_bytes = pool->max_cached_bytes();
+  pool->set_max_cached_bytes(0);
+  pool->set_max_cached_bytes(max_cached_bytes);
+  const HostMemPoolStats before = pool->GetStats();
+  std::thread producer([&]() {
+    FOR_RANGE(int64_t, i, 0, num) {
+      blocks.at(i).first = pool->Allocate(num_bytes, &blocks.at(i).second);
+      if (i >= 64) {
+        // keep a window of live blocks, freed by the consumer thread below
+        std::thread([&]() { pool->Deallocate(blocks.at(i - 64).first, blocks.at(i - 64).second); })
+            .join();
+      }
+    }
+  });
+  producer.join();
+  FOR_RANGE(int64_t, i, num - 64, num) {
+    pool->Deallocate(blocks.at(i).first, blocks.at(i).second);
+  }
+  const HostMemPoolStats after = pool->GetStats();
+  ASSERT_EQ(after.allocate_cnt - before.allocate_cnt, num);
+  // all but the first window is served by blocks freed on the other threads
+  ASSERT_GE(after.hit_cnt - before.hit_cnt, num - 2 * 64);
+  ASSERT_LE(after.system_bytes - before.system_bytes, 2 * 64 * 2 * num_bytes);
+}
+
+TEST(HostMemPool, max_cached_bytes) {
+  HostMemPool* pool = HostMemPool::Get();
+  const size_t max_cached_bytes = pool->max_cached_bytes();
+  const size_t num_bytes = 4 * 1024 * 1024;
+  std::vector<std::pair<void*, size_t>> blocks(16);
+  for (auto& pair : blocks) { pair.first = pool->Allocate(num_bytes, &pair.second); }
+  // empties the central cache, and leaves room for two blocks beside the thread caches
+  pool->set_max_cached_bytes(0);
+  const HostMemPoolStats before = pool->GetStats();
+  pool->set_max_cached_bytes(before.cached_bytes + 8 * 1024 * 1024);
+  for (auto& pair : blocks) { pool->Deallocate(pair.first, pair.second); }
+  const HostMemPoolStats after = pool->GetStats();
+  ASSERT_EQ(after.cached_bytes - before.cached_bytes, 2 * num_bytes);
+  ASSERT_EQ(before.system_bytes - after.system_bytes, 14 * num_bytes);
+  pool->set_max_cached_bytes(0);
+  ASSERT_EQ(pool->GetStats().cached_bytes, before.cached_bytes);
+  pool->set_max_cached_bytes(max_cached_bytes);
+}
+
+TEST(HostMemPool, thread_caches_count_toward_max_cached_bytes) {
+  HostMemPool* pool = HostMemPool::Get();
+  const size_t max_cached_bytes = pool->max_cached_bytes();
+  // empties the central cache, what is left are the thread caches of this thread
+  pool->set_max_cached_bytes(0);
+  const HostMemPoolStats before = pool->GetStats();
+  pool->set_max_cached_bytes(before.cached_bytes + 8 * 1024);
+  std::thread([&]() {
+    // the thread cache of the class would take all of them without the cap
+    std::vector<std::pair<void*, size_t>> blocks(32);
+    for (auto& pair : blocks) { pair.first = pool->Allocate(1024, &pair.second); }
+    for (auto& pair : blocks) { pool->Deallocate(pair.first, pair.second); }
+    const HostMemPoolStats after = pool->GetStats();
+    ASSERT_EQ(after.cached_bytes - before.cached_bytes, 8 * 1024);
+    ASSERT_EQ(after.system_bytes - before.system_bytes, 8 * 1024);
+  }).join();
+  pool->set_max_cached_bytes(max_cached_bytes);
+}
+
+}  // namespace test
+
+}  // namespace oneflow
@@ -0,0 +1,136 @@
+/*
+Copyright 2020 The OneFlow Authors. All rights reserved.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+*/
+#include "oneflow/core/common/cpu_test_util.h"
+#include "oneflow/core/ndarray/ndarray_reduce.h"
+#include "oneflow/core/thread/thread_pool.h"
+#include "oneflow/core/job/resource_desc.h"
+#include "oneflow/core/job/global_for.h"
+
+namespace oneflow {
+
+namespace test {
+
+namespace {
+
+class CpuNdarrayReduceTest : public ::testing::Test {
+ protected:
+  void SetUp() override {
+    Global<ResourceDesc, ForSession>::New(Resource());
+    Global<ThreadPool>::New(4);
+  }
+  void TearDown() override {
+    Global<ThreadPool>::Delete();
+    Global<ResourceDesc, ForSession>::Delete();
+  }
+};
+
+template<typename T, template<typename> class binary_func>
+void CheckReduce(const DimVector& x_dim_vec, const DimVector& y_dim_vec) {
+  const Shape x_shape(x_dim_vec);
+  const Shape y_shape(y_dim_vec);
+  const std::vector<T> x = RandomIntData<T>(x_shape.elem_cnt(), -8, 8);
+  std::vector<T> tmp(x.size());
+  std::vector<T> y(y_shape.elem_cnt());
+  std::vector<T> expected(y_shape.elem_cnt());
+  NdarrayReduce<DeviceType::kCPU, T, binary_func>::Reduce(
+      nullptr, XpuVarNdarray<T>(y_shape, y.data()), XpuVarNdarray<const T>(x_shape, x.data()),
+      XpuVarNdarray<T>(x_shape, tmp.data()));
+  NdarrayDefaultReduce<DeviceType::kCPU, T, binary_func>::Reduce(
+      nullptr, XpuVarNdarray<T>(y_shape, expected.data()),
+      XpuVarNdarray<const T>(x_shape, x.data()), XpuVarNdarray<T>(x_shape, tmp.data()));
+  FOR_RANGE(size_t, i, 0, y.size()) { ASSERT_EQ(y.at(i), expected.at(i)); }
+}
+
+// an empty x reduces to the unit of binary_func
+template<typename T, template<typename> class binary_func>
+void CheckEmptyReduce(const DimVector& x_dim_vec, const DimVector& y_dim_vec) {
+  const Shape x_shape(x_dim_vec);
+  const Shape y_shape(y_dim_vec);
+  ASSERT_EQ(x_shape.elem_cnt(), 0);
+  std::vector<T> y(y_shape.elem_cnt(), static_cast<T>(3));
+  NdarrayReduce<DeviceType::kCPU, T, binary_func>::Reduce(
+      nullptr, XpuVarNdarray<T>(y_shape, y.data()), XpuVarNdarray<const T>(x_shape, nullptr),
+      XpuVarNdarray<T>(x_shape, nullptr));
+  for (const T val : y) { ASSERT_EQ(val, (UnitOfBinaryFunc<T, binary_func>::Val())); }
+}
+
+template<template<typename> class binary_func>
+void CheckAllShapes() {
+  // scalar
+  CheckReduce<float, binary_func>({1000003}, {1});
+  // matrix row
+  CheckReduce<float, binary_func>({517, 1033}, {517, 1});
+  // matrix col, both few columns and many columns
+  CheckReduce<double, binary_func>({40000, 7}, {1, 7});
+  CheckReduce<float, binary_func>({129, 2063}, {1, 2063});
+  // xyz cube y
+  CheckReduce<int32_t, binary_func>({7, 301, 1029}, {7, 1, 1029});
+  // xyz cube xz
+  CheckReduce<double, binary_func>({31, 5, 3001}, {1, 5, 1});
+  // empty x, for the scalar, matrix row, matrix col, xyz cube y and xyz cube xz reduces
+  CheckEmptyReduce<float, binary_func>({0}, {1});
+  CheckEmptyReduce<float, binary_func>({5, 0}, {5, 1});
+  CheckEmptyReduce<float, binary_func>({0, 5}, {1, 5});
+  CheckEmptyReduce<float, binary_func>({3, 0, 4}, {3, 1, 4});
+  CheckEmptyReduce<float, binary_func>({0, 3, 4}, {1, 3, 1});
+}
+
+}  // namespace
+
+// values are whole numbers so float sums are exact in any order
+TEST_F(CpuNdarrayReduceTest, sum) { CheckAllShapes<BinaryFuncSum>(); }
+
+TEST_F(CpuNdarrayReduceTest, max) { CheckAllShapes<BinaryFuncMax>(); }
+
+TEST_F(CpuNdarrayReduceTest, min) { CheckAllShapes<BinaryFuncMin>(); }
+
+TEST_F(CpuNdarrayReduceTest, any) { CheckAllShapes<BinaryFuncAny>(); }
+
+TEST_F(CpuNdarrayReduceTest, prod) { CheckReduce<int64_t, BinaryFuncProd>({3, 17, 5}, {1, 17, 1}); }
+
+// fast paths vs the generic per-axis reduce, run with --gtest_also_run_disabled_tests
+TEST_F(CpuNdarrayReduceTest, DISABLED_benchmark) {
+  const std::vector<std::pair<DimVector, DimVector>> cases = {
+      {{1 << 24}, {1}},
+      {{4096, 4096}, {4096, 1}},
+      {{4096, 4096}, {1, 4096}},
+      {{64, 256, 1024}, {64, 1, 1024}},
+      {{64, 256, 1024}, {1, 256, 1}}};
+  for (const auto& pair : cases) {
+    const Shape x_shape(pair.first);
+    const Shape y_shape(pair.second);
+    const std::vector<float> x = RandomIntData<float>(x_shape.elem_cnt(), -8, 8);
+    std::vector<float> tmp(x.size());
+    std::vector<float> y(y_shape.elem_cnt());
+    XpuVarNdarray<float> y_var(y_shape, y.data());
+    XpuVarNdarray<const float> x_var(x_shape, x.data());
+    XpuVarNdarray<float> tmp_var(x_shape, tmp.data());
+    const double fast_ms = BenchmarkMs([&]() {
+      NdarrayReduce<DeviceType::kCPU, float, BinaryFuncSum>::Reduce(nullptr, y_var, x_var,
+                                                                    tmp_var);
+    });
+    const double generic_ms = BenchmarkMs([&]() {
+      NdarrayDefaultReduce<DeviceType::kCPU, float, BinaryFuncSum>::Reduce(nullptr, y_var, x_var,
+                                                                           tmp_var);
+    });
+    std::cout << x_shape.ToString() << " -> " << y_shape.ToString() << ": fast " << fast_ms
+              << " ms, generic " << generic_ms << " ms" << std::endl;
+  }
+}
+
+}  // namespace test
+
+}  // namespace oneflow
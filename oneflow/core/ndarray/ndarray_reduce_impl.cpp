@@ -17,26 +17,296 @@ limitations under the License.
 #include "oneflow/core/common/preprocessor.h"
 #include "oneflow/core/ndarray/ndarray_reduce_impl.h"
 #include "oneflow/core/ndarray/binary_func.h"
+#include "oneflow/core/common/balanced_splitter.h"
+#include "oneflow/core/common/cpu_simd.h"
+#include "oneflow/core/thread/thread_manager.h"
 
 namespace oneflow {
 
-#define SPECIALIZE_CPU_NDARRAY_REDUCE_IMPL(struct_name)                                            \
-  template<typename T, template<typename> class binary_func>                                       \
-  struct struct_name<DeviceType::kCPU, T, binary_func> final {                                     \
-    static bool Matched(const XpuVarNdarray<T>& y, const XpuVarNdarray<const T>& x) {              \
-      return false;                                                                                \
-    }                                                                                              \
-    static void Reduce(DeviceCtx* ctx, const XpuVarNdarray<T>& y, const XpuVarNdarray<const T>& x, \
-                       const XpuVarNdarray<T>& tmp_storage) {                                      \
-      UNIMPLEMENTED();                                                                             \
-    }                                                                                              \
-  }
-SPECIALIZE_CPU_NDARRAY_REDUCE_IMPL(NdarrayScalarReduce);
-SPECIALIZE_CPU_NDARRAY_REDUCE_IMPL(NdarrayMatrixRowReduce);
-SPECIALIZE_CPU_NDARRAY_REDUCE_IMPL(NdarrayMatrixColReduce);
-SPECIALIZE_CPU_NDARRAY_REDUCE_IMPL(NdarrayXYZCubeYReduce);
-SPECIALIZE_CPU_NDARRAY_REDUCE_IMPL(NdarrayXYZCubeXZReduce);
-#undef SPECIALIZE_CPU_NDARRAY_REDUCE_IMPL
+namespace {
+
+// elements one thread reduces at least
+constexpr int64_t kReduceGrainSize = 32768;
+// the number of partial results is bounded and depends only on the shape, so results do not
+// change with the number of threads
+constexpr int64_t kReduceMaxPartNum = 256;
+// columns accumulated together, small enough to keep the accumulators in L1
+constexpr int64_t kReduceColBlockSize = 1024;
+
+int64_t ReducePartNum(int64_t elem_num, int64_t max_part_num) {
+  const int64_t part_num = (elem_num + kReduceGrainSize - 1) / kReduceGrainSize;
+  return std::max<int64_t>(std::min(std::min(part_num, kReduceMaxPartNum), max_part_num), 1);
+}
+
+template<template<typename> class binary_func>
+struct SimdReduceOp final {
+  static const bool value = false;
+};
+
+#define SPECIALIZE_SIMD_REDUCE_OP(binary_func, vec_func, vec_reduce_func)                   \
+  template<>                                                                                \
+  struct SimdReduceOp<binary_func> final {                                                  \
+    static const bool value = true;                                                         \
+    template<typename V>                                                                    \
+    static typename V::Reg Apply(const typename V::Reg& a, const typename V::Reg& b) {      \
+      return V::vec_func(a, b);                                                             \
+    }                                                                                       \
+    template<typename V>                                                                    \
+    static auto Reduce(const typename V::Reg& a) -> decltype(V::vec_reduce_func(a)) {       \
+      return V::vec_reduce_func(a);                                                         \
+    }                                                                                       \
+  };
+SPECIALIZE_SIMD_REDUCE_OP(BinaryFuncSum, Add, ReduceAdd);
+SPECIALIZE_SIMD_REDUCE_OP(BinaryFuncProd, Mul, ReduceMul);
+SPECIALIZE_SIMD_REDUCE_OP(BinaryFuncMax, Max, ReduceMax);
+SPECIALIZE_SIMD_REDUCE_OP(BinaryFuncMin, Min, ReduceMin);
+#undef SPECIALIZE_SIMD_REDUCE_OP
+
+template<typename T, template<typename> class binary_func, typename Enable = void>
+struct CpuReduceUtil final {
+  static T ReduceRow(const T* x, int64_t n) {
+    T reduced = UnitOfBinaryFunc<T, binary_func>::Val();
+    FOR_RANGE(int64_t, i, 0, n) { reduced = binary_func<T>::Invoke(reduced, x[i]); }
+    return reduced;
+  }
+  // y[i] = binary_func(y[i], x[i])
+  static void AccumulateRow(T* y, const T* x, int64_t n) {
+    FOR_RANGE(int64_t, i, 0, n) { y[i] = binary_func<T>::Invoke(y[i], x[i]); }
+  }
+};
+
+template<typename T, template<typename> class binary_func>
+struct CpuReduceUtil<T, binary_func,
+                     typename std::enable_if<std::is_arithmetic<T>::value
+                                             && SimdReduceOp<binary_func>::value>::type>
+    final {
+  using V = simd::SimdVec<T>;
+  using Op = SimdReduceOp<binary_func>;
+
+  static T ReduceRow(const T* x, int64_t n) {
+    const int64_t width = V::kWidth;
+    T reduced = UnitOfBinaryFunc<T, binary_func>::Val();
+    int64_t i = 0;
+    if (n >= width * 4) {
+      // four independent accumulators hide the latency of the vector op
+      typename V::Reg acc0 = V::Set1(reduced);
+      typename V::Reg acc1 = acc0;
+      typename V::Reg acc2 = acc0;
+      typename V::Reg acc3 = acc0;
+      for (; i + width * 4 <= n; i += width * 4) {
+        acc0 = Op::template Apply<V>(acc0, V::Load(x + i));
+        acc1 = Op::template Apply<V>(acc1, V::Load(x + i + width));
+        acc2 = Op::template Apply<V>(acc2, V::Load(x + i + width * 2));
+        acc3 = Op::template Apply<V>(acc3, V::Load(x + i + width * 3));
+      }
+      for (; i + width <= n; i += width) { acc0 = Op::template Apply<V>(acc0, V::Load(x + i)); }
+      acc0 = Op::template Apply<V>(Op::template Apply<V>(acc0, acc1),
+                                   Op::template Apply<V>(acc2, acc3));
+      reduced = Op::template Reduce<V>(acc0);
+    }
+    for (; i < n; ++i) { reduced = binary_func<T>::Invoke(reduced, x[i]); }
+    return reduced;
+  }
+
+  static void AccumulateRow(T* y, const T* x, int64_t n) {
+    const int64_t width = V::kWidth;
+    int64_t i = 0;
+    for (; i + width <= n; i += width) {
+      V::Store(y + i, Op::template Apply<V>(V::Load(y + i), V::Load(x + i)));
+    }
+    for (; i < n; ++i) { y[i] = binary_func<T>::Invoke(y[i], x[i]); }
+  }
+};
+
+// y[col_begin, col_end) = reduce of x[0, num_rows)[col_begin, col_end)
+template<typename T, template<typename> class binary_func>
+void ReduceCols(T* y, const T* x, int64_t num_rows, int64_t num_cols, int64_t col_begin,
+                int64_t col_end) {
+  for (int64_t block_begin = col_begin; block_begin < col_end;
+       block_begin += kReduceColBlockSize) {
+    const int64_t block_size = std::min(kReduceColBlockSize, col_end - block_begin);
+    std::fill(y + block_begin, y + block_begin + block_size,
+              UnitOfBinaryFunc<T, binary_func>::Val());
+    FOR_RANGE(int64_t, row, 0, num_rows) {
+      CpuReduceUtil<T, binary_func>::AccumulateRow(y + block_begin,
+                                                   x + row * num_cols + block_begin, block_size);
+    }
+  }
+}
+
+// y[0, num_cols) = reduce of x[num_rows][num_cols]
+template<typename T, template<typename> class binary_func>
+void ReduceMatrixCols(T* y, const T* x, int64_t num_rows, int64_t num_cols) {
+  const int64_t num_blocks = (num_cols + kReduceColBlockSize - 1) / kReduceColBlockSize;
+  const int64_t part_num = ReducePartNum(num_rows * num_cols, num_rows);
+  if (part_num <= num_blocks) {
+    // num_rows is 0 when x is empty
+    const int64_t block_elem_num = std::max<int64_t>(num_rows * kReduceColBlockSize, 1);
+    const int64_t grain_size = std::max<int64_t>(kReduceGrainSize / block_elem_num, 1);
+    ParallelFor(num_blocks, grain_size, [&](int64_t begin, int64_t end) {
+      ReduceCols<T, binary_func>(y, x, num_rows, num_cols, begin * kReduceColBlockSize,
+                                 std::min(end * kReduceColBlockSize, num_cols));
+    });
+  } else {
+    // too few columns to keep the threads busy, so split the rows as well
+    std::vector<T> partials(part_num * num_cols);
+    BalancedSplitter bs(num_rows, part_num);
+    ParallelFor(part_num, 1, [&](int64_t begin, int64_t end) {
+      FOR_RANGE(int64_t, i, begin, end) {
+        const Range range = bs.At(i);
+        ReduceCols<T, binary_func>(partials.data() + i * num_cols, x + range.begin() * num_cols,
+                                   range.size(), num_cols, 0, num_cols);
+      }
+    });
+    std::copy(partials.begin(), partials.begin() + num_cols, y);
+    FOR_RANGE(int64_t, i, 1, part_num) {
+      CpuReduceUtil<T, binary_func>::AccumulateRow(y, partials.data() + i * num_cols, num_cols);
+    }
+  }
+}
+
+}  // namespace
+
+template<typename T, template<typename> class binary_func>
+struct NdarrayScalarReduce<DeviceType::kCPU, T, binary_func> final {
+  static bool Matched(const XpuVarNdarray<T>& y, const XpuVarNdarray<const T>& x) {
+    return y.shape().ElemNum() == 1;
+  }
+  static void Reduce(DeviceCtx* ctx, const XpuVarNdarray<T>& y, const XpuVarNdarray<const T>& x,
+                     const XpuVarNdarray<T>& tmp_storage) {
+    CHECK(Matched(y, x));
+    const int64_t elem_num = x.shape().ElemNum();
+    const int64_t part_num = ReducePartNum(elem_num, elem_num);
+    if (part_num == 1) {
+      *y.ptr() = CpuReduceUtil<T, binary_func>::ReduceRow(x.ptr(), elem_num);
+      return;
+    }
+    // tmp_storage may alias x, so the partial results live on the heap
+    std::vector<T> partials(part_num);
+    BalancedSplitter bs(elem_num, part_num);
+    ParallelFor(part_num, 1, [&](int64_t begin, int64_t end) {
+      FOR_RANGE(int64_t, i, begin, end) {
+        const Range range = bs.At(i);
+        partials.at(i) =
+            CpuReduceUtil<T, binary_func>::ReduceRow(x.ptr() + range.begin(), range.size());
+      }
+    });
+    *y.ptr() = CpuReduceUtil<T, binary_func>::ReduceRow(partials.data(), part_num);
+  }
+};
+
+template<typename T, template<typename> class binary_func>
+struct NdarrayMatrixRowReduce<DeviceType::kCPU, T, binary_func> final {
+  static bool Matched(const XpuVarNdarray<T>& y, const XpuVarNdarray<const T>& x) {
+    if (x.shape().NumAxes() != 2) { return false; }
+    if (y.shape().NumAxes() != 2) { return false; }
+    return x.shape().At(0) == y.shape().At(0) && y.shape().At(1) == 1;
+  }
+  static void Reduce(DeviceCtx* ctx, const XpuVarNdarray<T>& y, const XpuVarNdarray<const T>& x,
+                     const XpuVarNdarray<T>& tmp_storage) {
+    CHECK(Matched(y, x));
+    const int64_t num_rows = x.shape().At(0);
+    const int64_t num_cols = x.shape().At(1);
+    const T* x_ptr = x.ptr();
+    T* y_ptr = y.ptr();
+    ParallelFor(num_rows, std::max<int64_t>(kReduceGrainSize / std::max<int64_t>(num_cols, 1), 1),
+                [&](int64_t begin, int64_t end) {
+                  FOR_RANGE(int64_t, row, begin, end) {
+                    y_ptr[row] =
+                        CpuReduceUtil<T, binary_func>::ReduceRow(x_ptr + row * num_cols, num_cols);
+                  }
+                });
+  }
+};
+
+template<typename T, template<typename> class binary_func>
+struct NdarrayMatrixColReduce<DeviceType::kCPU, T, binary_func> final {
+  static bool Matched(const XpuVarNdarray<T>& y, const XpuVarNdarray<const T>& x) {
+    if (x.shape().NumAxes() != 2) { return false; }
+    if (y.shape().NumAxes() != 2) { return false; }
+    return y.shape().At(0) == 1 && x.shape().At(1) == y.shape().At(1);
+  }
+  static void Reduce(DeviceCtx* ctx, const XpuVarNdarray<T>& y, const XpuVarNdarray<const T>& x,
+                     const XpuVarNdarray<T>& tmp_storage) {
+    CHECK(Matched(y, x));
+    ReduceMatrixCols<T, binary_func>(y.ptr(), x.ptr(), x.shape().At(0), x.shape().At(1));
+  }
+};
+
+template<typename T, template<typename> class binary_func>
+struct NdarrayXYZCubeYReduce<DeviceType::kCPU, T, binary_func> final {
+  static bool Matched(const XpuVarNdarray<T>& y, const XpuVarNdarray<const T>& x) {
+    if (x.shape().NumAxes() != 3) { return false; }
+    if (y.shape().NumAxes() != 3) { return false; }
+    return x.shape().At(0) == y.shape().At(0) && y.shape().At(1) == 1
+           && x.shape().At(2) == y.shape().At(2);
+  }
+  static void Reduce(DeviceCtx* ctx, const XpuVarNdarray<T>& y, const XpuVarNdarray<const T>& x,
+                     const XpuVarNdarray<T>& tmp_storage) {
+    CHECK(Matched(y, x));
+    const int64_t dim_x = x.shape().At(0);
+    const int64_t dim_y = x.shape().At(1);
+    const int64_t dim_z = x.shape().At(2);
+    const int64_t num_blocks = (dim_z + kReduceColBlockSize - 1) / kReduceColBlockSize;
+    const T* x_ptr = x.ptr();
+    T* y_ptr = y.ptr();
+    // every x index is an independent column reduce of a dim_y * dim_z matrix
+    ParallelFor(dim_x * num_blocks,
+                std::max<int64_t>(
+                    kReduceGrainSize / std::max<int64_t>(dim_y * kReduceColBlockSize, 1), 1),
+                [&](int64_t begin, int64_t end) {
+                  FOR_RANGE(int64_t, i, begin, end) {
+                    const int64_t col_begin = (i % num_blocks) * kReduceColBlockSize;
+                    const int64_t col_end = std::min(col_begin + kReduceColBlockSize, dim_z);
+                    ReduceCols<T, binary_func>(y_ptr + (i / num_blocks) * dim_z,
+                                               x_ptr + (i / num_blocks) * dim_y * dim_z, dim_y,
+                                               dim_z, col_begin, col_end);
+                  }
+                });
+  }
+};
+
+template<typename T, template<typename> class binary_func>
+struct NdarrayXYZCubeXZReduce<DeviceType::kCPU, T, binary_func> final {
+  static bool Matched(const XpuVarNdarray<T>& y, const XpuVarNdarray<const T>& x) {
+    if (x.shape().NumAxes() != 3) { return false; }
+    if (y.shape().NumAxes() != 3) { return false; }
+    return y.shape().At(0) == 1 && x.shape().At(1) == y.shape().At(1) && y.shape().At(2) == 1;
+  }
+  static void Reduce(DeviceCtx* ctx, const XpuVarNdarray<T>& y, const XpuVarNdarray<const T>& x,
+                     const XpuVarNdarray<T>& tmp_storage) {
+    CHECK(Matched(y, x));
+    const int64_t dim_x = x.shape().At(0);
+    const int64_t dim_y = x.shape().At(1);
+    const int64_t dim_z = x.shape().At(2);
+    const T* x_ptr = x.ptr();
+    T* y_ptr = y.ptr();
+    // the x axis of every y index is split into part_num parts reduced independently
+    const int64_t part_num = ReducePartNum(dim_x * dim_z, dim_x);
+    std::vector<T> partials(dim_y * part_num);
+    BalancedSplitter bs(dim_x, part_num);
+    ParallelFor(dim_y * part_num,
+                std::max<int64_t>(
+                    kReduceGrainSize * part_num / std::max<int64_t>(dim_x * dim_z, 1), 1),
+                [&](int64_t begin, int64_t end) {
+                  FOR_RANGE(int64_t, i, begin, end) {
+                    const int64_t y_idx = i / part_num;
+                    const Range range = bs.At(i % part_num);
+                    T reduced = UnitOfBinaryFunc<T, binary_func>::Val();
+                    FOR_RANGE(int64_t, x_idx, range.begin(), range.end()) {
+                      reduced = binary_func<T>::Invoke(
+                          reduced, CpuReduceUtil<T, binary_func>::ReduceRow(
+                                       x_ptr + (x_idx * dim_y + y_idx) * dim_z, dim_z));
+                    }
+                    partials.at(i) = reduced;
+                  }
+                });
+    FOR_RANGE(int64_t, y_idx, 0, dim_y) {
+      y_ptr[y_idx] =
+          CpuReduceUtil<T, binary_func>::ReduceRow(partials.data() + y_idx * part_num, part_num);
+    }
+  }
+};
 
 #define INSTANTIATE_NDARRAY_REDUCE_IMPL(dtype, binary_func)                                       \
   template struct NdarrayScalarReduce<DeviceType::kCPU, OF_PP_PAIR_FIRST(dtype), binary_func>;    \
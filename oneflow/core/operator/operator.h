@@ -187,6 +187,9 @@ class Operator {
 
   Maybe<const SbpSignature*> sbp_signature() const;
   SbpSignature* mut_sbp_signature() { return op_attribute_.mutable_sbp_signature(); }
+  const BlobLastUsedSignature& blob_last_used_signature() const {
+    return op_attribute_.blob_last_used_signature();
+  }
   BlobLastUsedSignature* mut_blob_last_used_signature() {
     return op_attribute_.mutable_blob_last_used_signature();
   }
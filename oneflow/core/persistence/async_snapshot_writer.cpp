@@ -0,0 +1,131 @@
+/*
+Copyright 2020 The OneFlow Authors. All rights reserved.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+*/
+#include "oneflow/core/persistence/async_snapshot_writer.h"
+#include "oneflow/core/common/str_util.h"
+#include "oneflow/core/control/ctrl_client.h"
+#include "oneflow/core/persistence/file_system.h"
+
+namespace oneflow {
+
+namespace {
+
+// The writes of a snapshot not landed yet, plus kMarkedCount once MarkDone waits for them. The
+// write that brings the count down to kMarkedCount pushes the landed key that MarkDone pulls.
+constexpr int32_t kMarkedCount = 1 << 30;
+
+std::string PendingFileCountKey(const std::string& snapshot_root_path) {
+  return "AsyncSnapshotPendingFileCount-" + snapshot_root_path;
+}
+
+std::string LandedKey(const std::string& snapshot_root_path) {
+  return "AsyncSnapshotLanded-" + snapshot_root_path;
+}
+
+// a reader sees either no file at path or all of it, also after a crash
+void WriteFileAtomically(const std::string& path, const char* data, size_t size) {
+  const std::string tmp_path = path + ".writing";
+  std::unique_ptr<fs::WritableFile> file;
+  SnapshotFS()->NewWritableFile(tmp_path, &file);
+  file->Append(data, size);
+  file->Sync();
+  file->Close();
+  SnapshotFS()->RenameFile(tmp_path, path);
+}
+
+}  // namespace
+
+AsyncSnapshotWriter::AsyncSnapshotWriter(int32_t thread_num, uint64_t staging_byte_size)
+    : staging_byte_size_(staging_byte_size),
+      staged_byte_size_(0),
+      pending_work_cnt_(0),
+      thread_pool_(thread_num) {}
+
+AsyncSnapshotWriter::~AsyncSnapshotWriter() { WaitUntilDone(); }
+
+void AsyncSnapshotWriter::Write(const std::string& snapshot_root_path, const std::string& path,
+                                const char* data, size_t size) {
+  Write(snapshot_root_path, {path}, {std::string(data, size)});
+}
+
+void AsyncSnapshotWriter::Write(const std::string& snapshot_root_path,
+                                const std::vector<std::string>& paths,
+                                std::vector<std::string> data_vec) {
+  CHECK_EQ(paths.size(), data_vec.size());
+  size_t size = 0;
+  for (const std::string& data : data_vec) { size += data.size(); }
+  {
+    std::unique_lock<std::mutex> lock(mutex_);
+    // a buffer larger than all of them waits for the others to be written
+    cond_.wait(lock, [&]() {
+      return staged_byte_size_ == 0 || staged_byte_size_ + size <= staging_byte_size_;
+    });
+    staged_byte_size_ += size;
+  }
+  Global<CtrlClient>::Get()->IncreaseCount(PendingFileCountKey(snapshot_root_path));
+  std::shared_ptr<std::vector<std::string>> buffers(
+      new std::vector<std::string>(std::move(data_vec)));
+  AddWork([this, snapshot_root_path, paths, buffers, size]() {
+    FOR_RANGE(size_t, i, 0, paths.size()) {
+      WriteFileAtomically(paths.at(i), buffers->at(i).data(), buffers->at(i).size());
+    }
+    if (Global<CtrlClient>::Get()->IncreaseCount(PendingFileCountKey(snapshot_root_path), -1)
+        == kMarkedCount) {
+      Global<CtrlClient>::Get()->PushKV(LandedKey(snapshot_root_path), "");
+    }
+    std::vector<std::string>().swap(*buffers);
+    std::unique_lock<std::mutex> lock(mutex_);
+    staged_byte_size_ -= size;
+    cond_.notify_all();
+  });
+}
+
+void AsyncSnapshotWriter::MarkDone(const std::string& snapshot_root_path) {
+  const std::string key = PendingFileCountKey(snapshot_root_path);
+  // blocks until the last pending file of any machine lands, without polling the count
+  if (Global<CtrlClient>::Get()->IncreaseCount(key, kMarkedCount) > kMarkedCount) {
+    std::string landed;
+    Global<CtrlClient>::Get()->PullKV(LandedKey(snapshot_root_path), &landed);
+    Global<CtrlClient>::Get()->ClearKV(LandedKey(snapshot_root_path));
+  }
+  Global<CtrlClient>::Get()->EraseCount(key);
+  WriteFileAtomically(JoinPath(snapshot_root_path, "snapshot_done"), nullptr, 0);
+}
+
+void AsyncSnapshotWriter::AsyncMarkDone(const std::string& snapshot_root_path) {
+  // works are taken in the order they are added, so the writes of this machine before are taken
+  // by the time it waits for them
+  AddWork([this, snapshot_root_path]() { MarkDone(snapshot_root_path); });
+}
+
+void AsyncSnapshotWriter::WaitUntilDone() {
+  std::unique_lock<std::mutex> lock(mutex_);
+  cond_.wait(lock, [this]() { return pending_work_cnt_ == 0; });
+}
+
+void AsyncSnapshotWriter::AddWork(const std::function<void()>& work) {
+  {
+    std::unique_lock<std::mutex> lock(mutex_);
+    pending_work_cnt_ += 1;
+  }
+  thread_pool_.AddWork([this, work]() {
+    work();
+    std::unique_lock<std::mutex> lock(mutex_);
+    pending_work_cnt_ -= 1;
+    cond_.notify_all();
+  });
+}
+
+}  // namespace oneflow
@@ -0,0 +1,67 @@
+/*
+Copyright 2020 The OneFlow Authors. All rights reserved.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+*/
+#ifndef ONEFLOW_CORE_PERSISTENCE_ASYNC_SNAPSHOT_WRITER_H_
+#define ONEFLOW_CORE_PERSISTENCE_ASYNC_SNAPSHOT_WRITER_H_
+
+#include <condition_variable>
+#include <mutex>
+#include <string>
+#include <vector>
+#include "oneflow/core/thread/thread_pool.h"
+
+namespace oneflow {
+
+// Writes the files of snapshots off the actor threads. Write copies the data to a staging buffer
+// and returns, waiting only while the buffers not written yet hold staging_byte_size bytes, so
+// the actor fills one buffer while the others are written. thread_num threads write each buffer
+// to a temporary file, sync it and rename it to its path. The writes of a snapshot still to land
+// are counted by the CtrlClient over all machines, and MarkDone blocks on a key the last of them
+// pushes, to write snapshot_done only when the files of every machine have landed.
+class AsyncSnapshotWriter final {
+ public:
+  OF_DISALLOW_COPY_AND_MOVE(AsyncSnapshotWriter);
+  AsyncSnapshotWriter(int32_t thread_num, uint64_t staging_byte_size);
+  // WaitUntilDone
+  ~AsyncSnapshotWriter();
+
+  void Write(const std::string& snapshot_root_path, const std::string& path, const char* data,
+             size_t size);
+  // Writes each of data_vec to the path at its index in one work, in order, so that a reader who
+  // sees the last of the files sees the others complete.
+  void Write(const std::string& snapshot_root_path, const std::vector<std::string>& paths,
+             std::vector<std::string> data_vec);
+  // Waits until the files written to the snapshot by all machines have landed, then writes its
+  // snapshot_done. Called once per snapshot, after the writes of all machines were added.
+  void MarkDone(const std::string& snapshot_root_path);
+  // MarkDone on a writer thread
+  void AsyncMarkDone(const std::string& snapshot_root_path);
+  // waits for the works added so far, the writes and the AsyncMarkDone
+  void WaitUntilDone();
+
+ private:
+  void AddWork(const std::function<void()>& work);
+
+  uint64_t staging_byte_size_;
+  uint64_t staged_byte_size_;
+  int64_t pending_work_cnt_;
+  std::mutex mutex_;
+  std::condition_variable cond_;
+  ThreadPool thread_pool_;
+};
+
+}  // namespace oneflow
+
+#endif  // ONEFLOW_CORE_PERSISTENCE_ASYNC_SNAPSHOT_WRITER_H_
@@ -0,0 +1,88 @@
+/*
+Copyright 2020 The OneFlow Authors. All rights reserved.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+*/
+#include <gtest/gtest.h>
+#include <fstream>
+#include <iterator>
+#include <random>
+#include "oneflow/core/persistence/async_snapshot_writer.h"
+#include "oneflow/core/persistence/snapshot_test_util.h"
+
+#ifdef OF_PLATFORM_POSIX
+
+namespace oneflow {
+
+namespace {
+
+using test::TearDownSnapshotTest;
+
+// an empty snapshot root
+std::string SetUpSnapshot(const std::string& name) {
+  const std::string root = test::SetUpSnapshotTest("async_" + name);
+  SnapshotFS()->CreateDir(root);
+  return root;
+}
+
+std::string ReadFile(const std::string& path) {
+  std::ifstream in(path, std::ios::binary);
+  return std::string(std::istreambuf_iterator<char>(in), std::istreambuf_iterator<char>());
+}
+
+}  // namespace
+
+TEST(AsyncSnapshotWriter, write_and_mark_done) {
+  const std::string root = SetUpSnapshot("write_and_mark_done");
+  {
+    // staging for about two of the files, and a file larger than all of it
+    AsyncSnapshotWriter writer(2, 64);
+    std::mt19937 gen(0);
+    std::vector<std::string> contents;
+    for (const size_t size : {10, 40, 30, 200, 0, 50}) {
+      std::string content(size, '\0');
+      for (char& c : content) { c = static_cast<char>(gen()); }
+      contents.push_back(content);
+    }
+    FOR_RANGE(size_t, i, 0, contents.size()) {
+      std::string data = contents.at(i);
+      writer.Write(root, JoinPath(root, "file_" + std::to_string(i)), data.data(), data.size());
+      // the data is staged, so the caller may reuse its memory once Write returns
+      std::fill(data.begin(), data.end(), 'x');
+    }
+    writer.AsyncMarkDone(root);
+    writer.WaitUntilDone();
+    ASSERT_TRUE(SnapshotFS()->FileExists(JoinPath(root, "snapshot_done")));
+    FOR_RANGE(size_t, i, 0, contents.size()) {
+      ASSERT_EQ(ReadFile(JoinPath(root, "file_" + std::to_string(i))), contents.at(i));
+    }
+    // each file was renamed from its temporary one
+    ASSERT_EQ(SnapshotFS()->ListDir(root).size(), contents.size() + 1);
+  }
+  TearDownSnapshotTest(root);
+}
+
+TEST(AsyncSnapshotWriter, mark_done_without_files) {
+  const std::string root = SetUpSnapshot("mark_done_without_files");
+  {
+    AsyncSnapshotWriter writer(1, 64);
+    writer.MarkDone(root);
+    ASSERT_TRUE(SnapshotFS()->FileExists(JoinPath(root, "snapshot_done")));
+    writer.WaitUntilDone();
+  }
+  TearDownSnapshotTest(root);
+}
+
+}  // namespace oneflow
+
+#endif  // OF_PLATFORM_POSIX
@@ -70,6 +70,10 @@ class WritableFile {
   // persisted, depending on the implementation.
   virtual void Flush() = 0;
 
+  // Flushes the file and syncs its contents to the storage device, so that they persist even if
+  // the machine crashes. Falls back to Flush() where the filesystem has no stronger guarantee.
+  virtual void Sync() { Flush(); }
+
  private:
 };
 
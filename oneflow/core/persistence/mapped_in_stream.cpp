@@ -0,0 +1,128 @@
+/*
+Copyright 2020 The OneFlow Authors. All rights reserved.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+*/
+#include "oneflow/core/persistence/mapped_in_stream.h"
+#include <cstring>
+
+#ifdef OF_PLATFORM_POSIX
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif  // OF_PLATFORM_POSIX
+
+namespace oneflow {
+
+namespace {
+
+constexpr size_t kDefaultReadaheadSize = 16 * 1024 * 1024;  // 16MB
+
+}  // namespace
+
+#ifdef OF_PLATFORM_POSIX
+
+MappedFile::MappedFile(const std::string& file_path)
+    : file_path_(file_path), data_(nullptr), size_(0) {
+  const int fd = open(file_path.c_str(), O_RDONLY);
+  PCHECK(fd != -1) << "Fail to open file " << file_path;
+  struct stat st {};
+  PCHECK(fstat(fd, &st) == 0) << "Fail to stat file " << file_path;
+  size_ = static_cast<size_t>(st.st_size);
+  if (size_ > 0) {
+    // private and writable, so consumers may modify their records in place
+    void* ptr = mmap(nullptr, size_, PROT_READ | PROT_WRITE, MAP_PRIVATE, fd, 0);
+    PCHECK(ptr != MAP_FAILED) << "Fail to map file " << file_path;
+    data_ = static_cast<char*>(ptr);
+    PCHECK(madvise(data_, size_, MADV_SEQUENTIAL) == 0);
+  }
+  PCHECK(close(fd) == 0);
+}
+
+MappedFile::~MappedFile() {
+  if (data_ != nullptr) { PCHECK(munmap(data_, size_) == 0) << "Fail to unmap " << file_path_; }
+}
+
+void MappedFile::WillNeed(size_t offset, size_t len) const {
+  if (offset >= size_) { return; }
+  len = std::min(len, size_ - offset);
+  // madvise wants a page aligned address, the mapping itself is
+  static const size_t page_size = sysconf(_SC_PAGESIZE);
+  const size_t aligned_offset = offset / page_size * page_size;
+  PCHECK(madvise(data_ + aligned_offset, len + offset - aligned_offset, MADV_WILLNEED) == 0);
+}
+
+#else
+
+MappedFile::MappedFile(const std::string& file_path)
+    : file_path_(file_path), data_(nullptr), size_(0) {
+  UNIMPLEMENTED();
+}
+
+MappedFile::~MappedFile() = default;
+
+void MappedFile::WillNeed(size_t offset, size_t len) const { UNIMPLEMENTED(); }
+
+#endif  // OF_PLATFORM_POSIX
+
+MappedInStream::MappedInStream(const std::vector<std::string>& file_paths, size_t readahead_size)
+    : file_paths_(file_paths),
+      readahead_size_(readahead_size),
+      next_file_idx_(0),
+      cur_file_pos_(0),
+      readahead_end_(0) {
+  CHECK_GT(readahead_size_, 0);
+}
+
+MappedInStream::MappedInStream(const std::vector<std::string>& file_paths)
+    : MappedInStream(file_paths, kDefaultReadaheadSize) {}
+
+int32_t MappedInStream::Read(size_t n, char** ptr) {
+  if (IsEof()) { return -1; }
+  CHECK_LE(cur_file_pos_ + n, cur_file_->size())
+      << "a record crosses the end of file " << file_paths_.at(next_file_idx_ - 1);
+  if (cur_file_pos_ + n + readahead_size_ / 2 > readahead_end_) {
+    ReadAhead(cur_file_pos_ + n + readahead_size_);
+  }
+  *ptr = cur_file_->mut_data() + cur_file_pos_;
+  cur_file_pos_ += n;
+  return 0;
+}
+
+int32_t MappedInStream::ReadFully(char* s, size_t n) {
+  char* ptr = nullptr;
+  if (Read(n, &ptr) != 0) { return -1; }
+  if (n > 0) { std::memcpy(s, ptr, n); }
+  return 0;
+}
+
+bool MappedInStream::IsEof() {
+  while (!cur_file_ || cur_file_pos_ == cur_file_->size()) {
+    if (next_file_idx_ == file_paths_.size()) { return true; }
+    cur_file_.reset(new MappedFile(file_paths_.at(next_file_idx_)));
+    next_file_idx_ += 1;
+    cur_file_pos_ = 0;
+    readahead_end_ = 0;
+  }
+  return false;
+}
+
+void MappedInStream::ReadAhead(size_t end) {
+  end = std::min(end, cur_file_->size());
+  if (end <= readahead_end_) { return; }
+  cur_file_->WillNeed(readahead_end_, end - readahead_end_);
+  readahead_end_ = end;
+}
+
+}  // namespace oneflow
@@ -0,0 +1,76 @@
+/*
+Copyright 2020 The OneFlow Authors. All rights reserved.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+*/
+#ifndef ONEFLOW_CORE_PERSISTENCE_MAPPED_IN_STREAM_H_
+#define ONEFLOW_CORE_PERSISTENCE_MAPPED_IN_STREAM_H_
+
+#include "oneflow/core/common/util.h"
+
+namespace oneflow {
+
+// A local file mapped copy-on-write. Writes through mut_data() never reach the file, so slices of
+// the mapping can be handed out as buffers that stay valid while the MappedFile is alive.
+class MappedFile final {
+ public:
+  OF_DISALLOW_COPY_AND_MOVE(MappedFile);
+  explicit MappedFile(const std::string& file_path);
+  ~MappedFile();
+
+  const char* data() const { return data_; }
+  char* mut_data() { return data_; }
+  size_t size() const { return size_; }
+
+  // asks the kernel to read [offset, offset + len) ahead
+  void WillNeed(size_t offset, size_t len) const;
+
+ private:
+  std::string file_path_;
+  char* data_;
+  size_t size_;
+};
+
+// Reads a sequence of local files through mappings instead of a staging buffer. Read returns a
+// pointer into current_file() rather than copying, and the next readahead_size bytes are requested
+// with madvise once the reader is half way through the window requested before.
+class MappedInStream final {
+ public:
+  OF_DISALLOW_COPY_AND_MOVE(MappedInStream);
+  MappedInStream(const std::vector<std::string>& file_paths, size_t readahead_size);
+  explicit MappedInStream(const std::vector<std::string>& file_paths);
+  ~MappedInStream() = default;
+
+  // 0: success
+  // -1: eof
+  // *ptr stays valid while current_file() is held, n bytes must not cross the end of a file
+  int32_t Read(size_t n, char** ptr);
+  int32_t ReadFully(char* s, size_t n);
+
+  const std::shared_ptr<MappedFile>& current_file() const { return cur_file_; }
+
+ private:
+  bool IsEof();
+  void ReadAhead(size_t end);
+
+  std::vector<std::string> file_paths_;
+  size_t readahead_size_;
+  size_t next_file_idx_;
+  std::shared_ptr<MappedFile> cur_file_;
+  size_t cur_file_pos_;
+  size_t readahead_end_;
+};
+
+}  // namespace oneflow
+
+#endif  // ONEFLOW_CORE_PERSISTENCE_MAPPED_IN_STREAM_H_
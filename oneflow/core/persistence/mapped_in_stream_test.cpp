@@ -0,0 +1,156 @@
+/*
+Copyright 2020 The OneFlow Authors. All rights reserved.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+*/
+#include <gtest/gtest.h>
+#include <chrono>
+#include "oneflow/core/common/process_state.h"
+#include "oneflow/core/common/str_util.h"
+#include "oneflow/core/common/tensor_buffer.h"
+#include "oneflow/core/job/job_set.pb.h"
+#include "oneflow/core/persistence/mapped_in_stream.h"
+#include "oneflow/core/persistence/persistent_in_stream.h"
+#include "oneflow/core/persistence/posix/posix_file_system.h"
+
+namespace oneflow {
+
+namespace {
+
+// writes records framed like OFRecord files, an int64 size followed by the bytes
+std::vector<std::string> WriteRecordFiles(fs::FileSystem* file_system, const std::string& prefix,
+                                          int64_t file_num, int64_t record_num_per_file,
+                                          int64_t max_record_size,
+                                          std::vector<std::string>* records) {
+  std::string current_dir = GetCwd();
+  StringReplace(&current_dir, '\\', '/');
+  std::mt19937 gen(0);
+  std::uniform_int_distribution<int64_t> size_dis(1, max_record_size);
+  std::vector<std::string> file_paths;
+  FOR_RANGE(int64_t, i, 0, file_num) {
+    const std::string file_path = JoinPath(current_dir, prefix + std::to_string(i));
+    std::unique_ptr<fs::WritableFile> file;
+    file_system->NewWritableFile(file_path, &file);
+    FOR_RANGE(int64_t, j, 0, record_num_per_file) {
+      const int64_t size = size_dis(gen);
+      std::string record(size, '\0');
+      FOR_RANGE(int64_t, k, 0, size) { record[k] = static_cast<char>(gen()); }
+      file->Append(reinterpret_cast<const char*>(&size), sizeof(size));
+      file->Append(record.data(), size);
+      if (records != nullptr) { records->push_back(std::move(record)); }
+    }
+    file->Close();
+    file_paths.push_back(file_path);
+  }
+  return file_paths;
+}
+
+}  // namespace
+
+#ifdef OF_PLATFORM_POSIX
+
+TEST(MappedInStream, read_records) {
+  fs::PosixFileSystem file_system;
+  std::vector<std::string> records;
+  // an empty file in between is skipped
+  std::vector<std::string> file_paths =
+      WriteRecordFiles(&file_system, "/tmp_mapped_in_stream_test_", 3, 100, 5000, &records);
+  std::vector<std::string> empty_records;
+  const std::vector<std::string> empty_file_paths =
+      WriteRecordFiles(&file_system, "/tmp_mapped_in_stream_test_empty_", 1, 0, 1, &empty_records);
+  file_paths.insert(file_paths.begin() + 1, empty_file_paths.front());
+  std::vector<std::unique_ptr<TensorBuffer>> buffers;
+  {
+    // a small readahead window moves several times within a file
+    MappedInStream in_stream(file_paths, 4096);
+    for (const std::string& record : records) {
+      int64_t size = -1;
+      ASSERT_EQ(in_stream.ReadFully(reinterpret_cast<char*>(&size), sizeof(size)), 0);
+      ASSERT_EQ(size, static_cast<int64_t>(record.size()));
+      char* ptr = nullptr;
+      ASSERT_EQ(in_stream.Read(size, &ptr), 0);
+      buffers.emplace_back(new TensorBuffer());
+      buffers.back()->Borrow(Shape({size}), DataType::kChar, ptr, in_stream.current_file());
+      ASSERT_TRUE(buffers.back()->is_borrowed());
+    }
+    int64_t size = -1;
+    ASSERT_EQ(in_stream.ReadFully(reinterpret_cast<char*>(&size), sizeof(size)), -1);
+  }
+  // the buffers keep the mappings alive after the stream is gone
+  FOR_RANGE(size_t, i, 0, records.size()) {
+    ASSERT_EQ(std::string(buffers.at(i)->data<char>(), buffers.at(i)->elem_cnt()), records.at(i));
+  }
+  // writes stay private, resizing leaves the mapping for owned memory
+  buffers.front()->mut_data<char>()[0] = ~records.front()[0];
+  buffers.front()->Resize(Shape({8}), DataType::kChar);
+  ASSERT_FALSE(buffers.front()->is_borrowed());
+  buffers.clear();
+  for (const std::string& file_path : file_paths) {
+    std::unique_ptr<fs::RandomAccessFile> file;
+    file_system.NewRandomAccessFile(file_path, &file);
+    if (file_path == file_paths.front()) {
+      char first = 0;
+      file->Read(sizeof(int64_t), 1, &first);
+      ASSERT_EQ(first, records.front()[0]);
+    }
+    file_system.DelFile(file_path);
+  }
+}
+
+// compares reading records through the mapping with reading them through PersistentInStream
+// into TensorBuffers, run with --gtest_also_run_disabled_tests
+TEST(MappedInStream, DISABLED_benchmark) {
+  fs::PosixFileSystem file_system;
+  Global<const IOConf>::New();
+  for (const int64_t max_record_size : {1024, 128 * 1024}) {
+    const int64_t record_num_per_file = 512 * 1024 * 1024 / max_record_size;
+    const std::vector<std::string> file_paths =
+        WriteRecordFiles(&file_system, "/tmp_mapped_in_stream_benchmark_", 4,
+                         record_num_per_file, max_record_size, nullptr);
+    int64_t total_size = 0;
+    const auto Time = [&](const std::function<int32_t(TensorBuffer*)>& ReadSample) {
+      const auto start = std::chrono::steady_clock::now();
+      TensorBuffer buffer;
+      total_size = 0;
+      while (ReadSample(&buffer) == 0) { total_size += buffer.elem_cnt(); }
+      return std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+    };
+    PersistentInStream in_stream(&file_system, file_paths, false, false);
+    const double stream_s = Time([&](TensorBuffer* buffer) {
+      int64_t size = -1;
+      if (in_stream.ReadFully(reinterpret_cast<char*>(&size), sizeof(size)) != 0) { return -1; }
+      buffer->Resize(Shape({size}), DataType::kChar);
+      return in_stream.ReadFully(buffer->mut_data<char>(), size);
+    });
+    MappedInStream mapped_in_stream(file_paths);
+    const double mapped_s = Time([&](TensorBuffer* buffer) {
+      int64_t size = -1;
+      if (mapped_in_stream.ReadFully(reinterpret_cast<char*>(&size), sizeof(size)) != 0) {
+        return -1;
+      }
+      char* ptr = nullptr;
+      CHECK_EQ(mapped_in_stream.Read(size, &ptr), 0);
+      buffer->Borrow(Shape({size}), DataType::kChar, ptr, mapped_in_stream.current_file());
+      return 0;
+    });
+    const double total_mb = static_cast<double>(total_size) / (1024 * 1024);
+    LOG(INFO) << "max record size " << max_record_size << ": stream " << total_mb / stream_s
+              << " MB/s, mapped " << total_mb / mapped_s << " MB/s";
+    for (const std::string& file_path : file_paths) { file_system.DelFile(file_path); }
+  }
+  Global<const IOConf>::Delete();
+}
+
+#endif  // OF_PLATFORM_POSIX
+
+}  // namespace oneflow
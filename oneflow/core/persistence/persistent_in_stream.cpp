@@ -37,6 +37,20 @@ size_t GetBufferSize(int64_t session_id) {
   }
 }
 
+int32_t GetReadAheadThreadNum(int64_t session_id) {
+  const int32_t thread_num =
+      Global<const IOConf>::Get(session_id)->persistence_read_ahead_thread_num();
+  CHECK_GE(thread_num, 0);
+  return thread_num;
+}
+
+size_t GetReadAheadBlockSize(int64_t session_id) {
+  const int64_t block_size =
+      Global<const IOConf>::Get(session_id)->persistence_read_ahead_block_byte();
+  CHECK_GT(block_size, 0);
+  return block_size;
+}
+
 }  // namespace
 
 PersistentInStream::PersistentInStream(fs::FileSystem* fs,
@@ -48,6 +62,18 @@ PersistentInStream::PersistentInStream(int64_t session_id, fs::FileSystem* fs,
                                        const std::vector<std::string>& file_paths, uint64_t offset,
                                        bool cyclic, bool with_local_copy) {
   if (with_local_copy) { CHECK_EQ(offset, 0); }
+  // a local copy is written in file order by the stream that downloads it
+  const int32_t read_ahead_thread_num = GetReadAheadThreadNum(session_id);
+  if (read_ahead_thread_num > 0 && !with_local_copy) {
+    read_ahead_scanner_.reset(new ReadAheadScanner(fs, file_paths, offset, cyclic,
+                                                   GetReadAheadBlockSize(session_id),
+                                                   read_ahead_thread_num));
+    buffer_.resize(1);
+    cur_buf_begin_ = buffer_.data();
+    cur_buf_end_ = buffer_.data();
+    *cur_buf_end_ = '\0';
+    return;
+  }
   std::vector<std::shared_ptr<BinaryInStream>> streams;
   for (auto& file_path : file_paths) {
     if (with_local_copy) {
@@ -120,8 +146,26 @@ int32_t PersistentInStream::ReadFully(char* s, size_t n) {
   return 0;
 }
 
+ReadAheadStats PersistentInStream::read_ahead_stats() const {
+  if (read_ahead_scanner_) { return read_ahead_scanner_->stats(); }
+  ReadAheadStats stats;
+  stats.bytes_read = 0;
+  stats.elapsed_s = 0;
+  stats.stall_s = 0;
+  return stats;
+}
+
 void PersistentInStream::UpdateBuffer() {
   CHECK_EQ(cur_buf_begin_, cur_buf_end_);
+  if (read_ahead_scanner_) {
+    char* data = nullptr;
+    const size_t n = read_ahead_scanner_->Next(&data);
+    if (n == 0) { return; }
+    cur_buf_begin_ = data;
+    cur_buf_end_ = data + n;
+    *cur_buf_end_ = '\0';
+    return;
+  }
   uint64_t n = stream_scanner_->UpdateBuffer(&buffer_);
   cur_buf_begin_ = buffer_.data();
   cur_buf_end_ = buffer_.data() + n;
@@ -129,6 +173,8 @@ void PersistentInStream::UpdateBuffer() {
 }
 
 bool PersistentInStream::IsEof() const {
-  return cur_buf_begin_ == cur_buf_end_ && stream_scanner_->IsEof();
+  if (cur_buf_begin_ != cur_buf_end_) { return false; }
+  return read_ahead_scanner_ ? read_ahead_scanner_->IsEof() : stream_scanner_->IsEof();
 }
+
 }  // namespace oneflow
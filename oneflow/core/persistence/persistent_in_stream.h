@@ -17,6 +17,7 @@ limitations under the License.
 #define ONEFLOW_CORE_PERSISTENCE_PERSISTENT_IN_STREAM_H_
 
 #include "oneflow/core/persistence/file_system.h"
+#include "oneflow/core/persistence/read_ahead_scanner.h"
 #include "oneflow/core/persistence/stream_scanner.h"
 
 namespace oneflow {
@@ -44,11 +45,16 @@ class PersistentInStream {
   int32_t ReadLine(std::string* l);
   int32_t ReadFully(char* s, size_t n);
 
+  // all zero when the stream does not read ahead
+  ReadAheadStats read_ahead_stats() const;
+
  private:
   bool IsEof() const;
   void UpdateBuffer();
 
   std::unique_ptr<StreamScanner> stream_scanner_;
+  // replaces stream_scanner_ and buffer_ when IOConf asks for read ahead threads
+  std::unique_ptr<ReadAheadScanner> read_ahead_scanner_;
 
   std::vector<char> buffer_;
   char* cur_buf_begin_;
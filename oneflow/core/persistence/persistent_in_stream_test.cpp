@@ -0,0 +1,120 @@
+/*
+Copyright 2020 The OneFlow Authors. All rights reserved.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+*/
+#include <gtest/gtest.h>
+#include "oneflow/core/common/process_state.h"
+#include "oneflow/core/common/str_util.h"
+#include "oneflow/core/job/job_set.pb.h"
+#include "oneflow/core/persistence/persistent_in_stream.h"
+#include "oneflow/core/persistence/posix/posix_file_system.h"
+
+namespace oneflow {
+
+namespace {
+
+std::vector<std::string> WriteFiles(fs::FileSystem* file_system,
+                                    const std::vector<std::string>& contents) {
+  std::string current_dir = GetCwd();
+  StringReplace(&current_dir, '\\', '/');
+  std::vector<std::string> file_paths;
+  FOR_RANGE(size_t, i, 0, contents.size()) {
+    const std::string file_path =
+        JoinPath(current_dir, "/tmp_persistent_in_stream_test_" + std::to_string(i));
+    std::unique_ptr<fs::WritableFile> file;
+    file_system->NewWritableFile(file_path, &file);
+    file->Append(contents.at(i).data(), contents.at(i).size());
+    file->Close();
+    file_paths.push_back(file_path);
+  }
+  return file_paths;
+}
+
+void SetIOConf(int32_t read_ahead_thread_num, uint64_t read_ahead_block_byte) {
+  IOConf* io_conf = new IOConf();
+  io_conf->set_persistence_buf_byte(16);
+  io_conf->set_persistence_read_ahead_thread_num(read_ahead_thread_num);
+  io_conf->set_persistence_read_ahead_block_byte(read_ahead_block_byte);
+  Global<const IOConf>::Delete();
+  Global<const IOConf>::SetAllocated(io_conf);
+}
+
+// reads n bytes at a time, as many as fit in the expected bytes
+std::string ReadAll(PersistentInStream* in_stream, size_t n, size_t expected_size) {
+  std::string ret;
+  std::vector<char> buffer(n);
+  while (ret.size() + n <= expected_size && in_stream->ReadFully(buffer.data(), n) == 0) {
+    ret.append(buffer.data(), n);
+  }
+  return ret;
+}
+
+}  // namespace
+
+#ifdef OF_PLATFORM_POSIX
+
+TEST(PersistentInStream, read_ahead) {
+  fs::PosixFileSystem file_system;
+  std::mt19937 gen(0);
+  std::vector<std::string> contents;
+  for (const size_t size : {1000, 0, 1, 4097, 333}) {
+    std::string content(size, '\0');
+    for (char& c : content) { c = static_cast<char>(gen()); }
+    contents.push_back(content);
+  }
+  const std::vector<std::string> file_paths = WriteFiles(&file_system, contents);
+  std::string whole;
+  for (const std::string& content : contents) { whole += content; }
+  for (const int32_t thread_num : {0, 1, 3}) {
+    for (const uint64_t block_size : {1, 7, 4096}) {
+      SetIOConf(thread_num, block_size);
+      for (const uint64_t offset : {0, 999, 1000, 1001, 5430}) {
+        const std::string expected = whole.substr(offset);
+        PersistentInStream acyclic(&file_system, file_paths, offset, false, false);
+        ASSERT_EQ(ReadAll(&acyclic, 1, whole.size()), expected);
+        char c;
+        ASSERT_EQ(acyclic.ReadFully(&c, 1), -1);
+        // whole files, then the files before the offset again
+        PersistentInStream cyclic(&file_system, file_paths, offset, true, false);
+        const std::string twice = expected + whole + whole.substr(0, offset);
+        ASSERT_EQ(ReadAll(&cyclic, 3, twice.size()), twice.substr(0, twice.size() / 3 * 3));
+      }
+      PersistentInStream in_stream(&file_system, file_paths, false, false);
+      ASSERT_EQ(ReadAll(&in_stream, 64, whole.size()), whole.substr(0, whole.size() / 64 * 64));
+      const ReadAheadStats stats = in_stream.read_ahead_stats();
+      if (thread_num == 0) {
+        ASSERT_EQ(stats.bytes_read, 0);
+      } else {
+        ASSERT_GE(stats.bytes_read, whole.size() / 64 * 64);
+        ASSERT_LE(stats.stall_s, stats.elapsed_s);
+      }
+    }
+  }
+  // lines across blocks
+  const std::vector<std::string> line_file_paths = WriteFiles(&file_system, {"ab\ncd", "e\n\nf"});
+  for (const int32_t thread_num : {0, 2}) {
+    SetIOConf(thread_num, 2);
+    PersistentInStream in_stream(&file_system, line_file_paths, false, false);
+    std::vector<std::string> lines;
+    std::string line;
+    while (in_stream.ReadLine(&line) == 0) { lines.push_back(line); }
+    ASSERT_EQ(lines, std::vector<std::string>({"ab", "cde", "", "f"}));
+  }
+  Global<const IOConf>::Delete();
+  for (const std::string& file_path : file_paths) { file_system.DelFile(file_path); }
+}
+
+#endif  // OF_PLATFORM_POSIX
+
+}  // namespace oneflow
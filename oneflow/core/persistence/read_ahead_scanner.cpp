@@ -0,0 +1,153 @@
+/*
+Copyright 2020 The OneFlow Authors. All rights reserved.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+*/
+#include "oneflow/core/persistence/read_ahead_scanner.h"
+
+namespace oneflow {
+
+ReadAheadScanner::ReadAheadScanner(fs::FileSystem* fs, const std::vector<std::string>& file_paths,
+                                   uint64_t offset, bool cyclic, size_t block_size,
+                                   int32_t thread_num)
+    : cyclic_(cyclic),
+      block_size_(block_size),
+      next_read_(0),
+      next_consume_(0),
+      holding_(false),
+      closed_(false),
+      bytes_read_(0),
+      stall_s_(0),
+      start_(std::chrono::steady_clock::now()) {
+  CHECK_GT(block_size, 0);
+  CHECK_GT(thread_num, 0);
+  uint64_t whole_file_size = 0;
+  for (const std::string& file_path : file_paths) {
+    files_.emplace_back();
+    fs->NewRandomAccessFile(file_path, &files_.back());
+    file_sizes_.push_back(fs->GetFileSize(file_path));
+    whole_file_size += file_sizes_.back();
+  }
+  CHECK_LE(offset, whole_file_size);
+  if (cyclic && whole_file_size > 0) { offset %= whole_file_size; }
+  plan_file_idx_ = 0;
+  plan_offset_ = offset;
+  while (plan_file_idx_ < files_.size() && plan_offset_ >= file_sizes_.at(plan_file_idx_)) {
+    plan_offset_ -= file_sizes_.at(plan_file_idx_);
+    plan_file_idx_ += 1;
+  }
+  if (cyclic && whole_file_size > 0) {
+    block_num_ = -1;
+  } else {
+    block_num_ = 0;
+    FOR_RANGE(int64_t, i, plan_file_idx_, files_.size()) {
+      const uint64_t size = file_sizes_.at(i) - (i == plan_file_idx_ ? plan_offset_ : 0);
+      block_num_ += RoundUp(size, block_size) / block_size;
+    }
+  }
+  blocks_.resize(2 * thread_num);
+  for (Block& block : blocks_) {
+    block.data.resize(block_size + 1);
+    block.size = 0;
+    block.seq = -1;
+  }
+  FOR_RANGE(int32_t, i, 0, thread_num) { threads_.emplace_back([this]() { ReadLoop(); }); }
+}
+
+ReadAheadScanner::~ReadAheadScanner() {
+  {
+    std::unique_lock<std::mutex> lock(mutex_);
+    closed_ = true;
+  }
+  cond_.notify_all();
+  for (std::thread& thread : threads_) { thread.join(); }
+}
+
+bool ReadAheadScanner::IsEof() const {
+  std::unique_lock<std::mutex> lock(mutex_);
+  return next_consume_ == block_num_;
+}
+
+size_t ReadAheadScanner::Next(char** data) {
+  std::unique_lock<std::mutex> lock(mutex_);
+  if (holding_) {
+    holding_ = false;
+    cond_.notify_all();
+  }
+  if (next_consume_ == block_num_) { return 0; }
+  const Block& block = blocks_.at(next_consume_ % blocks_.size());
+  if (block.seq != next_consume_) {
+    const auto start = std::chrono::steady_clock::now();
+    cond_.wait(lock, [&]() { return block.seq == next_consume_; });
+    stall_s_ += std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+  }
+  next_consume_ += 1;
+  holding_ = true;
+  *data = const_cast<char*>(block.data.data());
+  return block.size;
+}
+
+ReadAheadStats ReadAheadScanner::stats() const {
+  std::unique_lock<std::mutex> lock(mutex_);
+  ReadAheadStats stats;
+  stats.bytes_read = bytes_read_;
+  stats.elapsed_s =
+      std::chrono::duration<double>(std::chrono::steady_clock::now() - start_).count();
+  stats.stall_s = stall_s_;
+  return stats;
+}
+
+void ReadAheadScanner::ReadLoop() {
+  std::unique_lock<std::mutex> lock(mutex_);
+  while (true) {
+    // the block of next_read_ shares its buffer with the one blocks_.size() before it
+    cond_.wait(lock, [this]() {
+      return closed_ || next_read_ == block_num_
+             || next_read_ < ReleasedNum() + static_cast<int64_t>(blocks_.size());
+    });
+    if (closed_ || next_read_ == block_num_) { return; }
+    const int64_t seq = next_read_;
+    next_read_ += 1;
+    Block* block = &blocks_.at(seq % blocks_.size());
+    int64_t file_idx = 0;
+    uint64_t offset = 0;
+    size_t size = 0;
+    PlanBlock(&file_idx, &offset, &size);
+    lock.unlock();
+    files_.at(file_idx)->Read(offset, size, block->data.data());
+    lock.lock();
+    block->size = size;
+    block->seq = seq;
+    bytes_read_ += size;
+    cond_.notify_all();
+  }
+}
+
+void ReadAheadScanner::PlanBlock(int64_t* file_idx, uint64_t* offset, size_t* size) {
+  // skips the ends of files, and empty files
+  while (plan_file_idx_ == files_.size() || plan_offset_ == file_sizes_.at(plan_file_idx_)) {
+    if (plan_file_idx_ == files_.size()) {
+      CHECK(cyclic_);
+      plan_file_idx_ = 0;
+    } else {
+      plan_file_idx_ += 1;
+    }
+    plan_offset_ = 0;
+  }
+  *file_idx = plan_file_idx_;
+  *offset = plan_offset_;
+  *size = std::min<uint64_t>(block_size_, file_sizes_.at(plan_file_idx_) - plan_offset_);
+  plan_offset_ += *size;
+}
+
+}  // namespace oneflow
@@ -0,0 +1,92 @@
+/*
+Copyright 2020 The OneFlow Authors. All rights reserved.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+*/
+#ifndef ONEFLOW_CORE_PERSISTENCE_READ_AHEAD_SCANNER_H_
+#define ONEFLOW_CORE_PERSISTENCE_READ_AHEAD_SCANNER_H_
+
+#include <chrono>
+#include <condition_variable>
+#include <mutex>
+#include <thread>
+#include "oneflow/core/persistence/file_system.h"
+
+namespace oneflow {
+
+struct ReadAheadStats {
+  uint64_t bytes_read;
+  // since the scanner was created
+  double elapsed_s;
+  // spent by the consumer waiting for blocks still being read
+  double stall_s;
+};
+
+// Scans a sequence of files as StreamScanner does, in blocks of block_size which thread_num
+// threads read ahead with positional reads, at most two blocks per thread. Next hands the blocks
+// out in file order whichever thread read them, so only the waiting on the file system moves off
+// the consumer's thread and the bytes it sees stay the same.
+class ReadAheadScanner final {
+ public:
+  OF_DISALLOW_COPY_AND_MOVE(ReadAheadScanner);
+  ReadAheadScanner(fs::FileSystem* fs, const std::vector<std::string>& file_paths,
+                   uint64_t offset, bool cyclic, size_t block_size, int32_t thread_num);
+  ~ReadAheadScanner();
+
+  bool IsEof() const;
+  // the next block, valid until the following call and followed by one writable byte
+  // 0: eof
+  size_t Next(char** data);
+
+  ReadAheadStats stats() const;
+
+ private:
+  struct Block {
+    std::vector<char> data;
+    size_t size;
+    // the position of the block in the scan once it is read, -1 before
+    int64_t seq;
+  };
+
+  void ReadLoop();
+  // the range of the block after the last planned one
+  void PlanBlock(int64_t* file_idx, uint64_t* offset, size_t* size);
+  int64_t ReleasedNum() const { return next_consume_ - (holding_ ? 1 : 0); }
+
+  std::vector<std::unique_ptr<fs::RandomAccessFile>> files_;
+  std::vector<uint64_t> file_sizes_;
+  bool cyclic_;
+  size_t block_size_;
+  // -1 when cyclic
+  int64_t block_num_;
+  int64_t plan_file_idx_;
+  uint64_t plan_offset_;
+  int64_t next_read_;
+  int64_t next_consume_;
+  // whether the consumer still uses block next_consume_ - 1
+  bool holding_;
+  bool closed_;
+  std::vector<Block> blocks_;
+
+  uint64_t bytes_read_;
+  double stall_s_;
+  std::chrono::steady_clock::time_point start_;
+
+  mutable std::mutex mutex_;
+  std::condition_variable cond_;
+  std::vector<std::thread> threads_;
+};
+
+}  // namespace oneflow
+
+#endif  // ONEFLOW_CORE_PERSISTENCE_READ_AHEAD_SCANNER_H_
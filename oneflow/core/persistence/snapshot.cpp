@@ -14,7 +14,9 @@ See the License for the specific language governing permissions and
 limitations under the License.
 */
 #include "oneflow/core/persistence/snapshot.h"
+#include "oneflow/core/common/protobuf.h"
 #include "oneflow/core/common/str_util.h"
+#include "oneflow/core/persistence/async_snapshot_writer.h"
 #include "oneflow/core/persistence/persistent_in_stream.h"
 #include "oneflow/core/persistence/persistent_out_stream.h"
 #include "oneflow/core/register/tensor_slice_copier.h"
@@ -24,18 +26,56 @@ namespace oneflow {
 
 namespace {
 
+// A key is either one data file of its logical blob, or a directory of shards. Each shard is a data
+// file of a slice of the logical blob, written by one rank, and an index of that slice.
+constexpr char kShardDirSuffix[] = "-shards";
+constexpr char kShardIndexSuffix[] = ".index";
+
 std::string GenDataFilePath(const std::string& root, const std::string& key) {
   return JoinPath(root, key);
 }
 
+std::string GenShardDirPath(const std::string& root, const std::string& key) {
+  return JoinPath(root, key + kShardDirSuffix);
+}
+
+struct SnapshotShard {
+  std::string data_path;
+  TensorSliceView slice;
+};
+
+std::vector<SnapshotShard> ListShards(const std::string& root, const std::string& key,
+                                      const Shape& logical_blob_shape) {
+  const std::string path = GenDataFilePath(root, key);
+  if (SnapshotFS()->FileExists(path)) { return {{path, TensorSliceView(logical_blob_shape)}}; }
+  const std::string shard_dir = GenShardDirPath(root, key);
+  CHECK(SnapshotFS()->FileExists(shard_dir)) << "model snapshot not found, path: " << path;
+  const std::string index_suffix = kShardIndexSuffix;
+  std::vector<SnapshotShard> shards;
+  for (const std::string& name : SnapshotFS()->ListDir(shard_dir)) {
+    const size_t suffix_pos = name.size() - index_suffix.size();
+    if (name.size() <= index_suffix.size() || name.substr(suffix_pos) != index_suffix) { continue; }
+    const std::string index_path = JoinPath(shard_dir, name);
+    std::vector<char> index(SnapshotFS()->GetFileSize(index_path));
+    PersistentInStream in_stream(SnapshotFS(), index_path);
+    in_stream.ReadFully(index.data(), index.size());
+    TensorSliceViewProto slice_proto;
+    CHECK(TxtString2PbMessage(std::string(index.begin(), index.end()), &slice_proto))
+        << "bad model snapshot index, path: " << index_path;
+    shards.push_back(
+        {JoinPath(shard_dir, name.substr(0, suffix_pos)), TensorSliceView(slice_proto)});
+  }
+  return shards;
+}
+
 }  // namespace
 
 SnapshotReader::SnapshotReader(const std::string& snapshot_root_path)
     : root_path_(snapshot_root_path) {}
 
 bool SnapshotReader::HasKey(const std::string& key) const {
-  const std::string path = GenDataFilePath(root_path_, key);
-  return SnapshotFS()->FileExists(path);
+  return SnapshotFS()->FileExists(GenDataFilePath(root_path_, key))
+         || SnapshotFS()->FileExists(GenShardDirPath(root_path_, key));
 }
 
 void SnapshotReader::Read(const std::string& key, Blob* blob) const {
@@ -48,24 +88,47 @@ void SnapshotReader::Read(const std::string& key, const Shape& logical_blob_shap
                           DataType data_type, const TensorSliceView& slice, char* dst) const {
   const TensorSliceView logical_blob_slice(logical_blob_shape);
   CHECK(logical_blob_slice.Contains(slice));
-  const std::string path = GenDataFilePath(root_path_, key);
-  const int64_t logical_blob_size = logical_blob_shape.elem_cnt() * GetSizeOfDataType(data_type);
-  CHECK_EQ(SnapshotFS()->GetFileSize(path), logical_blob_size)
-      << "unexpected model snapshot size, path: " << path;
-  if (slice.shape().Count(1) == logical_blob_shape.Count(1)) {
-    PersistentInStream in_stream(
-        SnapshotFS(), path,
-        slice.At(0).begin() * slice.shape().Count(1) * GetSizeOfDataType(data_type));
-    in_stream.ReadFully(dst, slice.shape().elem_cnt() * GetSizeOfDataType(data_type));
-  } else {
-    std::vector<char> buffer(logical_blob_size);
-    PersistentInStream in_stream(SnapshotFS(), path);
-    in_stream.ReadFully(buffer.data(), logical_blob_size);
-    TensorSliceCopier copier(slice, logical_blob_slice, data_type);
-    CpuDeviceCtx device_ctx;
-    std::unique_ptr<MemoryCopier> host_memory_copier(NewDefaultMemoryCopier(DeviceType::kCPU));
-    copier.Copy(&device_ctx, *host_memory_copier, dst, buffer.data());
+  const int64_t size_of_data_type = GetSizeOfDataType(data_type);
+  CpuDeviceCtx device_ctx;
+  std::unique_ptr<MemoryCopier> host_memory_copier(NewDefaultMemoryCopier(DeviceType::kCPU));
+  std::vector<char> buffer;
+  int64_t elem_cnt = 0;
+  const std::vector<SnapshotShard> shards = ListShards(root_path_, key, logical_blob_shape);
+  FOR_RANGE(size_t, i, 0, shards.size()) {
+    const SnapshotShard& shard = shards.at(i);
+    CHECK(logical_blob_slice.Contains(shard.slice))
+        << "model snapshot shard out of its logical blob, path: " << shard.data_path;
+    // disjoint shards, so that the element count below only matches with the slice covered
+    FOR_RANGE(size_t, j, 0, i) {
+      CHECK(shards.at(j).slice.Intersect(shard.slice).IsEmpty())
+          << "model snapshot shards overlap, paths: " << shards.at(j).data_path << ", "
+          << shard.data_path;
+    }
+    CHECK_EQ(SnapshotFS()->GetFileSize(shard.data_path),
+             shard.slice.shape().elem_cnt() * size_of_data_type)
+        << "unexpected model snapshot size, path: " << shard.data_path;
+    const TensorSliceView intersection = shard.slice.Intersect(slice);
+    if (intersection.IsEmpty()) { continue; }
+    elem_cnt += intersection.shape().elem_cnt();
+    // the rows of the shard along the first axis which the intersection is in, contiguous in its
+    // data file
+    std::vector<Range> rows_range_vec = shard.slice.range_vec();
+    rows_range_vec.front() = intersection.At(0);
+    const TensorSliceView rows(rows_range_vec);
+    const int64_t row_size = shard.slice.shape().Count(1) * size_of_data_type;
+    PersistentInStream in_stream(SnapshotFS(), shard.data_path,
+                                 (rows.At(0).begin() - shard.slice.At(0).begin()) * row_size);
+    if (rows == slice) {
+      in_stream.ReadFully(dst, rows.shape().elem_cnt() * size_of_data_type);
+    } else {
+      buffer.resize(rows.shape().elem_cnt() * size_of_data_type);
+      in_stream.ReadFully(buffer.data(), buffer.size());
+      TensorSliceCopier copier(slice, rows, intersection, data_type);
+      copier.Copy(&device_ctx, *host_memory_copier, dst, buffer.data());
+    }
   }
+  CHECK_EQ(elem_cnt, slice.shape().elem_cnt())
+      << "model snapshot shards do not cover the slice exactly, key: " << key;
 }
 
 void SnapshotReader::Read(const std::string& key, const Shape& logical_blob_shape,
@@ -95,16 +158,75 @@ void SnapshotWriter::Write(const std::string& key, const char* data, size_t size
   const std::string dir_path = Dirname(path);
   SnapshotFS()->CreateDirIfNotExist(dir_path);
   CHECK(!SnapshotFS()->FileExists(path));
-  PersistentOutStream out_stream(SnapshotFS(), path);
-  out_stream.Write(data, size);
+  WriteFile(path, data, size);
 }
 
 void SnapshotWriter::Write(const std::string& key, const Blob* blob) {
   Write(key, blob->dptr<char>(), blob->ByteSizeOfBlobBody());
 }
 
+void SnapshotWriter::WriteShard(const std::string& key, int64_t shard_id, int64_t shard_num,
+                                const TensorSliceView& slice, const char* data, size_t size) {
+  CHECK_GE(shard_id, 0);
+  CHECK_LT(shard_id, shard_num);
+  const std::string shard_dir = GenShardDirPath(root_path_, key);
+  OfCallOnce("SnapshotWriteCreateShardDir-" + shard_dir,
+             [&]() { SnapshotFS()->RecursivelyCreateDirIfNotExist(shard_dir); });
+  // Saved again to the same root, each shard is overwritten by its rank, and shard 0 deletes the
+  // shards an earlier save with more ranks left behind.
+  if (shard_id == 0) { DeleteShardsFrom(shard_dir, shard_num); }
+  const std::string data_path = JoinPath(shard_dir, std::to_string(shard_id));
+  const std::string index_path = data_path + kShardIndexSuffix;
+  TensorSliceViewProto slice_proto;
+  slice.ToProto(&slice_proto);
+  const std::string index = PbMessage2TxtString(slice_proto);
+  // the index after the data, in the same work of the AsyncSnapshotWriter, so that a shard with an
+  // index is complete
+  if (Global<AsyncSnapshotWriter>::Get() != nullptr) {
+    Global<AsyncSnapshotWriter>::Get()->Write(root_path_, {data_path, index_path},
+                                              {std::string(data, size), index});
+  } else {
+    WriteFile(data_path, data, size);
+    WriteFile(index_path, index.data(), index.size());
+  }
+}
+
+void SnapshotWriter::WriteShard(const std::string& key, int64_t shard_id, int64_t shard_num,
+                                const TensorSliceView& slice, const Blob* blob) {
+  CHECK_EQ(ShapeView(slice.shape()), blob->shape());
+  WriteShard(key, shard_id, shard_num, slice, blob->dptr<char>(), blob->ByteSizeOfBlobBody());
+}
+
 void SnapshotWriter::Close() {
-  PersistentOutStream out_stream(SnapshotFS(), JoinPath(root_path_, "snapshot_done"));
+  if (Global<AsyncSnapshotWriter>::Get() != nullptr) {
+    Global<AsyncSnapshotWriter>::Get()->AsyncMarkDone(root_path_);
+  } else {
+    PersistentOutStream out_stream(SnapshotFS(), JoinPath(root_path_, "snapshot_done"));
+  }
+}
+
+void SnapshotWriter::DeleteShardsFrom(const std::string& shard_dir, int64_t shard_id_begin) {
+  // the files an earlier save still writes in the background land before they are deleted
+  if (Global<AsyncSnapshotWriter>::Get() != nullptr) {
+    Global<AsyncSnapshotWriter>::Get()->WaitUntilDone();
+  }
+  for (const std::string& name : SnapshotFS()->ListDir(shard_dir)) {
+    // the data file and the index of a shard are named by its id
+    const std::string id = name.substr(0, name.find('.'));
+    if (id.empty() || id.find_first_not_of("0123456789") != std::string::npos) { continue; }
+    if (oneflow_cast<int64_t>(id) >= shard_id_begin) {
+      SnapshotFS()->DelFile(JoinPath(shard_dir, name));
+    }
+  }
+}
+
+void SnapshotWriter::WriteFile(const std::string& path, const char* data, size_t size) {
+  if (Global<AsyncSnapshotWriter>::Get() != nullptr) {
+    Global<AsyncSnapshotWriter>::Get()->Write(root_path_, path, data, size);
+  } else {
+    PersistentOutStream out_stream(SnapshotFS(), path);
+    out_stream.Write(data, size);
+  }
 }
 
 }  // namespace oneflow
@@ -52,9 +52,23 @@ class SnapshotWriter final {
 
   void Write(const std::string& key, const char* data, size_t size);
   void Write(const std::string& key, const Blob* blob);
+  // Writes blob as shard shard_id of the shard_num ones of key, the part at slice of the logical
+  // blob. Each rank writes the shard of its part, which SnapshotReader reads any slice from
+  // without merging them.
+  void WriteShard(const std::string& key, int64_t shard_id, int64_t shard_num,
+                  const TensorSliceView& slice, const char* data, size_t size);
+  void WriteShard(const std::string& key, int64_t shard_id, int64_t shard_num,
+                  const TensorSliceView& slice, const Blob* blob);
+  // Writes snapshot_done, with the async checkpoint in the background once the files written to
+  // the snapshot have landed.
   void Close();
 
  private:
+  // deletes the shards in shard_dir with an id of shard_id_begin or more
+  void DeleteShardsFrom(const std::string& shard_dir, int64_t shard_id_begin);
+  // on the AsyncSnapshotWriter when there is one
+  void WriteFile(const std::string& path, const char* data, size_t size);
+
   const std::string root_path_;
 };
 
@@ -0,0 +1,144 @@
+/*
+Copyright 2020 The OneFlow Authors. All rights reserved.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+*/
+#include <gtest/gtest.h>
+#include "oneflow/core/persistence/async_snapshot_writer.h"
+#include "oneflow/core/persistence/snapshot.h"
+#include "oneflow/core/persistence/snapshot_test_util.h"
+
+#ifdef OF_PLATFORM_POSIX
+
+namespace oneflow {
+
+namespace {
+
+using test::SetUpSnapshotTest;
+using test::TearDownSnapshotTest;
+
+// 0, 1, 2, ... in the row major order of shape
+std::vector<float> Iota(const Shape& shape) {
+  std::vector<float> data(shape.elem_cnt());
+  std::iota(data.begin(), data.end(), 0.0f);
+  return data;
+}
+
+// the elements of data, a logical blob of shape, at slice
+std::vector<float> SliceOf(const std::vector<float>& data, const Shape& shape,
+                           const TensorSliceView& slice) {
+  CHECK_EQ(shape.NumAxes(), 2);
+  std::vector<float> ret;
+  FOR_RANGE(int64_t, i, slice.At(0).begin(), slice.At(0).end()) {
+    FOR_RANGE(int64_t, j, slice.At(1).begin(), slice.At(1).end()) {
+      ret.push_back(data.at(i * shape.At(1) + j));
+    }
+  }
+  return ret;
+}
+
+void WriteShards(const std::string& root, const std::string& key, const std::vector<float>& data,
+                 const Shape& shape, const std::vector<TensorSliceView>& shard_slices) {
+  SnapshotWriter writer(root);
+  FOR_RANGE(int64_t, i, 0, shard_slices.size()) {
+    const std::vector<float> shard = SliceOf(data, shape, shard_slices.at(i));
+    writer.WriteShard(key, i, shard_slices.size(), shard_slices.at(i),
+                      reinterpret_cast<const char*>(shard.data()), shard.size() * sizeof(float));
+  }
+}
+
+std::vector<float> Read(const std::string& root, const std::string& key, const Shape& shape,
+                        const TensorSliceView& slice) {
+  std::vector<float> ret(slice.shape().elem_cnt());
+  SnapshotReader(root).Read(key, shape, DataType::kFloat, slice,
+                            reinterpret_cast<char*>(ret.data()));
+  return ret;
+}
+
+}  // namespace
+
+TEST(Snapshot, read_slices_of_shards) {
+  const std::string root = SetUpSnapshotTest("read_slices_of_shards");
+  const Shape shape({6, 4});
+  const std::vector<float> data = Iota(shape);
+  // split along the first axis as ModelSaveV2 does, and along the second one
+  WriteShards(root, "rows", data, shape, {{{0, 2}, {0, 4}}, {{2, 5}, {0, 4}}, {{5, 6}, {0, 4}}});
+  WriteShards(root, "cols", data, shape, {{{0, 6}, {0, 1}}, {{0, 6}, {1, 4}}});
+  // and as one data file
+  SnapshotWriter(root).Write("whole", reinterpret_cast<const char*>(data.data()),
+                             data.size() * sizeof(float));
+  SnapshotReader reader(root);
+  for (const std::string& key : {"rows", "cols", "whole"}) {
+    ASSERT_TRUE(reader.HasKey(key));
+    // the whole blob, rows across shards, a block across shards, the rows of one shard and a
+    // block in one shard
+    for (const TensorSliceView& slice :
+         std::vector<TensorSliceView>{TensorSliceView(shape),
+                                      {{1, 6}, {0, 4}},
+                                      {{1, 4}, {1, 3}},
+                                      {{2, 5}, {0, 4}},
+                                      {{3, 4}, {2, 4}}}) {
+      ASSERT_EQ(Read(root, key, shape, slice), SliceOf(data, shape, slice)) << key;
+    }
+  }
+  ASSERT_FALSE(reader.HasKey("missing"));
+  TearDownSnapshotTest(root);
+}
+
+TEST(Snapshot, shards_not_covering_the_slice_exactly) {
+  const std::string root = SetUpSnapshotTest("shards_not_covering_the_slice_exactly");
+  const Shape shape({6, 4});
+  const std::vector<float> data = Iota(shape);
+  WriteShards(root, "uncovered", data, shape, {{{0, 2}, {0, 4}}, {{3, 6}, {0, 4}}});
+  // an overlap and a gap of the same size, with as many elements as the blob
+  WriteShards(root, "overlapping", data, shape, {{{0, 3}, {0, 4}}, {{2, 5}, {0, 4}}});
+  ASSERT_DEATH(Read(root, "uncovered", shape, TensorSliceView(shape)), "do not cover the slice");
+  ASSERT_DEATH(Read(root, "overlapping", shape, TensorSliceView(shape)), "shards overlap");
+  // slices away from the gap still read
+  const TensorSliceView head({{0, 2}, {0, 4}});
+  ASSERT_EQ(Read(root, "uncovered", shape, head), SliceOf(data, shape, head));
+  TearDownSnapshotTest(root);
+}
+
+TEST(Snapshot, save_again_with_fewer_shards) {
+  const std::string root = SetUpSnapshotTest("save_again_with_fewer_shards");
+  const Shape shape({6, 4});
+  const std::vector<float> data = Iota(shape);
+  WriteShards(root, "var", data, shape,
+              {{{0, 2}, {0, 4}}, {{2, 3}, {0, 4}}, {{3, 5}, {0, 4}}, {{5, 6}, {0, 4}}});
+  // saved again to the same root, with other values and fewer ranks
+  std::vector<float> new_data(data.size());
+  std::transform(data.begin(), data.end(), new_data.begin(), [](float x) { return -x; });
+  WriteShards(root, "var", new_data, shape, {{{0, 3}, {0, 4}}, {{3, 6}, {0, 4}}});
+  ASSERT_EQ(SnapshotFS()->ListDir(JoinPath(root, "var-shards")).size(), 4);
+  ASSERT_EQ(Read(root, "var", shape, TensorSliceView(shape)), new_data);
+  TearDownSnapshotTest(root);
+}
+
+TEST(Snapshot, write_shards_asynchronously) {
+  const std::string root = SetUpSnapshotTest("write_shards_asynchronously");
+  Global<AsyncSnapshotWriter>::New(2, 64);
+  const Shape shape({6, 4});
+  const std::vector<float> data = Iota(shape);
+  WriteShards(root, "var", data, shape, {{{0, 3}, {0, 4}}, {{3, 6}, {0, 4}}});
+  Global<AsyncSnapshotWriter>::Get()->WaitUntilDone();
+  // the data and the index of each shard
+  ASSERT_EQ(SnapshotFS()->ListDir(JoinPath(root, "var-shards")).size(), 4);
+  ASSERT_EQ(Read(root, "var", shape, TensorSliceView(shape)), data);
+  Global<AsyncSnapshotWriter>::Delete();
+  TearDownSnapshotTest(root);
+}
+
+}  // namespace oneflow
+
+#endif  // OF_PLATFORM_POSIX
@@ -0,0 +1,80 @@
+/*
+Copyright 2020 The OneFlow Authors. All rights reserved.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+*/
+#ifndef ONEFLOW_CORE_PERSISTENCE_SNAPSHOT_TEST_UTIL_H_
+#define ONEFLOW_CORE_PERSISTENCE_SNAPSHOT_TEST_UTIL_H_
+
+#include "oneflow/core/common/process_state.h"
+#include "oneflow/core/common/str_util.h"
+#include "oneflow/core/control/ctrl_client.h"
+#include "oneflow/core/control/ctrl_server.h"
+#include "oneflow/core/control/ctrl_util.h"
+#include "oneflow/core/job/env_desc.h"
+#include "oneflow/core/job/global_for.h"
+#include "oneflow/core/job/job_set.pb.h"
+#include "oneflow/core/job/machine_context.h"
+#include "oneflow/core/job/resource_desc.h"
+#include "oneflow/core/persistence/file_system.h"
+
+namespace oneflow {
+
+namespace test {
+
+// The globals the snapshot tests need: the control plane of one machine, which SnapshotWriter
+// creates the directories once through and AsyncSnapshotWriter counts the pending writes with,
+// and the local file system as the snapshot one. Returns the path of a snapshot root of name
+// under the current directory, which does not exist.
+inline std::string SetUpSnapshotTest(const std::string& name) {
+  EnvProto env_proto;
+  auto* machine = env_proto.add_machine();
+  machine->set_id(0);
+  machine->set_addr("127.0.0.1");
+  env_proto.set_ctrl_port(CtrlUtil().FindAvailablePort());
+  Global<EnvDesc>::New(env_proto);
+  Global<CtrlServer>::New();
+  Global<CtrlClient>::New();
+  Global<MachineCtx>::New(0);
+  Resource resource;
+  resource.set_machine_num(1);
+  resource.set_cpu_device_num(1);
+  Global<ResourceDesc, ForSession>::New(resource);
+  IOConf* io_conf = new IOConf();
+  io_conf->mutable_data_fs_conf()->mutable_localfs_conf();
+  io_conf->mutable_snapshot_fs_conf()->mutable_localfs_conf();
+  Global<const IOConf>::Delete();
+  Global<const IOConf>::SetAllocated(io_conf);
+  std::string current_dir = GetCwd();
+  StringReplace(&current_dir, '\\', '/');
+  const std::string root = JoinPath(current_dir, "tmp_snapshot_test_" + name);
+  if (SnapshotFS()->FileExists(root)) { SnapshotFS()->RecursivelyDeleteDir(root); }
+  return root;
+}
+
+// deletes the snapshot root and the globals of SetUpSnapshotTest
+inline void TearDownSnapshotTest(const std::string& root) {
+  if (SnapshotFS()->FileExists(root)) { SnapshotFS()->RecursivelyDeleteDir(root); }
+  Global<const IOConf>::Delete();
+  Global<ResourceDesc, ForSession>::Delete();
+  Global<MachineCtx>::Delete();
+  Global<CtrlClient>::Delete();
+  Global<CtrlServer>::Delete();
+  Global<EnvDesc>::Delete();
+}
+
+}  // namespace test
+
+}  // namespace oneflow
+
+#endif  // ONEFLOW_CORE_PERSISTENCE_SNAPSHOT_TEST_UTIL_H_
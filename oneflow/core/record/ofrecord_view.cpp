@@ -0,0 +1,309 @@
+/*
+Copyright 2020 The OneFlow Authors. All rights reserved.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+*/
+#include "oneflow/core/record/ofrecord_view.h"
+#include "oneflow/core/common/data_type.h"
+
+namespace oneflow {
+
+namespace {
+
+enum WireType : uint32_t {
+  kVarint = 0,
+  kFixed64 = 1,
+  kLengthDelimited = 2,
+  kFixed32 = 5,
+};
+
+// Reads the fields of a message. Each method returns false on malformed input.
+class WireReader final {
+ public:
+  WireReader(const char* data, size_t size) : ptr_(data), end_(data + size) {}
+  ~WireReader() = default;
+
+  bool done() const { return ptr_ == end_; }
+
+  bool ReadVarint(uint64_t* value) {
+    uint64_t result = 0;
+    for (int32_t shift = 0; shift < 64 && ptr_ < end_; shift += 7) {
+      const uint8_t byte = static_cast<uint8_t>(*ptr_++);
+      result |= static_cast<uint64_t>(byte & 0x7f) << shift;
+      if ((byte & 0x80) == 0) {
+        *value = result;
+        return true;
+      }
+    }
+    return false;
+  }
+
+  bool ReadTag(uint32_t* field, uint32_t* wire_type) {
+    uint64_t tag;
+    if (!ReadVarint(&tag)) { return false; }
+    *field = static_cast<uint32_t>(tag >> 3);
+    *wire_type = static_cast<uint32_t>(tag & 7);
+    return *field != 0;
+  }
+
+  bool ReadLengthDelimited(const char** data, size_t* size) {
+    uint64_t length;
+    if (!ReadVarint(&length) || length > static_cast<uint64_t>(end_ - ptr_)) { return false; }
+    *data = ptr_;
+    *size = length;
+    ptr_ += length;
+    return true;
+  }
+
+  template<typename T>
+  bool ReadFixed(T* value) {
+    if (end_ - ptr_ < static_cast<ptrdiff_t>(sizeof(T))) { return false; }
+    std::memcpy(value, ptr_, sizeof(T));
+    ptr_ += sizeof(T);
+    return true;
+  }
+
+  bool Skip(uint32_t wire_type) {
+    uint64_t varint;
+    const char* data;
+    size_t size;
+    switch (wire_type) {
+      case kVarint: return ReadVarint(&varint);
+      case kFixed64: return ReadFixed(&varint);
+      case kLengthDelimited: return ReadLengthDelimited(&data, &size);
+      case kFixed32: return ReadFixed(reinterpret_cast<uint32_t*>(&varint));
+      // groups are not used by record.proto
+      default: return false;
+    }
+  }
+
+ private:
+  const char* ptr_;
+  const char* end_;
+};
+
+// how the values of a FloatList, DoubleList, Int32List and Int64List are written
+template<typename T>
+uint32_t ValueWireType();
+template<>
+uint32_t ValueWireType<float>() {
+  return kFixed32;
+}
+template<>
+uint32_t ValueWireType<double>() {
+  return kFixed64;
+}
+template<>
+uint32_t ValueWireType<int32_t>() {
+  return kVarint;
+}
+template<>
+uint32_t ValueWireType<int64_t>() {
+  return kVarint;
+}
+
+bool ReadValue(WireReader* reader, float* value) { return reader->ReadFixed(value); }
+bool ReadValue(WireReader* reader, double* value) { return reader->ReadFixed(value); }
+bool ReadValue(WireReader* reader, int32_t* value) {
+  uint64_t varint;
+  if (!reader->ReadVarint(&varint)) { return false; }
+  *value = static_cast<int32_t>(varint);
+  return true;
+}
+bool ReadValue(WireReader* reader, int64_t* value) {
+  uint64_t varint;
+  if (!reader->ReadVarint(&varint)) { return false; }
+  *value = static_cast<int64_t>(varint);
+  return true;
+}
+
+// Calls Fn on the values of a list message in order, until Fn returns false. Returns false on
+// malformed input.
+template<typename Src, typename F>
+bool ForEachValue(const char* data, size_t size, const F& Fn) {
+  WireReader reader(data, size);
+  while (!reader.done()) {
+    uint32_t field;
+    uint32_t wire_type;
+    if (!reader.ReadTag(&field, &wire_type)) { return false; }
+    if (field != 1) {
+      if (!reader.Skip(wire_type)) { return false; }
+    } else if (wire_type == kLengthDelimited) {
+      const char* run;
+      size_t run_size;
+      if (!reader.ReadLengthDelimited(&run, &run_size)) { return false; }
+      WireReader run_reader(run, run_size);
+      while (!run_reader.done()) {
+        Src value;
+        if (!ReadValue(&run_reader, &value)) { return false; }
+        if (!Fn(value)) { return true; }
+      }
+    } else if (wire_type == ValueWireType<Src>()) {
+      Src value;
+      if (!ReadValue(&reader, &value)) { return false; }
+      if (!Fn(value)) { return true; }
+    } else {
+      return false;
+    }
+  }
+  return true;
+}
+
+template<typename Src>
+int64_t CountValues(const char* data, size_t size) {
+  int64_t count = 0;
+  CHECK(ForEachValue<Src>(data, size, [&](Src) {
+    count += 1;
+    return true;
+  })) << "malformed OFRecord";
+  return count;
+}
+
+template<typename Src, typename T>
+void CopyValues(const char* data, size_t size, T* dst, int64_t num) {
+  int64_t count = 0;
+  CHECK(ForEachValue<Src>(data, size, [&](Src value) {
+    if (count == num) { return false; }
+    dst[count] = static_cast<T>(value);
+    count += 1;
+    return true;
+  })) << "malformed OFRecord";
+  CHECK_EQ(count, num);
+}
+
+}  // namespace
+
+bool OFRecordFeatureView::Init(const char* data, size_t size) {
+  kind_case_ = Feature::KIND_NOT_SET;
+  data_ = nullptr;
+  size_ = 0;
+  WireReader reader(data, size);
+  while (!reader.done()) {
+    uint32_t field;
+    uint32_t wire_type;
+    if (!reader.ReadTag(&field, &wire_type)) { return false; }
+    if (field >= Feature::kBytesList && field <= Feature::kInt64List
+        && wire_type == kLengthDelimited) {
+      // one list written in two parts has to be merged, which no writer of OFRecord does
+      if (field == kind_case_) { return false; }
+      kind_case_ = static_cast<Feature::KindCase>(field);
+      if (!reader.ReadLengthDelimited(&data_, &size_)) { return false; }
+    } else if (!reader.Skip(wire_type)) {
+      return false;
+    }
+  }
+  return true;
+}
+
+int64_t OFRecordFeatureView::value_size() const {
+  switch (kind_case_) {
+    case Feature::kBytesList: {
+      int64_t count = 0;
+      WireReader reader(data_, size_);
+      while (!reader.done()) {
+        uint32_t field;
+        uint32_t wire_type;
+        CHECK(reader.ReadTag(&field, &wire_type) && reader.Skip(wire_type)) << "malformed OFRecord";
+        if (field == 1 && wire_type == kLengthDelimited) { count += 1; }
+      }
+      return count;
+    }
+    case Feature::kFloatList: return CountValues<float>(data_, size_);
+    case Feature::kDoubleList: return CountValues<double>(data_, size_);
+    case Feature::kInt32List: return CountValues<int32_t>(data_, size_);
+    case Feature::kInt64List: return CountValues<int64_t>(data_, size_);
+    default: return 0;
+  }
+}
+
+void OFRecordFeatureView::bytes_value(int64_t index, const char** data, size_t* size) const {
+  CHECK(has_bytes_list());
+  WireReader reader(data_, size_);
+  while (!reader.done()) {
+    uint32_t field;
+    uint32_t wire_type;
+    CHECK(reader.ReadTag(&field, &wire_type)) << "malformed OFRecord";
+    if (field == 1 && wire_type == kLengthDelimited) {
+      CHECK(reader.ReadLengthDelimited(data, size)) << "malformed OFRecord";
+      if (index == 0) { return; }
+      index -= 1;
+    } else {
+      CHECK(reader.Skip(wire_type)) << "malformed OFRecord";
+    }
+  }
+  LOG(FATAL) << "bytes_list index out of range";
+}
+
+template<typename T>
+void OFRecordFeatureView::CopyValuesTo(T* dst, int64_t num) const {
+  switch (kind_case_) {
+    case Feature::kFloatList: CopyValues<float, T>(data_, size_, dst, num); break;
+    case Feature::kDoubleList: CopyValues<double, T>(data_, size_, dst, num); break;
+    case Feature::kInt32List: CopyValues<int32_t, T>(data_, size_, dst, num); break;
+    case Feature::kInt64List: CopyValues<int64_t, T>(data_, size_, dst, num); break;
+    default: UNIMPLEMENTED();
+  }
+}
+
+bool OFRecordView::Find(const std::string& name, OFRecordFeatureView* feature) const {
+  bool found = false;
+  const char* value = nullptr;
+  size_t value_size = 0;
+  WireReader reader(data_, size_);
+  while (!reader.done()) {
+    uint32_t field;
+    uint32_t wire_type;
+    CHECK(reader.ReadTag(&field, &wire_type)) << "malformed OFRecord";
+    if (field != 1 || wire_type != kLengthDelimited) {
+      CHECK(reader.Skip(wire_type)) << "malformed OFRecord";
+      continue;
+    }
+    const char* entry;
+    size_t entry_size;
+    CHECK(reader.ReadLengthDelimited(&entry, &entry_size)) << "malformed OFRecord";
+    // an entry of the feature map, with the name in field 1 and the Feature in field 2
+    const char* key = nullptr;
+    size_t key_size = 0;
+    const char* entry_value = nullptr;
+    size_t entry_value_size = 0;
+    WireReader entry_reader(entry, entry_size);
+    while (!entry_reader.done()) {
+      uint32_t entry_field;
+      uint32_t entry_wire_type;
+      CHECK(entry_reader.ReadTag(&entry_field, &entry_wire_type)) << "malformed OFRecord";
+      if (entry_field == 1 && entry_wire_type == kLengthDelimited) {
+        CHECK(entry_reader.ReadLengthDelimited(&key, &key_size)) << "malformed OFRecord";
+      } else if (entry_field == 2 && entry_wire_type == kLengthDelimited) {
+        CHECK(entry_reader.ReadLengthDelimited(&entry_value, &entry_value_size))
+            << "malformed OFRecord";
+      } else {
+        CHECK(entry_reader.Skip(entry_wire_type)) << "malformed OFRecord";
+      }
+    }
+    if (key_size == name.size()
+        && (key_size == 0 || std::memcmp(key, name.data(), key_size) == 0)) {
+      found = true;
+      value = entry_value;
+      value_size = entry_value_size;
+    }
+  }
+  if (found) { CHECK(feature->Init(value, value_size)) << "malformed OFRecord"; }
+  return found;
+}
+
+#define INSTANTIATE_OFRECORD_FEATURE_VIEW_COPY_VALUES_TO(type_cpp, type_proto) \
+  template void OFRecordFeatureView::CopyValuesTo<type_cpp>(type_cpp * dst, int64_t num) const;
+OF_PP_FOR_EACH_TUPLE(INSTANTIATE_OFRECORD_FEATURE_VIEW_COPY_VALUES_TO, POD_DATA_TYPE_SEQ);
+#undef INSTANTIATE_OFRECORD_FEATURE_VIEW_COPY_VALUES_TO
+
+}  // namespace oneflow
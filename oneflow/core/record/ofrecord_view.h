@@ -0,0 +1,70 @@
+/*
+Copyright 2020 The OneFlow Authors. All rights reserved.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+*/
+#ifndef ONEFLOW_CORE_RECORD_OFRECORD_VIEW_H_
+#define ONEFLOW_CORE_RECORD_OFRECORD_VIEW_H_
+
+#include "oneflow/core/common/util.h"
+#include "oneflow/core/record/record.pb.h"
+
+namespace oneflow {
+
+// A Feature inside a serialized OFRecord, read in place from the protobuf wire format instead of
+// being parsed into a message. Numeric lists may be packed or not, in any number of runs, as
+// protobuf accepts them.
+class OFRecordFeatureView final {
+ public:
+  OFRecordFeatureView() : kind_case_(Feature::KIND_NOT_SET), data_(nullptr), size_(0) {}
+  ~OFRecordFeatureView() = default;
+
+  // returns false when [data, data + size) is not a Feature this view can read
+  bool Init(const char* data, size_t size);
+
+  Feature::KindCase kind_case() const { return kind_case_; }
+  bool has_bytes_list() const { return kind_case_ == Feature::kBytesList; }
+  // the number of values of the list
+  int64_t value_size() const;
+  // the index-th value of the bytes_list
+  void bytes_value(int64_t index, const char** data, size_t* size) const;
+  // converts the first num values of a numeric list to T
+  template<typename T>
+  void CopyValuesTo(T* dst, int64_t num) const;
+
+ private:
+  Feature::KindCase kind_case_;
+  // the list message of the feature
+  const char* data_;
+  size_t size_;
+};
+
+// A serialized OFRecord. Find scans the features without copying or allocating, so decoding a
+// few features of a large record costs a walk over their names instead of a full parse.
+class OFRecordView final {
+ public:
+  OFRecordView(const char* data, size_t size) : data_(data), size_(size) {}
+  ~OFRecordView() = default;
+
+  // returns false when there is no feature name, and as in an OFRecord map the last of
+  // duplicated names wins
+  bool Find(const std::string& name, OFRecordFeatureView* feature) const;
+
+ private:
+  const char* data_;
+  size_t size_;
+};
+
+}  // namespace oneflow
+
+#endif  // ONEFLOW_CORE_RECORD_OFRECORD_VIEW_H_
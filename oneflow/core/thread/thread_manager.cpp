@@ -18,8 +18,6 @@ limitations under the License.
 #include "oneflow/core/job/global_for.h"
 #include "oneflow/core/thread/cpu_thread.h"
 #include "oneflow/core/thread/gpu_thread.h"
-#include "oneflow/core/common/balanced_splitter.h"
-#include "oneflow/core/common/blocking_counter.h"
 #include "oneflow/core/job/machine_context.h"
 #include "oneflow/core/job/global_for.h"
 
@@ -28,7 +26,7 @@ namespace oneflow {
 ThreadMgr::~ThreadMgr() {
   for (size_t i = 0; i < threads_.size(); ++i) {
     ActorMsg msg = ActorMsg::BuildCommandMsg(-1, ActorCmd::kStopThread);
-    threads_[i]->GetMsgChannelPtr()->Send(msg);
+    threads_[i]->EnqueueActorMsg(msg);
     delete threads_[i];
     LOG(INFO) << "actor thread " << i << " finish";
   }
@@ -71,17 +69,43 @@ void SingleThreadLoop(size_t num, std::function<void(size_t i)> Callback) {
 }
 
 void MultiThreadLoop(size_t num, std::function<void(size_t i)> Callback) {
-  size_t thread_num = Global<ThreadPool>::Get()->thread_num();
-  thread_num = std::min(num, thread_num);
-  BalancedSplitter bs(num, thread_num);
-  BlockingCounter bc(thread_num);
-  FOR_RANGE(size_t, range_id, 0, thread_num) {
-    Global<ThreadPool>::Get()->AddWork([&bc, &bs, range_id, Callback] {
-      FOR_RANGE(size_t, i, bs.At(range_id).begin(), bs.At(range_id).end()) { Callback(i); }
-      bc.Decrease();
-    });
+  if (num == 0) { return; }
+  ThreadPool* thread_pool = Global<ThreadPool>::Get();
+  // several small ranges per thread so that a slow element does not hold up the others
+  const size_t range_num_per_thread = 4;
+  const size_t grain_size =
+      std::max<size_t>(num / (thread_pool->thread_num() * range_num_per_thread), 1);
+  thread_pool->ParallelFor(num, grain_size, thread_pool->thread_num() + 1,
+                           [&Callback](int64_t begin, int64_t end) {
+                             FOR_RANGE(size_t, i, begin, end) { Callback(i); }
+                           });
+}
+
+int64_t ParallelForMaxParallelism() {
+  ThreadPool* thread_pool = Global<ThreadPool>::Get();
+  // such as in tools and tests, which do not create the runtime
+  if (thread_pool == nullptr || Global<ResourceDesc, ForSession>::Get() == nullptr) { return 1; }
+  int64_t parallelism = thread_pool->thread_num() + 1;
+  const int64_t max_parallelism =
+      Global<ResourceDesc, ForSession>::Get()->CpuKernelMaxParallelism();
+  if (max_parallelism > 0) { parallelism = std::min(parallelism, max_parallelism); }
+  return parallelism;
+}
+
+void ParallelFor(int64_t num, int64_t grain_size,
+                 const std::function<void(int64_t begin, int64_t end)>& DoEach) {
+  if (num <= 0) { return; }
+  CHECK_GT(grain_size, 0);
+  const int64_t parallelism = ParallelForMaxParallelism();
+  // enough sub-ranges to balance the load, but no more than that
+  const int64_t range_num_per_thread = 4;
+  const int64_t max_range_num = parallelism * range_num_per_thread;
+  grain_size = std::max(grain_size, (num + max_range_num - 1) / max_range_num);
+  if (parallelism == 1 || num <= grain_size) {
+    DoEach(0, num);
+  } else {
+    Global<ThreadPool>::Get()->ParallelFor(num, grain_size, parallelism, DoEach);
   }
-  bc.WaitUntilCntEqualZero();
 }
 
 }  // namespace oneflow
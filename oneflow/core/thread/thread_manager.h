@@ -44,6 +44,22 @@ class ThreadMgr final {
 
 void SingleThreadLoop(size_t num, std::function<void(size_t i)> Callback);
 void MultiThreadLoop(size_t num, std::function<void(size_t i)> Callback);
+// Calls DoEach on disjoint sub-ranges of [0, num) on the compute thread pool. Every sub-range
+// but the last holds at least grain_size elements, so small inputs stay on the calling thread.
+// No more than Resource.cpu_kernel_max_parallelism threads work on one call, and only the calling
+// thread without a compute thread pool. The limit is the same for every caller in the process.
+void ParallelFor(int64_t num, int64_t grain_size,
+                 const std::function<void(int64_t begin, int64_t end)>& DoEach);
+// The most threads, the calling one included, that work on one ParallelFor call.
+int64_t ParallelForMaxParallelism();
+
+// elements one ParallelFor task of the cpu kernels handles at least
+constexpr int64_t kParallelForGrainSize = 32768;
+
+// the grain size of a ParallelFor over items of item_size elements each
+inline int64_t ParallelForGrainSize(int64_t item_size) {
+  return std::max<int64_t>(kParallelForGrainSize / std::max<int64_t>(item_size, 1), 1);
+}
 
 }  // namespace oneflow
 
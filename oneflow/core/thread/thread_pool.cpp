@@ -17,28 +17,151 @@ limitations under the License.
 
 namespace oneflow {
 
+namespace {
+
+constexpr int64_t kWorkStealingDequeCapacity = 4096;
+constexpr int32_t kSpinCntBeforeIdle = 64;
+
+thread_local const ThreadPool* current_pool = nullptr;
+thread_local int32_t current_worker_id = -1;
+
+struct ParallelForState {
+  ParallelForState(int64_t num, int64_t grain_size,
+                   const std::function<void(int64_t, int64_t)>& DoEach)
+      : num(num), grain_size(grain_size), DoEach(DoEach), next(0), done_cnt(0) {}
+
+  // returns true if the caller has done the last sub-range
+  bool RunUntilExhausted() {
+    int64_t cnt = 0;
+    while (true) {
+      const int64_t begin = next.fetch_add(grain_size, std::memory_order_relaxed);
+      if (begin >= num) { break; }
+      const int64_t end = std::min(begin + grain_size, num);
+      DoEach(begin, end);
+      cnt += end - begin;
+    }
+    return cnt > 0 && done_cnt.fetch_add(cnt, std::memory_order_acq_rel) + cnt == num;
+  }
+
+  const int64_t num;
+  const int64_t grain_size;
+  const std::function<void(int64_t, int64_t)> DoEach;
+  std::atomic<int64_t> next;
+  std::atomic<int64_t> done_cnt;
+  std::mutex mutex;
+  std::condition_variable cond;
+};
+
+}  // namespace
+
 ThreadPool::ThreadPool(int32_t thread_num)
-    : work_chans_(thread_num), threads_(thread_num), work_cnt_(0) {
+    : pending_work_cnt_(0), idle_thread_cnt_(0), is_closed_(false), threads_(thread_num) {
+  CHECK_GT(thread_num, 0);
   FOR_RANGE(int32_t, i, 0, thread_num) {
-    Channel<std::function<void()>>* chan = &(work_chans_.at(i));
-    threads_[i] = std::thread([chan]() {
-      std::function<void()> work;
-      while (chan->Receive(&work) == kChannelStatusSuccess) { work(); }
-    });
+    deques_.emplace_back(new WorkStealingDeque<Work>(kWorkStealingDequeCapacity));
+  }
+  FOR_RANGE(int32_t, i, 0, thread_num) {
+    threads_[i] = std::thread([this, i]() { WorkerLoop(i); });
   }
 }
 
 ThreadPool::~ThreadPool() {
-  FOR_RANGE(int32_t, i, 0, work_chans_.size()) {
-    work_chans_.at(i).Close();
-    threads_.at(i).join();
+  {
+    std::unique_lock<std::mutex> lock(idle_mutex_);
+    is_closed_ = true;
   }
+  idle_cond_.notify_all();
+  for (std::thread& thread : threads_) { thread.join(); }
+  CHECK_EQ(pending_work_cnt_.load(), 0);
 }
 
 void ThreadPool::AddWork(const std::function<void()>& work) {
-  const size_t cur_chan_idx =
-      work_cnt_.fetch_add(1, std::memory_order_relaxed) % work_chans_.size();
-  work_chans_.at(cur_chan_idx).Send(work);
+  Work* new_work = new Work(work);
+  pending_work_cnt_.fetch_add(1, std::memory_order_seq_cst);
+  if (current_pool != this || !deques_.at(current_worker_id)->PushBottom(new_work)) {
+    std::unique_lock<std::mutex> lock(shared_queue_mutex_);
+    shared_queue_.push_back(new_work);
+  }
+  WakeUpIdleWorker();
+}
+
+void ThreadPool::WakeUpIdleWorker() {
+  if (idle_thread_cnt_.load(std::memory_order_seq_cst) == 0) { return; }
+  { std::unique_lock<std::mutex> lock(idle_mutex_); }
+  idle_cond_.notify_one();
+}
+
+bool ThreadPool::TryTakeWork(int32_t worker_id, Work** work) {
+  bool found = deques_.at(worker_id)->PopBottom(work);
+  if (!found) {
+    std::unique_lock<std::mutex> lock(shared_queue_mutex_);
+    if (!shared_queue_.empty()) {
+      *work = shared_queue_.front();
+      shared_queue_.pop_front();
+      found = true;
+    }
+  }
+  FOR_RANGE(int32_t, i, 1, thread_num()) {
+    if (found) { break; }
+    found = deques_.at((worker_id + i) % thread_num())->Steal(work);
+  }
+  if (found) { pending_work_cnt_.fetch_sub(1, std::memory_order_relaxed); }
+  return found;
+}
+
+void ThreadPool::WorkerLoop(int32_t worker_id) {
+  current_pool = this;
+  current_worker_id = worker_id;
+  int32_t spin_cnt = 0;
+  while (true) {
+    Work* work = nullptr;
+    if (TryTakeWork(worker_id, &work)) {
+      (*work)();
+      delete work;
+      spin_cnt = 0;
+      continue;
+    }
+    // a work may be counted before it is visible in a queue
+    if (pending_work_cnt_.load(std::memory_order_relaxed) > 0 || ++spin_cnt < kSpinCntBeforeIdle) {
+      std::this_thread::yield();
+      continue;
+    }
+    spin_cnt = 0;
+    std::unique_lock<std::mutex> lock(idle_mutex_);
+    idle_thread_cnt_.fetch_add(1, std::memory_order_seq_cst);
+    idle_cond_.wait(lock, [this]() {
+      return pending_work_cnt_.load(std::memory_order_seq_cst) > 0 || is_closed_;
+    });
+    idle_thread_cnt_.fetch_sub(1, std::memory_order_relaxed);
+    if (is_closed_ && pending_work_cnt_.load() == 0) { break; }
+  }
+  current_pool = nullptr;
+  current_worker_id = -1;
+}
+
+void ThreadPool::ParallelFor(int64_t num, int64_t grain_size, int64_t parallelism,
+                             const std::function<void(int64_t, int64_t)>& DoEach) {
+  if (num <= 0) { return; }
+  CHECK_GT(grain_size, 0);
+  CHECK_GT(parallelism, 0);
+  const int64_t range_num = RoundUp(num, grain_size) / grain_size;
+  if (range_num == 1 || parallelism == 1) {
+    DoEach(0, num);
+    return;
+  }
+  // helpers may start after the loop is done, so the state is shared with them
+  auto state = std::make_shared<ParallelForState>(num, grain_size, DoEach);
+  auto RunAndNotify = [state]() {
+    if (state->RunUntilExhausted()) {
+      std::unique_lock<std::mutex> lock(state->mutex);
+      state->cond.notify_all();
+    }
+  };
+  const int64_t helper_num = std::min<int64_t>(std::min(range_num, parallelism) - 1, thread_num());
+  FOR_RANGE(int64_t, i, 0, helper_num) { AddWork(RunAndNotify); }
+  RunAndNotify();
+  std::unique_lock<std::mutex> lock(state->mutex);
+  state->cond.wait(lock, [&state]() { return state->done_cnt.load() == state->num; });
 }
 
 }  // namespace oneflow
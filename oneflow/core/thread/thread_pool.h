@@ -17,10 +17,15 @@ limitations under the License.
 #define ONEFLOW_CORE_THREAD_THREAD_POOL_H_
 
 #include "oneflow/core/common/util.h"
-#include "oneflow/core/common/channel.h"
+#include "oneflow/core/thread/work_stealing_deque.h"
 
 namespace oneflow {
 
+// Work-stealing thread pool.
+//
+// Works added from outside the pool go to a shared FIFO queue, works added by a worker go to the
+// bottom of its own deque. An idle worker pops its own deque first, then the shared queue, and
+// finally steals from the top of the other workers' deques.
 class ThreadPool final {
  public:
   OF_DISALLOW_COPY_AND_MOVE(ThreadPool);
@@ -31,11 +36,31 @@ class ThreadPool final {
   int32_t thread_num() const { return threads_.size(); }
   void AddWork(const std::function<void()>& work);
 
+  // Calls DoEach on disjoint sub-ranges of [0, num) whose size is at most grain_size, using at
+  // most parallelism threads. Sub-ranges are handed out dynamically, so workers finishing early
+  // take over the rest. The calling thread takes part in the loop, which makes it safe to call
+  // from a worker.
+  void ParallelFor(int64_t num, int64_t grain_size, int64_t parallelism,
+                   const std::function<void(int64_t begin, int64_t end)>& DoEach);
+
  private:
-  std::vector<Channel<std::function<void()>>> work_chans_;
-  std::vector<std::thread> threads_;
+  using Work = std::function<void()>;
+
+  void WorkerLoop(int32_t worker_id);
+  bool TryTakeWork(int32_t worker_id, Work** work);
+  void WakeUpIdleWorker();
 
-  std::atomic<size_t> work_cnt_;
+  std::vector<std::unique_ptr<WorkStealingDeque<Work>>> deques_;
+  std::deque<Work*> shared_queue_;
+  std::mutex shared_queue_mutex_;
+
+  std::atomic<int64_t> pending_work_cnt_;
+  std::atomic<int32_t> idle_thread_cnt_;
+  std::mutex idle_mutex_;
+  std::condition_variable idle_cond_;
+  bool is_closed_;
+
+  std::vector<std::thread> threads_;
 };
 
 }  // namespace oneflow
@@ -0,0 +1,75 @@
+/*
+Copyright 2020 The OneFlow Authors. All rights reserved.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+*/
+#include "oneflow/core/thread/thread_pool.h"
+#include "oneflow/core/common/blocking_counter.h"
+
+namespace oneflow {
+
+TEST(ThreadPool, single_thread_keeps_order) {
+  std::vector<int32_t> visited;
+  {
+    ThreadPool thread_pool(1);
+    FOR_RANGE(int32_t, i, 0, 1000) {
+      thread_pool.AddWork([&visited, i]() { visited.push_back(i); });
+    }
+  }
+  ASSERT_EQ(visited.size(), 1000);
+  FOR_RANGE(int32_t, i, 0, 1000) { ASSERT_EQ(visited.at(i), i); }
+}
+
+TEST(ThreadPool, nested_work) {
+  std::atomic<int64_t> cnt(0);
+  {
+    ThreadPool thread_pool(4);
+    FOR_RANGE(int32_t, i, 0, 64) {
+      thread_pool.AddWork([&thread_pool, &cnt]() {
+        FOR_RANGE(int32_t, j, 0, 64) { thread_pool.AddWork([&cnt]() { ++cnt; }); }
+      });
+    }
+  }
+  ASSERT_EQ(cnt.load(), 64 * 64);
+}
+
+TEST(ThreadPool, parallel_for) {
+  ThreadPool thread_pool(4);
+  std::vector<std::atomic<int32_t>> visits(10007);
+  for (auto& visit : visits) { visit.store(0); }
+  thread_pool.ParallelFor(visits.size(), 13, 3, [&visits](int64_t begin, int64_t end) {
+    FOR_RANGE(int64_t, i, begin, end) { ++visits.at(i); }
+  });
+  for (const auto& visit : visits) { ASSERT_EQ(visit.load(), 1); }
+}
+
+TEST(ThreadPool, nested_parallel_for) {
+  // every worker blocks in an inner loop, which must not deadlock
+  ThreadPool thread_pool(2);
+  const int64_t outer_num = 8;
+  const int64_t inner_num = 100;
+  std::atomic<int64_t> cnt(0);
+  BlockingCounter bc(outer_num);
+  FOR_RANGE(int64_t, i, 0, outer_num) {
+    thread_pool.AddWork([&]() {
+      thread_pool.ParallelFor(inner_num, 1, 3, [&cnt](int64_t begin, int64_t end) {
+        cnt += end - begin;
+      });
+      bc.Decrease();
+    });
+  }
+  bc.WaitUntilCntEqualZero();
+  ASSERT_EQ(cnt.load(), outer_num * inner_num);
+}
+
+}  // namespace oneflow
@@ -0,0 +1,105 @@
+/*
+Copyright 2020 The OneFlow Authors. All rights reserved.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+*/
+#ifndef ONEFLOW_CORE_THREAD_WORK_STEALING_DEQUE_H_
+#define ONEFLOW_CORE_THREAD_WORK_STEALING_DEQUE_H_
+
+#include "oneflow/core/common/util.h"
+
+namespace oneflow {
+
+// Bounded Chase-Lev deque. The owner thread pushes and pops at the bottom end, any other thread
+// may steal from the top end. Only pointers are stored so that every slot fits in one atomic.
+template<typename T>
+class WorkStealingDeque final {
+ public:
+  OF_DISALLOW_COPY_AND_MOVE(WorkStealingDeque);
+  explicit WorkStealingDeque(int64_t capacity);
+  ~WorkStealingDeque() = default;
+
+  // owner only, returns false if the deque is full
+  bool PushBottom(T* item);
+  // owner only
+  bool PopBottom(T** item);
+  // any thread
+  bool Steal(T** item);
+
+  bool Empty() const {
+    return bottom_.load(std::memory_order_relaxed) <= top_.load(std::memory_order_relaxed);
+  }
+
+ private:
+  std::unique_ptr<std::atomic<T*>[]> buffer_;
+  int64_t mask_;
+  alignas(64) std::atomic<int64_t> top_;
+  alignas(64) std::atomic<int64_t> bottom_;
+};
+
+template<typename T>
+WorkStealingDeque<T>::WorkStealingDeque(int64_t capacity) : top_(0), bottom_(0) {
+  CHECK_GT(capacity, 0);
+  CHECK_EQ(capacity & (capacity - 1), 0) << "capacity must be a power of two";
+  mask_ = capacity - 1;
+  buffer_.reset(new std::atomic<T*>[capacity]);
+  FOR_RANGE(int64_t, i, 0, capacity) { buffer_[i].store(nullptr, std::memory_order_relaxed); }
+}
+
+template<typename T>
+bool WorkStealingDeque<T>::PushBottom(T* item) {
+  const int64_t b = bottom_.load(std::memory_order_relaxed);
+  const int64_t t = top_.load(std::memory_order_acquire);
+  if (b - t > mask_) { return false; }
+  buffer_[b & mask_].store(item, std::memory_order_relaxed);
+  bottom_.store(b + 1, std::memory_order_release);
+  return true;
+}
+
+template<typename T>
+bool WorkStealingDeque<T>::PopBottom(T** item) {
+  const int64_t b = bottom_.load(std::memory_order_relaxed) - 1;
+  bottom_.store(b, std::memory_order_relaxed);
+  std::atomic_thread_fence(std::memory_order_seq_cst);
+  int64_t t = top_.load(std::memory_order_relaxed);
+  if (t > b) {
+    bottom_.store(b + 1, std::memory_order_relaxed);
+    return false;
+  }
+  *item = buffer_[b & mask_].load(std::memory_order_relaxed);
+  if (t < b) { return true; }
+  // the last item, race with thieves
+  const bool success = top_.compare_exchange_strong(t, t + 1, std::memory_order_seq_cst,
+                                                    std::memory_order_relaxed);
+  bottom_.store(b + 1, std::memory_order_relaxed);
+  return success;
+}
+
+template<typename T>
+bool WorkStealingDeque<T>::Steal(T** item) {
+  int64_t t = top_.load(std::memory_order_acquire);
+  std::atomic_thread_fence(std::memory_order_seq_cst);
+  const int64_t b = bottom_.load(std::memory_order_acquire);
+  if (t >= b) { return false; }
+  T* stolen = buffer_[t & mask_].load(std::memory_order_relaxed);
+  if (!top_.compare_exchange_strong(t, t + 1, std::memory_order_seq_cst,
+                                    std::memory_order_relaxed)) {
+    return false;
+  }
+  *item = stolen;
+  return true;
+}
+
+}  // namespace oneflow
+
+#endif  // ONEFLOW_CORE_THREAD_WORK_STEALING_DEQUE_H_
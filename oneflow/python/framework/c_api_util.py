@@ -144,6 +144,20 @@ def StopLazyGlobalSession():
         raise JobBuildAndInferError(error)
 
 
+def MarkAsyncSnapshotDone(snapshot_path):
+    error_str = oneflow_internal.MarkAsyncSnapshotDone(snapshot_path)
+    error = text_format.Parse(error_str, error_util.ErrorProto())
+    if error.HasField("error_type"):
+        raise JobBuildAndInferError(error)
+
+
+def WaitAsyncSnapshotsDone():
+    error_str = oneflow_internal.WaitAsyncSnapshotsDone()
+    error = text_format.Parse(error_str, error_util.ErrorProto())
+    if error.HasField("error_type"):
+        raise JobBuildAndInferError(error)
+
+
 def GetInterUserJobInfo():
     inter_user_job_info, error_str = oneflow_internal.GetSerializedInterUserJobInfo()
     error = text_format.Parse(error_str, error_util.ErrorProto())
@@ -17,6 +17,7 @@ import datetime
 import os
 
 import numpy as np
+import oneflow.python.framework.c_api_util as c_api_util
 import oneflow.python.framework.hob as hob
 import oneflow.python.framework.job_instance as job_instance
 import oneflow.python.framework.session_context as session_ctx
@@ -46,6 +47,13 @@ class CheckPoint(object):
         assert type(path) is str
         enable_if.unique([lazy_checkpoint_save, eager_checkpoint_save])(path)
 
+    @session_ctx.try_init_default_session
+    def wait(self) -> None:
+        r"""Wait until the checkpoints saved with `config.enable_async_checkpoint` are written,
+        each one with its snapshot_done. Closing the session waits as well.
+        """
+        enable_if.unique([lazy_checkpoint_wait, eager_checkpoint_wait])()
+
     @session_ctx.try_init_default_session
     def init(self) -> None:
         r"""Initialize models by default initializer of op or Job.
@@ -68,6 +76,14 @@ def lazy_checkpoint_save(path):
     session_ctx.GetDefaultSession().LaunchJob(_MakeModelSaveJobFunc(path))
 
 
+@enable_if.condition(hob.in_normal_mode & ~hob.eager_execution_enabled)
+def lazy_checkpoint_wait():
+    sess = session_ctx.GetDefaultSession()
+    sess.Sync()
+    if sess.config_proto.io_conf.enable_async_checkpoint:
+        c_api_util.WaitAsyncSnapshotsDone()
+
+
 @enable_if.condition(hob.in_normal_mode & ~hob.eager_execution_enabled)
 def lazy_checkpoint_init():
     session_ctx.GetDefaultSession().LaunchJob(_MakeModelInitJobFunc())
@@ -83,6 +99,12 @@ def eager_checkpoint_save(path):
     op_executor.EagerSaveVariableBlob(path)
 
 
+@enable_if.condition(hob.in_normal_mode & hob.eager_execution_enabled)
+def eager_checkpoint_wait():
+    # eager checkpoints are written when saved
+    pass
+
+
 @enable_if.condition(hob.in_normal_mode & hob.eager_execution_enabled)
 def eager_checkpoint_init():
     # eager variables are initialized in oneflow.get_variable()
@@ -128,10 +150,15 @@ def _MakeModelSaveJobFunc(path):
     def push_cb(blob):
         blob.CopyFromNdarray(np.frombuffer(path.encode("ascii"), dtype=np.int8))
 
+    sess = session_ctx.GetDefaultSession()
+    io_conf = sess.config_proto.io_conf
+
     def finish_cb():
-        pass
+        # every machine has added the writes of the snapshot, snapshot_done follows them. The
+        # legacy model save writes it by itself.
+        if io_conf.enable_async_checkpoint and io_conf.enable_model_io_v2:
+            c_api_util.MarkAsyncSnapshotDone(path)
 
-    sess = session_ctx.GetDefaultSession()
     return job_instance.MakeJobInstance(
         str(sess.inter_user_job_info.global_model_save_job_name),
         push_cb=push_cb,
@@ -211,6 +238,9 @@ class SnapshotManager(object):
                 fpath = os.path.join(file_path, f)
                 if f == "out" and os.path.isfile(fpath):
                     has_out_subfile = True
+                # split variables are saved as the shards of each rank
+                if f == "out-shards" and os.path.isdir(fpath):
+                    has_out_subfile = True
 
             if not has_out_subfile:
                 continue
@@ -15,6 +15,7 @@ limitations under the License.
 """
 from __future__ import absolute_import, print_function
 
+import oneflow.core.job.resource_pb2 as resource_util
 import oneflow.python.framework.hob as hob
 import oneflow.python.framework.session_context as session_ctx
 import oneflow.python.lib.core.enable_if as enable_if
@@ -118,6 +119,84 @@ def comm_net_worker_num(val):
     sess.config_proto.resource.comm_net_worker_num = val
 
 
+@oneflow_export("config.comm_net_send_mode")
+def api_comm_net_send_mode(val: str) -> None:
+    r"""Set up how epoll mode network sends large regst bodies.
+
+    Args:
+        val (str): "copy", "msg_zerocopy" (sendmsg with MSG_ZEROCOPY) or "vmsplice"
+    """
+    return enable_if.unique([comm_net_send_mode, do_nothing])(val)
+
+
+@enable_if.condition(hob.in_normal_mode & ~hob.session_initialized)
+def comm_net_send_mode(val):
+    sess = session_ctx.GetDefaultSession()
+    assert type(val) is str
+    mode2enum = {
+        "copy": resource_util.kCommNetSendCopy,
+        "msg_zerocopy": resource_util.kCommNetSendMsgZeroCopy,
+        "vmsplice": resource_util.kCommNetSendVmsplice,
+    }
+    assert val in mode2enum
+    sess.config_proto.resource.comm_net_send_mode = mode2enum[val]
+
+
+@oneflow_export("config.comm_net_zero_copy_min_byte_size")
+def api_comm_net_zero_copy_min_byte_size(val: int) -> None:
+    r"""Set up the smallest regst body sent without copy when comm_net_send_mode is not "copy".
+
+    Args:
+        val (int): size in bytes
+    """
+    return enable_if.unique([comm_net_zero_copy_min_byte_size, do_nothing])(val)
+
+
+@enable_if.condition(hob.in_normal_mode & ~hob.session_initialized)
+def comm_net_zero_copy_min_byte_size(val):
+    sess = session_ctx.GetDefaultSession()
+    assert type(val) is int
+    assert val >= 0
+    sess.config_proto.resource.comm_net_zero_copy_min_byte_size = val
+
+
+@oneflow_export("config.comm_net_socket_num_per_peer")
+def api_comm_net_socket_num_per_peer(val: int) -> None:
+    r"""Set up the number of sockets to each peer in epoll mode network.
+            The first socket carries control messages, large regst bodies are split over the others.
+
+    Args:
+        val (int): number of sockets
+    """
+    return enable_if.unique([comm_net_socket_num_per_peer, do_nothing])(val)
+
+
+@enable_if.condition(hob.in_normal_mode & ~hob.session_initialized)
+def comm_net_socket_num_per_peer(val):
+    sess = session_ctx.GetDefaultSession()
+    assert type(val) is int
+    assert val >= 1
+    sess.config_proto.resource.comm_net_socket_num_per_peer = val
+
+
+@oneflow_export("config.comm_net_stripe_min_byte_size")
+def api_comm_net_stripe_min_byte_size(val: int) -> None:
+    r"""Set up the smallest regst body split over several sockets in epoll mode network.
+
+    Args:
+        val (int): size in bytes
+    """
+    return enable_if.unique([comm_net_stripe_min_byte_size, do_nothing])(val)
+
+
+@enable_if.condition(hob.in_normal_mode & ~hob.session_initialized)
+def comm_net_stripe_min_byte_size(val):
+    sess = session_ctx.GetDefaultSession()
+    assert type(val) is int
+    assert val >= 0
+    sess.config_proto.resource.comm_net_stripe_min_byte_size = val
+
+
 @oneflow_export("config.max_mdsave_worker_num")
 def api_max_mdsave_worker_num(val: int) -> None:
     r"""Set up max number of workers for mdsave process.
@@ -169,6 +248,25 @@ def compute_thread_pool_size(val):
     sess.config_proto.resource.compute_thread_pool_size = val
 
 
+@oneflow_export("config.cpu_kernel_max_parallelism")
+def api_cpu_kernel_max_parallelism(val: int) -> None:
+    r"""Set up the max number of threads one cpu kernel uses in a single call.
+       The value applies to every cpu kernel of the process, there is no per kernel limit.
+
+    Args:
+        val (int): number of threads, 0 means all threads of compute thread pool
+    """
+    return enable_if.unique([cpu_kernel_max_parallelism, do_nothing])(val)
+
+
+@enable_if.condition(hob.in_normal_mode & ~hob.session_initialized)
+def cpu_kernel_max_parallelism(val):
+    sess = session_ctx.GetDefaultSession()
+    assert type(val) is int
+    assert val >= 0
+    sess.config_proto.resource.cpu_kernel_max_parallelism = val
+
+
 @oneflow_export("config.rdma_mem_block_mbyte")
 def api_rdma_mem_block_mbyte(val: int) -> None:
     r"""Set up the memory block size in rdma mode.
@@ -272,6 +370,61 @@ def thread_enable_local_message_queue(val):
     sess.config_proto.resource.thread_enable_local_message_queue = val
 
 
+@oneflow_export("config.thread_enable_lock_free_message_queue")
+def api_thread_enable_lock_free_message_queue(val: bool) -> None:
+    """Whether or not actor threads receive messages through a lock-free queue
+       instead of a mutex protected one.
+
+    Args:
+        val (bool):  True or False
+    """
+    return enable_if.unique([thread_enable_lock_free_message_queue, do_nothing])(val)
+
+
+@enable_if.condition(hob.in_normal_mode & ~hob.session_initialized)
+def thread_enable_lock_free_message_queue(val):
+    sess = session_ctx.GetDefaultSession()
+    assert type(val) is bool
+    sess.config_proto.resource.thread_enable_lock_free_message_queue = val
+
+
+@oneflow_export("config.thread_lock_free_message_queue_capacity")
+def api_thread_lock_free_message_queue_capacity(val: int) -> None:
+    """Set capacity of the lock-free message queue of each actor thread.
+
+    Args:
+        val (int): a power of two
+    """
+    return enable_if.unique([thread_lock_free_message_queue_capacity, do_nothing])(val)
+
+
+@enable_if.condition(hob.in_normal_mode & ~hob.session_initialized)
+def thread_lock_free_message_queue_capacity(val):
+    sess = session_ctx.GetDefaultSession()
+    assert type(val) is int
+    assert val >= 2 and (val & (val - 1)) == 0
+    sess.config_proto.resource.thread_lock_free_message_queue_capacity = val
+
+
+@oneflow_export("config.thread_lock_free_message_queue_spin_count")
+def api_thread_lock_free_message_queue_spin_count(val: int) -> None:
+    """Set how many times an actor thread polls its empty lock-free message queue
+       before it sleeps until a message is sent.
+
+    Args:
+        val (int): a non-negative number, 0 to sleep at once
+    """
+    return enable_if.unique([thread_lock_free_message_queue_spin_count, do_nothing])(val)
+
+
+@enable_if.condition(hob.in_normal_mode & ~hob.session_initialized)
+def thread_lock_free_message_queue_spin_count(val):
+    sess = session_ctx.GetDefaultSession()
+    assert type(val) is int
+    assert val >= 0
+    sess.config_proto.resource.thread_lock_free_message_queue_spin_count = val
+
+
 @oneflow_export("config.enable_debug_mode")
 def api_enable_debug_mode(val: bool) -> None:
     r"""Whether use debug mode or not.
@@ -323,6 +476,95 @@ def persistence_buf_byte(val):
     sess.config_proto.io_conf.persistence_buf_byte = val
 
 
+@oneflow_export("config.persistence_read_ahead_thread_num")
+def api_persistence_read_ahead_thread_num(val: int) -> None:
+    r"""Set up the number of threads reading ahead of each persistence input stream, 0 reads
+    in the thread of the stream.
+
+    Args:
+        val (int): e.g. 4
+    """
+    return enable_if.unique([persistence_read_ahead_thread_num, do_nothing])(val)
+
+
+@enable_if.condition(hob.in_normal_mode & ~hob.session_initialized)
+def persistence_read_ahead_thread_num(val):
+    sess = session_ctx.GetDefaultSession()
+    assert type(val) is int
+    sess.config_proto.io_conf.persistence_read_ahead_thread_num = val
+
+
+@oneflow_export("config.persistence_read_ahead_block_byte")
+def api_persistence_read_ahead_block_byte(val: int) -> None:
+    r"""Set up the size of the blocks read ahead of persistence input streams.
+
+    Args:
+        val (int): e.g. 4194304(bytes)
+    """
+    return enable_if.unique([persistence_read_ahead_block_byte, do_nothing])(val)
+
+
+@enable_if.condition(hob.in_normal_mode & ~hob.session_initialized)
+def persistence_read_ahead_block_byte(val):
+    sess = session_ctx.GetDefaultSession()
+    assert type(val) is int
+    sess.config_proto.io_conf.persistence_read_ahead_block_byte = val
+
+
+@oneflow_export("config.enable_async_checkpoint")
+def api_enable_async_checkpoint(val: bool = True) -> None:
+    r"""Whether or not model saves copy the variables to staging buffers and write them in the
+    background. `train.CheckPoint.wait` waits until the checkpoints are written.
+
+    Args:
+        val (bool, optional): True or False. Defaults to True.
+    """
+    return enable_if.unique([enable_async_checkpoint, do_nothing])(val)
+
+
+@enable_if.condition(hob.in_normal_mode & ~hob.session_initialized)
+def enable_async_checkpoint(val=True):
+    sess = session_ctx.GetDefaultSession()
+    assert type(val) is bool
+    sess.config_proto.io_conf.enable_async_checkpoint = val
+
+
+@oneflow_export("config.async_checkpoint_writer_num")
+def api_async_checkpoint_writer_num(val: int) -> None:
+    r"""Set up the number of threads writing checkpoints in the background.
+
+    Args:
+        val (int): e.g. 4
+    """
+    return enable_if.unique([async_checkpoint_writer_num, do_nothing])(val)
+
+
+@enable_if.condition(hob.in_normal_mode & ~hob.session_initialized)
+def async_checkpoint_writer_num(val):
+    sess = session_ctx.GetDefaultSession()
+    assert type(val) is int
+    assert val > 0
+    sess.config_proto.io_conf.async_checkpoint_writer_num = val
+
+
+@oneflow_export("config.async_checkpoint_staging_byte")
+def api_async_checkpoint_staging_byte(val: int) -> None:
+    r"""Set up the host memory of the variables copied for checkpoints not written yet. A save
+    waits while they hold more.
+
+    Args:
+        val (int): e.g. 2147483648(bytes)
+    """
+    return enable_if.unique([async_checkpoint_staging_byte, do_nothing])(val)
+
+
+@enable_if.condition(hob.in_normal_mode & ~hob.session_initialized)
+def async_checkpoint_staging_byte(val):
+    sess = session_ctx.GetDefaultSession()
+    assert type(val) is int
+    sess.config_proto.io_conf.async_checkpoint_staging_byte = val
+
+
 @oneflow_export("config.enable_model_io_v2")
 def api_enable_model_io_v2(val):
     r"""Whether or not use version2  of model input/output function.
@@ -564,6 +806,40 @@ def nccl_enable_all_to_all(val):
     sess.config_proto.resource.collective_boxing_conf.nccl_enable_all_to_all = val
 
 
+@oneflow_export("config.collective_boxing.cpu_enable_backend")
+def api_cpu_enable_backend(val: bool) -> None:
+    r"""Whether or not use the cpu collective boxing backend for boxing between cpu devices of several machines. Defaults to False, using the boxing actors
+
+    Args:
+        val (bool): True or False
+    """
+    return enable_if.unique([cpu_enable_backend, do_nothing])(val)
+
+
+@enable_if.condition(hob.in_normal_mode & ~hob.session_initialized)
+def cpu_enable_backend(val):
+    sess = session_ctx.GetDefaultSession()
+    assert type(val) is bool
+    sess.config_proto.resource.collective_boxing_conf.cpu_enable_backend = val
+
+
+@oneflow_export("config.collective_boxing.cpu_ring_threshold_kb")
+def api_cpu_ring_threshold_kb(val: int) -> None:
+    r"""Minimum size in KB for the cpu backend to use ring algorithms instead of recursive halving doubling and trees
+
+    Args:
+        val (int): Size in KB
+    """
+    return enable_if.unique([cpu_ring_threshold_kb, do_nothing])(val)
+
+
+@enable_if.condition(hob.in_normal_mode & ~hob.session_initialized)
+def cpu_ring_threshold_kb(val):
+    sess = session_ctx.GetDefaultSession()
+    assert type(val) is int
+    sess.config_proto.resource.collective_boxing_conf.cpu_ring_threshold_kb = val
+
+
 @enable_if.condition(hob.in_normal_mode & hob.session_initialized)
 def do_nothing(*args, **kwargs):
     print("Nothing happened because the session is running")
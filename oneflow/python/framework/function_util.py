@@ -415,6 +415,21 @@ def set_cudnn_conv_force_bwd_filter_algo(func_desc, value):
     func_desc.job_config_proto.cudnn_conv_force_bwd_filter_algo = value
 
 
+@oneflow_function_config("cpu_conv_force_fwd_algo")
+def set_cpu_conv_force_fwd_algo(func_desc, value):
+    r"""Set the algorithm of cpu conv forward. The tmp buffer of each conv is sized for the
+    forced algorithm. When it is not set or does not apply to a conv, the conv times each
+    applicable algorithm that fits in its tmp buffer on the first run and keeps the fastest.
+
+    Args:
+        func_desc (FunctionDesc): the description of the job function
+        value (int): 0 for im2col and gemm, 1 for the direct convolution of channels last 1x1
+            and depthwise convolutions, 2 for Winograd F(2x2, 3x3) of 3x3 convolutions with
+            stride 1
+    """
+    func_desc.job_config_proto.cpu_conv_force_fwd_algo = value
+
+
 @oneflow_function_config("cudnn_conv_heuristic_search_algo")
 def set_cudnn_conv_heuristic_search_algo(func_desc, value):
     r"""Set value to cudnn conv_heuristic_search algorithm
@@ -84,6 +84,14 @@ void StopLazyGlobalSession(std::string* error_str) {
   return oneflow::StopLazyGlobalSession().GetDataAndSerializedErrorProto(error_str);
 }
 
+void MarkAsyncSnapshotDone(const std::string& snapshot_path, std::string* error_str) {
+  return oneflow::MarkAsyncSnapshotDone(snapshot_path).GetDataAndSerializedErrorProto(error_str);
+}
+
+void WaitAsyncSnapshotsDone(std::string* error_str) {
+  return oneflow::WaitAsyncSnapshotsDone().GetDataAndSerializedErrorProto(error_str);
+}
+
 std::string GetSerializedInterUserJobInfo(std::string* error_str) {
   return oneflow::GetSerializedInterUserJobInfo().GetDataAndSerializedErrorProto(error_str,
                                                                                  std::string(""));
@@ -40,6 +40,7 @@ limitations under the License.
 #include "oneflow/core/framework/config_def.h"
 #include "oneflow/core/framework/user_op_conf.h"
 #include "oneflow/core/framework/user_op_registry_manager.h"
+#include "oneflow/core/persistence/async_snapshot_writer.h"
 #include "oneflow/core/persistence/tee_persistent_log_stream.h"
 #include "oneflow/core/vm/instruction.pb.h"
 #include "oneflow/core/vm/vm_util.h"
@@ -173,6 +174,22 @@ Maybe<void> StopLazyGlobalSession() {
   return Maybe<void>::Ok();
 }
 
+Maybe<void> MarkAsyncSnapshotDone(const std::string& snapshot_path) {
+  CHECK_OR_RETURN(Global<MachineCtx>::Get()->IsThisMachineMaster());
+  CHECK_NOTNULL_OR_RETURN(Global<AsyncSnapshotWriter>::Get())
+      << "async checkpoint is not enabled, or the session is not running";
+  Global<AsyncSnapshotWriter>::Get()->AsyncMarkDone(snapshot_path);
+  return Maybe<void>::Ok();
+}
+
+Maybe<void> WaitAsyncSnapshotsDone() {
+  CHECK_OR_RETURN(Global<MachineCtx>::Get()->IsThisMachineMaster());
+  if (Global<AsyncSnapshotWriter>::Get() != nullptr) {
+    Global<AsyncSnapshotWriter>::Get()->WaitUntilDone();
+  }
+  return Maybe<void>::Ok();
+}
+
 Maybe<std::string> GetSerializedInterUserJobInfo() {
   CHECK_OR_RETURN(Global<MachineCtx>::Get()->IsThisMachineMaster());
   CHECK_NOTNULL_OR_RETURN(Global<Oneflow>::Get());
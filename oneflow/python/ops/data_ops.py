@@ -288,6 +288,8 @@ def ofrecord_reader(
     random_shuffle: bool = False,
     shuffle_buffer_size: int = 1024,
     shuffle_after_epoch: bool = False,
+    use_mmap: bool = False,
+    lazy_decoding: bool = False,
     name: Optional[str] = None,
 ) -> remote_blob_util.BlobDef:
     r"""Get ofrecord object from ofrecord dataset.
@@ -301,6 +303,8 @@ def ofrecord_reader(
         random_shuffle (bool, optional): Determines records shuffled or not. Defaults to False.
         shuffle_buffer_size (int, optional): Shuffle buffer size. Defaults to 1024.
         shuffle_after_epoch (bool, optional): Shuffled or not after each epoch. Defaults to False.
+        use_mmap (bool, optional): Read records from memory mapped local files without copying them. Defaults to False.
+        lazy_decoding (bool, optional): Keep records serialized so that the decoders read only the features they need. Defaults to False.
         name (Optional[str], optional): Optional name. Defaults to None.
         
     Returns:
@@ -364,6 +368,8 @@ def ofrecord_reader(
         .Attr("shuffle_buffer_size", shuffle_buffer_size)
         .Attr("shuffle_after_epoch", shuffle_after_epoch)
         .Attr("part_name_suffix_length", part_name_suffix_length)
+        .Attr("use_mmap", use_mmap)
+        .Attr("lazy_decoding", lazy_decoding)
         .Build()
         .InferAndTryRun()
         .RemoteBlobList()[0]
@@ -476,6 +482,7 @@ def onerec_reader(
     shuffle_buffer_size=1024,
     shuffle_after_epoch=False,
     verify_example=True,
+    use_mmap=False,
     name=None,
 ):
     assert isinstance(files, (list, tuple))
@@ -494,6 +501,7 @@ def onerec_reader(
         .Attr("shuffle_buffer_size", shuffle_buffer_size)
         .Attr("shuffle_after_epoch", shuffle_after_epoch)
         .Attr("verify_example", verify_example)
+        .Attr("use_mmap", use_mmap)
         .Build()
         .InferAndTryRun()
         .RemoteBlobList()[0]
@@ -621,6 +621,59 @@ def gelu(
     )
 
 
+@oneflow_export("math.fused_elementwise")
+def fused_elementwise(
+    inputs: Sequence[remote_blob_util.BlobDef],
+    program: Sequence[str],
+    name: Optional[str] = None,
+) -> remote_blob_util.BlobDef:
+    r"""Evaluates an expression of elementwise functions of the inputs in one pass, on cpu.
+
+    The program lists the expression in postfix order. ``"in:i"`` pushes the i-th input,
+    ``"const:c"`` pushes the constant c, ``abs``, ``negative``, ``square``, ``sqrt``, ``relu``,
+    ``exp``, ``log``, ``sigmoid``, ``tanh`` and ``gelu`` replace the value on top by their
+    result, and ``add``, ``sub``, ``mul``, ``div``, ``maximum`` and ``minimum`` replace the two
+    values on top. The inputs are broadcast as by numpy, as long as the axes an input keeps are
+    contiguous, like those of a bias.
+
+    Args:
+        inputs (Sequence[remote_blob_util.BlobDef]): Input Blobs of the same data type
+        program (Sequence[str]): The expression in postfix order
+        name (Optional[str], optional): The name for the operation. Defaults to None.
+
+    Returns:
+        remote_blob_util.BlobDef: A Blob with the broadcast shape of the inputs.
+
+    For example, a bias_add, a gelu and a scalar_mul:
+
+    .. code-block:: python
+
+        import oneflow as flow
+        import numpy as np
+        import oneflow.typing as tp
+
+        @flow.global_function()
+        def fusedJob(x: tp.Numpy.Placeholder((2, 3)), bias: tp.Numpy.Placeholder((3,))
+        )->tp.Numpy:
+            return flow.math.fused_elementwise(
+                [x, bias], ["in:0", "in:1", "add", "gelu", "const:2", "mul"]
+            )
+
+    """
+    return (
+        flow.user_op_builder(
+            name if name is not None else id_util.UniqueStr("FusedElementwise_")
+        )
+        .Op("fused_elementwise")
+        .Input("in", list(inputs))
+        .Output("out")
+        .Attr("program", list(program))
+        .Build()
+        .InferAndTryRun()
+        .RemoteBlobList()[0]
+    )
+
+
 @oneflow_export("math.relu", "nn.relu")
 def relu(
     x: remote_blob_util.BlobDef, name: Optional[str] = None
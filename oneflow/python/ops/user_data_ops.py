@@ -2212,6 +2212,7 @@ def ofrecord_image_classification_reader(
     color_space: str = "BGR",
     decode_buffer_size_per_thread: int = 32,
     num_decode_threads_per_machine: Optional[int] = None,
+    use_mmap: bool = False,
     name: Optional[str] = None,
 ) -> BlobDef:
     """This operator creates a reader for image classification tasks. 
@@ -2230,6 +2231,7 @@ def ofrecord_image_classification_reader(
         color_space (str, optional): The color space. Defaults to "BGR".
         decode_buffer_size_per_thread (int, optional): The decode buffer size for per thread. Defaults to 32.
         num_decode_threads_per_machine (Optional[int], optional): The amounts of decode threads for each machine. Defaults to None.
+        use_mmap (bool, optional): Whether to read records from memory mapped local files without copying them. Defaults to False.
         name (Optional[str], optional): The name for the operation. Defaults to None.
 
     Returns:
@@ -2290,6 +2292,7 @@ def ofrecord_image_classification_reader(
         .Attr("label_feature_name", label_feature_name)
         .Attr("decode_buffer_size_per_thread", decode_buffer_size_per_thread)
         .Attr("num_decode_threads_per_machine", num_decode_threads_per_machine or 0)
+        .Attr("use_mmap", use_mmap)
         .Build()
         .InferAndTryRun()
         .RemoteBlobList()
@@ -0,0 +1,75 @@
+"""
+Copyright 2020 The OneFlow Authors. All rights reserved.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+"""
+import os
+import tempfile
+import unittest
+
+import numpy as np
+import oneflow as flow
+import oneflow.typing as tp
+
+
+def _test_async_checkpoint(test_case, writer_num, staging_byte):
+    flow.clear_default_session()
+    flow.config.enable_model_io_v2(True)
+    flow.config.enable_async_checkpoint(True)
+    flow.config.async_checkpoint_writer_num(writer_num)
+    flow.config.async_checkpoint_staging_byte(staging_byte)
+    shape = (64, 32)
+
+    @flow.global_function(type="predict")
+    def get_var() -> tp.Numpy:
+        return flow.get_variable(
+            name="var",
+            shape=shape,
+            dtype=flow.float,
+            initializer=flow.random_uniform_initializer(),
+        )
+
+    check_point = flow.train.CheckPoint()
+    check_point.init()
+    var_np = get_var()
+    snapshot_dirs = [tempfile.mkdtemp() for _ in range(3)]
+    for snapshot_dir in snapshot_dirs:
+        check_point.save(snapshot_dir)
+    # every snapshot saved so far is complete once wait returns
+    check_point.wait()
+    for snapshot_dir in snapshot_dirs:
+        var_dir = os.path.join(snapshot_dir, "var")
+        snapshot_done = os.path.join(snapshot_dir, "snapshot_done")
+        test_case.assertTrue(os.path.isfile(snapshot_done))
+        saved = np.fromfile(os.path.join(var_dir, "out"), dtype=np.float32)
+        test_case.assertTrue(np.array_equal(saved.reshape(shape), var_np))
+        # each file was renamed from its temporary one
+        test_case.assertFalse(
+            any(name.endswith(".writing") for name in os.listdir(var_dir))
+        )
+    check_point.load(snapshot_dirs[-1])
+    test_case.assertTrue(np.array_equal(get_var(), var_np))
+
+
+@flow.unittest.skip_unless_1n1d()
+class TestAsyncCheckpoint(flow.unittest.TestCase):
+    def test_wait(test_case):
+        _test_async_checkpoint(test_case, 2, 64 * 1024 * 1024)
+
+    def test_wait_with_small_staging(test_case):
+        # the variable does not fit the staging memory, so Write blocks on the writers
+        _test_async_checkpoint(test_case, 1, 1024)
+
+
+if __name__ == "__main__":
+    unittest.main()
@@ -0,0 +1,90 @@
+"""
+Copyright 2020 The OneFlow Authors. All rights reserved.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+"""
+import math
+import unittest
+import numpy as np
+import oneflow as flow
+import oneflow.typing as oft
+
+
+def _np_gelu(x):
+    return 0.5 * x * (1 + np.vectorize(math.erf)(x / math.sqrt(2)))
+
+
+def _run_fused_elementwise(inputs, program):
+    flow.clear_default_session()
+    func_config = flow.FunctionConfig()
+    func_config.default_data_type(flow.float)
+
+    @flow.global_function(function_config=func_config)
+    def FusedElementwiseJob(
+        a: oft.Numpy.Placeholder(inputs[0].shape),
+        b: oft.Numpy.Placeholder(inputs[1].shape),
+    ):
+        with flow.scope.placement("cpu", "0:0"):
+            return flow.math.fused_elementwise([a, b], program)
+
+    return FusedElementwiseJob(*inputs).get().numpy()
+
+
+@flow.unittest.skip_unless_1n1d()
+class TestFusedElementwise(flow.unittest.TestCase):
+    def test_bias_gelu_scale(test_case):
+        x = np.random.uniform(-5, 5, size=(7, 33, 5)).astype(np.float32)
+        bias = np.random.uniform(-1, 1, size=(33, 1)).astype(np.float32)
+        out = _run_fused_elementwise(
+            (x, bias), ["in:0", "in:1", "add", "gelu", "const:0.5", "mul"]
+        )
+        test_case.assertTrue(
+            np.allclose(out, _np_gelu(x + bias) * 0.5, rtol=1e-5, atol=1e-6)
+        )
+
+    def test_functions(test_case):
+        a = np.random.uniform(0.1, 4, size=(1000,)).astype(np.float32)
+        b = np.random.uniform(-4, 4, size=(1000,)).astype(np.float32)
+        program = [
+            "in:0",
+            "log",
+            "in:1",
+            "tanh",
+            "mul",
+            "in:1",
+            "sigmoid",
+            "in:0",
+            "sqrt",
+            "maximum",
+            "sub",
+            "in:1",
+            "exp",
+            "in:1",
+            "relu",
+            "square",
+            "minimum",
+            "in:0",
+            "negative",
+            "abs",
+            "div",
+            "add",
+        ]
+        out = _run_fused_elementwise((a, b), program)
+        sigmoid = 1 / (1 + np.exp(-b))
+        expected = np.log(a) * np.tanh(b) - np.maximum(sigmoid, np.sqrt(a))
+        expected += np.minimum(np.exp(b), np.square(np.maximum(b, 0))) / a
+        test_case.assertTrue(np.allclose(out, expected, rtol=1e-5, atol=1e-5))
+
+
+if __name__ == "__main__":
+    unittest.main()
@@ -0,0 +1,92 @@
+"""
+Copyright 2020 The OneFlow Authors. All rights reserved.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+"""
+import os
+import struct
+import tempfile
+import unittest
+from collections import OrderedDict
+
+import numpy as np
+import oneflow as flow
+import oneflow.core.record.record_pb2 as record_util
+import oneflow.typing as oft
+from test_util import GenArgList
+
+# records of 5 values and of 3, so that the short record of the second batch lands in the slot
+# a full record of the first batch was decoded into
+values_list = [
+    [1.0, 2.0, 3.0, 4.0, 5.0],
+    [6.0, 7.0, 8.0],
+    [9.0, 10.0, 11.0],
+    [12.0, 13.0, 14.0, 15.0, 16.0],
+]
+
+
+def _write_records(data_dir):
+    with open(os.path.join(data_dir, "part-0"), "wb") as f:
+        for values in values_list:
+            record = record_util.OFRecord()
+            record.feature["x"].float_list.value.extend(values)
+            serialized = record.SerializeToString()
+            f.write(struct.pack("q", len(serialized)))
+            f.write(serialized)
+
+
+def _run_test(test_case, lazy_decoding, dim1_varying_length):
+    flow.clear_default_session()
+    func_config = flow.FunctionConfig()
+    func_config.default_data_type(flow.float)
+    data_dir = tempfile.mkdtemp()
+    _write_records(data_dir)
+
+    @flow.global_function(function_config=func_config)
+    def raw_decoder_job() -> oft.Numpy:
+        with flow.scope.placement("cpu", "0:0"):
+            ofrecord = flow.data.ofrecord_reader(
+                data_dir, batch_size=2, lazy_decoding=lazy_decoding
+            )
+            return flow.data.OFRecordRawDecoder(
+                ofrecord,
+                "x",
+                shape=(5,),
+                dtype=flow.float,
+                dim1_varying_length=dim1_varying_length,
+                auto_zero_padding=True,
+            )
+
+    # auto_zero_padding pads the short records with zeros, whatever dim1_varying_length is
+    for i in range(2):
+        out = raw_decoder_job()
+        for j in range(2):
+            values = values_list[i * 2 + j]
+            expected = np.zeros((5,), dtype=np.float32)
+            expected[: len(values)] = values
+            test_case.assertTrue(np.array_equal(out[j], expected))
+
+
+@flow.unittest.skip_unless_1n1d()
+class TestOFRecordRawDecoder(flow.unittest.TestCase):
+    def test_auto_zero_padding(test_case):
+        arg_dict = OrderedDict()
+        arg_dict["test_case"] = [test_case]
+        arg_dict["lazy_decoding"] = [False, True]
+        arg_dict["dim1_varying_length"] = [False, True]
+        for arg in GenArgList(arg_dict):
+            _run_test(*arg)
+
+
+if __name__ == "__main__":
+    unittest.main()
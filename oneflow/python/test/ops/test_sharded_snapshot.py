@@ -0,0 +1,75 @@
+"""
+Copyright 2020 The OneFlow Authors. All rights reserved.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+"""
+import os
+import tempfile
+import unittest
+
+import numpy as np
+import oneflow as flow
+import oneflow.core.register.tensor_slice_view_pb2 as tensor_slice_view_pb
+import oneflow.typing as tp
+from google.protobuf import text_format
+
+
+def _write_sharded_snapshot(snapshot_dir, var_np, rows_list):
+    # the layout ModelSaveV2 writes for a variable split along the first axis: the rows of each
+    # shard and the index of those rows
+    shard_dir = os.path.join(snapshot_dir, "var", "out-shards")
+    os.makedirs(shard_dir)
+    for shard_id, (begin, end) in enumerate(rows_list):
+        var_np[begin:end].tofile(os.path.join(shard_dir, str(shard_id)))
+        index = tensor_slice_view_pb.TensorSliceViewProto()
+        for axis, size in enumerate(var_np.shape):
+            dim = index.dim.add()
+            dim.begin = begin if axis == 0 else 0
+            dim.end = end if axis == 0 else size
+        with open(os.path.join(shard_dir, str(shard_id) + ".index"), "w") as f:
+            f.write(text_format.MessageToString(index))
+
+
+def _test_load_sharded_snapshot(test_case, eager):
+    flow.clear_default_session()
+    flow.enable_eager_execution(eager)
+    shape = (10, 3)
+    var_np = np.random.rand(*shape).astype(np.float32)
+    snapshot_dir = tempfile.mkdtemp()
+    _write_sharded_snapshot(snapshot_dir, var_np, [(0, 4), (4, 7), (7, 10)])
+
+    @flow.global_function(type="predict")
+    def get_var() -> tp.Numpy:
+        return flow.get_variable(
+            name="var",
+            shape=shape,
+            dtype=flow.float,
+            initializer=flow.zeros_initializer(),
+        )
+
+    # loaded and not initialized, in eager mode when get_var creates the variable
+    flow.train.CheckPoint().load(snapshot_dir)
+    test_case.assertTrue(np.array_equal(get_var(), var_np))
+
+
+@flow.unittest.skip_unless_1n1d()
+class TestShardedSnapshot(flow.unittest.TestCase):
+    def test_lazy_load(test_case):
+        _test_load_sharded_snapshot(test_case, False)
+
+    def test_eager_load(test_case):
+        _test_load_sharded_snapshot(test_case, True)
+
+
+if __name__ == "__main__":
+    unittest.main()
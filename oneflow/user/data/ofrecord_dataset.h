@@ -21,6 +21,7 @@ limitations under the License.
 #include "oneflow/core/common/str_util.h"
 #include "oneflow/core/framework/op_kernel.h"
 #include "oneflow/core/persistence/persistent_in_stream.h"
+#include "oneflow/core/persistence/mapped_in_stream.h"
 #include "oneflow/core/job/job_set.pb.h"
 
 namespace oneflow {
@@ -56,10 +57,21 @@ class OFRecordDataset final : public Dataset<TensorBuffer> {
     range_ = bs.At(parallel_id_);
     std::vector<std::string> local_file_paths = GetLocalFilePaths();
     save_to_local_ = Global<const IOConf>::Get()->save_downloaded_file_to_local_fs();
-    in_stream_.reset(
-        new PersistentInStream(DataFS(), local_file_paths, !shuffle_after_epoch_, save_to_local_));
+    use_mmap_ = ctx->Attr<bool>("use_mmap");
+    if (use_mmap_ && DataFS() != LocalFS()) {
+      LOG(WARNING) << "use_mmap needs the data on the local file system, read by streams instead";
+      use_mmap_ = false;
+    }
+    if (use_mmap_) {
+      mapped_in_stream_.reset(new MappedInStream(local_file_paths));
+    } else {
+      in_stream_.reset(new PersistentInStream(DataFS(), local_file_paths, !shuffle_after_epoch_,
+                                              save_to_local_));
+    }
+  }
+  ~OFRecordDataset() {
+    if (in_stream_) { LogReadAheadStats(); }
   }
-  ~OFRecordDataset() = default;
 
   LoadTargetPtrList Next() override {
     LoadTargetPtrList ret;
@@ -71,6 +83,10 @@ class OFRecordDataset final : public Dataset<TensorBuffer> {
 
  private:
   void ReadSample(TensorBuffer& tensor) {
+    if (use_mmap_) {
+      ReadMappedSample(tensor);
+      return;
+    }
     int64_t OFRecord_size = -1;
     char* size_ptr = reinterpret_cast<char*>(&OFRecord_size);
     if (in_stream_->ReadFully(size_ptr, sizeof(int64_t)) != 0) {
@@ -82,13 +98,47 @@ class OFRecordDataset final : public Dataset<TensorBuffer> {
     CHECK_EQ(in_stream_->ReadFully(tensor.mut_data<char>(), OFRecord_size), 0);
   }
 
+  // the record borrows the mapping, which stays alive until the last record of its file is gone
+  void ReadMappedSample(TensorBuffer& tensor) {
+    int64_t OFRecord_size = -1;
+    char* size_ptr = reinterpret_cast<char*>(&OFRecord_size);
+    if (mapped_in_stream_->ReadFully(size_ptr, sizeof(int64_t)) != 0) {
+      if (shuffle_after_epoch_) {
+        ShuffleAfterEpoch();
+      } else {
+        mapped_in_stream_.reset(new MappedInStream(GetLocalFilePaths()));
+      }
+      CHECK_EQ(mapped_in_stream_->ReadFully(size_ptr, sizeof(int64_t)), 0);
+    }
+    CHECK_GT(OFRecord_size, 0);
+    char* record = nullptr;
+    CHECK_EQ(mapped_in_stream_->Read(OFRecord_size, &record), 0);
+    tensor.Borrow(Shape({OFRecord_size}), DataType::kChar, record,
+                  mapped_in_stream_->current_file());
+  }
+
   void ShuffleAfterEpoch() {
     CHECK(shuffle_after_epoch_);
     current_epoch_++;  // move to next epoch
     std::mt19937 g(kOneflowDatasetSeed + current_epoch_);
     std::shuffle(data_file_paths_.begin(), data_file_paths_.end(), g);
     std::vector<std::string> local_file_paths = GetLocalFilePaths();
-    in_stream_.reset(new PersistentInStream(DataFS(), local_file_paths, false, save_to_local_));
+    if (use_mmap_) {
+      mapped_in_stream_.reset(new MappedInStream(local_file_paths));
+    } else {
+      LogReadAheadStats();
+      in_stream_.reset(new PersistentInStream(DataFS(), local_file_paths, false, save_to_local_));
+    }
+  }
+
+  // how fast the files came in, and how long the reader waited for them
+  void LogReadAheadStats() const {
+    const ReadAheadStats stats = in_stream_->read_ahead_stats();
+    if (stats.bytes_read == 0) { return; }
+    const double mb = static_cast<double>(stats.bytes_read) / (1024 * 1024);
+    LOG(INFO) << "OFRecord reader " << parallel_id_ << ": read " << mb << " MB in "
+              << stats.elapsed_s << " s, " << mb / stats.elapsed_s << " MB/s, stalled "
+              << stats.stall_s << " s";
   }
 
   std::vector<std::string> GetLocalFilePaths() {
@@ -106,7 +156,9 @@ class OFRecordDataset final : public Dataset<TensorBuffer> {
   Range range_;
   std::vector<std::string> data_file_paths_;
   bool save_to_local_;
+  bool use_mmap_;
   std::unique_ptr<PersistentInStream> in_stream_;
+  std::unique_ptr<MappedInStream> mapped_in_stream_;
 };
 
 }  // namespace data
@@ -34,11 +34,17 @@ class OFRecordParser final : public Parser<TensorBuffer> {
   void Parse(std::shared_ptr<LoadTargetPtrList> batch_data,
              user_op::KernelComputeContext* ctx) override {
     user_op::Tensor* out_tensor = ctx->Tensor4ArgNameAndIndex("out", 0);
-    OFRecord* dptr = out_tensor->mut_dptr<OFRecord>();
-    MultiThreadLoop(batch_data->size(), [&](size_t i) {
-      TensorBuffer* buffer = batch_data->at(i).get();
-      CHECK(dptr[i].ParseFromArray(buffer->data<char>(), buffer->shape().elem_cnt()));
-    });
+    if (out_tensor->data_type() == DataType::kTensorBuffer) {
+      // lazy decoding, the decoders read the serialized records
+      TensorBuffer* dptr = out_tensor->mut_dptr<TensorBuffer>();
+      FOR_RANGE(size_t, i, 0, batch_data->size()) { dptr[i].Swap(batch_data->at(i).get()); }
+    } else {
+      OFRecord* dptr = out_tensor->mut_dptr<OFRecord>();
+      MultiThreadLoop(batch_data->size(), [&](size_t i) {
+        TensorBuffer* buffer = batch_data->at(i).get();
+        CHECK(dptr[i].ParseFromArray(buffer->data<char>(), buffer->shape().elem_cnt()));
+      });
+    }
     if (batch_data->size() != out_tensor->shape().elem_cnt()) {
       CHECK_EQ(out_tensor->mut_shape()->NumAxes(), 1);
       out_tensor->mut_shape()->Set(0, batch_data->size());
@@ -22,6 +22,7 @@ limitations under the License.
 #include "oneflow/core/common/str_util.h"
 #include "oneflow/core/framework/op_kernel.h"
 #include "oneflow/core/persistence/persistent_in_stream.h"
+#include "oneflow/core/persistence/mapped_in_stream.h"
 #include "oneflow/core/job/job_set.pb.h"
 
 #define XXH_NAMESPACE LZ4_
@@ -84,6 +85,11 @@ class OneRecDataset final : public Dataset<TensorBuffer> {
     parallel_num_ = ctx->parallel_ctx().parallel_num();
     BalancedSplitter bs(data_file_paths_.size(), parallel_num_);
     range_ = bs.At(parallel_id_);
+    use_mmap_ = ctx->Attr<bool>("use_mmap");
+    if (use_mmap_ && DataFS() != LocalFS()) {
+      LOG(WARNING) << "use_mmap needs the data on the local file system, read by streams instead";
+      use_mmap_ = false;
+    }
     ResetInstream();
     hash_state_ = LZ4_XXH64_createState();
   }
@@ -105,11 +111,11 @@ class OneRecDataset final : public Dataset<TensorBuffer> {
     static_assert(sizeof(OneRecFrameHeader) == kHeaderSize, "");
     OneRecFrameHeaderView header_view{};
     static_assert(sizeof(header_view.header) == kHeaderSize, "");
-    int32_t read_status = in_stream_->ReadFully(header_view.raw, kHeaderSize);
+    int32_t read_status = ReadFully(header_view.raw, kHeaderSize);
     if (read_status == -1) {
       ResetInstream();
       current_epoch_++;
-      CHECK_EQ(in_stream_->ReadFully(header_view.raw, kHeaderSize), 0);
+      CHECK_EQ(ReadFully(header_view.raw, kHeaderSize), 0);
     } else {
       CHECK_EQ(read_status, 0);
     }
@@ -123,14 +129,22 @@ class OneRecDataset final : public Dataset<TensorBuffer> {
     CHECK_NE(XXH64_update(hash_state_, header_view.raw, kHeaderSizeWithoutDigest), XXH_ERROR);
     CHECK_EQ(ByteSwap(header_view.header.digest), LZ4_XXH64_digest(hash_state_));
     const int32_t padded_size = RoundUp(payload_size, kPayloadAlignmentSize) - payload_size;
-    tensor.Resize(Shape({payload_size}), DataType::kChar);
-    char* body = tensor.mut_data<char>();
-    CHECK_EQ(in_stream_->ReadFully(body, payload_size), 0);
+    char* body = nullptr;
     char padded[kPayloadAlignmentSize];
-    CHECK_EQ(in_stream_->ReadFully(padded, padded_size), 0);  // read padded
+    if (use_mmap_) {
+      // the payload borrows the mapping instead of being copied
+      CHECK_EQ(mapped_in_stream_->Read(payload_size, &body), 0);
+      tensor.Borrow(Shape({payload_size}), DataType::kChar, body,
+                    mapped_in_stream_->current_file());
+    } else {
+      tensor.Resize(Shape({payload_size}), DataType::kChar);
+      body = tensor.mut_data<char>();
+      CHECK_EQ(in_stream_->ReadFully(body, payload_size), 0);
+    }
+    CHECK_EQ(ReadFully(padded, padded_size), 0);  // read padded
     static_assert(sizeof(OneRecFrameFooterView) == kDigestFieldSize, "");
     OneRecFrameFooterView footer_view{};
-    CHECK_EQ(in_stream_->ReadFully(footer_view.raw, kDigestFieldSize), 0);  // read footer
+    CHECK_EQ(ReadFully(footer_view.raw, kDigestFieldSize), 0);  // read footer
     CHECK_NE(XXH64_reset(hash_state_, seed), XXH_ERROR);
     CHECK_NE(LZ4_XXH64_update(hash_state_, body, payload_size), XXH_ERROR);
     CHECK_EQ(ByteSwap(footer_view.digest), LZ4_XXH64_digest(hash_state_));
@@ -142,7 +156,15 @@ class OneRecDataset final : public Dataset<TensorBuffer> {
       std::shuffle(data_file_paths_.begin(), data_file_paths_.end(), g);
     }
     std::vector<std::string> file_paths = GetLocalFilePaths();
-    in_stream_.reset(new PersistentInStream(DataFS(), file_paths, false, false));
+    if (use_mmap_) {
+      mapped_in_stream_.reset(new MappedInStream(file_paths));
+    } else {
+      in_stream_.reset(new PersistentInStream(DataFS(), file_paths, false, false));
+    }
+  }
+
+  int32_t ReadFully(char* s, size_t n) {
+    return use_mmap_ ? mapped_in_stream_->ReadFully(s, n) : in_stream_->ReadFully(s, n);
   }
 
   std::vector<std::string> GetLocalFilePaths() {
@@ -158,7 +180,9 @@ class OneRecDataset final : public Dataset<TensorBuffer> {
   int32_t parallel_num_;
   Range range_;
   std::vector<std::string> data_file_paths_;
+  bool use_mmap_;
   std::unique_ptr<PersistentInStream> in_stream_;
+  std::unique_ptr<MappedInStream> mapped_in_stream_;
   XXH64_state_t* hash_state_;
   int32_t batch_size_;
 };
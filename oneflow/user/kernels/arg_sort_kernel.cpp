@@ -14,7 +14,7 @@ See the License for the specific language governing permissions and
 limitations under the License.
 */
 #include "oneflow/core/framework/framework.h"
-#include "oneflow/core/kernel/new_kernel_util.h"
+#include "oneflow/user/kernels/sort_cpu_kernel_util.h"
 
 namespace oneflow {
 
@@ -28,13 +28,15 @@ class CpuArgSortKernel final : public user_op::OpKernel {
   void Compute(user_op::KernelComputeContext* ctx) const override {
     const user_op::Tensor* in = ctx->Tensor4ArgNameAndIndex("in", 0);
     user_op::Tensor* out = ctx->Tensor4ArgNameAndIndex("out", 0);
+    user_op::Tensor* tmp_buffer = ctx->Tensor4ArgNameAndIndex("tmp_buffer", 0);
 
-    const int32_t instance_size = in->shape().At(in->shape().NumAxes() - 1);
-    const int32_t instance_num = in->shape().elem_cnt() / instance_size;
+    const int64_t instance_size = in->shape().At(in->shape().NumAxes() - 1);
+    const int64_t instance_num = in->shape().elem_cnt() / instance_size;
     const std::string& direction = ctx->Attr<std::string>("direction");
     const bool is_ascending = direction == "ASCENDING";
     const bool is_descending = direction == "DESCENDING";
-    FOR_RANGE(int32_t, i, 0, instance_num) {
+    CHECK(is_ascending || is_descending);
+    const auto SortInstance = [&](int64_t i, bool parallel) {
       const T* in_ptr_i = in->dptr<T>() + i * instance_size;
       int32_t* out_ptr_i = out->mut_dptr<int32_t>() + i * instance_size;
       std::iota(out_ptr_i, out_ptr_i + instance_size, 0);
@@ -44,26 +46,37 @@ class CpuArgSortKernel final : public user_op::OpKernel {
         if (l == r) {
           return lhs < rhs;
         } else {
-          if (is_ascending) {
-            return l < r;
-          } else if (is_descending) {
-            return l > r;
-          } else {
-            UNIMPLEMENTED();
-          }
+          return is_ascending ? l < r : l > r;
         }
       };
-      std::sort(out_ptr_i, out_ptr_i + instance_size, comp);
+      if (parallel) {
+        CpuParallelSort(out_ptr_i, instance_size, comp, tmp_buffer->mut_dptr<int32_t>());
+      } else {
+        std::sort(out_ptr_i, out_ptr_i + instance_size, comp);
+      }
+    };
+    if (instance_size < kCpuSortParallelMinSize) {
+      const int64_t grain_size = std::max<int64_t>(kCpuSortParallelMinSize / instance_size, 1);
+      ParallelFor(instance_num, grain_size, [&](int64_t begin, int64_t end) {
+        FOR_RANGE(int64_t, i, begin, end) { SortInstance(i, false); }
+      });
+    } else {
+      FOR_RANGE(int64_t, i, 0, instance_num) { SortInstance(i, true); }
     }
   }
   bool AlwaysComputeWhenAllOutputsEmpty() const override { return false; }
 };
 
-#define REGISTER_CPU_ARG_SORT_KERNEL(dtype)               \
-  REGISTER_USER_KERNEL("arg_sort")                        \
-      .SetCreateFn<CpuArgSortKernel<dtype>>()             \
-      .SetIsMatchedHob((user_op::HobDeviceTag() == "cpu") \
-                       & (user_op::HobDataType("in", 0) == GetDataType<dtype>::value));
+#define REGISTER_CPU_ARG_SORT_KERNEL(dtype)                                                   \
+  REGISTER_USER_KERNEL("arg_sort")                                                            \
+      .SetCreateFn<CpuArgSortKernel<dtype>>()                                                 \
+      .SetIsMatchedHob((user_op::HobDeviceTag() == "cpu")                                     \
+                       & (user_op::HobDataType("in", 0) == GetDataType<dtype>::value))        \
+      .SetInferTmpSizeFn([](user_op::InferContext* ctx) -> size_t {                           \
+        const Shape* in_shape = ctx->Shape4ArgNameAndIndex("in", 0);                          \
+        const int64_t instance_size = in_shape->At(in_shape->NumAxes() - 1);                  \
+        return instance_size < kCpuSortParallelMinSize ? 0 : instance_size * sizeof(int32_t); \
+      });
 
 REGISTER_CPU_ARG_SORT_KERNEL(float)
 REGISTER_CPU_ARG_SORT_KERNEL(double)
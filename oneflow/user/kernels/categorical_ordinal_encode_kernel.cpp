@@ -32,12 +32,15 @@ class CategoricalOrdinalEncodeKernel final : public user_op::OpKernel {
     user_op::Tensor* table = ctx->Tensor4ArgNameAndIndex("table", 0);
     user_op::Tensor* size = ctx->Tensor4ArgNameAndIndex("size", 0);
     user_op::Tensor* out = ctx->Tensor4ArgNameAndIndex("out", 0);
+    user_op::Tensor* tmp_buffer = ctx->Tensor4ArgNameAndIndex("tmp_buffer", 0);
     const int64_t table_elem_cnt = table->shape().elem_cnt();
     CHECK_EQ(table_elem_cnt % 2, 0);
     const int64_t capacity = table_elem_cnt / 2;
     CategoricalOrdinalEncodeKernelUtil<device_type, T>::Encode(
         ctx->device_ctx(), capacity, table->mut_dptr<T>(), size->mut_dptr<T>(),
-        in->shape().elem_cnt(), in->dptr<T>(), out->mut_dptr<T>());
+        in->shape().elem_cnt(), in->dptr<T>(), out->mut_dptr<T>(),
+        tmp_buffer == nullptr ? nullptr : tmp_buffer->mut_dptr(),
+        tmp_buffer == nullptr ? 0 : tmp_buffer->shape().elem_cnt());
   }
   bool AlwaysComputeWhenAllOutputsEmpty() const override { return true; }
 };
@@ -46,7 +49,12 @@ class CategoricalOrdinalEncodeKernel final : public user_op::OpKernel {
   REGISTER_USER_KERNEL("CategoricalOrdinalEncode")                               \
       .SetCreateFn<CategoricalOrdinalEncodeKernel<device, cpp_type>>()           \
       .SetIsMatchedHob((user_op::HobDeviceTag() == device)                       \
-                       & (user_op::HobDataType("in", 0) == proto_type));
+                       & (user_op::HobDataType("in", 0) == proto_type))          \
+      .SetInferTmpSizeFn([](user_op::InferContext* ctx) -> size_t {              \
+        using Util = CategoricalOrdinalEncodeKernelUtil<device, cpp_type>;       \
+        return Util::GetEncodeWorkspaceSizeInBytes(                              \
+            ctx->TensorDesc4ArgNameAndIndex("in", 0)->shape().elem_cnt());       \
+      });
 
 REGISTER_CATEGORICAL_ORDINAL_ENCODE_KERNEL(DeviceType::kCPU, DataType::kInt32, int32_t);
 REGISTER_CATEGORICAL_ORDINAL_ENCODE_KERNEL(DeviceType::kCPU, DataType::kInt64, int64_t);
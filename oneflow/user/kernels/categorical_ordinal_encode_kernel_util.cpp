@@ -14,39 +14,79 @@ See the License for the specific language governing permissions and
 limitations under the License.
 */
 #include "oneflow/user/kernels/categorical_ordinal_encode_kernel_util.h"
+#include "oneflow/core/kernel/util/host_concurrent_hash_table.h"
+#include "oneflow/core/thread/thread_manager.h"
 
 namespace oneflow {
 
+namespace {
+
+// Probes the table from hash % capacity on, as the gpu kernel does. Returns the slot holding h,
+// or the empty slot where it would go, or -1 when the table is full of other keys.
+template<typename T>
+int64_t FindSlot(int64_t capacity, const T* table, const T h) {
+  int64_t idx = static_cast<int64_t>(static_cast<size_t>(h) % static_cast<size_t>(capacity));
+  for (int64_t count = 0; count < capacity; ++count) {
+    const T key = table[idx * 2];
+    if (key == h || key == 0) { return idx; }
+    idx += 1;
+    if (idx == capacity) { idx = 0; }
+  }
+  return -1;
+}
+
+}  // namespace
+
+// The hashes of a batch are made distinct first, which gives each distinct hash its rank in
+// order of first appearance. Distinct hashes are looked up in the table in parallel and the new
+// ones are inserted in that order, so new ids do not depend on the threads.
 template<typename T>
 struct CategoricalOrdinalEncodeKernelUtil<DeviceType::kCPU, T> {
   static void Encode(DeviceCtx* ctx, int64_t capacity, T* table, T* size, int64_t n, const T* hash,
-                     T* out) {
-    for (int64_t i = 0; i < n; ++i) {
-      const T h = hash[i];
-      bool success = false;
-      for (int64_t count = 0; count < capacity; ++count) {
-        size_t idx =
-            (static_cast<size_t>(h) + static_cast<size_t>(count)) % static_cast<size_t>(capacity);
-        T* k_ptr = table + idx * 2;
-        T* v_ptr = k_ptr + 1;
-        if (*k_ptr == h) {
-          out[i] = *v_ptr;
-          success = true;
-          break;
-        } else if (*k_ptr == 0) {
-          T new_size = *size + 1;
-          *k_ptr = h;
-          *v_ptr = new_size;
-          out[i] = new_size;
-          *size = new_size;
-          success = true;
-          break;
-        } else {
-          continue;
-        }
+                     T* out, void* workspace, int64_t workspace_size_in_bytes) {
+    CHECK_LE(GetEncodeWorkspaceSizeInBytes(n), workspace_size_in_bytes);
+    const int64_t hash_table_size = HostConcurrentHashTable<T>::WorkspaceSizeInBytes(n);
+    HostConcurrentHashTable<T> hash_table(n, hash, workspace, hash_table_size);
+    // the index of the first appearance of each distinct hash, then its id
+    int64_t* unique_index =
+        reinterpret_cast<int64_t*>(static_cast<char*>(workspace) + hash_table_size);
+    T* unique_id = reinterpret_cast<T*>(unique_index + n);
+    ParallelFor(hash_table.capacity(), kParallelForGrainSize,
+                [&](int64_t begin, int64_t end) { hash_table.Clear(begin, end); });
+    ParallelFor(n, kParallelForGrainSize,
+                [&](int64_t begin, int64_t end) { hash_table.Insert(begin, end, false); });
+    ParallelFor(hash_table.num_chunks(), 1,
+                [&](int64_t begin, int64_t end) { hash_table.CountUnique(begin, end); });
+    const int64_t num_unique = hash_table.ScanChunks();
+    ParallelFor(hash_table.num_chunks(), 1, [&](int64_t begin, int64_t end) {
+      hash_table.ForEachUnique(begin, end,
+                               [&](int64_t i, int64_t rank) { unique_index[rank] = i; });
+    });
+    // 0 for hash 0 and hashes not in the table yet, which are told apart below
+    ParallelFor(num_unique, kParallelForGrainSize, [&](int64_t begin, int64_t end) {
+      FOR_RANGE(int64_t, rank, begin, end) {
+        const T h = hash[unique_index[rank]];
+        const int64_t idx = h == 0 ? -1 : FindSlot<T>(capacity, table, h);
+        unique_id[rank] = idx == -1 ? 0 : table[idx * 2 + 1];
       }
-      CHECK(success);
+    });
+    FOR_RANGE(int64_t, rank, 0, num_unique) {
+      const T h = hash[unique_index[rank]];
+      if (h == 0 || unique_id[rank] != 0) { continue; }
+      const int64_t idx = FindSlot<T>(capacity, table, h);
+      CHECK_NE(idx, -1);
+      const T new_size = *size + 1;
+      table[idx * 2] = h;
+      table[idx * 2 + 1] = new_size;
+      unique_id[rank] = new_size;
+      *size = new_size;
     }
+    ParallelFor(n, kParallelForGrainSize, [&](int64_t begin, int64_t end) {
+      FOR_RANGE(int64_t, i, begin, end) { out[i] = unique_id[hash_table.Rank(i)]; }
+    });
+  }
+  static int64_t GetEncodeWorkspaceSizeInBytes(int64_t n) {
+    return HostConcurrentHashTable<T>::WorkspaceSizeInBytes(n) + n * (sizeof(int64_t) + sizeof(T));
   }
 };
 
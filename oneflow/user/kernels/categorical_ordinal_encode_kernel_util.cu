@@ -108,10 +108,11 @@ __global__ void EncodeGpu(const size_t capacity, T* table, T* size, const int64_
 template<typename T>
 struct CategoricalOrdinalEncodeKernelUtil<DeviceType::kGPU, T> {
   static void Encode(DeviceCtx* ctx, int64_t capacity, T* table, T* size, int64_t n, const T* hash,
-                     T* out) {
+                     T* out, void* workspace, int64_t workspace_size_in_bytes) {
     EncodeGpu<T><<<BlocksNum4ThreadsNum(n), kCudaThreadsNumPerBlock, 0, ctx->cuda_stream()>>>(
         capacity, table, size, n, hash, out);
   }
+  static int64_t GetEncodeWorkspaceSizeInBytes(int64_t n) { return 0; }
 };
 
 #define INSTANTIATE_CATEGORICAL_ORDINAL_ENCODE_KERNEL_UTIL_GPU(type_cpp, type_proto) \
@@ -23,7 +23,8 @@ namespace oneflow {
 template<DeviceType device_type, typename T>
 struct CategoricalOrdinalEncodeKernelUtil {
   static void Encode(DeviceCtx* ctx, int64_t capacity, T* table, T* size, int64_t n, const T* hash,
-                     T* out);
+                     T* out, void* workspace, int64_t workspace_size_in_bytes);
+  static int64_t GetEncodeWorkspaceSizeInBytes(int64_t n);
 };
 
 }  // namespace oneflow
@@ -0,0 +1,431 @@
+/*
+Copyright 2020 The OneFlow Authors. All rights reserved.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+*/
+#include "oneflow/user/kernels/conv_cpu_kernel_util.h"
+#include "oneflow/core/common/cpu_simd.h"
+
+namespace oneflow {
+
+namespace {
+
+// F(2x2, 3x3) works on 4x4 input tiles which give 2x2 output tiles
+constexpr int64_t kWinogradTileSize = 4;
+constexpr int64_t kWinogradNumPositions = kWinogradTileSize * kWinogradTileSize;
+constexpr int64_t kWinogradTileBlock = 16;
+// rows of the transformed input multiplied at a time, kWinogradTileBlock is a multiple of it
+constexpr int64_t kMatMulRows = 4;
+
+// strides of an image of the batch, with the channels first or last
+struct ImageLayout {
+  int64_t batch_stride;
+  int64_t channel_stride;
+  int64_t d_stride;
+  int64_t h_stride;
+  int64_t w_stride;
+};
+
+ImageLayout MakeImageLayout(bool channels_last, int64_t channels, const int64_t* dims) {
+  ImageLayout layout;
+  const int64_t spatial = dims[0] * dims[1] * dims[2];
+  layout.batch_stride = channels * spatial;
+  if (channels_last) {
+    layout.channel_stride = 1;
+    layout.w_stride = channels;
+  } else {
+    layout.channel_stride = spatial;
+    layout.w_stride = 1;
+  }
+  layout.h_stride = layout.w_stride * dims[2];
+  layout.d_stride = layout.h_stride * dims[1];
+  return layout;
+}
+
+// c = a * b, a is kMatMulRows x k, b is k x n, all row major
+template<typename T>
+void MatMulRows(int64_t k, int64_t n, const T* a, const T* b, T* c) {
+  using Vec = simd::SimdVec<T>;
+  constexpr int64_t kWidth = Vec::kWidth;
+  const int64_t vec_n = n / (2 * kWidth) * (2 * kWidth);
+  const T* a0 = a;
+  const T* a1 = a + k;
+  const T* a2 = a + 2 * k;
+  const T* a3 = a + 3 * k;
+  for (int64_t j = 0; j < vec_n; j += 2 * kWidth) {
+    typename Vec::Reg c00 = Vec::Zero();
+    typename Vec::Reg c01 = Vec::Zero();
+    typename Vec::Reg c10 = Vec::Zero();
+    typename Vec::Reg c11 = Vec::Zero();
+    typename Vec::Reg c20 = Vec::Zero();
+    typename Vec::Reg c21 = Vec::Zero();
+    typename Vec::Reg c30 = Vec::Zero();
+    typename Vec::Reg c31 = Vec::Zero();
+    const T* b_col = b + j;
+    FOR_RANGE(int64_t, l, 0, k) {
+      const typename Vec::Reg b0 = Vec::Load(b_col);
+      const typename Vec::Reg b1 = Vec::Load(b_col + kWidth);
+      b_col += n;
+      typename Vec::Reg a_l = Vec::Set1(a0[l]);
+      c00 = Vec::Fma(a_l, b0, c00);
+      c01 = Vec::Fma(a_l, b1, c01);
+      a_l = Vec::Set1(a1[l]);
+      c10 = Vec::Fma(a_l, b0, c10);
+      c11 = Vec::Fma(a_l, b1, c11);
+      a_l = Vec::Set1(a2[l]);
+      c20 = Vec::Fma(a_l, b0, c20);
+      c21 = Vec::Fma(a_l, b1, c21);
+      a_l = Vec::Set1(a3[l]);
+      c30 = Vec::Fma(a_l, b0, c30);
+      c31 = Vec::Fma(a_l, b1, c31);
+    }
+    Vec::Store(c + j, c00);
+    Vec::Store(c + j + kWidth, c01);
+    Vec::Store(c + n + j, c10);
+    Vec::Store(c + n + j + kWidth, c11);
+    Vec::Store(c + 2 * n + j, c20);
+    Vec::Store(c + 2 * n + j + kWidth, c21);
+    Vec::Store(c + 3 * n + j, c30);
+    Vec::Store(c + 3 * n + j + kWidth, c31);
+  }
+  FOR_RANGE(int64_t, j, vec_n, n) {
+    T sum[kMatMulRows] = {0};
+    FOR_RANGE(int64_t, l, 0, k) {
+      const T b_lj = b[l * n + j];
+      FOR_RANGE(int64_t, i, 0, kMatMulRows) { sum[i] += a[i * k + l] * b_lj; }
+    }
+    FOR_RANGE(int64_t, i, 0, kMatMulRows) { c[i * n + j] = sum[i]; }
+  }
+}
+
+// y[i] = y[i] + x[i] * w[i] for i in [0, size)
+template<typename T>
+void FmaRow(int64_t size, const T* x, const T* w, T* y) {
+  using Vec = simd::SimdVec<T>;
+  constexpr int64_t kWidth = Vec::kWidth;
+  const int64_t vec_size = size / kWidth * kWidth;
+  for (int64_t i = 0; i < vec_size; i += kWidth) {
+    Vec::Store(y + i, Vec::Fma(Vec::Load(x + i), Vec::Load(w + i), Vec::Load(y + i)));
+  }
+  FOR_RANGE(int64_t, i, vec_size, size) { y[i] += x[i] * w[i]; }
+}
+
+// y[i] = y[i] + b for i in [0, size)
+template<typename T>
+void AddScalarRow(int64_t size, T b, T* y) {
+  using Vec = simd::SimdVec<T>;
+  constexpr int64_t kWidth = Vec::kWidth;
+  const int64_t vec_size = size / kWidth * kWidth;
+  const typename Vec::Reg b_v = Vec::Set1(b);
+  for (int64_t i = 0; i < vec_size; i += kWidth) {
+    Vec::Store(y + i, Vec::Add(Vec::Load(y + i), b_v));
+  }
+  FOR_RANGE(int64_t, i, vec_size, size) { y[i] += b; }
+}
+
+// y[i] = y[i] + b[i] for i in [0, size)
+template<typename T>
+void AddRow(int64_t size, const T* b, T* y) {
+  using Vec = simd::SimdVec<T>;
+  constexpr int64_t kWidth = Vec::kWidth;
+  const int64_t vec_size = size / kWidth * kWidth;
+  for (int64_t i = 0; i < vec_size; i += kWidth) {
+    Vec::Store(y + i, Vec::Add(Vec::Load(y + i), Vec::Load(b + i)));
+  }
+  FOR_RANGE(int64_t, i, vec_size, size) { y[i] += b[i]; }
+}
+
+int64_t KernelSize(const ConvCpuParams& params) {
+  return params.kernel_dims[0] * params.kernel_dims[1] * params.kernel_dims[2];
+}
+
+int64_t WinogradNumTiles(const ConvCpuParams& params, int64_t* tiles_h, int64_t* tiles_w) {
+  *tiles_h = (params.out_dims[1] + 1) / 2;
+  *tiles_w = (params.out_dims[2] + 1) / 2;
+  return params.batch * params.out_dims[0] * *tiles_h * *tiles_w;
+}
+
+}  // namespace
+
+template<typename T>
+bool ConvCpuKernelUtil<T>::IsDepthwise(const ConvCpuParams& params) {
+  return params.channels_last && params.groups > 1 && params.groups == params.in_channels
+         && params.filters % params.in_channels == 0;
+}
+
+template<typename T>
+int64_t ConvCpuKernelUtil<T>::DepthwisePackedFilterSize(const ConvCpuParams& params) {
+  return KernelSize(params) * params.filters;
+}
+
+template<typename T>
+void ConvCpuKernelUtil<T>::PackDepthwiseFilter(const ConvCpuParams& params, const T* weight,
+                                               T* packed_filter) {
+  // a depthwise filter has one input channel, so both layouts are [filters, kd, kh, kw]
+  const int64_t kernel_size = KernelSize(params);
+  FOR_RANGE(int64_t, f, 0, params.filters) {
+    FOR_RANGE(int64_t, k, 0, kernel_size) {
+      packed_filter[k * params.filters + f] = weight[f * kernel_size + k];
+    }
+  }
+}
+
+template<typename T>
+void ConvCpuKernelUtil<T>::DepthwiseConv(int64_t row_begin, int64_t row_end,
+                                         const ConvCpuParams& params, const T* x,
+                                         const T* packed_filter, const T* bias, T* y) {
+  const int64_t channels = params.in_channels;
+  const int64_t filters = params.filters;
+  const int64_t multiplier = filters / channels;
+  const int64_t* in_dims = params.in_dims;
+  const int64_t* out_dims = params.out_dims;
+  const int64_t* kernel_dims = params.kernel_dims;
+  FOR_RANGE(int64_t, row, row_begin, row_end) {
+    const int64_t oh = row % out_dims[1];
+    const int64_t od = row / out_dims[1] % out_dims[0];
+    const int64_t n = row / (out_dims[1] * out_dims[0]);
+    T* y_row = y + row * out_dims[2] * filters;
+    FOR_RANGE(int64_t, ow, 0, out_dims[2]) {
+      T* y_pixel = y_row + ow * filters;
+      if (bias == nullptr) {
+        std::fill(y_pixel, y_pixel + filters, static_cast<T>(0));
+      } else {
+        std::copy(bias, bias + filters, y_pixel);
+      }
+      FOR_RANGE(int64_t, kd, 0, kernel_dims[0]) {
+        const int64_t id = od * params.strides[0] + kd * params.dilation_rate[0]
+                           - params.padding_before[0];
+        if (id < 0 || id >= in_dims[0]) { continue; }
+        FOR_RANGE(int64_t, kh, 0, kernel_dims[1]) {
+          const int64_t ih = oh * params.strides[1] + kh * params.dilation_rate[1]
+                             - params.padding_before[1];
+          if (ih < 0 || ih >= in_dims[1]) { continue; }
+          FOR_RANGE(int64_t, kw, 0, kernel_dims[2]) {
+            const int64_t iw = ow * params.strides[2] + kw * params.dilation_rate[2]
+                               - params.padding_before[2];
+            if (iw < 0 || iw >= in_dims[2]) { continue; }
+            const T* x_pixel = x + (((n * in_dims[0] + id) * in_dims[1] + ih) * in_dims[2] + iw)
+                                       * channels;
+            const T* tap =
+                packed_filter + ((kd * kernel_dims[1] + kh) * kernel_dims[2] + kw) * filters;
+            if (multiplier == 1) {
+              FmaRow<T>(filters, x_pixel, tap, y_pixel);
+            } else {
+              FOR_RANGE(int64_t, f, 0, filters) { y_pixel[f] += x_pixel[f / multiplier] * tap[f]; }
+            }
+          }
+        }
+      }
+    }
+  }
+}
+
+template<typename T>
+bool ConvCpuKernelUtil<T>::IsWinogradApplicable(const ConvCpuParams& params) {
+  return params.groups == 1 && params.kernel_dims[0] == 1 && params.kernel_dims[1] == 3
+         && params.kernel_dims[2] == 3 && params.strides[0] == 1 && params.strides[1] == 1
+         && params.strides[2] == 1 && params.dilation_rate[1] == 1
+         && params.dilation_rate[2] == 1 && params.padding_before[0] == 0
+         && params.in_dims[0] == params.out_dims[0];
+}
+
+template<typename T>
+int64_t ConvCpuKernelUtil<T>::WinogradTransformedFilterSize(const ConvCpuParams& params) {
+  return kWinogradNumPositions * params.in_channels * params.filters;
+}
+
+template<typename T>
+void ConvCpuKernelUtil<T>::WinogradTransformFilter(int64_t filter_begin, int64_t filter_end,
+                                                   const ConvCpuParams& params, const T* weight,
+                                                   T* transformed_filter) {
+  const int64_t channels = params.in_channels;
+  const int64_t filters = params.filters;
+  // [filters, channels, 3, 3] or [filters, 3, 3, channels]
+  const int64_t channel_stride = params.channels_last ? 1 : 9;
+  const int64_t tap_stride = params.channels_last ? channels : 1;
+  FOR_RANGE(int64_t, f, filter_begin, filter_end) {
+    FOR_RANGE(int64_t, c, 0, channels) {
+      const T* w = weight + f * 9 * channels + c * channel_stride;
+      T g[3][3];
+      FOR_RANGE(int64_t, i, 0, 3) {
+        FOR_RANGE(int64_t, j, 0, 3) { g[i][j] = w[(i * 3 + j) * tap_stride]; }
+      }
+      // G g with G = [1, 0, 0; 1/2, 1/2, 1/2; 1/2, -1/2, 1/2; 0, 0, 1]
+      T gg[4][3];
+      FOR_RANGE(int64_t, j, 0, 3) {
+        gg[0][j] = g[0][j];
+        gg[1][j] = (g[0][j] + g[1][j] + g[2][j]) / 2;
+        gg[2][j] = (g[0][j] - g[1][j] + g[2][j]) / 2;
+        gg[3][j] = g[2][j];
+      }
+      // (G g) G^T
+      FOR_RANGE(int64_t, i, 0, 4) {
+        T* u = transformed_filter + (i * kWinogradTileSize * channels + c) * filters + f;
+        const int64_t position_stride = channels * filters;
+        u[0] = gg[i][0];
+        u[position_stride] = (gg[i][0] + gg[i][1] + gg[i][2]) / 2;
+        u[2 * position_stride] = (gg[i][0] - gg[i][1] + gg[i][2]) / 2;
+        u[3 * position_stride] = gg[i][2];
+      }
+    }
+  }
+}
+
+template<typename T>
+int64_t ConvCpuKernelUtil<T>::WinogradNumBlocks(const ConvCpuParams& params) {
+  int64_t tiles_h = 0;
+  int64_t tiles_w = 0;
+  return RoundUp(WinogradNumTiles(params, &tiles_h, &tiles_w), kWinogradTileBlock)
+         / kWinogradTileBlock;
+}
+
+template<typename T>
+int64_t ConvCpuKernelUtil<T>::WinogradWorkspaceSize(const ConvCpuParams& params) {
+  return kWinogradNumPositions * kWinogradTileBlock * (params.in_channels + params.filters);
+}
+
+template<typename T>
+void ConvCpuKernelUtil<T>::WinogradConv(int64_t block_begin, int64_t block_end,
+                                        const ConvCpuParams& params, const T* x,
+                                        const T* transformed_filter, const T* bias, T* workspace,
+                                        T* y) {
+  const int64_t channels = params.in_channels;
+  const int64_t filters = params.filters;
+  const ImageLayout x_layout = MakeImageLayout(params.channels_last, channels, params.in_dims);
+  const ImageLayout y_layout = MakeImageLayout(params.channels_last, filters, params.out_dims);
+  int64_t tiles_h = 0;
+  int64_t tiles_w = 0;
+  const int64_t num_tiles = WinogradNumTiles(params, &tiles_h, &tiles_w);
+  // [16, kWinogradTileBlock, channels] and [16, kWinogradTileBlock, filters]
+  T* v = workspace;
+  T* m = workspace + kWinogradNumPositions * kWinogradTileBlock * channels;
+  const int64_t v_position_stride = kWinogradTileBlock * channels;
+  const int64_t m_position_stride = kWinogradTileBlock * filters;
+  // the image plane, the input row and the input column of a tile
+  const auto TileOrigin = [&](int64_t tile, int64_t* n, int64_t* d, int64_t* oh0, int64_t* ow0) {
+    *ow0 = tile % tiles_w * 2;
+    *oh0 = tile / tiles_w % tiles_h * 2;
+    *d = tile / (tiles_w * tiles_h) % params.out_dims[0];
+    *n = tile / (tiles_w * tiles_h * params.out_dims[0]);
+  };
+  FOR_RANGE(int64_t, block, block_begin, block_end) {
+    const int64_t tile_begin = block * kWinogradTileBlock;
+    const int64_t tile_end = std::min(tile_begin + kWinogradTileBlock, num_tiles);
+    // V = B^T d B with B^T = [1, 0, -1, 0; 0, 1, 1, 0; 0, -1, 1, 0; 0, 1, 0, -1]
+    FOR_RANGE(int64_t, t, 0, kWinogradTileBlock) {
+      if (tile_begin + t >= tile_end) {
+        FOR_RANGE(int64_t, p, 0, kWinogradNumPositions) {
+          std::fill_n(v + p * v_position_stride + t * channels, channels, static_cast<T>(0));
+        }
+        continue;
+      }
+      int64_t n, d, oh0, ow0;
+      TileOrigin(tile_begin + t, &n, &d, &oh0, &ow0);
+      const T* x_plane = x + n * x_layout.batch_stride + d * x_layout.d_stride;
+      int64_t offsets[kWinogradTileSize][kWinogradTileSize];
+      bool valid[kWinogradTileSize][kWinogradTileSize];
+      FOR_RANGE(int64_t, i, 0, kWinogradTileSize) {
+        const int64_t ih = oh0 + i - params.padding_before[1];
+        FOR_RANGE(int64_t, j, 0, kWinogradTileSize) {
+          const int64_t iw = ow0 + j - params.padding_before[2];
+          valid[i][j] = ih >= 0 && ih < params.in_dims[1] && iw >= 0 && iw < params.in_dims[2];
+          offsets[i][j] = ih * x_layout.h_stride + iw * x_layout.w_stride;
+        }
+      }
+      FOR_RANGE(int64_t, c, 0, channels) {
+        const T* x_channel = x_plane + c * x_layout.channel_stride;
+        T dt[kWinogradTileSize][kWinogradTileSize];
+        FOR_RANGE(int64_t, i, 0, kWinogradTileSize) {
+          FOR_RANGE(int64_t, j, 0, kWinogradTileSize) {
+            dt[i][j] = valid[i][j] ? x_channel[offsets[i][j]] : static_cast<T>(0);
+          }
+        }
+        T bd[kWinogradTileSize][kWinogradTileSize];
+        FOR_RANGE(int64_t, j, 0, kWinogradTileSize) {
+          bd[0][j] = dt[0][j] - dt[2][j];
+          bd[1][j] = dt[1][j] + dt[2][j];
+          bd[2][j] = dt[2][j] - dt[1][j];
+          bd[3][j] = dt[1][j] - dt[3][j];
+        }
+        T* v_tile = v + t * channels + c;
+        FOR_RANGE(int64_t, i, 0, kWinogradTileSize) {
+          T* v_row = v_tile + i * kWinogradTileSize * v_position_stride;
+          v_row[0] = bd[i][0] - bd[i][2];
+          v_row[v_position_stride] = bd[i][1] + bd[i][2];
+          v_row[2 * v_position_stride] = bd[i][2] - bd[i][1];
+          v_row[3 * v_position_stride] = bd[i][1] - bd[i][3];
+        }
+      }
+    }
+    // M = U . V, a matrix product over the channels for each position of the tile
+    FOR_RANGE(int64_t, p, 0, kWinogradNumPositions) {
+      const T* u = transformed_filter + p * channels * filters;
+      for (int64_t t = 0; t < tile_end - tile_begin; t += kMatMulRows) {
+        MatMulRows<T>(channels, filters, v + p * v_position_stride + t * channels, u,
+                      m + p * m_position_stride + t * filters);
+      }
+    }
+    // Y = A^T M A with A^T = [1, 1, 1, 0; 0, 1, -1, -1]
+    FOR_RANGE(int64_t, t, 0, tile_end - tile_begin) {
+      int64_t n, d, oh0, ow0;
+      TileOrigin(tile_begin + t, &n, &d, &oh0, &ow0);
+      T* y_plane = y + n * y_layout.batch_stride + d * y_layout.d_stride;
+      const bool has_row1 = oh0 + 1 < params.out_dims[1];
+      const bool has_col1 = ow0 + 1 < params.out_dims[2];
+      const int64_t y_offset = oh0 * y_layout.h_stride + ow0 * y_layout.w_stride;
+      FOR_RANGE(int64_t, f, 0, filters) {
+        const T* m_tile = m + t * filters + f;
+        T mt[kWinogradTileSize][kWinogradTileSize];
+        FOR_RANGE(int64_t, i, 0, kWinogradTileSize) {
+          FOR_RANGE(int64_t, j, 0, kWinogradTileSize) {
+            mt[i][j] = m_tile[(i * kWinogradTileSize + j) * m_position_stride];
+          }
+        }
+        T am[2][kWinogradTileSize];
+        FOR_RANGE(int64_t, j, 0, kWinogradTileSize) {
+          am[0][j] = mt[0][j] + mt[1][j] + mt[2][j];
+          am[1][j] = mt[1][j] - mt[2][j] - mt[3][j];
+        }
+        const T b = bias == nullptr ? static_cast<T>(0) : bias[f];
+        T* y_tile = y_plane + f * y_layout.channel_stride + y_offset;
+        y_tile[0] = am[0][0] + am[0][1] + am[0][2] + b;
+        if (has_col1) { y_tile[y_layout.w_stride] = am[0][1] - am[0][2] - am[0][3] + b; }
+        if (has_row1) {
+          y_tile[y_layout.h_stride] = am[1][0] + am[1][1] + am[1][2] + b;
+          if (has_col1) {
+            y_tile[y_layout.h_stride + y_layout.w_stride] = am[1][1] - am[1][2] - am[1][3] + b;
+          }
+        }
+      }
+    }
+  }
+}
+
+template<typename T>
+void ConvCpuKernelUtil<T>::AddBias(int64_t outer, int64_t filters, int64_t inner, const T* bias,
+                                   T* y) {
+  if (inner == 1) {
+    FOR_RANGE(int64_t, i, 0, outer) { AddRow<T>(filters, bias, y + i * filters); }
+  } else {
+    FOR_RANGE(int64_t, i, 0, outer) {
+      FOR_RANGE(int64_t, f, 0, filters) {
+        AddScalarRow<T>(inner, bias[f], y + (i * filters + f) * inner);
+      }
+    }
+  }
+}
+
+template struct ConvCpuKernelUtil<float>;
+template struct ConvCpuKernelUtil<double>;
+
+}  // namespace oneflow
@@ -0,0 +1,70 @@
+/*
+Copyright 2020 The OneFlow Authors. All rights reserved.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+*/
+#ifndef ONEFLOW_USER_KERNELS_CONV_CPU_KERNEL_UTIL_H_
+#define ONEFLOW_USER_KERNELS_CONV_CPU_KERNEL_UTIL_H_
+
+#include "oneflow/core/common/util.h"
+
+namespace oneflow {
+
+// a convolution with 1d and 2d ones padded to 3d, the dims are (d, h, w)
+struct ConvCpuParams {
+  bool channels_last;
+  int64_t batch;
+  int64_t in_channels;
+  int64_t filters;
+  int64_t groups;
+  int64_t in_dims[3];
+  int64_t out_dims[3];
+  int64_t kernel_dims[3];
+  int32_t strides[3];
+  int32_t dilation_rate[3];
+  int32_t padding_before[3];
+};
+
+// direct convolution of channels last depthwise convolutions, where each filter sees one input
+// channel, and Winograd F(2x2, 3x3) for 3x3 convolutions of stride 1
+template<typename T>
+struct ConvCpuKernelUtil {
+  static bool IsDepthwise(const ConvCpuParams& params);
+  // the depthwise filter is packed as [kd * kh * kw, filters]
+  static int64_t DepthwisePackedFilterSize(const ConvCpuParams& params);
+  static void PackDepthwiseFilter(const ConvCpuParams& params, const T* weight, T* packed_filter);
+  // rows [row_begin, row_end) of the batch * od * oh rows of y, bias may be nullptr
+  static void DepthwiseConv(int64_t row_begin, int64_t row_end, const ConvCpuParams& params,
+                            const T* x, const T* packed_filter, const T* bias, T* y);
+
+  static bool IsWinogradApplicable(const ConvCpuParams& params);
+  // the transformed filter is [16, in_channels, filters]
+  static int64_t WinogradTransformedFilterSize(const ConvCpuParams& params);
+  static void WinogradTransformFilter(int64_t filter_begin, int64_t filter_end,
+                                      const ConvCpuParams& params, const T* weight,
+                                      T* transformed_filter);
+  // the output is made of 2x2 tiles, a block is kWinogradTileBlock of them and the workspace
+  // holds the transformed input and output of one block
+  static int64_t WinogradNumBlocks(const ConvCpuParams& params);
+  static int64_t WinogradWorkspaceSize(const ConvCpuParams& params);
+  static void WinogradConv(int64_t block_begin, int64_t block_end, const ConvCpuParams& params,
+                           const T* x, const T* transformed_filter, const T* bias, T* workspace,
+                           T* y);
+
+  // y += bias with y viewed as [outer, filters, inner]
+  static void AddBias(int64_t outer, int64_t filters, int64_t inner, const T* bias, T* y);
+};
+
+}  // namespace oneflow
+
+#endif  // ONEFLOW_USER_KERNELS_CONV_CPU_KERNEL_UTIL_H_
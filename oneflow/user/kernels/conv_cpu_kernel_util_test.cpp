@@ -0,0 +1,217 @@
+/*
+Copyright 2020 The OneFlow Authors. All rights reserved.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+*/
+#include "oneflow/core/common/cpu_test_util.h"
+#include "oneflow/user/kernels/conv_cpu_kernel_util.h"
+
+namespace oneflow {
+
+namespace {
+
+using test::BenchmarkMs;
+using test::ExpectNear;
+using test::RandomData;
+using test::TwoParts;
+
+ConvCpuParams MakeParams(bool channels_last, int64_t batch, int64_t in_channels, int64_t filters,
+                         int64_t groups, const std::vector<int64_t>& in_dims,
+                         const std::vector<int64_t>& kernel_dims, int32_t stride, int32_t dilation,
+                         int32_t padding) {
+  ConvCpuParams params;
+  params.channels_last = channels_last;
+  params.batch = batch;
+  params.in_channels = in_channels;
+  params.filters = filters;
+  params.groups = groups;
+  FOR_RANGE(int, i, 0, 3) {
+    // no padding and a stride of 1 along d, as in conv2d padded to 3d
+    params.strides[i] = i == 0 ? 1 : stride;
+    params.dilation_rate[i] = i == 0 ? 1 : dilation;
+    params.padding_before[i] = i == 0 ? 0 : padding;
+    params.in_dims[i] = in_dims[i];
+    params.kernel_dims[i] = kernel_dims[i];
+    params.out_dims[i] = (in_dims[i] + 2 * params.padding_before[i]
+                          - params.dilation_rate[i] * (kernel_dims[i] - 1) - 1)
+                             / params.strides[i]
+                         + 1;
+  }
+  return params;
+}
+
+int64_t SpatialSize(const int64_t* dims) { return dims[0] * dims[1] * dims[2]; }
+
+// weight is [filters, in_channels / groups, kd, kh, kw], or with the channels last
+template<typename T>
+std::vector<T> NaiveConv(const ConvCpuParams& p, const std::vector<T>& x,
+                         const std::vector<T>& weight, const std::vector<T>& bias) {
+  const int64_t group_channels = p.in_channels / p.groups;
+  const int64_t group_filters = p.filters / p.groups;
+  const int64_t in_spatial = SpatialSize(p.in_dims);
+  const int64_t out_spatial = SpatialSize(p.out_dims);
+  const int64_t kernel_spatial = SpatialSize(p.kernel_dims);
+  std::vector<T> y(p.batch * p.filters * out_spatial);
+  FOR_RANGE(int64_t, n, 0, p.batch) {
+    FOR_RANGE(int64_t, f, 0, p.filters) {
+      FOR_RANGE(int64_t, o, 0, out_spatial) {
+        const int64_t od = o / (p.out_dims[1] * p.out_dims[2]);
+        const int64_t oh = o / p.out_dims[2] % p.out_dims[1];
+        const int64_t ow = o % p.out_dims[2];
+        double sum = bias.empty() ? 0 : bias[f];
+        FOR_RANGE(int64_t, gc, 0, group_channels) {
+          const int64_t c = f / group_filters * group_channels + gc;
+          FOR_RANGE(int64_t, k, 0, kernel_spatial) {
+            const int64_t kd = k / (p.kernel_dims[1] * p.kernel_dims[2]);
+            const int64_t kh = k / p.kernel_dims[2] % p.kernel_dims[1];
+            const int64_t kw = k % p.kernel_dims[2];
+            const int64_t id = od * p.strides[0] + kd * p.dilation_rate[0] - p.padding_before[0];
+            const int64_t ih = oh * p.strides[1] + kh * p.dilation_rate[1] - p.padding_before[1];
+            const int64_t iw = ow * p.strides[2] + kw * p.dilation_rate[2] - p.padding_before[2];
+            if (id < 0 || id >= p.in_dims[0] || ih < 0 || ih >= p.in_dims[1] || iw < 0
+                || iw >= p.in_dims[2]) {
+              continue;
+            }
+            const int64_t i = (id * p.in_dims[1] + ih) * p.in_dims[2] + iw;
+            const T x_value = p.channels_last ? x[(n * in_spatial + i) * p.in_channels + c]
+                                              : x[(n * p.in_channels + c) * in_spatial + i];
+            const T w_value = p.channels_last
+                                  ? weight[(f * kernel_spatial + k) * group_channels + gc]
+                                  : weight[(f * group_channels + gc) * kernel_spatial + k];
+            sum += x_value * w_value;
+          }
+        }
+        if (p.channels_last) {
+          y[(n * out_spatial + o) * p.filters + f] = sum;
+        } else {
+          y[(n * p.filters + f) * out_spatial + o] = sum;
+        }
+      }
+    }
+  }
+  return y;
+}
+
+template<typename T>
+std::vector<T> DepthwiseConv(const ConvCpuParams& p, const std::vector<T>& x,
+                             const std::vector<T>& weight, const std::vector<T>& bias) {
+  using Util = ConvCpuKernelUtil<T>;
+  std::vector<T> packed_filter(Util::DepthwisePackedFilterSize(p));
+  Util::PackDepthwiseFilter(p, weight.data(), packed_filter.data());
+  std::vector<T> y(p.batch * p.filters * SpatialSize(p.out_dims));
+  TwoParts(p.batch * p.out_dims[0] * p.out_dims[1], [&](int64_t begin, int64_t end) {
+    Util::DepthwiseConv(begin, end, p, x.data(), packed_filter.data(),
+                        bias.empty() ? nullptr : bias.data(), y.data());
+  });
+  return y;
+}
+
+template<typename T>
+std::vector<T> WinogradConv(const ConvCpuParams& p, const std::vector<T>& x,
+                            const std::vector<T>& weight, const std::vector<T>& bias) {
+  using Util = ConvCpuKernelUtil<T>;
+  std::vector<T> transformed_filter(Util::WinogradTransformedFilterSize(p));
+  TwoParts(p.filters, [&](int64_t begin, int64_t end) {
+    Util::WinogradTransformFilter(begin, end, p, weight.data(), transformed_filter.data());
+  });
+  std::vector<T> workspace(Util::WinogradWorkspaceSize(p));
+  std::vector<T> y(p.batch * p.filters * SpatialSize(p.out_dims));
+  TwoParts(Util::WinogradNumBlocks(p), [&](int64_t begin, int64_t end) {
+    Util::WinogradConv(begin, end, p, x.data(), transformed_filter.data(),
+                       bias.empty() ? nullptr : bias.data(), workspace.data(), y.data());
+  });
+  return y;
+}
+
+template<typename T>
+void TestConv(const ConvCpuParams& p, bool has_bias, double tolerance) {
+  using Util = ConvCpuKernelUtil<T>;
+  const std::vector<T> x = RandomData<T>(p.batch * p.in_channels * SpatialSize(p.in_dims), -1, 1);
+  const std::vector<T> weight =
+      RandomData<T>(p.filters * p.in_channels / p.groups * SpatialSize(p.kernel_dims), -1, 1);
+  const std::vector<T> bias = has_bias ? RandomData<T>(p.filters, -1, 1) : std::vector<T>();
+  const std::vector<T> expected = NaiveConv<T>(p, x, weight, bias);
+  if (Util::IsDepthwise(p)) {
+    ExpectNear(expected, DepthwiseConv<T>(p, x, weight, bias), tolerance);
+  }
+  if (Util::IsWinogradApplicable(p)) {
+    ExpectNear(expected, WinogradConv<T>(p, x, weight, bias), tolerance);
+  }
+}
+
+}  // namespace
+
+TEST(ConvCpuKernelUtil, depthwise) {
+  for (const int64_t multiplier : {1, 2}) {
+    for (const int64_t channels : {3, 32, 37}) {
+      for (const int32_t stride : {1, 2}) {
+        for (const int32_t dilation : {1, 2}) {
+          const ConvCpuParams p = MakeParams(true, 2, channels, channels * multiplier, channels,
+                                             {1, 11, 9}, {1, 3, 3}, stride, dilation, 1);
+          ASSERT_TRUE(ConvCpuKernelUtil<float>::IsDepthwise(p));
+          TestConv<float>(p, stride == 1, 1e-4);
+          TestConv<double>(p, stride == 2, 1e-10);
+        }
+      }
+    }
+  }
+  // conv3d
+  TestConv<float>(MakeParams(true, 1, 8, 8, 8, {5, 6, 7}, {3, 3, 3}, 1, 1, 1), true, 1e-4);
+}
+
+TEST(ConvCpuKernelUtil, winograd) {
+  for (const bool channels_last : {false, true}) {
+    for (const int64_t channels : {1, 3, 16}) {
+      for (const int64_t filters : {1, 16, 21}) {
+        // odd and even outputs, with and without padding
+        for (const int32_t padding : {0, 1}) {
+          const ConvCpuParams p = MakeParams(channels_last, 3, channels, filters, 1, {1, 9, 8},
+                                             {1, 3, 3}, 1, 1, padding);
+          ASSERT_TRUE(ConvCpuKernelUtil<float>::IsWinogradApplicable(p));
+          TestConv<float>(p, padding == 1, 1e-4);
+          TestConv<double>(p, padding == 0, 1e-10);
+        }
+      }
+    }
+  }
+  EXPECT_FALSE(ConvCpuKernelUtil<float>::IsWinogradApplicable(
+      MakeParams(false, 1, 4, 4, 1, {1, 9, 9}, {1, 3, 3}, 2, 1, 1)));
+  EXPECT_FALSE(ConvCpuKernelUtil<float>::IsWinogradApplicable(
+      MakeParams(false, 1, 4, 4, 1, {1, 9, 9}, {1, 5, 5}, 1, 1, 1)));
+}
+
+TEST(ConvCpuKernelUtil, add_bias) {
+  const std::vector<float> bias{1, 2, 3};
+  std::vector<float> y(2 * 3 * 5, 0);
+  ConvCpuKernelUtil<float>::AddBias(2, 3, 5, bias.data(), y.data());
+  FOR_RANGE(int64_t, i, 0, 30) { ASSERT_EQ(y[i], bias[i / 5 % 3]); }
+  std::fill(y.begin(), y.end(), 0);
+  ConvCpuKernelUtil<float>::AddBias(10, 3, 1, bias.data(), y.data());
+  FOR_RANGE(int64_t, i, 0, 30) { ASSERT_EQ(y[i], bias[i % 3]); }
+}
+
+// compares Winograd with the naive convolution on one thread, run with
+// --gtest_also_run_disabled_tests
+TEST(ConvCpuKernelUtil, DISABLED_benchmark) {
+  const ConvCpuParams p = MakeParams(false, 2, 64, 64, 1, {1, 56, 56}, {1, 3, 3}, 1, 1, 1);
+  const std::vector<float> x =
+      RandomData<float>(p.batch * p.in_channels * SpatialSize(p.in_dims), -1, 1);
+  const std::vector<float> weight = RandomData<float>(p.filters * p.in_channels * 9, -1, 1);
+  const std::vector<float> bias;
+  const double naive_ms = BenchmarkMs([&]() { NaiveConv<float>(p, x, weight, bias); }, 1);
+  const double winograd_ms = BenchmarkMs([&]() { WinogradConv<float>(p, x, weight, bias); }, 1);
+  LOG(INFO) << "3x3 conv of 2x64x56x56 to 64 filters: naive " << naive_ms << "ms, winograd "
+            << winograd_ms << "ms";
+}
+
+}  // namespace oneflow
@@ -13,10 +13,15 @@ WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
 See the License for the specific language governing permissions and
 limitations under the License.
 */
+#include <chrono>
 #include "oneflow/core/framework/framework.h"
 #include "oneflow/user/ops/nn_util.h"
+#include "oneflow/user/kernels/conv_cpu_kernel_util.h"
+#include "oneflow/core/common/balanced_splitter.h"
+#include "oneflow/core/job/job_desc.h"
 #include "oneflow/core/kernel/new_kernel_util.h"
 #include "oneflow/core/kernel/kernel_util.h"
+#include "oneflow/core/thread/thread_manager.h"
 
 namespace oneflow {
 
@@ -291,6 +296,185 @@ struct ConvKernelUtil final {
   }
 };
 
+Shape Gen5DShape(const ShapeView& shape, int32_t idx_offset) {
+  DimVector ret_vec;
+  shape.ToDimVector(&ret_vec);
+  int32_t ndims = ret_vec.size() - 2;
+  ret_vec.insert(ret_vec.begin() + idx_offset, 3 - ndims, 1);
+  return Shape(ret_vec);
+}
+
+std::vector<int32_t> Gen3DVec(const std::vector<int32_t>& origin_vec, int32_t fill_value) {
+  std::vector<int32_t> ret_vec = origin_vec;
+  ret_vec.insert(ret_vec.begin(), 3 - ret_vec.size(), fill_value);
+  return ret_vec;
+}
+
+// the values of cpu_conv_force_fwd_algo in the job config
+enum class ConvCpuAlgorithm : int32_t {
+  kIm2ColGemm = 0,  // im2col and a gemm for each sample
+  kDirect = 1,      // channels last depthwise, and channels last 1x1 as one gemm for many pixels
+  kWinograd = 2,    // F(2x2, 3x3)
+};
+
+const ConvCpuAlgorithm kConvCpuAlgorithms[] = {
+    ConvCpuAlgorithm::kIm2ColGemm, ConvCpuAlgorithm::kDirect, ConvCpuAlgorithm::kWinograd};
+
+// pixels of a chunk of the 1x1 direct convolution
+constexpr int64_t kDirectChunkSize = 1024;
+// bound on the size of the workspaces, each concurrent task of an algorithm has one
+constexpr size_t kMaxWorkspacesSize = 128 * 1024 * 1024;
+
+ConvCpuParams MakeConvCpuParams(int32_t idx_offset, const ShapeView& in_5d_shape,
+                                const ShapeView& out_5d_shape, const ShapeView& weight_5d_shape,
+                                const std::vector<int32_t>& strides_3d,
+                                const std::vector<int32_t>& dilation_rate_3d,
+                                const std::vector<int32_t>& padding_before_3d, int32_t groups) {
+  ConvCpuParams params;
+  params.channels_last = idx_offset == 1;
+  params.batch = in_5d_shape.At(0);
+  params.in_channels = in_5d_shape.At(params.channels_last ? 4 : 1);
+  params.filters = weight_5d_shape.At(0);
+  params.groups = groups;
+  FOR_RANGE(int32_t, i, 0, 3) {
+    params.in_dims[i] = in_5d_shape.At(idx_offset + i);
+    params.out_dims[i] = out_5d_shape.At(idx_offset + i);
+    params.kernel_dims[i] = weight_5d_shape.At(idx_offset + i);
+    params.strides[i] = strides_3d.at(i);
+    params.dilation_rate[i] = dilation_rate_3d.at(i);
+    params.padding_before[i] = padding_before_3d.at(i);
+  }
+  return params;
+}
+
+bool Is1x1(const ConvCpuParams& params) {
+  return params.kernel_dims[0] == 1 && params.kernel_dims[1] == 1 && params.kernel_dims[2] == 1;
+}
+
+// a 1x1 convolution that reads every pixel of the input in place
+bool Is1x1Identity(const ConvCpuParams& params) {
+  FOR_RANGE(int32_t, i, 0, 3) {
+    if (params.strides[i] != 1 || params.padding_before[i] != 0
+        || params.in_dims[i] != params.out_dims[i]) {
+      return false;
+    }
+  }
+  return Is1x1(params);
+}
+
+template<typename T>
+bool IsConvCpuAlgorithmApplicable(ConvCpuAlgorithm algorithm, const ConvCpuParams& params) {
+  switch (algorithm) {
+    case ConvCpuAlgorithm::kIm2ColGemm: return params.groups == 1;
+    case ConvCpuAlgorithm::kDirect:
+      return ConvCpuKernelUtil<T>::IsDepthwise(params)
+             || (params.channels_last && params.groups == 1 && Is1x1(params));
+    case ConvCpuAlgorithm::kWinograd: return ConvCpuKernelUtil<T>::IsWinogradApplicable(params);
+    default: UNIMPLEMENTED();
+  }
+  return false;
+}
+
+// the tmp buffer of an algorithm is a fixed part followed by the workspaces of the tasks, each
+// task works on a range of the items
+struct ConvCpuTmpLayout {
+  size_t fixed_size;
+  size_t workspace_size;
+  int64_t num_items;
+};
+
+template<typename T>
+ConvCpuTmpLayout GetConvCpuTmpLayout(ConvCpuAlgorithm algorithm, const ConvCpuParams& params) {
+  using Util = ConvCpuKernelUtil<T>;
+  const int64_t out_spatial = params.out_dims[0] * params.out_dims[1] * params.out_dims[2];
+  ConvCpuTmpLayout layout{0, 0, 0};
+  if (algorithm == ConvCpuAlgorithm::kIm2ColGemm) {
+    layout.workspace_size = params.in_channels * params.kernel_dims[0] * params.kernel_dims[1]
+                            * params.kernel_dims[2] * out_spatial * sizeof(T);
+    layout.num_items = params.batch;
+  } else if (algorithm == ConvCpuAlgorithm::kDirect && Util::IsDepthwise(params)) {
+    layout.fixed_size = Util::DepthwisePackedFilterSize(params) * sizeof(T);
+    layout.num_items = params.batch * params.out_dims[0] * params.out_dims[1];
+  } else if (algorithm == ConvCpuAlgorithm::kDirect) {
+    if (!Is1x1Identity(params)) {
+      layout.workspace_size = kDirectChunkSize * params.in_channels * sizeof(T);
+    }
+    layout.num_items = RoundUp(params.batch * out_spatial, kDirectChunkSize) / kDirectChunkSize;
+  } else if (algorithm == ConvCpuAlgorithm::kWinograd) {
+    layout.fixed_size = Util::WinogradTransformedFilterSize(params) * sizeof(T);
+    layout.workspace_size = Util::WinogradWorkspaceSize(params) * sizeof(T);
+    layout.num_items = Util::WinogradNumBlocks(params);
+  } else {
+    UNIMPLEMENTED();
+  }
+  return layout;
+}
+
+// one workspace for each thread of a ParallelFor
+int64_t MaxNumWorkspaces(const ConvCpuTmpLayout& layout) {
+  if (layout.workspace_size == 0) { return 0; }
+  const int64_t num_by_size = kMaxWorkspacesSize / layout.workspace_size;
+  return std::max<int64_t>(
+      std::min({layout.num_items, ParallelForMaxParallelism(), num_by_size}), 1);
+}
+
+// the tmp buffer holds the fixed part and at least one workspace of the algorithm
+bool IsConvCpuTmpBufferEnough(const ConvCpuTmpLayout& layout, size_t tmp_buffer_size) {
+  return tmp_buffer_size >= layout.fixed_size + layout.workspace_size;
+}
+
+// the forced algorithm of the job config when it applies, otherwise the one that usually runs
+// fastest: the direct convolution, then Winograd, then im2col and gemm
+template<typename T>
+ConvCpuAlgorithm GetDefaultConvCpuAlgorithm(const JobDesc& job_desc,
+                                            const ConvCpuParams& params) {
+  const JobConfigProto& job_conf = job_desc.job_conf();
+  if (job_conf.has_cpu_conv_force_fwd_algo()) {
+    const int32_t forced = job_conf.cpu_conv_force_fwd_algo();
+    CHECK(forced >= 0 && forced <= static_cast<int32_t>(ConvCpuAlgorithm::kWinograd))
+        << "invalid cpu_conv_force_fwd_algo " << forced;
+    if (IsConvCpuAlgorithmApplicable<T>(kConvCpuAlgorithms[forced], params)) {
+      return kConvCpuAlgorithms[forced];
+    }
+  }
+  for (ConvCpuAlgorithm algorithm : {ConvCpuAlgorithm::kDirect, ConvCpuAlgorithm::kWinograd}) {
+    if (IsConvCpuAlgorithmApplicable<T>(algorithm, params)) { return algorithm; }
+  }
+  CHECK(IsConvCpuAlgorithmApplicable<T>(ConvCpuAlgorithm::kIm2ColGemm, params));
+  return ConvCpuAlgorithm::kIm2ColGemm;
+}
+
+template<typename T>
+size_t InferConvCpuTmpSize(user_op::InferContext* ctx) {
+  const int32_t idx_offset = IdxOffset(ctx->Attr<std::string>("data_format"));
+  const auto Gen5DShapeOf = [&](const std::string& arg_name) -> Shape {
+    return Gen5DShape(ShapeView(ctx->TensorDesc4ArgNameAndIndex(arg_name, 0)->shape()),
+                      idx_offset);
+  };
+  const ConvCpuParams params = MakeConvCpuParams(
+      idx_offset, ShapeView(Gen5DShapeOf("in")), ShapeView(Gen5DShapeOf("out")),
+      ShapeView(Gen5DShapeOf("weight")),
+      Gen3DVec(ctx->Attr<std::vector<int32_t>>("strides"), 1),
+      Gen3DVec(ctx->Attr<std::vector<int32_t>>("dilation_rate"), 1),
+      Gen3DVec(ctx->Attr<std::vector<int32_t>>("padding_before"), 0),
+      ctx->Attr<int32_t>("groups"));
+  // the autotune only tries the other algorithms that fit in this buffer
+  const ConvCpuTmpLayout layout =
+      GetConvCpuTmpLayout<T>(GetDefaultConvCpuAlgorithm<T>(ctx->job_desc(), params), params);
+  return layout.fixed_size + MaxNumWorkspaces(layout) * layout.workspace_size;
+}
+
+// groups other than 1 are only supported by the direct depthwise convolution of channels last
+bool IsConvCpuGroupsSupported(const user_op::KernelRegContext& ctx) {
+  const int32_t groups = ctx.Attr<int32_t>("groups");
+  if (groups == 1) { return true; }
+  if (ctx.Attr<std::string>("data_format") != "channels_last") { return false; }
+  const Shape& in_shape = ctx.TensorDesc4ArgNameAndIndex("in", 0)->shape();
+  const Shape& weight_shape = ctx.TensorDesc4ArgNameAndIndex("weight", 0)->shape();
+  const int64_t channels = in_shape.At(in_shape.NumAxes() - 1);
+  return groups == channels && weight_shape.At(0) % channels == 0;
+}
+
 template<typename T>
 struct ConvOpKernelState final : public user_op::OpKernelState {
   Im2ColFunc<T> im2col_func_;
@@ -309,16 +493,11 @@ struct ConvOpKernelState final : public user_op::OpKernelState {
   int32_t idx_offset_;
   bool is_dynamic_;
 
+  // the algorithm of the forward kernel for each input shape
+  HashMap<Shape, ConvCpuAlgorithm> algorithm_cache_;
+
   void Update(const ShapeView& x_shape, const ShapeView& out_shape) {
-    auto Gen5DShape = [](const ShapeView& shape, int32_t idx_offset) -> Shape {
-      DimVector ret_vec;
-      shape.ToDimVector(&ret_vec);
-      int32_t ndims = ret_vec.size() - 2;
-      ret_vec.insert(ret_vec.begin() + idx_offset, 3 - ndims, 1);
-      return Shape(ret_vec);
-    };
     if (is_dynamic_) {
-      Shape in_shape;
       in_5d_shape_ = Gen5DShape(x_shape, idx_offset_);
       out_5d_shape_ = Gen5DShape(out_shape, idx_offset_);
     }
@@ -347,36 +526,17 @@ std::shared_ptr<user_op::OpKernelState> CreateConvOpKernelState(user_op::KernelI
     state->idx_offset_ = 1;
   }
 
-  auto Gen5DShape = [](const Shape& shape, int32_t idx_offset) -> Shape {
-    DimVector ret_vec(shape.dim_vec());
-    int32_t ndims = ret_vec.size() - 2;
-    ret_vec.insert(ret_vec.begin() + idx_offset, 3 - ndims, 1);
-    return Shape(ret_vec);
-  };
-  state->in_5d_shape_ =
-      Gen5DShape(ctx->TensorDesc4ArgNameAndIndex(in_name, 0)->shape(), state->idx_offset_);
-  state->out_5d_shape_ =
-      Gen5DShape(ctx->TensorDesc4ArgNameAndIndex(out_name, 0)->shape(), state->idx_offset_);
-  state->weight_5d_shape_ =
-      Gen5DShape(ctx->TensorDesc4ArgNameAndIndex(weight_name, 0)->shape(), state->idx_offset_);
-
-  auto Gen3DVec = [](const std::vector<int32_t>& origin_vec) -> std::vector<int32_t> {
-    std::vector<int32_t> ret_vec = origin_vec;
-    ret_vec.insert(ret_vec.begin(), 3 - ret_vec.size(), 1);
-    return ret_vec;
-  };
-  state->strides_3d_ = Gen3DVec(ctx->Attr<std::vector<int32_t>>("strides"));
-  state->dilation_rate_3d_ = Gen3DVec(ctx->Attr<std::vector<int32_t>>("dilation_rate"));
+  state->in_5d_shape_ = Gen5DShape(ShapeView(ctx->TensorDesc4ArgNameAndIndex(in_name, 0)->shape()),
+                                   state->idx_offset_);
+  state->out_5d_shape_ = Gen5DShape(
+      ShapeView(ctx->TensorDesc4ArgNameAndIndex(out_name, 0)->shape()), state->idx_offset_);
+  state->weight_5d_shape_ = Gen5DShape(
+      ShapeView(ctx->TensorDesc4ArgNameAndIndex(weight_name, 0)->shape()), state->idx_offset_);
+
+  state->strides_3d_ = Gen3DVec(ctx->Attr<std::vector<int32_t>>("strides"), 1);
+  state->dilation_rate_3d_ = Gen3DVec(ctx->Attr<std::vector<int32_t>>("dilation_rate"), 1);
+  state->padding_before_3d_ = Gen3DVec(ctx->Attr<std::vector<int32_t>>("padding_before"), 0);
   state->is_dynamic_ = ctx->TensorDesc4ArgNameAndIndex(in_name, 0)->is_dynamic();
-  const auto& padding_before = ctx->Attr<std::vector<int32_t>>("padding_before");
-  FOR_RANGE(uint8_t, dim, 0, 3) {
-    int64_t index = static_cast<int64_t>(dim) - (3 - padding_before.size());
-    if (index < 0) {
-      state->padding_before_3d_.push_back(0);
-    } else {
-      state->padding_before_3d_.push_back(padding_before.at(index));
-    }
-  }
 
   return std::move(state);
 }
@@ -386,6 +546,174 @@ void InitBiasMulBuf(T* dptr, int64_t num) {
   for (int64_t i = 0; i < num; ++i) { dptr[i] = 1; }
 }
 
+// copies the input pixels read by pixels [pixel_begin, pixel_begin + num_pixels) of a channels
+// last 1x1 convolution to rows, zeros for the padding
+template<typename T>
+void Gather1x1Pixels(const ConvCpuParams& params, int64_t pixel_begin, int64_t num_pixels,
+                     const T* x, T* rows) {
+  const int64_t* in_dims = params.in_dims;
+  const int64_t* out_dims = params.out_dims;
+  const int64_t channels = params.in_channels;
+  FOR_RANGE(int64_t, pixel, pixel_begin, pixel_begin + num_pixels) {
+    const int64_t ow = pixel % out_dims[2];
+    const int64_t oh = pixel / out_dims[2] % out_dims[1];
+    const int64_t od = pixel / (out_dims[2] * out_dims[1]) % out_dims[0];
+    const int64_t n = pixel / (out_dims[2] * out_dims[1] * out_dims[0]);
+    const int64_t id = od * params.strides[0] - params.padding_before[0];
+    const int64_t ih = oh * params.strides[1] - params.padding_before[1];
+    const int64_t iw = ow * params.strides[2] - params.padding_before[2];
+    T* row = rows + (pixel - pixel_begin) * channels;
+    if (id < 0 || id >= in_dims[0] || ih < 0 || ih >= in_dims[1] || iw < 0 || iw >= in_dims[2]) {
+      std::fill(row, row + channels, static_cast<T>(0));
+    } else {
+      const T* x_pixel =
+          x + (((n * in_dims[0] + id) * in_dims[1] + ih) * in_dims[2] + iw) * channels;
+      std::copy(x_pixel, x_pixel + channels, row);
+    }
+  }
+}
+
+template<typename T>
+void ConvCpuForward(user_op::KernelComputeContext* ctx, const ConvOpKernelState<T>& state,
+                    const ConvCpuParams& params, ConvCpuAlgorithm algorithm,
+                    const user_op::Tensor* in, const user_op::Tensor* weight,
+                    const user_op::Tensor* bias, user_op::Tensor* tmp_buffer,
+                    user_op::Tensor* out) {
+  using Util = ConvCpuKernelUtil<T>;
+  const ConvCpuTmpLayout layout = GetConvCpuTmpLayout<T>(algorithm, params);
+  const size_t tmp_buffer_size = tmp_buffer->shape().elem_cnt();
+  CHECK_GE(tmp_buffer_size, layout.fixed_size);
+  int64_t num_workspaces = MaxNumWorkspaces(layout);
+  if (layout.workspace_size > 0) {
+    // dynamic shapes get the workspaces that fit in the tmp buffer of the largest shape
+    num_workspaces = std::min<int64_t>(
+        num_workspaces, (tmp_buffer_size - layout.fixed_size) / layout.workspace_size);
+    CHECK_GT(num_workspaces, 0);
+  }
+  T* fixed_dptr = tmp_buffer->mut_dptr<T>();
+  char* workspaces_dptr = tmp_buffer->mut_dptr<char>() + layout.fixed_size;
+  // runs DoEach(workspace, item_begin, item_end) over all items, without a workspace when the
+  // algorithm needs none
+  const auto ForEachTask = [&](const std::function<void(T*, int64_t, int64_t)>& DoEach) {
+    if (num_workspaces == 0) {
+      ctx->ParallelFor(layout.num_items, 1,
+                       [&](int64_t begin, int64_t end) { DoEach(nullptr, begin, end); });
+    } else {
+      const BalancedSplitter splitter(layout.num_items, num_workspaces);
+      ctx->ParallelFor(num_workspaces, 1, [&](int64_t begin, int64_t end) {
+        FOR_RANGE(int64_t, i, begin, end) {
+          const Range range = splitter.At(i);
+          DoEach(reinterpret_cast<T*>(workspaces_dptr + i * layout.workspace_size), range.begin(),
+                 range.end());
+        }
+      });
+    }
+  };
+  const T* bias_dptr = bias == nullptr ? nullptr : bias->dptr<T>();
+  const int64_t out_spatial = params.out_dims[0] * params.out_dims[1] * params.out_dims[2];
+  if (algorithm == ConvCpuAlgorithm::kIm2ColGemm) {
+    ForEachTask([&](T* col_buf, int64_t sample_begin, int64_t sample_end) {
+      FOR_RANGE(int64_t, i, sample_begin, sample_end) {
+        state.im2col_func_(GetImgDptr<T>(in, i), ShapeView(state.in_5d_shape_),
+                           ShapeView(state.weight_5d_shape_), ShapeView(state.out_5d_shape_),
+                           state.strides_3d_.data(), state.dilation_rate_3d_.data(),
+                           state.padding_before_3d_.data(), col_buf);
+        // channels first: out = weight * col_buf
+        // channels last:  out = (weight * col_buf)(T)
+        state.forward_func_(CblasNoTrans, CblasNoTrans,
+                            params.filters,                  // filter
+                            out_spatial,                     // od * oh * ow
+                            state.weight_5d_shape_.Count(1),  // ci * kd * kh * kw
+                            static_cast<T>(1), weight->dptr<T>(), col_buf, static_cast<T>(0),
+                            GetImgMutDptr<T>(out, i));
+        if (bias_dptr != nullptr) {
+          Util::AddBias(params.channels_last ? out_spatial : 1, params.filters,
+                        params.channels_last ? 1 : out_spatial, bias_dptr,
+                        GetImgMutDptr<T>(out, i));
+        }
+      }
+    });
+  } else if (algorithm == ConvCpuAlgorithm::kDirect && Util::IsDepthwise(params)) {
+    Util::PackDepthwiseFilter(params, weight->dptr<T>(), fixed_dptr);
+    ForEachTask([&](T*, int64_t row_begin, int64_t row_end) {
+      Util::DepthwiseConv(row_begin, row_end, params, in->dptr<T>(), fixed_dptr, bias_dptr,
+                          out->mut_dptr<T>());
+    });
+  } else if (algorithm == ConvCpuAlgorithm::kDirect) {
+    const int64_t num_pixels = params.batch * out_spatial;
+    ForEachTask([&](T* rows, int64_t chunk_begin, int64_t chunk_end) {
+      FOR_RANGE(int64_t, chunk, chunk_begin, chunk_end) {
+        const int64_t pixel_begin = chunk * kDirectChunkSize;
+        const int64_t chunk_size = std::min(kDirectChunkSize, num_pixels - pixel_begin);
+        const T* x_rows = in->dptr<T>() + pixel_begin * params.in_channels;
+        if (rows != nullptr) {
+          Gather1x1Pixels<T>(params, pixel_begin, chunk_size, in->dptr<T>(), rows);
+          x_rows = rows;
+        }
+        // out = x_rows * weight(T), the pixels of a chunk are the rows of one gemm
+        T* out_rows = out->mut_dptr<T>() + pixel_begin * params.filters;
+        NewKernelUtil<DeviceType::kCPU>::OFGemm(nullptr, CblasNoTrans, CblasTrans, chunk_size,
+                                                params.filters, params.in_channels,
+                                                static_cast<T>(1), x_rows, weight->dptr<T>(),
+                                                static_cast<T>(0), out_rows);
+        if (bias_dptr != nullptr) {
+          Util::AddBias(chunk_size, params.filters, 1, bias_dptr, out_rows);
+        }
+      }
+    });
+  } else if (algorithm == ConvCpuAlgorithm::kWinograd) {
+    ctx->ParallelFor(params.filters, 1, [&](int64_t begin, int64_t end) {
+      Util::WinogradTransformFilter(begin, end, params, weight->dptr<T>(), fixed_dptr);
+    });
+    ForEachTask([&](T* workspace, int64_t block_begin, int64_t block_end) {
+      Util::WinogradConv(block_begin, block_end, params, in->dptr<T>(), fixed_dptr, bias_dptr,
+                         workspace, out->mut_dptr<T>());
+    });
+  } else {
+    UNIMPLEMENTED();
+  }
+}
+
+// the forced algorithm of the job config when it applies, otherwise the fastest of a run of
+// each applicable one that fits in the tmp buffer, which is sized for the default algorithm
+template<typename T>
+ConvCpuAlgorithm ChooseConvCpuAlgorithm(const JobDesc& job_desc, const ConvCpuParams& params,
+                                        size_t tmp_buffer_size,
+                                        const std::function<void(ConvCpuAlgorithm)>& Run) {
+  const ConvCpuAlgorithm default_algorithm = GetDefaultConvCpuAlgorithm<T>(job_desc, params);
+  const JobConfigProto& job_conf = job_desc.job_conf();
+  if (job_conf.has_cpu_conv_force_fwd_algo()
+      && kConvCpuAlgorithms[job_conf.cpu_conv_force_fwd_algo()] == default_algorithm) {
+    return default_algorithm;
+  }
+  std::vector<ConvCpuAlgorithm> candidates;
+  for (ConvCpuAlgorithm algorithm : kConvCpuAlgorithms) {
+    if (IsConvCpuAlgorithmApplicable<T>(algorithm, params)
+        && (algorithm == default_algorithm
+            || IsConvCpuTmpBufferEnough(GetConvCpuTmpLayout<T>(algorithm, params),
+                                        tmp_buffer_size))) {
+      candidates.push_back(algorithm);
+    }
+  }
+  CHECK(!candidates.empty());
+  if (candidates.size() == 1) { return candidates.front(); }
+  ConvCpuAlgorithm best = candidates.front();
+  double best_time = std::numeric_limits<double>::max();
+  for (ConvCpuAlgorithm algorithm : candidates) {
+    // the second run, the first one warms up the caches and the workspaces
+    Run(algorithm);
+    const auto start = std::chrono::steady_clock::now();
+    Run(algorithm);
+    const double time =
+        std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+    if (time < best_time) {
+      best = algorithm;
+      best_time = time;
+    }
+  }
+  return best;
+}
+
 template<typename T, size_t NDims>
 class ConvCpuKernel final : public user_op::OpKernel {
  public:
@@ -403,81 +731,42 @@ class ConvCpuKernel final : public user_op::OpKernel {
   void Compute(user_op::KernelComputeContext* ctx, user_op::OpKernelState* state) const override {
     const user_op::Tensor* in = ctx->Tensor4ArgNameAndIndex("in", 0);
     const user_op::Tensor* weight = ctx->Tensor4ArgNameAndIndex("weight", 0);
+    const user_op::Tensor* bias = ctx->Tensor4ArgNameAndIndex("bias", 0);
     user_op::Tensor* tmp_buffer = ctx->Tensor4ArgNameAndIndex("tmp_buffer", 0);
     user_op::Tensor* out = ctx->Tensor4ArgNameAndIndex("out", 0);
 
-    T* col_buf_dptr = tmp_buffer->mut_dptr<T>();
-
     auto* conv_state = dynamic_cast<ConvOpKernelState<T>*>(state);
-    conv_state->Update(in->shape(), out->shape());
     CHECK_NOTNULL(conv_state);
-    bool is_bias_mul_inited = false;
-    for (int64_t i = 0; i < in->shape().At(0); ++i) {
-      conv_state->im2col_func_(GetImgDptr<T>(in, i), ShapeView(conv_state->in_5d_shape_),
-                               ShapeView(conv_state->weight_5d_shape_),
-                               ShapeView(conv_state->out_5d_shape_), conv_state->strides_3d_.data(),
-                               conv_state->dilation_rate_3d_.data(),
-                               conv_state->padding_before_3d_.data(), col_buf_dptr);
-
-      // channels first: out = weight * col_buf
-      // channels last:  out = (weight * col_buf)(T)
-      int32_t idx_offset = conv_state->idx_offset_;
-      conv_state->forward_func_(
-          CblasNoTrans, CblasNoTrans,
-          conv_state->weight_5d_shape_.At(0),                           // filter
-          conv_state->out_5d_shape_.Count(idx_offset, idx_offset + 3),  // od * oh * ow
-          conv_state->weight_5d_shape_.Count(1),                        // ci * kd * kh * kw
-          static_cast<T>(1), weight->dptr<T>(), col_buf_dptr, static_cast<T>(0),
-          GetImgMutDptr<T>(out, i));
-
-      const user_op::Tensor* bias = ctx->Tensor4ArgNameAndIndex("bias", 0);
-      if (bias != nullptr) {
-        int64_t num_of_col_buf = CalcElemNumOfColBuf(out->shape(), weight->shape(), idx_offset);
-        int64_t num_of_bias_mul = tmp_buffer->shape().elem_cnt() - num_of_col_buf;
-        CHECK_GT(num_of_bias_mul, 0);
-        T* bias_mul_dptr = col_buf_dptr + num_of_col_buf * sizeof(T);
-        if (!is_bias_mul_inited) {
-          InitBiasMulBuf(bias_mul_dptr, num_of_bias_mul);
-          is_bias_mul_inited = true;
-        }
-
-        // channels first:  out += bias * bias_mul
-        // channels last:   out += (bias * bias_mul)(T)
-        conv_state->forward_func_(
-            CblasNoTrans, CblasNoTrans,
-            conv_state->weight_5d_shape_.At(0),                           // filter
-            conv_state->out_5d_shape_.Count(idx_offset, idx_offset + 3),  // od * oh * ow
-            1,                                                            // 1
-            static_cast<T>(1), bias->dptr<T>(), bias_mul_dptr, static_cast<T>(1),
-            GetImgMutDptr<T>(out, i));
-      }
+    conv_state->Update(in->shape(), out->shape());
+    const ConvCpuParams params = MakeConvCpuParams(
+        conv_state->idx_offset_, ShapeView(conv_state->in_5d_shape_),
+        ShapeView(conv_state->out_5d_shape_), ShapeView(conv_state->weight_5d_shape_),
+        conv_state->strides_3d_, conv_state->dilation_rate_3d_, conv_state->padding_before_3d_,
+        ctx->Attr<int32_t>("groups"));
+    const auto Run = [&](ConvCpuAlgorithm algorithm) {
+      ConvCpuForward<T>(ctx, *conv_state, params, algorithm, in, weight, bias, tmp_buffer, out);
+    };
+    Shape in_shape;
+    in->shape().ToShape(&in_shape);
+    auto it = conv_state->algorithm_cache_.find(in_shape);
+    if (it == conv_state->algorithm_cache_.end()) {
+      it = conv_state->algorithm_cache_
+               .emplace(in_shape, ChooseConvCpuAlgorithm<T>(ctx->job_desc(), params,
+                                                            tmp_buffer->shape().elem_cnt(), Run))
+               .first;
     }
+    Run(it->second);
   }
 };
 
-#define REGISTER_CONV_KERNEL(op_name, dtype, ndims)                                         \
-  REGISTER_USER_KERNEL(#op_name)                                                            \
-      .SetCreateFn<ConvCpuKernel<dtype, ndims>>()                                           \
-      .SetIsMatchedHob((user_op::HobDeviceTag() == "cpu")                                   \
-                       & (user_op::HobAttr<int32_t>("groups") == 1)                         \
-                       & (user_op::HobDataType("in", 0) == GetDataType<dtype>::value))      \
-      .SetInferTmpSizeFn([](user_op::InferContext* ctx) -> size_t {                         \
-        size_t tmp_buffer_size = 0;                                                         \
-        const auto& out_shape = ctx->TensorDesc4ArgNameAndIndex("out", 0)->shape();         \
-        const auto& weight_shape = ctx->TensorDesc4ArgNameAndIndex("weight", 0)->shape();   \
-                                                                                            \
-        int64_t idx_offset = IdxOffset(ctx->Attr<std::string>("data_format"));              \
-        tmp_buffer_size +=                                                                  \
-            CalcElemNumOfColBuf(out_shape, weight_shape, idx_offset) * sizeof(dtype);       \
-                                                                                            \
-        const auto* bias = ctx->TensorDesc4ArgNameAndIndex("bias", 0);                      \
-        if (bias != nullptr) {                                                              \
-          int64_t bias_mul_cnt = 1;                                                         \
-          for (int i = 0; i < ndims; ++i) { bias_mul_cnt *= out_shape.At(idx_offset + i); } \
-          tmp_buffer_size += bias_mul_cnt * sizeof(dtype);                                  \
-        }                                                                                   \
-        return tmp_buffer_size;                                                             \
-      })
+#define REGISTER_CONV_KERNEL(op_name, dtype, ndims)                                   \
+  REGISTER_USER_KERNEL(#op_name)                                                      \
+      .SetCreateFn<ConvCpuKernel<dtype, ndims>>()                                     \
+      .SetIsMatchedHob(                                                               \
+          (user_op::HobDeviceTag() == "cpu")                                          \
+          & (user_op::HobCtxGetter<bool>("groups", IsConvCpuGroupsSupported) == true) \
+          & (user_op::HobDataType("in", 0) == GetDataType<dtype>::value))             \
+      .SetInferTmpSizeFn(InferConvCpuTmpSize<dtype>)
 
 REGISTER_CONV_KERNEL(conv1d, float, 1);
 REGISTER_CONV_KERNEL(conv2d, float, 2);
@@ -0,0 +1,59 @@
+/*
+Copyright 2020 The OneFlow Authors. All rights reserved.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+*/
+#include "oneflow/core/framework/framework.h"
+#include "oneflow/core/thread/thread_manager.h"
+#include "oneflow/user/kernels/fused_elementwise_kernel_util.h"
+
+namespace oneflow {
+
+template<typename T>
+class FusedElementwiseCpuKernel final : public user_op::OpKernel {
+ public:
+  explicit FusedElementwiseCpuKernel(user_op::KernelCreateContext* ctx)
+      : program_(ctx->Attr<std::vector<std::string>>("program")) {}
+  ~FusedElementwiseCpuKernel() = default;
+
+ private:
+  void Compute(user_op::KernelComputeContext* ctx) const override {
+    user_op::Tensor* out = ctx->Tensor4ArgNameAndIndex("out", 0);
+    std::vector<const T*> inputs;
+    std::vector<FusedElementwiseBroadcast> broadcasts;
+    FOR_RANGE(int32_t, i, 0, ctx->user_op_conf().input_size("in")) {
+      const user_op::Tensor* in = ctx->Tensor4ArgNameAndIndex("in", i);
+      inputs.push_back(in->dptr<T>());
+      broadcasts.emplace_back();
+      CHECK_JUST(GetFusedElementwiseBroadcast(in->shape(), out->shape(), &broadcasts.back()));
+    }
+    T* out_ptr = out->mut_dptr<T>();
+    ParallelFor(out->shape().elem_cnt(), kParallelForGrainSize, [&](int64_t begin, int64_t end) {
+      program_.Run<T>(begin, end, inputs, broadcasts, out_ptr);
+    });
+  }
+  bool AlwaysComputeWhenAllOutputsEmpty() const override { return false; }
+
+  FusedElementwiseProgram program_;
+};
+
+#define REGISTER_FUSED_ELEMENTWISE_CPU_KERNEL(dtype)                                     \
+  REGISTER_USER_KERNEL("fused_elementwise")                                              \
+      .SetCreateWithCtxFn<FusedElementwiseCpuKernel<dtype>>()                            \
+      .SetIsMatchedHob((user_op::HobDeviceTag() == "cpu")                                \
+                       & (user_op::HobDataType("out", 0) == GetDataType<dtype>::value));
+
+REGISTER_FUSED_ELEMENTWISE_CPU_KERNEL(float)
+REGISTER_FUSED_ELEMENTWISE_CPU_KERNEL(double)
+
+}  // namespace oneflow
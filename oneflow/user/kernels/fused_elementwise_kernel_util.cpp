@@ -0,0 +1,224 @@
+/*
+Copyright 2020 The OneFlow Authors. All rights reserved.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+*/
+#include "oneflow/user/kernels/fused_elementwise_kernel_util.h"
+#include "oneflow/core/common/cpu_simd_math.h"
+#include "oneflow/core/common/data_type.h"
+
+namespace oneflow {
+
+namespace {
+
+// elements of a block, a multiple of the width of every SimdVec
+constexpr int64_t kBlockSize = 512;
+
+// the input values of output elements [begin, begin + n)
+template<typename T>
+void LoadInput(int64_t begin, int64_t n, const T* in, const FusedElementwiseBroadcast& broadcast,
+               T* dst) {
+  int64_t idx = (begin / broadcast.inner) % broadcast.size;
+  int64_t inner_idx = begin % broadcast.inner;
+  int64_t i = 0;
+  while (i < n) {
+    if (broadcast.inner == 1) {
+      const int64_t run = std::min(broadcast.size - idx, n - i);
+      std::copy(in + idx, in + idx + run, dst + i);
+      i += run;
+      idx += run;
+    } else {
+      const int64_t run = std::min(broadcast.inner - inner_idx, n - i);
+      std::fill(dst + i, dst + i + run, in[idx]);
+      i += run;
+      idx += 1;
+      inner_idx = 0;
+    }
+    if (idx == broadcast.size) { idx = 0; }
+  }
+}
+
+}  // namespace
+
+Maybe<void> GetFusedElementwiseBroadcast(const ShapeView& in, const ShapeView& out,
+                                         FusedElementwiseBroadcast* broadcast) {
+  CHECK_LE_OR_RETURN(in.NumAxes(), out.NumAxes());
+  const int64_t offset = out.NumAxes() - in.NumAxes();
+  broadcast->size = 1;
+  broadcast->inner = 1;
+  // from the last axis: axes broadcast over, then the axes in keeps, then broadcast again
+  bool kept = false;
+  bool kept_done = false;
+  for (int64_t i = out.NumAxes() - 1; i >= 0; --i) {
+    const int64_t out_dim = out.At(i);
+    const int64_t in_dim = i >= offset ? in.At(i - offset) : 1;
+    CHECK_OR_RETURN(in_dim == out_dim || in_dim == 1)
+        << "fused_elementwise can not broadcast " << in.ToString() << " to " << out.ToString();
+    if (out_dim == 1) { continue; }
+    if (in_dim == out_dim) {
+      CHECK_OR_RETURN(!kept_done) << "fused_elementwise broadcasts " << in.ToString() << " to "
+                                  << out.ToString() << " only when its kept axes are contiguous";
+      kept = true;
+      broadcast->size *= in_dim;
+    } else if (kept) {
+      kept_done = true;
+    } else {
+      broadcast->inner *= out_dim;
+    }
+  }
+  return Maybe<void>::Ok();
+}
+
+FusedElementwiseProgram::FusedElementwiseProgram(const std::vector<std::string>& tokens) {
+  CHECK_JUST(Parse(tokens, GetMaxVal<int32_t>(), &instructions_, &max_depth_));
+}
+
+Maybe<void> FusedElementwiseProgram::Check(const std::vector<std::string>& tokens,
+                                           int32_t num_inputs) {
+  std::vector<Instruction> instructions;
+  int64_t max_depth = 0;
+  return Parse(tokens, num_inputs, &instructions, &max_depth);
+}
+
+Maybe<void> FusedElementwiseProgram::Parse(const std::vector<std::string>& tokens,
+                                           int32_t num_inputs,
+                                           std::vector<Instruction>* instructions,
+                                           int64_t* max_depth) {
+  static const HashMap<std::string, OpCode> name2op_code = {
+      {"abs", kAbs},         {"negative", kNegative}, {"square", kSquare},   {"sqrt", kSqrt},
+      {"relu", kRelu},       {"exp", kExp},           {"log", kLog},         {"sigmoid", kSigmoid},
+      {"tanh", kTanh},       {"gelu", kGelu},         {"add", kAdd},         {"sub", kSub},
+      {"mul", kMul},         {"div", kDiv},           {"maximum", kMaximum}, {"minimum", kMinimum},
+  };
+  instructions->clear();
+  *max_depth = 0;
+  int64_t depth = 0;
+  for (const std::string& token : tokens) {
+    Instruction instruction;
+    instruction.input = 0;
+    instruction.constant = 0;
+    const size_t colon = token.find(':');
+    const std::string name = token.substr(0, colon);
+    const char* arg = colon == std::string::npos ? "" : token.c_str() + colon + 1;
+    char* arg_end = nullptr;
+    if (name == "in") {
+      const int64_t input = std::strtol(arg, &arg_end, 10);
+      CHECK_OR_RETURN(*arg != '\0' && *arg_end == '\0' && input >= 0 && input < num_inputs)
+          << "fused_elementwise has no input " << token;
+      instruction.op_code = kInput;
+      instruction.input = input;
+      depth += 1;
+    } else if (name == "const") {
+      instruction.constant = std::strtod(arg, &arg_end);
+      CHECK_OR_RETURN(*arg != '\0' && *arg_end == '\0') << "bad constant " << token;
+      instruction.op_code = kConst;
+      depth += 1;
+    } else {
+      const auto it = name2op_code.find(token);
+      CHECK_OR_RETURN(it != name2op_code.end()) << "unknown fused_elementwise token " << token;
+      instruction.op_code = it->second;
+      const int64_t arity = instruction.op_code < kAdd ? 1 : 2;
+      CHECK_GE_OR_RETURN(depth, arity) << "missing operand of " << token;
+      depth -= arity - 1;
+    }
+    instructions->push_back(instruction);
+    *max_depth = std::max(*max_depth, depth);
+  }
+  CHECK_EQ_OR_RETURN(depth, 1) << "a fused_elementwise program has to leave one value";
+  return Maybe<void>::Ok();
+}
+
+template<typename T>
+void FusedElementwiseProgram::Run(int64_t begin, int64_t end, const std::vector<const T*>& inputs,
+                                  const std::vector<FusedElementwiseBroadcast>& broadcasts,
+                                  T* out) const {
+  using V = simd::SimdVec<T>;
+  using Math = simd::Math<T>;
+  using Reg = typename V::Reg;
+  // the values on the stack, in the inputs or in the slots of scratch
+  std::vector<T> scratch(max_depth_ * kBlockSize);
+  std::vector<const T*> stack(max_depth_);
+  for (int64_t block_begin = begin; block_begin < end; block_begin += kBlockSize) {
+    const int64_t n = std::min(kBlockSize, end - block_begin);
+    int64_t depth = 0;
+    for (const Instruction& instruction : instructions_) {
+      switch (instruction.op_code) {
+        case kInput: {
+          const T* in = inputs.at(instruction.input);
+          const FusedElementwiseBroadcast& broadcast = broadcasts.at(instruction.input);
+          if (broadcast.inner == 1 && broadcast.size >= end) {
+            stack[depth] = in + block_begin;
+          } else {
+            T* slot = scratch.data() + depth * kBlockSize;
+            LoadInput(block_begin, n, in, broadcast, slot);
+            stack[depth] = slot;
+          }
+          depth += 1;
+          break;
+        }
+        case kConst: {
+          T* slot = scratch.data() + depth * kBlockSize;
+          std::fill(slot, slot + n, static_cast<T>(instruction.constant));
+          stack[depth] = slot;
+          depth += 1;
+          break;
+        }
+#define FUSED_ELEMENTWISE_UNARY_CASE(op_code, expr)                                  \
+  case op_code: {                                                                    \
+    T* slot = scratch.data() + (depth - 1) * kBlockSize;                             \
+    simd::Transform(n, stack[depth - 1], slot, [](Reg x) -> Reg { return (expr); }); \
+    stack[depth - 1] = slot;                                                         \
+    break;                                                                           \
+  }
+          FUSED_ELEMENTWISE_UNARY_CASE(kAbs, V::Max(x, V::Sub(V::Zero(), x)))
+          FUSED_ELEMENTWISE_UNARY_CASE(kNegative, V::Mul(V::Set1(-1), x))
+          FUSED_ELEMENTWISE_UNARY_CASE(kSquare, V::Mul(x, x))
+          FUSED_ELEMENTWISE_UNARY_CASE(kSqrt, V::Sqrt(x))
+          FUSED_ELEMENTWISE_UNARY_CASE(kRelu, V::Max(V::Zero(), x))
+          FUSED_ELEMENTWISE_UNARY_CASE(kExp, Math::Exp(x))
+          FUSED_ELEMENTWISE_UNARY_CASE(kLog, Math::Log(x))
+          FUSED_ELEMENTWISE_UNARY_CASE(kSigmoid, Math::Sigmoid(x))
+          FUSED_ELEMENTWISE_UNARY_CASE(kTanh, Math::Tanh(x))
+          FUSED_ELEMENTWISE_UNARY_CASE(kGelu, Math::Gelu(x))
+#undef FUSED_ELEMENTWISE_UNARY_CASE
+#define FUSED_ELEMENTWISE_BINARY_CASE(op_code, expr)             \
+  case op_code: {                                                \
+    T* slot = scratch.data() + (depth - 2) * kBlockSize;         \
+    simd::Transform(n, stack[depth - 2], stack[depth - 1], slot, \
+                    [](Reg a, Reg b) -> Reg { return (expr); }); \
+    stack[depth - 2] = slot;                                     \
+    depth -= 1;                                                  \
+    break;                                                       \
+  }
+          FUSED_ELEMENTWISE_BINARY_CASE(kAdd, V::Add(a, b))
+          FUSED_ELEMENTWISE_BINARY_CASE(kSub, V::Sub(a, b))
+          FUSED_ELEMENTWISE_BINARY_CASE(kMul, V::Mul(a, b))
+          FUSED_ELEMENTWISE_BINARY_CASE(kDiv, V::Div(a, b))
+          FUSED_ELEMENTWISE_BINARY_CASE(kMaximum, V::Max(a, b))
+          FUSED_ELEMENTWISE_BINARY_CASE(kMinimum, V::Min(a, b))
+#undef FUSED_ELEMENTWISE_BINARY_CASE
+        default: UNIMPLEMENTED();
+      }
+    }
+    std::copy(stack[0], stack[0] + n, out + block_begin);
+  }
+}
+
+#define INSTANTIATE_FUSED_ELEMENTWISE_PROGRAM_RUN(type_cpp, type_proto)               \
+  template void FusedElementwiseProgram::Run<type_cpp>(                               \
+      int64_t begin, int64_t end, const std::vector<const type_cpp*>& inputs,         \
+      const std::vector<FusedElementwiseBroadcast>& broadcasts, type_cpp* out) const;
+OF_PP_FOR_EACH_TUPLE(INSTANTIATE_FUSED_ELEMENTWISE_PROGRAM_RUN, FLOATING_DATA_TYPE_SEQ);
+#undef INSTANTIATE_FUSED_ELEMENTWISE_PROGRAM_RUN
+
+}  // namespace oneflow
@@ -0,0 +1,98 @@
+/*
+Copyright 2020 The OneFlow Authors. All rights reserved.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+*/
+#ifndef ONEFLOW_USER_KERNELS_FUSED_ELEMENTWISE_KERNEL_UTIL_H_
+#define ONEFLOW_USER_KERNELS_FUSED_ELEMENTWISE_KERNEL_UTIL_H_
+
+#include "oneflow/core/common/maybe.h"
+#include "oneflow/core/common/shape_view.h"
+
+namespace oneflow {
+
+// How an input of fused_elementwise is broadcast to the output: output element j reads input
+// element (j / inner) % size.
+struct FusedElementwiseBroadcast {
+  int64_t size;
+  int64_t inner;
+};
+
+// Numpy broadcasting of in to out, where the axes in keeps have to be contiguous once the axes
+// of out with a dim of 1 are left out: a scalar, a bias along some axes or the whole of out.
+Maybe<void> GetFusedElementwiseBroadcast(const ShapeView& in, const ShapeView& out,
+                                         FusedElementwiseBroadcast* broadcast);
+
+// The program of fused_elementwise, tokens in postfix order each pushing a value:
+//   in:<i>       the i-th input broadcast to the output
+//   const:<c>    the constant c
+//   abs, negative, square, sqrt, relu, exp, log, sigmoid, tanh, gelu
+//                the function of the value on top, in place of it
+//   add, sub, mul, div, maximum, minimum
+//                a op b in place of the two values a, b on top, b the topmost
+// and the one value left is the output. The program runs a block of elements at a time, with the
+// intermediate values of a block in the L1 cache, so that each input is read and the output
+// written once: ["in:0", "in:1", "add", "gelu", "const:2", "mul"] is a bias_add, a gelu and a
+// scalar_mul in one pass over the memory.
+class FusedElementwiseProgram final {
+ public:
+  OF_DISALLOW_COPY_AND_MOVE(FusedElementwiseProgram);
+  explicit FusedElementwiseProgram(const std::vector<std::string>& tokens);
+  ~FusedElementwiseProgram() = default;
+
+  // an error for an unknown token, an input out of [0, num_inputs), a missing operand or other
+  // than one value left at the end
+  static Maybe<void> Check(const std::vector<std::string>& tokens, int32_t num_inputs);
+
+  // the output elements [begin, end)
+  template<typename T>
+  void Run(int64_t begin, int64_t end, const std::vector<const T*>& inputs,
+           const std::vector<FusedElementwiseBroadcast>& broadcasts, T* out) const;
+
+ private:
+  enum OpCode {
+    kInput,
+    kConst,
+    kAbs,
+    kNegative,
+    kSquare,
+    kSqrt,
+    kRelu,
+    kExp,
+    kLog,
+    kSigmoid,
+    kTanh,
+    kGelu,
+    kAdd,
+    kSub,
+    kMul,
+    kDiv,
+    kMaximum,
+    kMinimum,
+  };
+  struct Instruction {
+    OpCode op_code;
+    int32_t input;
+    double constant;
+  };
+
+  static Maybe<void> Parse(const std::vector<std::string>& tokens, int32_t num_inputs,
+                           std::vector<Instruction>* instructions, int64_t* max_depth);
+
+  std::vector<Instruction> instructions_;
+  int64_t max_depth_;
+};
+
+}  // namespace oneflow
+
+#endif  // ONEFLOW_USER_KERNELS_FUSED_ELEMENTWISE_KERNEL_UTIL_H_
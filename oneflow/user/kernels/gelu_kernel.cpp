@@ -14,6 +14,8 @@ See the License for the specific language governing permissions and
 limitations under the License.
 */
 #include "oneflow/core/framework/framework.h"
+#include "oneflow/core/common/cpu_simd_math.h"
+#include "oneflow/core/thread/thread_manager.h"
 
 namespace oneflow {
 
@@ -30,10 +32,10 @@ class CpuGeluKernel final : public user_op::OpKernel {
     const int32_t elem_cnt = in->shape().elem_cnt();
     const T* in_ptr = in->dptr<T>();
     T* out_ptr = out->mut_dptr<T>();
-    T inv_sqrt2 = std::sqrt(0.5);
-    FOR_RANGE(int32_t, i, 0, elem_cnt) {
-      out_ptr[i] = 0.5 * in_ptr[i] * (1.0 + std::erf(inv_sqrt2 * in_ptr[i]));
-    }
+    ParallelFor(elem_cnt, kParallelForGrainSize, [&](int64_t begin, int64_t end) {
+      simd::Transform(end - begin, in_ptr + begin, out_ptr + begin,
+                      [](typename simd::Math<T>::Reg v) { return simd::Math<T>::Gelu(v); });
+    });
   };
 
   bool AlwaysComputeWhenAllOutputsEmpty() const override { return false; }
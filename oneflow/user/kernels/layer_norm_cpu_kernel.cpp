@@ -14,6 +14,8 @@ See the License for the specific language governing permissions and
 limitations under the License.
 */
 #include "oneflow/core/framework/framework.h"
+#include "oneflow/user/kernels/layer_norm_cpu_kernel_util.h"
+#include "oneflow/core/thread/thread_manager.h"
 
 namespace oneflow {
 
@@ -25,7 +27,44 @@ class LayerNormCpuKernel final : public user_op::OpKernel {
 
  private:
   bool AlwaysComputeWhenAllOutputsEmpty() const override { return false; }
-  void Compute(user_op::KernelComputeContext* ctx) const override { TODO(); };
+  void Compute(user_op::KernelComputeContext* ctx) const override {
+    const user_op::Tensor* x = ctx->Tensor4ArgNameAndIndex("x", 0);
+    user_op::Tensor* y = ctx->Tensor4ArgNameAndIndex("y", 0);
+    user_op::Tensor* mean = ctx->Tensor4ArgNameAndIndex("mean", 0);
+    user_op::Tensor* inv_variance = ctx->Tensor4ArgNameAndIndex("inv_variance", 0);
+    const bool scale = ctx->Attr<bool>("scale");
+    const bool center = ctx->Attr<bool>("center");
+    T* normalized_ptr =
+        scale ? ctx->Tensor4ArgNameAndIndex("normalized", 0)->mut_dptr<T>() : nullptr;
+    const double epsilon = ctx->Attr<double>("epsilon");
+    const int64_t num_instances = mean->shape().elem_cnt();
+    const int64_t norm_size = x->shape().elem_cnt() / num_instances;
+    int64_t instance_size = 0;
+    const T* gamma_ptr = nullptr;
+    const T* beta_ptr = nullptr;
+    if (scale) {
+      const user_op::Tensor* gamma = ctx->Tensor4ArgNameAndIndex("gamma", 0);
+      instance_size = gamma->shape().elem_cnt();
+      gamma_ptr = gamma->dptr<T>();
+    }
+    if (center) {
+      const user_op::Tensor* beta = ctx->Tensor4ArgNameAndIndex("beta", 0);
+      if (gamma_ptr) {
+        CHECK_EQ(beta->shape().elem_cnt(), instance_size);
+      } else {
+        instance_size = beta->shape().elem_cnt();
+      }
+      beta_ptr = beta->dptr<T>();
+    }
+    if (scale || center) { CHECK_EQ(y->shape().elem_cnt() % instance_size, 0); }
+    const int64_t grain_size = ParallelForGrainSize(norm_size);
+    ctx->ParallelFor(num_instances, grain_size, [&](int64_t begin, int64_t end) {
+      LayerNormCpuKernelUtil<T>::Forward(begin, end, norm_size, instance_size, epsilon,
+                                         x->dptr<T>(), gamma_ptr, beta_ptr, mean->mut_dptr<T>(),
+                                         inv_variance->mut_dptr<T>(), normalized_ptr,
+                                         y->mut_dptr<T>());
+    });
+  };
 };
 
 #define REGISTER_LAYER_NORM_CPU_KERNEL(dtype)             \
@@ -45,7 +84,21 @@ class LayerNormGradCpuKernel final : public user_op::OpKernel {
 
  private:
   bool AlwaysComputeWhenAllOutputsEmpty() const override { return false; }
-  void Compute(user_op::KernelComputeContext* ctx) const override { TODO(); };
+  void Compute(user_op::KernelComputeContext* ctx) const override {
+    const user_op::Tensor* dy = ctx->Tensor4ArgNameAndIndex("dy", 0);
+    const user_op::Tensor* x = ctx->Tensor4ArgNameAndIndex("x", 0);
+    const user_op::Tensor* mean = ctx->Tensor4ArgNameAndIndex("mean", 0);
+    const user_op::Tensor* inv_variance = ctx->Tensor4ArgNameAndIndex("inv_variance", 0);
+    user_op::Tensor* dx = ctx->Tensor4ArgNameAndIndex("dx", 0);
+    const int64_t num_instances = mean->shape().elem_cnt();
+    const int64_t norm_size = x->shape().elem_cnt() / num_instances;
+    const int64_t grain_size = ParallelForGrainSize(norm_size);
+    ctx->ParallelFor(num_instances, grain_size, [&](int64_t begin, int64_t end) {
+      LayerNormCpuKernelUtil<T>::Backward(begin, end, norm_size, dy->dptr<T>(), x->dptr<T>(),
+                                          mean->dptr<T>(), inv_variance->dptr<T>(),
+                                          dx->mut_dptr<T>());
+    });
+  };
 };
 
 #define REGISTER_LAYER_NORM_GRAD_CPU_KERNEL(dtype)        \
@@ -65,7 +118,33 @@ class LayerNormParamGradCpuKernel final : public user_op::OpKernel {
 
  private:
   bool AlwaysComputeWhenAllOutputsEmpty() const override { return false; }
-  void Compute(user_op::KernelComputeContext* ctx) const override { TODO(); };
+  void Compute(user_op::KernelComputeContext* ctx) const override {
+    const user_op::Tensor* dy = ctx->Tensor4ArgNameAndIndex("dy", 0);
+    user_op::Tensor* beta_diff = ctx->Tensor4ArgNameAndIndex("beta_diff", 0);
+    user_op::Tensor* gamma_diff = ctx->Tensor4ArgNameAndIndex("gamma_diff", 0);
+    user_op::Tensor* normalized_diff = ctx->Tensor4ArgNameAndIndex("normalized_diff", 0);
+    const user_op::Tensor* gamma = ctx->Tensor4ArgNameAndIndex("gamma", 0);
+    const int64_t begin_params_axis = ctx->Attr<int64_t>("begin_params_axis");
+    const int64_t m = dy->shape().Count(begin_params_axis);
+    CHECK_EQ(dy->shape().elem_cnt() % m, 0);
+    const int64_t n = dy->shape().elem_cnt() / m;
+    const T* normalized_ptr = nullptr;
+    if (gamma_diff != nullptr) {
+      CHECK_EQ(m, gamma_diff->shape().elem_cnt());
+      normalized_ptr = ctx->Tensor4ArgNameAndIndex("normalized", 0)->dptr<T>();
+    }
+    if (beta_diff != nullptr) { CHECK_EQ(m, beta_diff->shape().elem_cnt()); }
+    if (normalized_diff != nullptr && gamma != nullptr) { CHECK_EQ(m, gamma->shape().elem_cnt()); }
+    // split by columns, so every sum of gamma_diff and beta_diff is made by one thread
+    ctx->ParallelFor(m, ParallelForGrainSize(n), [&](int64_t begin, int64_t end) {
+      LayerNormCpuKernelUtil<T>::ParamGrad(
+          begin, end, n, m, dy->dptr<T>(), normalized_ptr,
+          gamma != nullptr ? gamma->dptr<T>() : nullptr,
+          gamma_diff != nullptr ? gamma_diff->mut_dptr<T>() : nullptr,
+          beta_diff != nullptr ? beta_diff->mut_dptr<T>() : nullptr,
+          normalized_diff != nullptr ? normalized_diff->mut_dptr<T>() : nullptr);
+    });
+  };
 };
 
 #define REGISTER_LAYER_NORM_PARAM_GRAD_CPU_KERNEL(dtype)  \
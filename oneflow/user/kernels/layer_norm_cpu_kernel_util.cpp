@@ -0,0 +1,262 @@
+/*
+Copyright 2020 The OneFlow Authors. All rights reserved.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+*/
+#include "oneflow/user/kernels/layer_norm_cpu_kernel_util.h"
+#include "oneflow/core/common/cpu_simd.h"
+
+namespace oneflow {
+
+namespace {
+
+// Welford's algorithm over each vector lane, then the lanes and the tail are merged as in Chan et
+// al., so x is read once and the variance does not suffer from cancellation
+template<typename T>
+void RowMeanInvVariance(const T* x, int64_t norm_size, double epsilon, T* mean,
+                        T* inv_variance) {
+  using Vec = simd::SimdVec<T>;
+  constexpr int64_t kWidth = Vec::kWidth;
+  const int64_t vec_size = norm_size / kWidth * kWidth;
+  T row_mean = 0;
+  T row_m2 = 0;
+  int64_t cnt = 0;
+  if (vec_size > 0) {
+    typename Vec::Reg mean_v = Vec::Zero();
+    typename Vec::Reg m2_v = Vec::Zero();
+    for (int64_t i = 0; i < vec_size; i += kWidth) {
+      const typename Vec::Reg x_v = Vec::Load(x + i);
+      const typename Vec::Reg delta = Vec::Sub(x_v, mean_v);
+      mean_v = Vec::Fma(delta, Vec::Set1(static_cast<T>(1) / (i / kWidth + 1)), mean_v);
+      m2_v = Vec::Fma(delta, Vec::Sub(x_v, mean_v), m2_v);
+    }
+    T lane_mean[kWidth];
+    T lane_m2[kWidth];
+    Vec::Store(lane_mean, mean_v);
+    Vec::Store(lane_m2, m2_v);
+    const int64_t lane_cnt = vec_size / kWidth;
+    row_mean = lane_mean[0];
+    row_m2 = lane_m2[0];
+    cnt = lane_cnt;
+    for (int64_t lane = 1; lane < kWidth; ++lane) {
+      const T delta = lane_mean[lane] - row_mean;
+      const T ratio = static_cast<T>(lane_cnt) / (cnt + lane_cnt);
+      row_mean += delta * ratio;
+      row_m2 += lane_m2[lane] + delta * delta * cnt * ratio;
+      cnt += lane_cnt;
+    }
+  }
+  for (int64_t i = vec_size; i < norm_size; ++i) {
+    cnt += 1;
+    const T delta = x[i] - row_mean;
+    row_mean += delta / cnt;
+    row_m2 += delta * (x[i] - row_mean);
+  }
+  const T variance = std::max(row_m2 / norm_size, static_cast<T>(0));
+  *mean = row_mean;
+  *inv_variance = static_cast<T>(1) / std::sqrt(variance + static_cast<T>(epsilon));
+}
+
+// gamma and beta start at the first element of the row
+template<typename T, bool do_scale, bool do_center>
+void RowNormalizeScaleCenter(const T* x, int64_t norm_size, T mean, T inv_variance,
+                             const T* gamma, const T* beta, T* normalized, T* y) {
+  using Vec = simd::SimdVec<T>;
+  constexpr int64_t kWidth = Vec::kWidth;
+  const int64_t vec_size = norm_size / kWidth * kWidth;
+  const typename Vec::Reg mean_v = Vec::Set1(mean);
+  const typename Vec::Reg inv_variance_v = Vec::Set1(inv_variance);
+  for (int64_t i = 0; i < vec_size; i += kWidth) {
+    typename Vec::Reg v = Vec::Mul(Vec::Sub(Vec::Load(x + i), mean_v), inv_variance_v);
+    if (do_scale) {
+      Vec::Store(normalized + i, v);
+      v = Vec::Mul(v, Vec::Load(gamma + i));
+    }
+    if (do_center) { v = Vec::Add(v, Vec::Load(beta + i)); }
+    Vec::Store(y + i, v);
+  }
+  for (int64_t i = vec_size; i < norm_size; ++i) {
+    T v = (x[i] - mean) * inv_variance;
+    if (do_scale) {
+      normalized[i] = v;
+      v *= gamma[i];
+    }
+    if (do_center) { v += beta[i]; }
+    y[i] = v;
+  }
+}
+
+template<typename T, bool do_scale, bool do_center>
+void ForwardRows(int64_t row_begin, int64_t row_end, int64_t norm_size, int64_t instance_size,
+                 double epsilon, const T* x, const T* gamma, const T* beta, T* mean,
+                 T* inv_variance, T* normalized, T* y) {
+  FOR_RANGE(int64_t, row, row_begin, row_end) {
+    const int64_t offset = row * norm_size;
+    RowMeanInvVariance<T>(x + offset, norm_size, epsilon, mean + row, inv_variance + row);
+    if ((!do_scale && !do_center) || instance_size == norm_size) {
+      RowNormalizeScaleCenter<T, do_scale, do_center>(x + offset, norm_size, mean[row],
+                                                      inv_variance[row], gamma, beta,
+                                                      normalized + offset, y + offset);
+    } else {
+      // params that do not line up with the rows, as GPU's InstanceScaleCenter
+      FOR_RANGE(int64_t, i, offset, offset + norm_size) {
+        const int64_t elem_id = i % instance_size;
+        T v = (x[i] - mean[row]) * inv_variance[row];
+        if (do_scale) {
+          normalized[i] = v;
+          v *= gamma[elem_id];
+        }
+        if (do_center) { v += beta[elem_id]; }
+        y[i] = v;
+      }
+    }
+  }
+}
+
+template<typename T>
+void BackwardRow(const T* dy, const T* x, int64_t norm_size, T mean, T inv_variance, T* dx) {
+  using Vec = simd::SimdVec<T>;
+  constexpr int64_t kWidth = Vec::kWidth;
+  const int64_t vec_size = norm_size / kWidth * kWidth;
+  const typename Vec::Reg mean_v = Vec::Set1(mean);
+  const typename Vec::Reg inv_variance_v = Vec::Set1(inv_variance);
+  T sum_dy = 0;
+  T sum_dy_normalized = 0;
+  if (vec_size > 0) {
+    typename Vec::Reg sum_dy_v = Vec::Zero();
+    typename Vec::Reg sum_dy_normalized_v = Vec::Zero();
+    for (int64_t i = 0; i < vec_size; i += kWidth) {
+      const typename Vec::Reg dy_v = Vec::Load(dy + i);
+      const typename Vec::Reg normalized_v =
+          Vec::Mul(Vec::Sub(Vec::Load(x + i), mean_v), inv_variance_v);
+      sum_dy_v = Vec::Add(sum_dy_v, dy_v);
+      sum_dy_normalized_v = Vec::Fma(dy_v, normalized_v, sum_dy_normalized_v);
+    }
+    sum_dy = Vec::ReduceAdd(sum_dy_v);
+    sum_dy_normalized = Vec::ReduceAdd(sum_dy_normalized_v);
+  }
+  for (int64_t i = vec_size; i < norm_size; ++i) {
+    sum_dy += dy[i];
+    sum_dy_normalized += dy[i] * (x[i] - mean) * inv_variance;
+  }
+  // dx = inv_variance * (dy - mean(dy) - normalized * mean(dy * normalized))
+  const T mean_dy = sum_dy / norm_size;
+  const T mean_dy_normalized = sum_dy_normalized / norm_size;
+  const typename Vec::Reg mean_dy_v = Vec::Set1(mean_dy);
+  const typename Vec::Reg mean_dy_normalized_v = Vec::Set1(mean_dy_normalized);
+  for (int64_t i = 0; i < vec_size; i += kWidth) {
+    const typename Vec::Reg normalized_v =
+        Vec::Mul(Vec::Sub(Vec::Load(x + i), mean_v), inv_variance_v);
+    const typename Vec::Reg v = Vec::Sub(Vec::Sub(Vec::Load(dy + i), mean_dy_v),
+                                         Vec::Mul(normalized_v, mean_dy_normalized_v));
+    Vec::Store(dx + i, Vec::Mul(v, inv_variance_v));
+  }
+  for (int64_t i = vec_size; i < norm_size; ++i) {
+    const T normalized = (x[i] - mean) * inv_variance;
+    dx[i] = (dy[i] - mean_dy - normalized * mean_dy_normalized) * inv_variance;
+  }
+}
+
+// out[i] = a[i] * b[i] + c[i], or a[i] * b[i] when c is nullptr
+template<typename T>
+void MulAdd(int64_t size, const T* a, const T* b, const T* c, T* out) {
+  using Vec = simd::SimdVec<T>;
+  constexpr int64_t kWidth = Vec::kWidth;
+  const int64_t vec_size = size / kWidth * kWidth;
+  if (c != nullptr) {
+    for (int64_t i = 0; i < vec_size; i += kWidth) {
+      Vec::Store(out + i, Vec::Fma(Vec::Load(a + i), Vec::Load(b + i), Vec::Load(c + i)));
+    }
+    for (int64_t i = vec_size; i < size; ++i) { out[i] = a[i] * b[i] + c[i]; }
+  } else {
+    for (int64_t i = 0; i < vec_size; i += kWidth) {
+      Vec::Store(out + i, Vec::Mul(Vec::Load(a + i), Vec::Load(b + i)));
+    }
+    for (int64_t i = vec_size; i < size; ++i) { out[i] = a[i] * b[i]; }
+  }
+}
+
+template<typename T>
+void AddTo(int64_t size, const T* a, T* out) {
+  using Vec = simd::SimdVec<T>;
+  constexpr int64_t kWidth = Vec::kWidth;
+  const int64_t vec_size = size / kWidth * kWidth;
+  for (int64_t i = 0; i < vec_size; i += kWidth) {
+    Vec::Store(out + i, Vec::Add(Vec::Load(a + i), Vec::Load(out + i)));
+  }
+  for (int64_t i = vec_size; i < size; ++i) { out[i] += a[i]; }
+}
+
+}  // namespace
+
+template<typename T>
+void LayerNormCpuKernelUtil<T>::Forward(int64_t row_begin, int64_t row_end, int64_t norm_size,
+                                        int64_t instance_size, double epsilon, const T* x,
+                                        const T* gamma, const T* beta, T* mean, T* inv_variance,
+                                        T* normalized, T* y) {
+  if (gamma != nullptr) { CHECK(normalized != nullptr); }
+  if (gamma != nullptr && beta != nullptr) {
+    ForwardRows<T, true, true>(row_begin, row_end, norm_size, instance_size, epsilon, x, gamma,
+                               beta, mean, inv_variance, normalized, y);
+  } else if (gamma != nullptr) {
+    ForwardRows<T, true, false>(row_begin, row_end, norm_size, instance_size, epsilon, x, gamma,
+                                beta, mean, inv_variance, normalized, y);
+  } else if (beta != nullptr) {
+    ForwardRows<T, false, true>(row_begin, row_end, norm_size, instance_size, epsilon, x, gamma,
+                                beta, mean, inv_variance, normalized, y);
+  } else {
+    ForwardRows<T, false, false>(row_begin, row_end, norm_size, instance_size, epsilon, x, gamma,
+                                 beta, mean, inv_variance, normalized, y);
+  }
+}
+
+template<typename T>
+void LayerNormCpuKernelUtil<T>::Backward(int64_t row_begin, int64_t row_end, int64_t norm_size,
+                                         const T* dy, const T* x, const T* mean,
+                                         const T* inv_variance, T* dx) {
+  FOR_RANGE(int64_t, row, row_begin, row_end) {
+    const int64_t offset = row * norm_size;
+    BackwardRow<T>(dy + offset, x + offset, norm_size, mean[row], inv_variance[row], dx + offset);
+  }
+}
+
+template<typename T>
+void LayerNormCpuKernelUtil<T>::ParamGrad(int64_t col_begin, int64_t col_end, int64_t n,
+                                          int64_t m, const T* dy, const T* normalized,
+                                          const T* gamma, T* gamma_diff, T* beta_diff,
+                                          T* normalized_diff) {
+  const int64_t cols = col_end - col_begin;
+  if (gamma_diff != nullptr) { std::fill(gamma_diff + col_begin, gamma_diff + col_end, 0); }
+  if (beta_diff != nullptr) { std::fill(beta_diff + col_begin, beta_diff + col_end, 0); }
+  // the partial sums of a block of columns stay in cache while the rows stream by
+  FOR_RANGE(int64_t, row, 0, n) {
+    const int64_t offset = row * m + col_begin;
+    if (gamma_diff != nullptr) {
+      MulAdd<T>(cols, dy + offset, normalized + offset, gamma_diff + col_begin,
+                gamma_diff + col_begin);
+    }
+    if (beta_diff != nullptr) { AddTo<T>(cols, dy + offset, beta_diff + col_begin); }
+    if (normalized_diff != nullptr) {
+      if (gamma != nullptr) {
+        MulAdd<T>(cols, dy + offset, gamma + col_begin, nullptr, normalized_diff + offset);
+      } else {
+        std::copy(dy + offset, dy + offset + cols, normalized_diff + offset);
+      }
+    }
+  }
+}
+
+template struct LayerNormCpuKernelUtil<float>;
+template struct LayerNormCpuKernelUtil<double>;
+
+}  // namespace oneflow
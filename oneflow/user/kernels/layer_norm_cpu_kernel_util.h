@@ -0,0 +1,43 @@
+/*
+Copyright 2020 The OneFlow Authors. All rights reserved.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+*/
+#ifndef ONEFLOW_USER_KERNELS_LAYER_NORM_CPU_KERNEL_UTIL_H_
+#define ONEFLOW_USER_KERNELS_LAYER_NORM_CPU_KERNEL_UTIL_H_
+
+#include "oneflow/core/common/util.h"
+
+namespace oneflow {
+
+// x is viewed as rows of norm_size elements, gamma and beta repeat every instance_size elements
+// of x. Forward and Backward handle rows [row_begin, row_end), ParamGrad handles columns
+// [col_begin, col_end) of the n x m dy, so callers may split the work between threads.
+template<typename T>
+struct LayerNormCpuKernelUtil {
+  // gamma, beta and normalized may be nullptr, normalized is written only when given
+  static void Forward(int64_t row_begin, int64_t row_end, int64_t norm_size, int64_t instance_size,
+                      double epsilon, const T* x, const T* gamma, const T* beta, T* mean,
+                      T* inv_variance, T* normalized, T* y);
+  // dy is the diff of normalized
+  static void Backward(int64_t row_begin, int64_t row_end, int64_t norm_size, const T* dy,
+                       const T* x, const T* mean, const T* inv_variance, T* dx);
+  // every output may be nullptr, normalized_diff is dy when gamma is nullptr
+  static void ParamGrad(int64_t col_begin, int64_t col_end, int64_t n, int64_t m, const T* dy,
+                        const T* normalized, const T* gamma, T* gamma_diff, T* beta_diff,
+                        T* normalized_diff);
+};
+
+}  // namespace oneflow
+
+#endif  // ONEFLOW_USER_KERNELS_LAYER_NORM_CPU_KERNEL_UTIL_H_
@@ -0,0 +1,213 @@
+/*
+Copyright 2020 The OneFlow Authors. All rights reserved.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+*/
+#include "oneflow/core/common/cpu_test_util.h"
+#include "oneflow/user/kernels/layer_norm_cpu_kernel_util.h"
+
+namespace oneflow {
+
+namespace {
+
+using test::BenchmarkMs;
+using test::ExpectNear;
+using test::RandomData;
+using test::RandomDataFarFromZero;
+using test::TwoParts;
+
+// the straightforward two pass version in double
+template<typename T>
+void NaiveForward(int64_t num_instances, int64_t norm_size, int64_t instance_size, double epsilon,
+                  const T* x, const T* gamma, const T* beta, T* mean, T* inv_variance,
+                  T* normalized, T* y) {
+  FOR_RANGE(int64_t, row, 0, num_instances) {
+    const T* x_row = x + row * norm_size;
+    double sum = 0;
+    FOR_RANGE(int64_t, i, 0, norm_size) { sum += x_row[i]; }
+    const double row_mean = sum / norm_size;
+    double square_sum = 0;
+    FOR_RANGE(int64_t, i, 0, norm_size) {
+      square_sum += (x_row[i] - row_mean) * (x_row[i] - row_mean);
+    }
+    const double row_inv_variance = 1.0 / std::sqrt(square_sum / norm_size + epsilon);
+    mean[row] = row_mean;
+    inv_variance[row] = row_inv_variance;
+    FOR_RANGE(int64_t, i, row * norm_size, (row + 1) * norm_size) {
+      double v = (x[i] - row_mean) * row_inv_variance;
+      if (gamma != nullptr) {
+        normalized[i] = v;
+        v *= gamma[i % instance_size];
+      }
+      if (beta != nullptr) { v += beta[i % instance_size]; }
+      y[i] = v;
+    }
+  }
+}
+
+template<typename T>
+void NaiveBackward(int64_t num_instances, int64_t norm_size, const T* dy, const T* x,
+                   const T* mean, const T* inv_variance, T* dx) {
+  FOR_RANGE(int64_t, row, 0, num_instances) {
+    const int64_t offset = row * norm_size;
+    double sum_dy = 0;
+    double sum_dy_normalized = 0;
+    FOR_RANGE(int64_t, i, offset, offset + norm_size) {
+      sum_dy += dy[i];
+      sum_dy_normalized += dy[i] * (x[i] - mean[row]) * inv_variance[row];
+    }
+    FOR_RANGE(int64_t, i, offset, offset + norm_size) {
+      const double normalized = (x[i] - mean[row]) * inv_variance[row];
+      dx[i] = (dy[i] - sum_dy / norm_size - normalized * sum_dy_normalized / norm_size)
+              * inv_variance[row];
+    }
+  }
+}
+
+template<typename T>
+void TestForwardBackward(int64_t num_instances, int64_t norm_size, int64_t instance_size,
+                         bool scale, bool center, double tolerance) {
+  const int64_t elem_cnt = num_instances * norm_size;
+  const std::vector<T> x = RandomDataFarFromZero<T>(elem_cnt);
+  const std::vector<T> dy = RandomData<T>(elem_cnt, -1, 1);
+  const std::vector<T> gamma = RandomData<T>(instance_size, 0.5, 1.5);
+  const std::vector<T> beta = RandomData<T>(instance_size, -1, 1);
+  const T* gamma_ptr = scale ? gamma.data() : nullptr;
+  const T* beta_ptr = center ? beta.data() : nullptr;
+  std::vector<T> mean(num_instances);
+  std::vector<T> inv_variance(num_instances);
+  std::vector<T> normalized(elem_cnt);
+  std::vector<T> y(elem_cnt);
+  std::vector<T> dx(elem_cnt);
+  std::vector<T> expected_mean(num_instances);
+  std::vector<T> expected_inv_variance(num_instances);
+  std::vector<T> expected_normalized(elem_cnt);
+  std::vector<T> expected_y(elem_cnt);
+  std::vector<T> expected_dx(elem_cnt);
+  const double epsilon = 1e-5;
+  NaiveForward<T>(num_instances, norm_size, instance_size, epsilon, x.data(), gamma_ptr, beta_ptr,
+                  expected_mean.data(), expected_inv_variance.data(), expected_normalized.data(),
+                  expected_y.data());
+  TwoParts(num_instances, [&](int64_t begin, int64_t end) {
+    LayerNormCpuKernelUtil<T>::Forward(begin, end, norm_size, instance_size, epsilon, x.data(),
+                                       gamma_ptr, beta_ptr, mean.data(), inv_variance.data(),
+                                       normalized.data(), y.data());
+  });
+  ExpectNear(expected_mean, mean, tolerance);
+  ExpectNear(expected_inv_variance, inv_variance, tolerance);
+  ExpectNear(expected_y, y, tolerance);
+  if (scale) { ExpectNear(expected_normalized, normalized, tolerance); }
+
+  NaiveBackward<T>(num_instances, norm_size, dy.data(), x.data(), mean.data(),
+                   inv_variance.data(), expected_dx.data());
+  LayerNormCpuKernelUtil<T>::Backward(0, num_instances, norm_size, dy.data(), x.data(),
+                                      mean.data(), inv_variance.data(), dx.data());
+  ExpectNear(expected_dx, dx, tolerance);
+}
+
+template<typename T>
+void TestParamGrad(int64_t n, int64_t m, double tolerance) {
+  const std::vector<T> dy = RandomData<T>(n * m, -1, 1);
+  const std::vector<T> normalized = RandomData<T>(n * m, -2, 2);
+  const std::vector<T> gamma = RandomData<T>(m, 0.5, 1.5);
+  std::vector<T> expected_gamma_diff(m, 0);
+  std::vector<T> expected_beta_diff(m, 0);
+  std::vector<T> expected_normalized_diff(n * m);
+  FOR_RANGE(int64_t, i, 0, n) {
+    FOR_RANGE(int64_t, j, 0, m) {
+      expected_gamma_diff[j] += dy[i * m + j] * normalized[i * m + j];
+      expected_beta_diff[j] += dy[i * m + j];
+      expected_normalized_diff[i * m + j] = dy[i * m + j] * gamma[j];
+    }
+  }
+  std::vector<T> gamma_diff(m, -1);
+  std::vector<T> beta_diff(m, -1);
+  std::vector<T> normalized_diff(n * m);
+  TwoParts(m, [&](int64_t begin, int64_t end) {
+    LayerNormCpuKernelUtil<T>::ParamGrad(begin, end, n, m, dy.data(), normalized.data(),
+                                         gamma.data(), gamma_diff.data(), beta_diff.data(),
+                                         normalized_diff.data());
+  });
+  ExpectNear(expected_gamma_diff, gamma_diff, tolerance);
+  ExpectNear(expected_beta_diff, beta_diff, tolerance);
+  ExpectNear(expected_normalized_diff, normalized_diff, tolerance);
+  // without gamma normalized_diff is dy
+  LayerNormCpuKernelUtil<T>::ParamGrad(0, m, n, m, dy.data(), nullptr, nullptr, nullptr, nullptr,
+                                       normalized_diff.data());
+  ExpectNear(dy, normalized_diff, 0);
+}
+
+}  // namespace
+
+TEST(LayerNormCpuKernelUtil, forward_backward) {
+  // sizes with and without a tail after the last vector
+  for (const int64_t norm_size : {1, 7, 64, 67, 768}) {
+    for (const bool scale : {true, false}) {
+      for (const bool center : {true, false}) {
+        TestForwardBackward<float>(10, norm_size, norm_size, scale, center, 1e-3);
+        TestForwardBackward<double>(10, norm_size, norm_size, scale, center, 1e-9);
+      }
+    }
+  }
+  // params repeat within a row
+  TestForwardBackward<float>(6, 96, 32, true, true, 1e-3);
+  TestForwardBackward<double>(6, 96, 32, true, true, 1e-9);
+}
+
+TEST(LayerNormCpuKernelUtil, param_grad) {
+  for (const int64_t m : {1, 7, 64, 67, 768}) {
+    TestParamGrad<float>(33, m, 1e-4);
+    TestParamGrad<double>(33, m, 1e-9);
+  }
+}
+
+// compares with the naive two pass version on one thread over typical hidden sizes, run with
+// --gtest_also_run_disabled_tests
+TEST(LayerNormCpuKernelUtil, DISABLED_benchmark) {
+  const int64_t num_instances = 4096;
+  for (const int64_t norm_size : {768, 1024, 4096}) {
+    const int64_t elem_cnt = num_instances * norm_size;
+    const std::vector<float> x = RandomData<float>(elem_cnt, -1, 1);
+    const std::vector<float> dy = RandomData<float>(elem_cnt, -1, 1);
+    const std::vector<float> gamma = RandomData<float>(norm_size, 0.5, 1.5);
+    const std::vector<float> beta = RandomData<float>(norm_size, -1, 1);
+    std::vector<float> mean(num_instances);
+    std::vector<float> inv_variance(num_instances);
+    std::vector<float> normalized(elem_cnt);
+    std::vector<float> y(elem_cnt);
+    std::vector<float> dx(elem_cnt);
+    const double forward_ms = BenchmarkMs([&]() {
+      LayerNormCpuKernelUtil<float>::Forward(0, num_instances, norm_size, norm_size, 1e-5,
+                                             x.data(), gamma.data(), beta.data(), mean.data(),
+                                             inv_variance.data(), normalized.data(), y.data());
+    });
+    const double naive_forward_ms = BenchmarkMs([&]() {
+      NaiveForward<float>(num_instances, norm_size, norm_size, 1e-5, x.data(), gamma.data(),
+                          beta.data(), mean.data(), inv_variance.data(), normalized.data(),
+                          y.data());
+    });
+    const double backward_ms = BenchmarkMs([&]() {
+      LayerNormCpuKernelUtil<float>::Backward(0, num_instances, norm_size, dy.data(), x.data(),
+                                              mean.data(), inv_variance.data(), dx.data());
+    });
+    const double naive_backward_ms = BenchmarkMs([&]() {
+      NaiveBackward<float>(num_instances, norm_size, dy.data(), x.data(), mean.data(),
+                           inv_variance.data(), dx.data());
+    });
+    LOG(INFO) << num_instances << "x" << norm_size << ": forward " << forward_ms << "ms (naive "
+              << naive_forward_ms << "ms), backward " << backward_ms << "ms (naive "
+              << naive_backward_ms << "ms)";
+  }
+}
+
+}  // namespace oneflow
@@ -15,9 +15,39 @@ limitations under the License.
 */
 #include "oneflow/core/framework/framework.h"
 #include "oneflow/user/kernels/math_unary_elementwise_func.h"
+#include "oneflow/core/common/cpu_simd_math.h"
+#include "oneflow/core/thread/thread_manager.h"
 
 namespace oneflow {
 
+namespace {
+
+template<template<typename> class UnaryFunctor, typename T>
+struct CpuUnaryForward {
+  static void Compute(int64_t n, const T* x, T* y) {
+    for (int64_t i = 0; i < n; ++i) { y[i] = UnaryFunctor<T>::Forward(x[i]); }
+  }
+};
+
+// the functors simd::Math has on whole vectors
+#define SPECIALIZE_SIMD_CPU_UNARY_FORWARD(functor, math_func)      \
+  template<typename T>                                             \
+  struct CpuUnaryForward<functor, T> {                             \
+    static void Compute(int64_t n, const T* x, T* y) {             \
+      simd::Transform(n, x, y, [](typename simd::Math<T>::Reg v) { \
+        return simd::Math<T>::math_func(v);                        \
+      });                                                          \
+    }                                                              \
+  };
+SPECIALIZE_SIMD_CPU_UNARY_FORWARD(ErfFunctor, Erf)
+SPECIALIZE_SIMD_CPU_UNARY_FORWARD(ExpFunctor, Exp)
+SPECIALIZE_SIMD_CPU_UNARY_FORWARD(LogFunctor, Log)
+SPECIALIZE_SIMD_CPU_UNARY_FORWARD(SigmoidFunctor, Sigmoid)
+SPECIALIZE_SIMD_CPU_UNARY_FORWARD(TanhFunctor, Tanh)
+#undef SPECIALIZE_SIMD_CPU_UNARY_FORWARD
+
+}  // namespace
+
 template<template<typename> class UnaryFunctor, typename T>
 class MathUnaryElementwiseCpuKernel final : public user_op::OpKernel {
  public:
@@ -32,7 +62,9 @@ class MathUnaryElementwiseCpuKernel final : public user_op::OpKernel {
     T* y = tensor_y->mut_dptr<T>();
     int64_t n = tensor_x->shape().elem_cnt();
     CHECK_LE(n, GetMaxVal<int32_t>() / 2);
-    for (int32_t i = 0; i < n; ++i) { y[i] = UnaryFunctor<T>::Forward(x[i]); }
+    ParallelFor(n, kParallelForGrainSize, [&](int64_t begin, int64_t end) {
+      CpuUnaryForward<UnaryFunctor, T>::Compute(end - begin, x + begin, y + begin);
+    });
   }
   bool AlwaysComputeWhenAllOutputsEmpty() const override { return false; }
 };
@@ -54,7 +86,9 @@ class MathUnaryElementwiseGradCpuKernel final : public user_op::OpKernel {
     T* dx = tensor_dx->mut_dptr<T>();
     int64_t n = tensor_x->shape().elem_cnt();
     CHECK_LE(n, GetMaxVal<int32_t>() / 2);
-    for (int32_t i = 0; i < n; ++i) { dx[i] = UnaryFunctor<T>::Backward(x[i], dy[i]); }
+    ParallelFor(n, kParallelForGrainSize, [&](int64_t begin, int64_t end) {
+      for (int64_t i = begin; i < end; ++i) { dx[i] = UnaryFunctor<T>::Backward(x[i], dy[i]); }
+    });
   }
   bool AlwaysComputeWhenAllOutputsEmpty() const override { return false; }
 };
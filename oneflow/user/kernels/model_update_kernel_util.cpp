@@ -15,6 +15,7 @@ limitations under the License.
 */
 #include "oneflow/core/framework/framework.h"
 #include "oneflow/user/kernels/model_update_kernel_util.h"
+#include "oneflow/core/thread/thread_manager.h"
 
 namespace oneflow {
 
@@ -33,9 +34,11 @@ void SGDUpdateKernelUtil<DeviceType::kCPU, T, G>::Update(DeviceCtx* ctx, int64_t
                                                          T* model) {
   const T lr = *learning_rate;
   if (scale_by_ptr != nullptr) { scale *= *scale_by_ptr; }
-  for (int64_t i = 0; i != n; ++i) {
-    SGDUpdateFunctor<T, G>()(model_diff + i, model + i, scale, l1, l2, weight_decay, lr);
-  }
+  user_op::ParallelForInOpKernel(n, kParallelForGrainSize, [=](int64_t begin, int64_t end) {
+    for (int64_t i = begin; i != end; ++i) {
+      SGDUpdateFunctor<T, G>()(model_diff + i, model + i, scale, l1, l2, weight_decay, lr);
+    }
+  });
 }
 
 template struct SGDUpdateKernelUtil<DeviceType::kCPU, float, float>;
@@ -85,10 +88,12 @@ void MomentumUpdateKernelUtil<DeviceType::kCPU, T, G>::Update(
     const float* learning_rate, const T* scale_by_ptr, const G* model_diff, T* model, T* momentum) {
   const T lr = *learning_rate;
   if (scale_by_ptr != nullptr) { scale *= *scale_by_ptr; }
-  for (int64_t i = 0; i != n; ++i) {
-    MomentumUpdateFunctor<T, G>()(model_diff + i, model + i, momentum + i, scale, l1, l2, beta,
-                                  weight_decay, lr);
-  }
+  user_op::ParallelForInOpKernel(n, kParallelForGrainSize, [=](int64_t begin, int64_t end) {
+    for (int64_t i = begin; i != end; ++i) {
+      MomentumUpdateFunctor<T, G>()(model_diff + i, model + i, momentum + i, scale, l1, l2, beta,
+                                    weight_decay, lr);
+    }
+  });
 }
 
 template struct MomentumUpdateKernelUtil<DeviceType::kCPU, float, float>;
@@ -144,10 +149,12 @@ void AdamUpdateKernelUtil<DeviceType::kCPU, T, G>::Update(
     T* model, T* m, T* v) {
   const float lr = *learning_rate;
   if (scale_by_ptr != nullptr) { scale *= *scale_by_ptr; }
-  FOR_RANGE(int64_t, i, 0, n) {
-    AdamUpdateFunctor<T, G>()(model_diff + i, model + i, m + i, v + i, scale, l1, l2, beta1, beta2,
-                              epsilon, weight_decay, lr);
-  }
+  user_op::ParallelForInOpKernel(n, kParallelForGrainSize, [=](int64_t begin, int64_t end) {
+    FOR_RANGE(int64_t, i, begin, end) {
+      AdamUpdateFunctor<T, G>()(model_diff + i, model + i, m + i, v + i, scale, l1, l2, beta1,
+                                beta2, epsilon, weight_decay, lr);
+    }
+  });
 }
 
 template struct AdamUpdateKernelUtil<DeviceType::kCPU, float, float>;
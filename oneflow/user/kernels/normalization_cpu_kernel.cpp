@@ -0,0 +1,301 @@
+/*
+Copyright 2020 The OneFlow Authors. All rights reserved.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+*/
+#include "oneflow/core/framework/framework.h"
+#include "oneflow/user/kernels/normalization_cpu_kernel_util.h"
+#include "oneflow/core/thread/thread_manager.h"
+
+namespace oneflow {
+
+namespace {
+
+constexpr int64_t kMaskBits = 32;
+
+constexpr int64_t kCacheLineSize = 64;
+
+// with channels last a task reads a block of channels from every row, so it takes at least a
+// cache line of them
+template<typename T>
+int64_t ChannelGrainSize(int64_t outer, int64_t inner) {
+  const int64_t grain_size = ParallelForGrainSize(outer * inner);
+  return inner == 1 ? std::max<int64_t>(grain_size, kCacheLineSize / sizeof(T)) : grain_size;
+}
+
+void CheckParamTensor(const user_op::Tensor* tensor, DataType data_type, int64_t channel) {
+  CHECK_EQ(tensor->shape().NumAxes(), 1);
+  CHECK_EQ(tensor->shape().At(0), channel);
+  CHECK_EQ(tensor->data_type(), data_type);
+}
+
+template<typename T>
+class NormalizationCpuKernel final : public user_op::OpKernel {
+ public:
+  NormalizationCpuKernel() = default;
+  ~NormalizationCpuKernel() override = default;
+
+ private:
+  void Compute(user_op::KernelComputeContext* ctx) const override {
+    const bool training = ctx->user_op_conf().op_type_name() == "normalization"
+                              ? ctx->Attr<bool>("training")
+                              : true;
+    const auto* x = ctx->Tensor4ArgNameAndIndex("x", 0);
+    auto* y = ctx->Tensor4ArgNameAndIndex("y", 0);
+    const auto* gamma = ctx->Tensor4ArgNameAndIndex("gamma", 0);
+    const auto* beta = ctx->Tensor4ArgNameAndIndex("beta", 0);
+    auto* moving_mean = ctx->Tensor4ArgNameAndIndex("moving_mean", 0);
+    auto* moving_variance = ctx->Tensor4ArgNameAndIndex("moving_variance", 0);
+    const auto axis = ctx->Attr<int32_t>("axis");
+    const auto epsilon = ctx->Attr<float>("epsilon");
+
+    const DataType data_type = x->data_type();
+    CHECK_EQ(x->shape(), y->shape());
+    CHECK_EQ(y->data_type(), data_type);
+    CHECK_GE(axis, 0);
+    CHECK_LT(axis, x->shape().NumAxes());
+    const int64_t elem_cnt = x->shape().elem_cnt();
+    const int64_t outer = x->shape().Count(0, axis);
+    const int64_t channel = x->shape().At(axis);
+    const int64_t inner = x->shape().Count(axis + 1);
+    CheckParamTensor(gamma, data_type, channel);
+    CheckParamTensor(beta, data_type, channel);
+    CheckParamTensor(moving_mean, data_type, channel);
+    CheckParamTensor(moving_variance, data_type, channel);
+
+    // y = x * scale + shift per channel, for inference it is the whole op
+    std::vector<T> scale(channel);
+    std::vector<T> shift(channel);
+    const T* gamma_ptr = gamma->dptr<T>();
+    const T* beta_ptr = beta->dptr<T>();
+    if (training) {
+      const auto momentum = ctx->Attr<float>("momentum");
+      auto* mean = ctx->Tensor4ArgNameAndIndex("mean", 0);
+      auto* inv_variance = ctx->Tensor4ArgNameAndIndex("inv_variance", 0);
+      CheckParamTensor(mean, data_type, channel);
+      CheckParamTensor(inv_variance, data_type, channel);
+      T* mean_ptr = mean->mut_dptr<T>();
+      // variance goes to inv_variance first
+      T* inv_variance_ptr = inv_variance->mut_dptr<T>();
+      ctx->ParallelFor(channel, ChannelGrainSize<T>(outer, inner),
+                       [&](int64_t begin, int64_t end) {
+                         NormalizationCpuKernelUtil<T>::ComputeStatistics(
+                             begin, end, outer, channel, inner, x->dptr<T>(), mean_ptr,
+                             inv_variance_ptr);
+                       });
+      // moving statistics use the unbiased variance, as cudnn
+      const int64_t count = outer * inner;
+      const T unbias = count > 1 ? static_cast<T>(count) / (count - 1) : 1;
+      T* moving_mean_ptr = moving_mean->mut_dptr<T>();
+      T* moving_variance_ptr = moving_variance->mut_dptr<T>();
+      FOR_RANGE(int64_t, i, 0, channel) {
+        const T variance = inv_variance_ptr[i];
+        moving_mean_ptr[i] = momentum * moving_mean_ptr[i] + (1 - momentum) * mean_ptr[i];
+        moving_variance_ptr[i] =
+            momentum * moving_variance_ptr[i] + (1 - momentum) * variance * unbias;
+        inv_variance_ptr[i] = static_cast<T>(1) / std::sqrt(variance + epsilon);
+        scale[i] = gamma_ptr[i] * inv_variance_ptr[i];
+        shift[i] = beta_ptr[i] - mean_ptr[i] * scale[i];
+      }
+    } else {
+      const T* moving_mean_ptr = moving_mean->dptr<T>();
+      const T* moving_variance_ptr = moving_variance->dptr<T>();
+      FOR_RANGE(int64_t, i, 0, channel) {
+        scale[i] = gamma_ptr[i] / std::sqrt(moving_variance_ptr[i] + epsilon);
+        shift[i] = beta_ptr[i] - moving_mean_ptr[i] * scale[i];
+      }
+    }
+
+    const T* add_to_output_ptr = nullptr;
+    if (ctx->user_op_conf().has_input("_add_to_output", 0)) {
+      const user_op::Tensor* add_to_output = ctx->Tensor4ArgNameAndIndex("_add_to_output", 0);
+      CHECK_EQ(add_to_output->data_type(), y->data_type());
+      CHECK_EQ(add_to_output->shape(), y->shape());
+      add_to_output_ptr = add_to_output->dptr<T>();
+    }
+    const int64_t num_blocks = NormalizationCpuKernelUtil<T>::NumBlocks(outer, channel, inner);
+    ctx->ParallelFor(num_blocks, ParallelForGrainSize(elem_cnt / std::max<int64_t>(num_blocks, 1)),
+                     [&](int64_t begin, int64_t end) {
+                       NormalizationCpuKernelUtil<T>::ScaleShift(
+                           begin, end, channel, inner, x->dptr<T>(), scale.data(), shift.data(),
+                           add_to_output_ptr, y->mut_dptr<T>());
+                     });
+
+    if (ctx->user_op_conf().op_type_name() == "normalization_add_relu") {
+      CHECK(add_to_output_ptr == nullptr);
+      auto* mask = ctx->Tensor4ArgNameAndIndex("reserve_space", 0);
+      const T* addend_ptr = nullptr;
+      if (ctx->user_op_conf().has_input("addend", 0)) {
+        addend_ptr = ctx->Tensor4ArgNameAndIndex("addend", 0)->dptr<T>();
+      }
+      ctx->ParallelFor(RoundUp(elem_cnt, kMaskBits) / kMaskBits, ParallelForGrainSize(kMaskBits),
+                       [&](int64_t begin, int64_t end) {
+                         NormalizationCpuKernelUtil<T>::AddRelu(begin, end, elem_cnt, y->dptr<T>(),
+                                                                addend_ptr, y->mut_dptr<T>(),
+                                                                mask->mut_dptr<int32_t>());
+                       });
+    }
+  }
+
+  bool AlwaysComputeWhenAllOutputsEmpty() const override { return false; }
+};
+
+#define REGISTER_BN_CPU_KERNEL(dtype)                                                           \
+  REGISTER_USER_KERNEL("normalization")                                                         \
+      .SetCreateFn<NormalizationCpuKernel<dtype>>()                                             \
+      .SetIsMatchedHob((user_op::HobDeviceTag() == "cpu")                                       \
+                       & (user_op::HobDataType("y", 0) == GetDataType<dtype>::value))           \
+      .SetInplaceProposalFn([](const user_op::InferContext& ctx,                                \
+                               user_op::AddInplaceArgPair AddInplaceArgPairFn) -> Maybe<void> { \
+        if (ctx.user_op_conf().has_input("_add_to_output", 0)) {                                \
+          OF_RETURN_IF_ERROR(AddInplaceArgPairFn("y", 0, "_add_to_output", 0, true));           \
+        }                                                                                       \
+        return Maybe<void>::Ok();                                                               \
+      });
+
+REGISTER_BN_CPU_KERNEL(float)
+REGISTER_BN_CPU_KERNEL(double)
+
+#undef REGISTER_BN_CPU_KERNEL
+
+#define REGISTER_BN_ADD_RELU_CPU_KERNEL(dtype)                                        \
+  REGISTER_USER_KERNEL("normalization_add_relu")                                      \
+      .SetCreateFn<NormalizationCpuKernel<dtype>>()                                   \
+      .SetIsMatchedHob((user_op::HobDeviceTag() == "cpu")                             \
+                       & (user_op::HobDataType("y", 0) == GetDataType<dtype>::value));
+
+REGISTER_BN_ADD_RELU_CPU_KERNEL(float)
+REGISTER_BN_ADD_RELU_CPU_KERNEL(double)
+
+#undef REGISTER_BN_ADD_RELU_CPU_KERNEL
+
+size_t InferGradTmpSize(user_op::InferContext* ctx) {
+  const auto* dy = ctx->TensorDesc4ArgNameAndIndex("dy", 0);
+  if (ctx->user_op_conf().op_type_name() == "normalization_add_relu_grad"
+      && !ctx->user_op_conf().has_output("addend_diff", 0)) {
+    return dy->shape().elem_cnt() * GetSizeOfDataType(dy->data_type());
+  }
+  return 0;
+}
+
+template<typename T>
+class NormalizationGradCpuKernel final : public user_op::OpKernel {
+ public:
+  NormalizationGradCpuKernel() = default;
+  ~NormalizationGradCpuKernel() override = default;
+
+ private:
+  void Compute(user_op::KernelComputeContext* ctx) const override {
+    const auto* x = ctx->Tensor4ArgNameAndIndex("x", 0);
+    auto* dx = ctx->Tensor4ArgNameAndIndex("dx", 0);
+    const auto* dy = ctx->Tensor4ArgNameAndIndex("dy", 0);
+    const auto* gamma = ctx->Tensor4ArgNameAndIndex("gamma", 0);
+    auto* gamma_diff = ctx->Tensor4ArgNameAndIndex("gamma_diff", 0);
+    auto* beta_diff = ctx->Tensor4ArgNameAndIndex("beta_diff", 0);
+    const auto* mean = ctx->Tensor4ArgNameAndIndex("mean", 0);
+    const auto* inv_variance = ctx->Tensor4ArgNameAndIndex("inv_variance", 0);
+    const auto axis = ctx->Attr<int32_t>("axis");
+
+    const DataType data_type = x->data_type();
+    CHECK_EQ(dy->shape(), x->shape());
+    CHECK_EQ(dy->data_type(), data_type);
+    CHECK_EQ(dx->shape(), x->shape());
+    CHECK_EQ(dx->data_type(), data_type);
+    CHECK_GE(axis, 0);
+    CHECK_LT(axis, x->shape().NumAxes());
+    const int64_t elem_cnt = x->shape().elem_cnt();
+    const int64_t outer = x->shape().Count(0, axis);
+    const int64_t channel = x->shape().At(axis);
+    const int64_t inner = x->shape().Count(axis + 1);
+    CheckParamTensor(gamma, data_type, channel);
+    CheckParamTensor(gamma_diff, data_type, channel);
+    CheckParamTensor(beta_diff, data_type, channel);
+    CheckParamTensor(mean, data_type, channel);
+    CheckParamTensor(inv_variance, data_type, channel);
+
+    const T* bn_dy_ptr = nullptr;
+    if (ctx->user_op_conf().op_type_name() == "normalization_grad") {
+      bn_dy_ptr = dy->dptr<T>();
+    } else if (ctx->user_op_conf().op_type_name() == "normalization_add_relu_grad") {
+      const auto* mask = ctx->Tensor4ArgNameAndIndex("reserve_space", 0);
+      T* relu_dx_ptr = nullptr;
+      if (ctx->user_op_conf().has_output("addend_diff", 0)) {
+        relu_dx_ptr = ctx->Tensor4ArgNameAndIndex("addend_diff", 0)->mut_dptr<T>();
+      } else {
+        auto* tmp_buffer = ctx->Tensor4ArgNameAndIndex("tmp_buffer", 0);
+        CHECK_GE(tmp_buffer->shape().elem_cnt(), static_cast<int64_t>(elem_cnt * sizeof(T)));
+        relu_dx_ptr = tmp_buffer->mut_dptr<T>();
+      }
+      ctx->ParallelFor(RoundUp(elem_cnt, kMaskBits) / kMaskBits, ParallelForGrainSize(kMaskBits),
+                       [&](int64_t begin, int64_t end) {
+                         NormalizationCpuKernelUtil<T>::ReluBackward(
+                             begin, end, elem_cnt, mask->dptr<int32_t>(), dy->dptr<T>(),
+                             relu_dx_ptr);
+                       });
+      bn_dy_ptr = relu_dx_ptr;
+    } else {
+      UNIMPLEMENTED();
+    }
+
+    T* gamma_diff_ptr = gamma_diff->mut_dptr<T>();
+    T* beta_diff_ptr = beta_diff->mut_dptr<T>();
+    // sum(dy * (x - mean)) goes to gamma_diff first
+    ctx->ParallelFor(channel, ChannelGrainSize<T>(outer, inner), [&](int64_t begin, int64_t end) {
+      NormalizationCpuKernelUtil<T>::ComputeGradSums(begin, end, outer, channel, inner, bn_dy_ptr,
+                                                     x->dptr<T>(), mean->dptr<T>(),
+                                                     beta_diff_ptr, gamma_diff_ptr);
+    });
+    // dx = gamma * inv_variance * (dy - mean(dy) - normalized * mean(dy * normalized)), folded
+    // into dx = dy * dy_scale + x * x_scale + shift per channel
+    const T count = outer * inner;
+    const T* gamma_ptr = gamma->dptr<T>();
+    const T* mean_ptr = mean->dptr<T>();
+    const T* inv_variance_ptr = inv_variance->dptr<T>();
+    std::vector<T> dy_scale(channel);
+    std::vector<T> x_scale(channel);
+    std::vector<T> shift(channel);
+    FOR_RANGE(int64_t, i, 0, channel) {
+      gamma_diff_ptr[i] *= inv_variance_ptr[i];
+      dy_scale[i] = gamma_ptr[i] * inv_variance_ptr[i];
+      x_scale[i] = -dy_scale[i] * inv_variance_ptr[i] * gamma_diff_ptr[i] / count;
+      shift[i] = -dy_scale[i] * beta_diff_ptr[i] / count - x_scale[i] * mean_ptr[i];
+    }
+    const int64_t num_blocks = NormalizationCpuKernelUtil<T>::NumBlocks(outer, channel, inner);
+    ctx->ParallelFor(num_blocks, ParallelForGrainSize(elem_cnt / std::max<int64_t>(num_blocks, 1)),
+                     [&](int64_t begin, int64_t end) {
+                       NormalizationCpuKernelUtil<T>::BackwardScaleShift(
+                           begin, end, channel, inner, bn_dy_ptr, x->dptr<T>(), dy_scale.data(),
+                           x_scale.data(), shift.data(), dx->mut_dptr<T>());
+                     });
+  }
+
+  bool AlwaysComputeWhenAllOutputsEmpty() const override { return false; }
+};
+
+#define REGISTER_BN_GRAD_CPU_KERNEL(op_type_name, dtype)                               \
+  REGISTER_USER_KERNEL(op_type_name)                                                   \
+      .SetCreateFn<NormalizationGradCpuKernel<dtype>>()                                \
+      .SetIsMatchedHob((user_op::HobDeviceTag() == "cpu")                              \
+                       & (user_op::HobDataType("dx", 0) == GetDataType<dtype>::value)) \
+      .SetInferTmpSizeFn(InferGradTmpSize);
+
+REGISTER_BN_GRAD_CPU_KERNEL("normalization_grad", float)
+REGISTER_BN_GRAD_CPU_KERNEL("normalization_grad", double)
+REGISTER_BN_GRAD_CPU_KERNEL("normalization_add_relu_grad", float)
+REGISTER_BN_GRAD_CPU_KERNEL("normalization_add_relu_grad", double)
+
+#undef REGISTER_BN_GRAD_CPU_KERNEL
+
+}  // namespace
+
+}  // namespace oneflow
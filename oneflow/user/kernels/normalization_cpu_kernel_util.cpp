@@ -0,0 +1,283 @@
+/*
+Copyright 2020 The OneFlow Authors. All rights reserved.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+*/
+#include "oneflow/user/kernels/normalization_cpu_kernel_util.h"
+#include "oneflow/core/common/cpu_simd.h"
+
+namespace oneflow {
+
+namespace {
+
+// sums are kept in T for at most this many elements per lane before going into a double
+constexpr int64_t kPartialSumSize = 4096;
+
+constexpr int kMaskBits = 32;
+
+// adds sum(u - u_center) and sum((u - u_center) * (v - v_center)) of contiguous elements
+template<typename T, bool has_u_center>
+void ContiguousSums(const T* u, const T* v, int64_t size, T u_center, T v_center, double* sum_u,
+                    double* sum_uv) {
+  using Vec = simd::SimdVec<T>;
+  constexpr int64_t kWidth = Vec::kWidth;
+  const typename Vec::Reg u_center_v = Vec::Set1(u_center);
+  const typename Vec::Reg v_center_v = Vec::Set1(v_center);
+  for (int64_t begin = 0; begin < size; begin += kPartialSumSize * kWidth) {
+    const int64_t end = std::min(size, begin + kPartialSumSize * kWidth);
+    const int64_t vec_end = begin + (end - begin) / kWidth * kWidth;
+    typename Vec::Reg sum_u_v = Vec::Zero();
+    typename Vec::Reg sum_uv_v = Vec::Zero();
+    for (int64_t i = begin; i < vec_end; i += kWidth) {
+      typename Vec::Reg u_v = Vec::Load(u + i);
+      if (has_u_center) { u_v = Vec::Sub(u_v, u_center_v); }
+      sum_u_v = Vec::Add(sum_u_v, u_v);
+      sum_uv_v = Vec::Fma(u_v, Vec::Sub(Vec::Load(v + i), v_center_v), sum_uv_v);
+    }
+    T partial_u = Vec::ReduceAdd(sum_u_v);
+    T partial_uv = Vec::ReduceAdd(sum_uv_v);
+    for (int64_t i = vec_end; i < end; ++i) {
+      const T u_i = has_u_center ? u[i] - u_center : u[i];
+      partial_u += u_i;
+      partial_uv += u_i * (v[i] - v_center);
+    }
+    *sum_u += partial_u;
+    *sum_uv += partial_uv;
+  }
+}
+
+// sum_u += u - u_center and sum_uv += (u - u_center) * (v - v_center) elementwise
+template<typename T, bool has_u_center>
+void AccumulateRow(const T* u, const T* v, int64_t size, const T* u_center, const T* v_center,
+                   T* sum_u, T* sum_uv) {
+  using Vec = simd::SimdVec<T>;
+  constexpr int64_t kWidth = Vec::kWidth;
+  const int64_t vec_size = size / kWidth * kWidth;
+  for (int64_t i = 0; i < vec_size; i += kWidth) {
+    typename Vec::Reg u_v = Vec::Load(u + i);
+    if (has_u_center) { u_v = Vec::Sub(u_v, Vec::Load(u_center + i)); }
+    Vec::Store(sum_u + i, Vec::Add(Vec::Load(sum_u + i), u_v));
+    Vec::Store(sum_uv + i, Vec::Fma(u_v, Vec::Sub(Vec::Load(v + i), Vec::Load(v_center + i)),
+                                    Vec::Load(sum_uv + i)));
+  }
+  for (int64_t i = vec_size; i < size; ++i) {
+    const T u_i = has_u_center ? u[i] - u_center[i] : u[i];
+    sum_u[i] += u_i;
+    sum_uv[i] += u_i * (v[i] - v_center[i]);
+  }
+}
+
+// per channel sum(u - u_center) and sum((u - u_center) * (v - v_center)) over all of u and v,
+// centers and sums are indexed from channel_begin
+template<typename T, bool has_u_center>
+void ChannelSums(int64_t channel_begin, int64_t channel_end, int64_t outer, int64_t channel,
+                 int64_t inner, const T* u, const T* v, const T* u_center, const T* v_center,
+                 T* sum_u, T* sum_uv) {
+  const int64_t num_channels = channel_end - channel_begin;
+  if (inner == 1) {
+    // rows stream by while the sums of a block of channels stay in cache
+    std::vector<T> partial_u(num_channels);
+    std::vector<T> partial_uv(num_channels);
+    std::vector<double> total_u(num_channels, 0);
+    std::vector<double> total_uv(num_channels, 0);
+    for (int64_t row_begin = 0; row_begin < outer; row_begin += kPartialSumSize) {
+      const int64_t row_end = std::min(outer, row_begin + kPartialSumSize);
+      std::fill(partial_u.begin(), partial_u.end(), 0);
+      std::fill(partial_uv.begin(), partial_uv.end(), 0);
+      FOR_RANGE(int64_t, row, row_begin, row_end) {
+        const int64_t offset = row * channel + channel_begin;
+        AccumulateRow<T, has_u_center>(u + offset, v + offset, num_channels, u_center, v_center,
+                                       partial_u.data(), partial_uv.data());
+      }
+      FOR_RANGE(int64_t, i, 0, num_channels) {
+        total_u[i] += partial_u[i];
+        total_uv[i] += partial_uv[i];
+      }
+    }
+    FOR_RANGE(int64_t, i, 0, num_channels) {
+      sum_u[i] = total_u[i];
+      sum_uv[i] = total_uv[i];
+    }
+  } else {
+    FOR_RANGE(int64_t, i, 0, num_channels) {
+      double total_u = 0;
+      double total_uv = 0;
+      FOR_RANGE(int64_t, o, 0, outer) {
+        const int64_t offset = (o * channel + channel_begin + i) * inner;
+        ContiguousSums<T, has_u_center>(u + offset, v + offset, inner,
+                                        has_u_center ? u_center[i] : 0, v_center[i], &total_u,
+                                        &total_uv);
+      }
+      sum_u[i] = total_u;
+      sum_uv[i] = total_uv;
+    }
+  }
+}
+
+// out = a * a_scale + b * b_scale + shift, the b term is skipped when b is nullptr, scales and
+// shift are vectors of size elements
+template<typename T>
+void AffineRow(int64_t size, const T* a, const T* a_scale, const T* b, const T* b_scale,
+               const T* shift, const T* addend, T* out) {
+  using Vec = simd::SimdVec<T>;
+  constexpr int64_t kWidth = Vec::kWidth;
+  const int64_t vec_size = size / kWidth * kWidth;
+  for (int64_t i = 0; i < vec_size; i += kWidth) {
+    typename Vec::Reg v = Vec::Load(shift + i);
+    if (b != nullptr) { v = Vec::Fma(Vec::Load(b + i), Vec::Load(b_scale + i), v); }
+    v = Vec::Fma(Vec::Load(a + i), Vec::Load(a_scale + i), v);
+    if (addend != nullptr) { v = Vec::Add(v, Vec::Load(addend + i)); }
+    Vec::Store(out + i, v);
+  }
+  for (int64_t i = vec_size; i < size; ++i) {
+    T v = shift[i];
+    if (b != nullptr) { v += b[i] * b_scale[i]; }
+    v += a[i] * a_scale[i];
+    if (addend != nullptr) { v += addend[i]; }
+    out[i] = v;
+  }
+}
+
+// the same with scalar scales and shift
+template<typename T>
+void AffineBlock(int64_t size, const T* a, T a_scale, const T* b, T b_scale, T shift,
+                 const T* addend, T* out) {
+  using Vec = simd::SimdVec<T>;
+  constexpr int64_t kWidth = Vec::kWidth;
+  const int64_t vec_size = size / kWidth * kWidth;
+  const typename Vec::Reg a_scale_v = Vec::Set1(a_scale);
+  const typename Vec::Reg b_scale_v = Vec::Set1(b_scale);
+  const typename Vec::Reg shift_v = Vec::Set1(shift);
+  for (int64_t i = 0; i < vec_size; i += kWidth) {
+    typename Vec::Reg v = shift_v;
+    if (b != nullptr) { v = Vec::Fma(Vec::Load(b + i), b_scale_v, v); }
+    v = Vec::Fma(Vec::Load(a + i), a_scale_v, v);
+    if (addend != nullptr) { v = Vec::Add(v, Vec::Load(addend + i)); }
+    Vec::Store(out + i, v);
+  }
+  for (int64_t i = vec_size; i < size; ++i) {
+    T v = shift;
+    if (b != nullptr) { v += b[i] * b_scale; }
+    v += a[i] * a_scale;
+    if (addend != nullptr) { v += addend[i]; }
+    out[i] = v;
+  }
+}
+
+template<typename T>
+void AffineBlocks(int64_t block_begin, int64_t block_end, int64_t channel, int64_t inner,
+                  const T* a, const T* a_scale, const T* b, const T* b_scale, const T* shift,
+                  const T* addend, T* out) {
+  const int64_t block_size = inner == 1 ? channel : inner;
+  FOR_RANGE(int64_t, block, block_begin, block_end) {
+    const int64_t offset = block * block_size;
+    const T* block_b = b != nullptr ? b + offset : nullptr;
+    const T* block_addend = addend != nullptr ? addend + offset : nullptr;
+    if (inner == 1) {
+      AffineRow<T>(channel, a + offset, a_scale, block_b, b_scale, shift, block_addend,
+                   out + offset);
+    } else {
+      const int64_t c = block % channel;
+      AffineBlock<T>(inner, a + offset, a_scale[c], block_b, b != nullptr ? b_scale[c] : 0,
+                     shift[c], block_addend, out + offset);
+    }
+  }
+}
+
+}  // namespace
+
+template<typename T>
+void NormalizationCpuKernelUtil<T>::ComputeStatistics(int64_t channel_begin, int64_t channel_end,
+                                                      int64_t outer, int64_t channel,
+                                                      int64_t inner, const T* x, T* mean,
+                                                      T* variance) {
+  const int64_t num_channels = channel_end - channel_begin;
+  // the shift keeps sum(x^2) - sum(x)^2 / n from cancelling when the mean is far from zero
+  std::vector<T> shift(num_channels);
+  FOR_RANGE(int64_t, i, 0, num_channels) { shift[i] = x[(channel_begin + i) * inner]; }
+  std::vector<T> sum(num_channels);
+  std::vector<T> square_sum(num_channels);
+  ChannelSums<T, true>(channel_begin, channel_end, outer, channel, inner, x, x, shift.data(),
+                       shift.data(), sum.data(), square_sum.data());
+  const T count = outer * inner;
+  FOR_RANGE(int64_t, i, 0, num_channels) {
+    const T shifted_mean = sum[i] / count;
+    mean[channel_begin + i] = shift[i] + shifted_mean;
+    variance[channel_begin + i] =
+        std::max(square_sum[i] / count - shifted_mean * shifted_mean, static_cast<T>(0));
+  }
+}
+
+template<typename T>
+void NormalizationCpuKernelUtil<T>::ScaleShift(int64_t block_begin, int64_t block_end,
+                                               int64_t channel, int64_t inner, const T* x,
+                                               const T* scale, const T* shift, const T* addend,
+                                               T* y) {
+  AffineBlocks<T>(block_begin, block_end, channel, inner, x, scale, nullptr, nullptr, shift,
+                  addend, y);
+}
+
+template<typename T>
+void NormalizationCpuKernelUtil<T>::ComputeGradSums(int64_t channel_begin, int64_t channel_end,
+                                                    int64_t outer, int64_t channel, int64_t inner,
+                                                    const T* dy, const T* x, const T* mean,
+                                                    T* sum_dy, T* sum_dy_x_diff) {
+  ChannelSums<T, false>(channel_begin, channel_end, outer, channel, inner, dy, x, nullptr,
+                        mean + channel_begin, sum_dy + channel_begin,
+                        sum_dy_x_diff + channel_begin);
+}
+
+template<typename T>
+void NormalizationCpuKernelUtil<T>::BackwardScaleShift(int64_t block_begin, int64_t block_end,
+                                                       int64_t channel, int64_t inner,
+                                                       const T* dy, const T* x,
+                                                       const T* dy_scale, const T* x_scale,
+                                                       const T* shift, T* dx) {
+  AffineBlocks<T>(block_begin, block_end, channel, inner, dy, dy_scale, x, x_scale, shift,
+                  nullptr, dx);
+}
+
+template<typename T>
+void NormalizationCpuKernelUtil<T>::AddRelu(int64_t word_begin, int64_t word_end,
+                                            int64_t elem_cnt, const T* x, const T* addend, T* y,
+                                            int32_t* mask) {
+  FOR_RANGE(int64_t, word, word_begin, word_end) {
+    const int64_t begin = word * kMaskBits;
+    const int64_t end = std::min(elem_cnt, begin + kMaskBits);
+    uint32_t bits = 0;
+    FOR_RANGE(int64_t, i, begin, end) {
+      const T v = addend != nullptr ? x[i] + addend[i] : x[i];
+      const bool is_positive = v > 0;
+      bits |= static_cast<uint32_t>(is_positive) << (i - begin);
+      y[i] = is_positive ? v : 0;
+    }
+    mask[word] = static_cast<int32_t>(bits);
+  }
+}
+
+template<typename T>
+void NormalizationCpuKernelUtil<T>::ReluBackward(int64_t word_begin, int64_t word_end,
+                                                 int64_t elem_cnt, const int32_t* mask,
+                                                 const T* dy, T* dx) {
+  FOR_RANGE(int64_t, word, word_begin, word_end) {
+    const int64_t begin = word * kMaskBits;
+    const int64_t end = std::min(elem_cnt, begin + kMaskBits);
+    const uint32_t bits = static_cast<uint32_t>(mask[word]);
+    FOR_RANGE(int64_t, i, begin, end) { dx[i] = ((bits >> (i - begin)) & 1) ? dy[i] : 0; }
+  }
+}
+
+template struct NormalizationCpuKernelUtil<float>;
+template struct NormalizationCpuKernelUtil<double>;
+
+}  // namespace oneflow
@@ -0,0 +1,55 @@
+/*
+Copyright 2020 The OneFlow Authors. All rights reserved.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+*/
+#ifndef ONEFLOW_USER_KERNELS_NORMALIZATION_CPU_KERNEL_UTIL_H_
+#define ONEFLOW_USER_KERNELS_NORMALIZATION_CPU_KERNEL_UTIL_H_
+
+#include "oneflow/core/common/util.h"
+
+namespace oneflow {
+
+// x is viewed as [outer, channel, inner]. Reductions handle channels [channel_begin, channel_end)
+// over all of x. Elementwise functions handle blocks [block_begin, block_end), a block is a row
+// of all channels when inner is 1 (channel last), otherwise the inner elements of one channel.
+template<typename T>
+struct NormalizationCpuKernelUtil {
+  static int64_t NumBlocks(int64_t outer, int64_t channel, int64_t inner) {
+    return inner == 1 ? outer : outer * channel;
+  }
+  // biased variance, the sums are shifted by the first element of each channel
+  static void ComputeStatistics(int64_t channel_begin, int64_t channel_end, int64_t outer,
+                                int64_t channel, int64_t inner, const T* x, T* mean, T* variance);
+  // y = x * scale + shift (+ addend), addend may be nullptr and may be y
+  static void ScaleShift(int64_t block_begin, int64_t block_end, int64_t channel, int64_t inner,
+                         const T* x, const T* scale, const T* shift, const T* addend, T* y);
+  // sum_dy = sum(dy), sum_dy_x_diff = sum(dy * (x - mean))
+  static void ComputeGradSums(int64_t channel_begin, int64_t channel_end, int64_t outer,
+                              int64_t channel, int64_t inner, const T* dy, const T* x,
+                              const T* mean, T* sum_dy, T* sum_dy_x_diff);
+  // dx = dy * dy_scale + x * x_scale + shift
+  static void BackwardScaleShift(int64_t block_begin, int64_t block_end, int64_t channel,
+                                 int64_t inner, const T* dy, const T* x, const T* dy_scale,
+                                 const T* x_scale, const T* shift, T* dx);
+  // the relu of normalization_add_relu on words [word_begin, word_end) of the mask, bit i % 32 of
+  // word i / 32 tells whether y[i] is positive, the same layout as the gpu kernel
+  static void AddRelu(int64_t word_begin, int64_t word_end, int64_t elem_cnt, const T* x,
+                      const T* addend, T* y, int32_t* mask);
+  static void ReluBackward(int64_t word_begin, int64_t word_end, int64_t elem_cnt,
+                           const int32_t* mask, const T* dy, T* dx);
+};
+
+}  // namespace oneflow
+
+#endif  // ONEFLOW_USER_KERNELS_NORMALIZATION_CPU_KERNEL_UTIL_H_
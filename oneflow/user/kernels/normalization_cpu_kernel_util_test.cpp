@@ -0,0 +1,160 @@
+/*
+Copyright 2020 The OneFlow Authors. All rights reserved.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+*/
+#include "oneflow/core/common/cpu_test_util.h"
+#include "oneflow/user/kernels/normalization_cpu_kernel_util.h"
+
+namespace oneflow {
+
+namespace {
+
+using test::ExpectNear;
+using test::RandomData;
+using test::RandomDataFarFromZero;
+using test::TwoParts;
+
+template<typename T>
+void TestForwardBackward(int64_t outer, int64_t channel, int64_t inner, double tolerance) {
+  using Util = NormalizationCpuKernelUtil<T>;
+  const int64_t elem_cnt = outer * channel * inner;
+  const int64_t count = outer * inner;
+  const std::vector<T> x = RandomDataFarFromZero<T>(elem_cnt);
+  const std::vector<T> dy = RandomData<T>(elem_cnt, -1, 1);
+  const std::vector<T> gamma = RandomData<T>(channel, 0.5, 1.5);
+  const std::vector<T> beta = RandomData<T>(channel, -1, 1);
+  const auto ChannelOf = [&](int64_t i) { return i / inner % channel; };
+
+  // two pass reference in double
+  std::vector<double> sum(channel, 0);
+  FOR_RANGE(int64_t, i, 0, elem_cnt) { sum[ChannelOf(i)] += x[i]; }
+  std::vector<double> square_diff_sum(channel, 0);
+  FOR_RANGE(int64_t, i, 0, elem_cnt) {
+    const double diff = x[i] - sum[ChannelOf(i)] / count;
+    square_diff_sum[ChannelOf(i)] += diff * diff;
+  }
+  std::vector<T> expected_mean(channel);
+  std::vector<T> expected_variance(channel);
+  FOR_RANGE(int64_t, c, 0, channel) {
+    expected_mean[c] = sum[c] / count;
+    expected_variance[c] = square_diff_sum[c] / count;
+  }
+  std::vector<T> mean(channel);
+  std::vector<T> variance(channel);
+  TwoParts(channel, [&](int64_t begin, int64_t end) {
+    Util::ComputeStatistics(begin, end, outer, channel, inner, x.data(), mean.data(),
+                            variance.data());
+  });
+  ExpectNear(expected_mean, mean, tolerance);
+  ExpectNear(expected_variance, variance, tolerance);
+
+  const T epsilon = 1e-5;
+  std::vector<T> inv_variance(channel);
+  std::vector<T> scale(channel);
+  std::vector<T> shift(channel);
+  FOR_RANGE(int64_t, c, 0, channel) {
+    inv_variance[c] = 1 / std::sqrt(variance[c] + epsilon);
+    scale[c] = gamma[c] * inv_variance[c];
+    shift[c] = beta[c] - mean[c] * scale[c];
+  }
+  const std::vector<T> addend = RandomData<T>(elem_cnt, -1, 1);
+  std::vector<T> expected_y(elem_cnt);
+  FOR_RANGE(int64_t, i, 0, elem_cnt) {
+    const int64_t c = ChannelOf(i);
+    expected_y[i] = (x[i] - mean[c]) * inv_variance[c] * gamma[c] + beta[c] + addend[i];
+  }
+  // addend in place, as with _add_to_output
+  std::vector<T> y = addend;
+  const int64_t num_blocks = Util::NumBlocks(outer, channel, inner);
+  TwoParts(num_blocks, [&](int64_t begin, int64_t end) {
+    Util::ScaleShift(begin, end, channel, inner, x.data(), scale.data(), shift.data(), y.data(),
+                     y.data());
+  });
+  ExpectNear(expected_y, y, tolerance);
+
+  std::vector<double> sum_dy(channel, 0);
+  std::vector<double> sum_dy_normalized(channel, 0);
+  FOR_RANGE(int64_t, i, 0, elem_cnt) {
+    const int64_t c = ChannelOf(i);
+    sum_dy[c] += dy[i];
+    sum_dy_normalized[c] += dy[i] * (x[i] - mean[c]) * inv_variance[c];
+  }
+  std::vector<T> expected_dx(elem_cnt);
+  FOR_RANGE(int64_t, i, 0, elem_cnt) {
+    const int64_t c = ChannelOf(i);
+    const double normalized = (x[i] - mean[c]) * inv_variance[c];
+    expected_dx[i] = gamma[c] * inv_variance[c]
+                     * (dy[i] - sum_dy[c] / count - normalized * sum_dy_normalized[c] / count);
+  }
+  std::vector<T> grad_sum_dy(channel);
+  std::vector<T> grad_sum_dy_x_diff(channel);
+  TwoParts(channel, [&](int64_t begin, int64_t end) {
+    Util::ComputeGradSums(begin, end, outer, channel, inner, dy.data(), x.data(), mean.data(),
+                          grad_sum_dy.data(), grad_sum_dy_x_diff.data());
+  });
+  std::vector<T> dy_scale(channel);
+  std::vector<T> x_scale(channel);
+  std::vector<T> dx_shift(channel);
+  FOR_RANGE(int64_t, c, 0, channel) {
+    ASSERT_NEAR(grad_sum_dy[c], sum_dy[c], tolerance * count);
+    ASSERT_NEAR(grad_sum_dy_x_diff[c] * inv_variance[c], sum_dy_normalized[c], tolerance * count);
+    dy_scale[c] = gamma[c] * inv_variance[c];
+    x_scale[c] = -dy_scale[c] * inv_variance[c] * inv_variance[c] * grad_sum_dy_x_diff[c] / count;
+    dx_shift[c] = -dy_scale[c] * grad_sum_dy[c] / count - x_scale[c] * mean[c];
+  }
+  std::vector<T> dx(elem_cnt);
+  TwoParts(num_blocks, [&](int64_t begin, int64_t end) {
+    Util::BackwardScaleShift(begin, end, channel, inner, dy.data(), x.data(), dy_scale.data(),
+                             x_scale.data(), dx_shift.data(), dx.data());
+  });
+  ExpectNear(expected_dx, dx, tolerance * 10);
+}
+
+}  // namespace
+
+TEST(NormalizationCpuKernelUtil, forward_backward) {
+  // channel last, and channel first with and without a tail after the last vector
+  for (const int64_t inner : {1, 7, 64, 67}) {
+    for (const int64_t channel : {1, 5, 32, 37}) {
+      TestForwardBackward<float>(6, channel, inner, 1e-3);
+      TestForwardBackward<double>(6, channel, inner, 1e-9);
+    }
+  }
+}
+
+TEST(NormalizationCpuKernelUtil, add_relu) {
+  const int64_t elem_cnt = 100;
+  const std::vector<float> x = RandomData<float>(elem_cnt, -1, 1);
+  const std::vector<float> addend = RandomData<float>(elem_cnt, -1, 1);
+  const std::vector<float> dy = RandomData<float>(elem_cnt, -1, 1);
+  const int64_t num_words = RoundUp(elem_cnt, 32) / 32;
+  std::vector<float> y = x;
+  std::vector<int32_t> mask(num_words);
+  TwoParts(num_words, [&](int64_t begin, int64_t end) {
+    NormalizationCpuKernelUtil<float>::AddRelu(begin, end, elem_cnt, y.data(), addend.data(),
+                                               y.data(), mask.data());
+  });
+  std::vector<float> dx(elem_cnt);
+  TwoParts(num_words, [&](int64_t begin, int64_t end) {
+    NormalizationCpuKernelUtil<float>::ReluBackward(begin, end, elem_cnt, mask.data(), dy.data(),
+                                                    dx.data());
+  });
+  FOR_RANGE(int64_t, i, 0, elem_cnt) {
+    const float sum = x[i] + addend[i];
+    ASSERT_EQ(y[i], sum > 0 ? sum : 0);
+    ASSERT_EQ(dx[i], sum > 0 ? dy[i] : 0);
+  }
+}
+
+}  // namespace oneflow
@@ -19,6 +19,7 @@ limitations under the License.
 #include "oneflow/core/common/tensor_buffer.h"
 #include "oneflow/core/kernel/new_kernel_util.h"
 #include "oneflow/core/kernel/kernel_util.h"
+#include "oneflow/core/record/ofrecord_view.h"
 #include "oneflow/core/thread/thread_manager.h"
 #include "oneflow/user/image/random_crop_generator.h"
 #include "oneflow/user/image/image_util.h"
@@ -32,6 +33,36 @@ namespace oneflow {
 
 namespace {
 
+// A record is an OFRecord, or the serialized OFRecord in a TensorBuffer when the reader decodes
+// lazily. Only the requested feature is read from serialized records, in place.
+const Feature& GetFeature(const OFRecord& record, const std::string& name) {
+  auto it = record.feature().find(name);
+  CHECK(it != record.feature().end()) << "Field " << name << " not found";
+  return it->second;
+}
+
+OFRecordFeatureView GetFeature(const TensorBuffer& record, const std::string& name) {
+  OFRecordFeatureView feature;
+  CHECK(OFRecordView(record.data<char>(), record.nbytes()).Find(name, &feature))
+      << "Field " << name << " not found";
+  return feature;
+}
+
+// the only value of a bytes_list
+void GetOnlyBytes(const Feature& feature, const char** data, size_t* size) {
+  CHECK(feature.has_bytes_list());
+  CHECK_EQ(feature.bytes_list().value_size(), 1);
+  const std::string& value0 = feature.bytes_list().value(0);
+  *data = value0.data();
+  *size = value0.size();
+}
+
+void GetOnlyBytes(const OFRecordFeatureView& feature, const char** data, size_t* size) {
+  CHECK(feature.has_bytes_list());
+  CHECK_EQ(feature.value_size(), 1);
+  feature.bytes_value(0, data, size);
+}
+
 template<typename T>
 void DecodeOneRawOFRecord(const Feature& feature, T* dptr, int64_t sample_elem_cnt,
                           bool dim1_varying_length, bool auto_zero_padding) {
@@ -68,9 +99,35 @@ void DecodeOneRawOFRecord(const Feature& feature, T* dptr, int64_t sample_elem_c
   }
 }
 
+template<typename T>
+void DecodeOneRawOFRecord(const OFRecordFeatureView& feature, T* dptr, int64_t sample_elem_cnt,
+                          bool dim1_varying_length, bool auto_zero_padding) {
+  if (feature.has_bytes_list()) {
+    const char* value0;
+    size_t value0_size;
+    GetOnlyBytes(feature, &value0, &value0_size);
+    sample_elem_cnt = std::min<int64_t>(sample_elem_cnt, value0_size);
+    CopyElem<int8_t, T>(reinterpret_cast<const int8_t*>(value0), dptr, sample_elem_cnt);
+    return;
+  }
+  if (feature.kind_case() == Feature::KIND_NOT_SET) { UNIMPLEMENTED(); }
+  const int64_t value_size = feature.value_size();
+  const int64_t padding_elem_num = auto_zero_padding ? sample_elem_cnt - value_size : 0;
+  if (dim1_varying_length || auto_zero_padding) {
+    CHECK_LE(value_size, sample_elem_cnt);
+    sample_elem_cnt = value_size;
+  } else {
+    CHECK_EQ(sample_elem_cnt, value_size);
+  }
+  feature.CopyValuesTo<T>(dptr, sample_elem_cnt);
+  if (padding_elem_num > 0) {
+    std::memset(dptr + sample_elem_cnt, 0, padding_elem_num * sizeof(T));
+  }
+}
+
 }  // namespace
 
-template<typename T>
+template<typename T, typename RecordType>
 class OFRecordRawDecoderKernel final : public user_op::OpKernel {
  public:
   OFRecordRawDecoderKernel() = default;
@@ -84,7 +141,7 @@ class OFRecordRawDecoderKernel final : public user_op::OpKernel {
     int64_t record_num = in_blob->shape().At(0);
     int64_t sample_elem_cnt = out_blob->shape().Count(1);
     CHECK(record_num > 0);
-    const OFRecord* records = in_blob->dptr<OFRecord>();
+    const RecordType* records = in_blob->dptr<RecordType>();
     T* out_dptr = out_blob->mut_dptr<T>();
     const std::string& name = ctx->Attr<std::string>("name");
 
@@ -92,24 +149,25 @@ class OFRecordRawDecoderKernel final : public user_op::OpKernel {
     bool dim1_varying_length = ctx->Attr<bool>("dim1_varying_length");
 
     MultiThreadLoop(record_num, [&](size_t i) {
-      const OFRecord& record = *(records + i);
       T* dptr = out_dptr + i * sample_elem_cnt;
-      CHECK(record.feature().find(name) != record.feature().end())
-          << "Field " << name << " not found";
-      const Feature& feature = record.feature().at(name);
-      DecodeOneRawOFRecord(feature, dptr, sample_elem_cnt, auto_zero_padding, dim1_varying_length);
+      const auto& feature = GetFeature(records[i], name);
+      DecodeOneRawOFRecord(feature, dptr, sample_elem_cnt, dim1_varying_length, auto_zero_padding);
     });
   }
   bool AlwaysComputeWhenAllOutputsEmpty() const override { return false; }
 };
 
-#define REGISTER_RAW_DECODER_KERNEL(dtype)                                      \
-  REGISTER_USER_KERNEL("ofrecord_raw_decoder")                                  \
-      .SetCreateFn<OFRecordRawDecoderKernel<dtype>>()                           \
-      .SetIsMatchedHob((user_op::HobDeviceTag() == "cpu")                       \
-                       & (user_op::HobDataType("in", 0) == DataType::kOFRecord) \
+#define REGISTER_RAW_DECODER_KERNEL_WITH_RECORD_TYPE(dtype, record_type, record_data_type) \
+  REGISTER_USER_KERNEL("ofrecord_raw_decoder")                                             \
+      .SetCreateFn<OFRecordRawDecoderKernel<dtype, record_type>>()                         \
+      .SetIsMatchedHob((user_op::HobDeviceTag() == "cpu")                                  \
+                       & (user_op::HobDataType("in", 0) == record_data_type)               \
                        & (user_op::HobDataType("out", 0) == GetDataType<dtype>::value));
 
+#define REGISTER_RAW_DECODER_KERNEL(dtype)                                           \
+  REGISTER_RAW_DECODER_KERNEL_WITH_RECORD_TYPE(dtype, OFRecord, DataType::kOFRecord) \
+  REGISTER_RAW_DECODER_KERNEL_WITH_RECORD_TYPE(dtype, TensorBuffer, DataType::kTensorBuffer)
+
 REGISTER_RAW_DECODER_KERNEL(char)
 REGISTER_RAW_DECODER_KERNEL(float)
 REGISTER_RAW_DECODER_KERNEL(double)
@@ -118,6 +176,7 @@ REGISTER_RAW_DECODER_KERNEL(int32_t)
 REGISTER_RAW_DECODER_KERNEL(int64_t)
 REGISTER_RAW_DECODER_KERNEL(uint8_t)
 
+template<typename RecordType>
 class OFRecordBytesDecoderKernel final : public user_op::OpKernel {
  public:
   OFRecordBytesDecoderKernel() = default;
@@ -128,49 +187,49 @@ class OFRecordBytesDecoderKernel final : public user_op::OpKernel {
     const user_op::Tensor* in = ctx->Tensor4ArgNameAndIndex("in", 0);
     user_op::Tensor* out = ctx->Tensor4ArgNameAndIndex("out", 0);
     CHECK_EQ(out->shape(), in->shape());
-    CHECK_EQ(in->data_type(), DataType::kOFRecord);
     CHECK_EQ(out->data_type(), DataType::kTensorBuffer);
     const int64_t num_instances = in->shape().elem_cnt();
-    const auto* records = in->dptr<OFRecord>();
+    const auto* records = in->dptr<RecordType>();
     auto* buffers = out->mut_dptr<TensorBuffer>();
     const std::string& name = ctx->Attr<std::string>("name");
     MultiThreadLoop(num_instances, [&](size_t i) {
-      const OFRecord& record = *(records + i);
       TensorBuffer* buffer = buffers + i;
-      auto it = record.feature().find(name);
-      CHECK(it != record.feature().end()) << "Field " << name << " not found";
-      const Feature& feature = it->second;
-      CHECK(feature.has_bytes_list());
-      CHECK_EQ(feature.bytes_list().value_size(), 1);
-      const int64_t size = feature.bytes_list().value(0).size();
-      buffer->Resize(Shape({size}), DataType::kUInt8);
-      memcpy(buffer->mut_data(), feature.bytes_list().value(0).data(), size);
+      const char* value0;
+      size_t size;
+      GetOnlyBytes(GetFeature(records[i], name), &value0, &size);
+      buffer->Resize(Shape({static_cast<int64_t>(size)}), DataType::kUInt8);
+      memcpy(buffer->mut_data(), value0, size);
     });
   }
   bool AlwaysComputeWhenAllOutputsEmpty() const override { return false; }
 };
 
 REGISTER_USER_KERNEL("ofrecord_bytes_decoder")
-    .SetCreateFn<OFRecordBytesDecoderKernel>()
+    .SetCreateFn<OFRecordBytesDecoderKernel<OFRecord>>()
     .SetIsMatchedHob((user_op::HobDeviceTag() == "cpu")
                      & (user_op::HobDataType("in", 0) == DataType::kOFRecord)
                      & (user_op::HobDataType("out", 0) == DataType::kTensorBuffer));
 
+REGISTER_USER_KERNEL("ofrecord_bytes_decoder")
+    .SetCreateFn<OFRecordBytesDecoderKernel<TensorBuffer>>()
+    .SetIsMatchedHob((user_op::HobDeviceTag() == "cpu")
+                     & (user_op::HobDataType("in", 0) == DataType::kTensorBuffer)
+                     & (user_op::HobDataType("out", 0) == DataType::kTensorBuffer));
+
 namespace {
 
-void DecodeRandomCropImageFromOneRecord(const OFRecord& record, TensorBuffer* buffer,
+template<typename RecordType>
+void DecodeRandomCropImageFromOneRecord(const RecordType& record, TensorBuffer* buffer,
                                         const std::string& name, const std::string& color_space,
                                         RandomCropGenerator* random_crop_gen) {
-  CHECK(record.feature().find(name) != record.feature().end()) << "Field " << name << " not found";
-  const Feature& feature = record.feature().at(name);
-  CHECK(feature.has_bytes_list());
-  CHECK(feature.bytes_list().value_size() == 1);
-  const std::string& src_data = feature.bytes_list().value(0);
+  const char* src_data;
+  size_t src_size;
+  GetOnlyBytes(GetFeature(record, name), &src_data, &src_size);
 
-  // cv::_InputArray image_data(src_data.data(), src_data.size());
+  // cv::_InputArray image_data(src_data, src_size);
   // cv::Mat image = cv::imdecode(image_data, cv::IMREAD_ANYCOLOR);
   cv::Mat image =
-      cv::imdecode(cv::Mat(1, src_data.size(), CV_8UC1, (void*)(src_data.data())),  // NOLINT
+      cv::imdecode(cv::Mat(1, src_size, CV_8UC1, (void*)(src_data)),  // NOLINT
                    ImageUtil::IsColor(color_space) ? cv::IMREAD_COLOR : cv::IMREAD_GRAYSCALE);
   int W = image.cols;
   int H = image.rows;
@@ -213,6 +272,7 @@ void DecodeRandomCropImageFromOneRecord(const OFRecord& record, TensorBuffer* bu
 
 }  // namespace
 
+template<typename RecordType>
 class OFRecordImageDecoderRandomCropKernel final : public user_op::OpKernel {
  public:
   OFRecordImageDecoderRandomCropKernel() = default;
@@ -232,13 +292,13 @@ class OFRecordImageDecoderRandomCropKernel final : public user_op::OpKernel {
     CHECK(record_num > 0);
     user_op::Tensor* in_blob = ctx->Tensor4ArgNameAndIndex("in", 0);
     CHECK_EQ(out_blob->shape(), in_blob->shape());
-    const OFRecord* records = in_blob->dptr<OFRecord>();
+    const RecordType* records = in_blob->dptr<RecordType>();
     TensorBuffer* buffers = out_blob->mut_dptr<TensorBuffer>();
     const std::string& name = ctx->Attr<std::string>("name");
     const std::string& color_space = ctx->Attr<std::string>("color_space");
 
     MultiThreadLoop(record_num, [&](size_t i) {
-      const OFRecord& record = *(records + i);
+      const RecordType& record = *(records + i);
       TensorBuffer* buffer = buffers + i;
       RandomCropGenerator* gen = crop_window_generators->GetGenerator(i);
       DecodeRandomCropImageFromOneRecord(record, buffer, name, color_space, gen);
@@ -248,11 +308,18 @@ class OFRecordImageDecoderRandomCropKernel final : public user_op::OpKernel {
 };
 
 REGISTER_USER_KERNEL("ofrecord_image_decoder_random_crop")
-    .SetCreateFn<OFRecordImageDecoderRandomCropKernel>()
+    .SetCreateFn<OFRecordImageDecoderRandomCropKernel<OFRecord>>()
     .SetIsMatchedHob((user_op::HobDeviceTag() == "cpu")
                      & (user_op::HobDataType("in", 0) == DataType::kOFRecord)
                      & (user_op::HobDataType("out", 0) == DataType::kTensorBuffer));
 
+REGISTER_USER_KERNEL("ofrecord_image_decoder_random_crop")
+    .SetCreateFn<OFRecordImageDecoderRandomCropKernel<TensorBuffer>>()
+    .SetIsMatchedHob((user_op::HobDeviceTag() == "cpu")
+                     & (user_op::HobDataType("in", 0) == DataType::kTensorBuffer)
+                     & (user_op::HobDataType("out", 0) == DataType::kTensorBuffer));
+
+template<typename RecordType>
 class OFRecordImageDecoderKernel final : public user_op::OpKernel {
  public:
   OFRecordImageDecoderKernel() = default;
@@ -265,13 +332,13 @@ class OFRecordImageDecoderKernel final : public user_op::OpKernel {
     CHECK(record_num > 0);
     user_op::Tensor* in_blob = ctx->Tensor4ArgNameAndIndex("in", 0);
     CHECK_EQ(out_blob->shape(), in_blob->shape());
-    const OFRecord* records = in_blob->dptr<OFRecord>();
+    const RecordType* records = in_blob->dptr<RecordType>();
     TensorBuffer* buffers = out_blob->mut_dptr<TensorBuffer>();
     const std::string& name = ctx->Attr<std::string>("name");
     const std::string& color_space = ctx->Attr<std::string>("color_space");
 
     MultiThreadLoop(record_num, [&](size_t i) {
-      const OFRecord& record = *(records + i);
+      const RecordType& record = *(records + i);
       TensorBuffer* buffer = buffers + i;
       DecodeRandomCropImageFromOneRecord(record, buffer, name, color_space, nullptr);
     });
@@ -280,9 +347,15 @@ class OFRecordImageDecoderKernel final : public user_op::OpKernel {
 };
 
 REGISTER_USER_KERNEL("ofrecord_image_decoder")
-    .SetCreateFn<OFRecordImageDecoderKernel>()
+    .SetCreateFn<OFRecordImageDecoderKernel<OFRecord>>()
     .SetIsMatchedHob((user_op::HobDeviceTag() == "cpu")
                      & (user_op::HobDataType("in", 0) == DataType::kOFRecord)
                      & (user_op::HobDataType("out", 0) == DataType::kTensorBuffer));
 
+REGISTER_USER_KERNEL("ofrecord_image_decoder")
+    .SetCreateFn<OFRecordImageDecoderKernel<TensorBuffer>>()
+    .SetIsMatchedHob((user_op::HobDeviceTag() == "cpu")
+                     & (user_op::HobDataType("in", 0) == DataType::kTensorBuffer)
+                     & (user_op::HobDataType("out", 0) == DataType::kTensorBuffer));
+
 }  // namespace oneflow
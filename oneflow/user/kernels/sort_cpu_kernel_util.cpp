@@ -0,0 +1,195 @@
+/*
+Copyright 2020 The OneFlow Authors. All rights reserved.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+*/
+#include <array>
+#include "oneflow/user/kernels/sort_cpu_kernel_util.h"
+#include "oneflow/core/common/cpu_simd.h"
+#include "oneflow/core/common/data_type.h"
+
+namespace oneflow {
+
+namespace {
+
+// the heap is used for k up to 1 / kHeapMaxRatio of the elements, for which few elements beat
+// its worst one when the order is random
+constexpr int64_t kHeapMaxRatio = 256;
+
+// An unsigned key of each value in the order of the values, with -0.0 as 0.0 and nan beyond the
+// infinity of its sign.
+template<typename T, typename Enable = void>
+struct RadixKey;
+
+template<typename T>
+struct RadixKey<T, typename std::enable_if<std::is_integral<T>::value>::type> {
+  using Key = typename std::make_unsigned<T>::type;
+  static Key Of(T x) { return static_cast<Key>(x) ^ (Key(1) << (sizeof(T) * 8 - 1)); }
+};
+
+template<typename T>
+struct RadixKey<T, typename std::enable_if<std::is_floating_point<T>::value>::type> {
+  using Key = typename std::conditional<sizeof(T) == 4, uint32_t, uint64_t>::type;
+  static Key Of(T x) {
+    if (x == 0) { x = 0; }
+    Key bits;
+    std::memcpy(&bits, &x, sizeof(T));
+    // all bits flipped for negative values and the sign bit for the others, without a branch
+    const int32_t sign_shift = sizeof(T) * 8 - 1;
+    return bits ^ ((Key(0) - (bits >> sign_shift)) | (Key(1) << sign_shift));
+  }
+};
+
+// the order of top_k, larger first and of equal ones the smaller index
+template<typename T>
+struct Better {
+  const T* in;
+  bool operator()(int32_t lhs, int32_t rhs) const {
+    const T l = in[lhs];
+    const T r = in[rhs];
+    if (l == r) {
+      return lhs < rhs;
+    } else {
+      return l > r;
+    }
+  }
+};
+
+template<typename T>
+void HeapTopK(const T* in, int64_t begin, int64_t end, int64_t k, int32_t* out) {
+  using V = simd::SimdVec<T>;
+  const Better<T> better{in};
+  // the best k so far in a heap with the worst on top
+  std::iota(out, out + k, static_cast<int32_t>(begin));
+  std::make_heap(out, out + k, better);
+  T worst = in[out[0]];
+  int64_t i = begin + k;
+  // later elements equal to the worst lose to it
+  for (; i + 2 * V::kWidth <= end; i += 2 * V::kWidth) {
+    if (V::ReduceMax(V::Max(V::Load(in + i), V::Load(in + i + V::kWidth))) <= worst) { continue; }
+    FOR_RANGE(int64_t, j, i, i + 2 * V::kWidth) {
+      if (in[j] > worst) {
+        std::pop_heap(out, out + k, better);
+        out[k - 1] = static_cast<int32_t>(j);
+        std::push_heap(out, out + k, better);
+        worst = in[out[0]];
+      }
+    }
+  }
+  for (; i < end; ++i) {
+    if (in[i] > worst) {
+      std::pop_heap(out, out + k, better);
+      out[k - 1] = static_cast<int32_t>(i);
+      std::push_heap(out, out + k, better);
+      worst = in[out[0]];
+    }
+  }
+}
+
+bool IsHeapTopK(int64_t size, int64_t k) { return k * kHeapMaxRatio <= size || k == 1; }
+
+// candidates has room for end - begin + 1 indices
+template<typename T>
+void RadixSelectTopK(const T* in, int64_t begin, int64_t end, int64_t k, int32_t* candidates,
+                     int32_t* out) {
+  using Key = typename RadixKey<T>::Key;
+  // how many of the elements with the digits of the k-th largest so far belong to the top k
+  int64_t remaining = k;
+  std::array<int64_t, 256> histogram;
+  // the digit of the k-th largest among the elements counted in histogram
+  const auto SelectDigit = [&]() {
+    Key digit = 255;
+    while (histogram[digit] < remaining) {
+      remaining -= histogram[digit];
+      digit -= 1;
+    }
+    return digit;
+  };
+  int32_t shift = sizeof(Key) * 8 - 8;
+  histogram.fill(0);
+  FOR_RANGE(int64_t, i, begin, end) { histogram[RadixKey<T>::Of(in[i]) >> shift] += 1; }
+  Key digit = SelectDigit();
+  // elements with a larger digit belong to the top k, the ones with the same digit are the
+  // candidates for the rest, in the order of their indices. Both are written without branches.
+  int64_t num_candidates = 0;
+  int64_t count = 0;
+  FOR_RANGE(int64_t, i, begin, end) {
+    const Key key_digit = RadixKey<T>::Of(in[i]) >> shift;
+    out[count] = static_cast<int32_t>(i);
+    count += key_digit > digit;
+    candidates[num_candidates] = static_cast<int32_t>(i);
+    num_candidates += key_digit == digit;
+  }
+  while (num_candidates > remaining && shift > 0) {
+    shift -= 8;
+    histogram.fill(0);
+    FOR_RANGE(int64_t, j, 0, num_candidates) {
+      histogram[(RadixKey<T>::Of(in[candidates[j]]) >> shift) & 0xff] += 1;
+    }
+    digit = SelectDigit();
+    int64_t num_kept = 0;
+    FOR_RANGE(int64_t, j, 0, num_candidates) {
+      const int32_t i = candidates[j];
+      const Key key_digit = (RadixKey<T>::Of(in[i]) >> shift) & 0xff;
+      out[count] = i;
+      count += key_digit > digit;
+      candidates[num_kept] = i;
+      num_kept += key_digit == digit;
+    }
+    num_candidates = num_kept;
+  }
+  // all the candidates are in the top k, or they are equal and the smaller indices are
+  std::copy(candidates, candidates + remaining, out + count);
+  CHECK_EQ(count + remaining, k);
+}
+
+}  // namespace
+
+template<typename T>
+int64_t TopKCpuKernelUtil<T>::BufferSize(int64_t size, int64_t k) {
+  k = std::min(k, size);
+  if (k <= 0 || IsHeapTopK(size, k)) { return 0; }
+  return size + 1;
+}
+
+template<typename T>
+void TopKCpuKernelUtil<T>::TopK(const T* in, int64_t begin, int64_t end, int64_t k, bool sorted,
+                                int32_t* buffer, int32_t* out) {
+  k = std::min(k, end - begin);
+  if (k <= 0) { return; }
+  if (IsHeapTopK(end - begin, k)) {
+    HeapTopK(in, begin, end, k, out);
+    if (sorted) { std::sort_heap(out, out + k, Better<T>{in}); }
+  } else {
+    RadixSelectTopK(in, begin, end, k, buffer, out);
+    if (sorted) { std::sort(out, out + k, Better<T>{in}); }
+  }
+}
+
+template<typename T>
+void TopKCpuKernelUtil<T>::TopKOfCandidates(const T* in, int32_t* candidates,
+                                            int64_t num_candidates, int64_t k, bool sorted,
+                                            int32_t* out) {
+  k = std::min(k, num_candidates);
+  const Better<T> better{in};
+  std::nth_element(candidates, candidates + k, candidates + num_candidates, better);
+  if (sorted) { std::sort(candidates, candidates + k, better); }
+  std::copy(candidates, candidates + k, out);
+}
+
+#define INSTANTIATE_TOP_K_CPU_KERNEL_UTIL(type_cpp, type_proto) \
+  template struct TopKCpuKernelUtil<type_cpp>;
+OF_PP_FOR_EACH_TUPLE(INSTANTIATE_TOP_K_CPU_KERNEL_UTIL, ARITHMETIC_DATA_TYPE_SEQ);
+#undef INSTANTIATE_TOP_K_CPU_KERNEL_UTIL
+
+}  // namespace oneflow
@@ -0,0 +1,110 @@
+/*
+Copyright 2020 The OneFlow Authors. All rights reserved.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+*/
+#ifndef ONEFLOW_USER_KERNELS_SORT_CPU_KERNEL_UTIL_H_
+#define ONEFLOW_USER_KERNELS_SORT_CPU_KERNEL_UTIL_H_
+
+#include "oneflow/core/common/util.h"
+#include "oneflow/core/thread/thread_manager.h"
+
+namespace oneflow {
+
+// instances of at least this size are sorted, or searched for their top k, by several threads
+// each, smaller ones one per thread
+constexpr int64_t kCpuSortParallelMinSize = 65536;
+
+// The top_k of in[begin, end) of one instance: the indices of the k largest elements, of equal
+// elements the smaller index first, in that order when sorted. Small k keep a heap of the best k
+// so far and skip the vectors of elements not beating its worst, larger k find the k-th largest by
+// a radix select. out has room for min(k, end - begin) indices, buffer for BufferSize(end - begin,
+// k) ones.
+template<typename T>
+struct TopKCpuKernelUtil {
+  static int64_t BufferSize(int64_t size, int64_t k);
+  static void TopK(const T* in, int64_t begin, int64_t end, int64_t k, bool sorted,
+                   int32_t* buffer, int32_t* out);
+  // the top_k of the elements at the num_candidates indices, which are reordered, such as the top
+  // k of each part of a large instance
+  static void TopKOfCandidates(const T* in, int32_t* candidates, int64_t num_candidates, int64_t k,
+                               bool sorted, int32_t* out);
+};
+
+// A round of a merge sort with runs of run_size: dst[begin, end) is that part of merging
+// each two adjacent runs of src[0, n). The part of each run it reads is found by a binary search,
+// so that any split of [0, n) merges in parallel.
+template<typename T, typename Comp>
+void MergeSortedRuns(const T* src, int64_t n, int64_t run_size, int64_t begin, int64_t end,
+                     const Comp& comp, T* dst) {
+  // the number of elements of a among the first pos of merging a and b, a first of equal ones
+  const auto CoRank = [&](const T* a, int64_t a_size, const T* b, int64_t b_size, int64_t pos) {
+    int64_t lo = std::max<int64_t>(0, pos - b_size);
+    int64_t hi = std::min(pos, a_size);
+    while (lo < hi) {
+      const int64_t mid = (lo + hi) / 2;
+      if (comp(b[pos - mid - 1], a[mid])) {
+        hi = mid;
+      } else {
+        lo = mid + 1;
+      }
+    }
+    return lo;
+  };
+  int64_t pos = begin;
+  while (pos < end) {
+    const int64_t pair_begin = pos / (2 * run_size) * (2 * run_size);
+    const int64_t mid = std::min(pair_begin + run_size, n);
+    const int64_t pair_end = std::min(pair_begin + 2 * run_size, n);
+    const int64_t stop = std::min(end, pair_end);
+    const T* a = src + pair_begin;
+    const T* b = src + mid;
+    const int64_t a_begin = CoRank(a, mid - pair_begin, b, pair_end - mid, pos - pair_begin);
+    const int64_t a_end = CoRank(a, mid - pair_begin, b, pair_end - mid, stop - pair_begin);
+    std::merge(a + a_begin, a + a_end, b + (pos - pair_begin - a_begin),
+               b + (stop - pair_begin - a_end), dst + pos, comp);
+    pos = stop;
+  }
+}
+
+// Sorts data[0, n) by comp on the compute thread pool: runs sorted by one thread each, then merged
+// in rounds each split over all threads. buffer has room for n elements. comp has to be a total
+// order for the result to be independent of the number of threads.
+template<typename T, typename Comp>
+void CpuParallelSort(T* data, int64_t n, const Comp& comp, T* buffer) {
+  // elements of a run, and that one thread merges at least
+  const int64_t kRunSize = 16384;
+  const int64_t run_num = (n + kRunSize - 1) / kRunSize;
+  ParallelFor(run_num, 1, [&](int64_t begin, int64_t end) {
+    FOR_RANGE(int64_t, i, begin, end) {
+      std::sort(data + i * kRunSize, data + std::min((i + 1) * kRunSize, n), comp);
+    }
+  });
+  T* src = data;
+  T* dst = buffer;
+  for (int64_t run_size = kRunSize; run_size < n; run_size *= 2) {
+    ParallelFor(n, kRunSize, [&](int64_t begin, int64_t end) {
+      MergeSortedRuns(src, n, run_size, begin, end, comp, dst);
+    });
+    std::swap(src, dst);
+  }
+  if (src != data) {
+    ParallelFor(n, kRunSize, [&](int64_t begin, int64_t end) {
+      std::copy(src + begin, src + end, data + begin);
+    });
+  }
+}
+
+}  // namespace oneflow
+
+#endif  // ONEFLOW_USER_KERNELS_SORT_CPU_KERNEL_UTIL_H_
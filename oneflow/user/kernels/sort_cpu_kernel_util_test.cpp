@@ -0,0 +1,146 @@
+/*
+Copyright 2020 The OneFlow Authors. All rights reserved.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+*/
+#include "oneflow/core/common/cpu_test_util.h"
+#include "oneflow/user/kernels/sort_cpu_kernel_util.h"
+
+namespace oneflow {
+
+namespace {
+
+using test::BenchmarkMs;
+using test::RandomIntData;
+
+// the top_k of the kernel before, nth_element and sort of all indices
+template<typename T>
+std::vector<int32_t> NaiveTopK(const std::vector<T>& in, int64_t k) {
+  std::vector<int32_t> indices(in.size());
+  std::iota(indices.begin(), indices.end(), 0);
+  std::sort(indices.begin(), indices.end(), [&](int32_t lhs, int32_t rhs) {
+    return in[lhs] == in[rhs] ? lhs < rhs : in[lhs] > in[rhs];
+  });
+  indices.resize(std::min<int64_t>(k, in.size()));
+  return indices;
+}
+
+// values from few distinct ones, so that there are many ties, or all different
+template<typename T>
+void TestTopK(int64_t size, int64_t distinct, int64_t k) {
+  const std::vector<T> in = RandomIntData<T>(size, -distinct / 2, distinct / 2);
+  const std::vector<int32_t> expected = NaiveTopK(in, k);
+  std::vector<int32_t> out(expected.size());
+  std::vector<int32_t> buffer(TopKCpuKernelUtil<T>::BufferSize(size, k));
+  TopKCpuKernelUtil<T>::TopK(in.data(), 0, size, k, true, buffer.data(), out.data());
+  ASSERT_EQ(out, expected) << "size " << size << " k " << k;
+  TopKCpuKernelUtil<T>::TopK(in.data(), 0, size, k, false, buffer.data(), out.data());
+  std::sort(out.begin(), out.end());
+  std::vector<int32_t> sorted_expected = expected;
+  std::sort(sorted_expected.begin(), sorted_expected.end());
+  ASSERT_EQ(out, sorted_expected) << "size " << size << " k " << k;
+  // in parts, as the kernel does for large instances
+  const int64_t part_size = std::max<int64_t>(k * 2, 100);
+  std::vector<int32_t> candidates;
+  std::vector<int32_t> part_buffer(TopKCpuKernelUtil<T>::BufferSize(part_size, k));
+  for (int64_t begin = 0; begin < size; begin += part_size) {
+    const int64_t end = std::min(begin + part_size, size);
+    std::vector<int32_t> part(std::min(k, end - begin));
+    TopKCpuKernelUtil<T>::TopK(in.data(), begin, end, k, false, part_buffer.data(), part.data());
+    candidates.insert(candidates.end(), part.begin(), part.end());
+  }
+  TopKCpuKernelUtil<T>::TopKOfCandidates(in.data(), candidates.data(), candidates.size(), k, true,
+                                         out.data());
+  ASSERT_EQ(out, expected) << "size " << size << " k " << k << " in parts";
+}
+
+}  // namespace
+
+TEST(TopKCpuKernelUtil, heap_and_radix_select) {
+  for (const int64_t size : {1, 7, 100, 1000, 4099}) {
+    for (const int64_t k : {1, 2, 10, 64, 5000}) {
+      for (const int64_t distinct : {3, 1000000}) {
+        TestTopK<float>(size, distinct, k);
+        TestTopK<double>(size, distinct, k);
+        TestTopK<int8_t>(size, std::min<int64_t>(distinct, 200), k);
+        TestTopK<int32_t>(size, distinct, k);
+        TestTopK<int64_t>(size, distinct, k);
+      }
+    }
+  }
+}
+
+TEST(TopKCpuKernelUtil, signed_zeros_and_infinities) {
+  const float inf = std::numeric_limits<float>::infinity();
+  const std::vector<float> in = {0.0f, -inf, -0.0f, 1.0f, inf, -0.0f, -1.0f, 0.0f, inf};
+  for (int64_t k = 1; k <= static_cast<int64_t>(in.size()); ++k) {
+    std::vector<int32_t> out(k);
+    std::vector<int32_t> buffer(TopKCpuKernelUtil<float>::BufferSize(in.size(), k));
+    TopKCpuKernelUtil<float>::TopK(in.data(), 0, in.size(), k, true, buffer.data(), out.data());
+    ASSERT_EQ(out, NaiveTopK(in, k)) << "k " << k;
+  }
+}
+
+TEST(MergeSortedRuns, any_split) {
+  const int64_t n = 1000;
+  std::vector<int32_t> data = RandomIntData<int32_t>(n, -25, 25);
+  std::vector<int32_t> expected = data;
+  std::sort(expected.begin(), expected.end());
+  std::vector<int32_t> buffer(n);
+  std::mt19937 gen(0);
+  int64_t run_size = 7;
+  for (int64_t begin = 0; begin < n; begin += run_size) {
+    std::sort(data.begin() + begin, data.begin() + std::min(begin + run_size, n));
+  }
+  for (; run_size < n; run_size *= 2) {
+    // random splits of [0, n)
+    int64_t begin = 0;
+    while (begin < n) {
+      const int64_t end = std::min<int64_t>(n, begin + 1 + gen() % 150);
+      MergeSortedRuns(data.data(), n, run_size, begin, end, std::less<int32_t>(), buffer.data());
+      begin = end;
+    }
+    std::swap(data, buffer);
+  }
+  ASSERT_EQ(data, expected);
+}
+
+// compares top 100 of 1M by the heap with nth_element over all indices, and times the radix
+// select, run with --gtest_also_run_disabled_tests
+TEST(TopKCpuKernelUtil, DISABLED_benchmark) {
+  const int64_t size = 1 << 20;
+  const int64_t k = 100;
+  const std::vector<float> in = RandomIntData<float>(size, -(1 << 29), 1 << 29);
+  std::vector<int32_t> indices(size);
+  std::vector<int32_t> out(k);
+  std::vector<int32_t> buffer(TopKCpuKernelUtil<float>::BufferSize(size, size / 8));
+  const double nth_element_ms = BenchmarkMs([&]() {
+    std::iota(indices.begin(), indices.end(), 0);
+    auto comp = [&](int32_t lhs, int32_t rhs) {
+      return in[lhs] == in[rhs] ? lhs < rhs : in[lhs] > in[rhs];
+    };
+    std::nth_element(indices.begin(), indices.begin() + k, indices.end(), comp);
+    std::sort(indices.begin(), indices.begin() + k, comp);
+  });
+  const double heap_ms = BenchmarkMs(
+      [&]() { TopKCpuKernelUtil<float>::TopK(in.data(), 0, size, k, true, nullptr, out.data()); });
+  const double radix_select_ms = BenchmarkMs([&]() {
+    TopKCpuKernelUtil<float>::TopK(in.data(), 0, size, size / 8, false, buffer.data(),
+                                   indices.data());
+  });
+  LOG(INFO) << "top " << k << " of " << size << ": nth_element " << nth_element_ms << "ms, heap "
+            << heap_ms << "ms, unsorted top " << size / 8 << " by radix select " << radix_select_ms
+            << "ms";
+}
+
+}  // namespace oneflow
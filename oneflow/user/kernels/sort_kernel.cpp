@@ -14,7 +14,7 @@ See the License for the specific language governing permissions and
 limitations under the License.
 */
 #include "oneflow/core/framework/framework.h"
-#include "oneflow/core/kernel/new_kernel_util.h"
+#include "oneflow/user/kernels/sort_cpu_kernel_util.h"
 
 namespace oneflow {
 
@@ -28,32 +28,51 @@ class CpuSortKernel final : public user_op::OpKernel {
   void Compute(user_op::KernelComputeContext* ctx) const override {
     const user_op::Tensor* in = ctx->Tensor4ArgNameAndIndex("in", 0);
     user_op::Tensor* out = ctx->Tensor4ArgNameAndIndex("out", 0);
+    user_op::Tensor* tmp_buffer = ctx->Tensor4ArgNameAndIndex("tmp_buffer", 0);
 
-    Memcpy<DeviceType::kCPU>(ctx->device_ctx(), out->mut_dptr<T>(), in->dptr<T>(),
-                             in->shape().elem_cnt() * sizeof(T));
-    const int32_t instance_size = in->shape().At(in->shape().NumAxes() - 1);
-    const int32_t instance_num = in->shape().elem_cnt() / instance_size;
+    const int64_t instance_size = in->shape().At(in->shape().NumAxes() - 1);
+    const int64_t instance_num = in->shape().elem_cnt() / instance_size;
     const std::string& direction = ctx->Attr<std::string>("direction");
     const bool is_ascending = direction == "ASCENDING";
     const bool is_descending = direction == "DESCENDING";
-    FOR_RANGE(int32_t, i, 0, instance_num) {
+    CHECK(is_ascending || is_descending);
+    const auto SortInstance = [&](int64_t i, bool parallel) {
+      const T* in_ptr_i = in->dptr<T>() + i * instance_size;
       T* out_ptr_i = out->mut_dptr<T>() + i * instance_size;
-      if (is_ascending) {
+      std::copy(in_ptr_i, in_ptr_i + instance_size, out_ptr_i);
+      T* buffer = parallel ? tmp_buffer->mut_dptr<T>() : nullptr;
+      if (is_ascending && parallel) {
+        CpuParallelSort(out_ptr_i, instance_size, std::less<T>(), buffer);
+      } else if (is_ascending) {
         std::sort(out_ptr_i, out_ptr_i + instance_size, std::less<T>());
-      } else if (is_descending) {
-        std::sort(out_ptr_i, out_ptr_i + instance_size, std::greater<T>());
+      } else if (parallel) {
+        CpuParallelSort(out_ptr_i, instance_size, std::greater<T>(), buffer);
       } else {
-        UNIMPLEMENTED();
+        std::sort(out_ptr_i, out_ptr_i + instance_size, std::greater<T>());
       }
+    };
+    if (instance_size < kCpuSortParallelMinSize) {
+      const int64_t grain_size = std::max<int64_t>(kCpuSortParallelMinSize / instance_size, 1);
+      ParallelFor(instance_num, grain_size, [&](int64_t begin, int64_t end) {
+        FOR_RANGE(int64_t, i, begin, end) { SortInstance(i, false); }
+      });
+    } else {
+      FOR_RANGE(int64_t, i, 0, instance_num) { SortInstance(i, true); }
     }
   }
   bool AlwaysComputeWhenAllOutputsEmpty() const override { return false; }
 };
 
-#define REGISTER_CPU_SORT_KERNEL(dtype)                                             \
-  REGISTER_USER_KERNEL("sort").SetCreateFn<CpuSortKernel<dtype>>().SetIsMatchedHob( \
-      (user_op::HobDeviceTag() == "cpu")                                            \
-      & (user_op::HobDataType("out", 0) == GetDataType<dtype>::value));
+#define REGISTER_CPU_SORT_KERNEL(dtype)                                                     \
+  REGISTER_USER_KERNEL("sort")                                                              \
+      .SetCreateFn<CpuSortKernel<dtype>>()                                                  \
+      .SetIsMatchedHob((user_op::HobDeviceTag() == "cpu")                                   \
+                       & (user_op::HobDataType("out", 0) == GetDataType<dtype>::value))     \
+      .SetInferTmpSizeFn([](user_op::InferContext* ctx) -> size_t {                         \
+        const Shape* in_shape = ctx->Shape4ArgNameAndIndex("in", 0);                        \
+        const int64_t instance_size = in_shape->At(in_shape->NumAxes() - 1);                \
+        return instance_size < kCpuSortParallelMinSize ? 0 : instance_size * sizeof(dtype); \
+      });
 
 REGISTER_CPU_SORT_KERNEL(float)
 REGISTER_CPU_SORT_KERNEL(double)
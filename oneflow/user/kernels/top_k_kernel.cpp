@@ -14,62 +14,52 @@ See the License for the specific language governing permissions and
 limitations under the License.
 */
 #include "oneflow/core/framework/framework.h"
-#include "oneflow/core/thread/thread_manager.h"
 #include "oneflow/core/common/balanced_splitter.h"
+#include "oneflow/user/kernels/sort_cpu_kernel_util.h"
 
 namespace oneflow {
 
 namespace {
 
-template<typename T>
-void ComputeTopOne(const T* in_ptr, const Range& range, int32_t instance_size, int32_t* out_ptr) {
-  FOR_RANGE(int32_t, i, range.begin(), range.end()) {
-    const T* in_ptr_i = in_ptr + i * instance_size;
-    out_ptr[i] = std::distance(in_ptr_i, std::max_element(in_ptr_i, in_ptr_i + instance_size));
-  }
-}
+// Small instances are spread over tasks, large ones are split into parts whose top k are taken
+// by the tasks. The tmp buffer holds the top k of each part, then a buffer of the radix select
+// for each task.
+struct TopKCpuTmpLayout {
+  int64_t part_size;
+  int64_t part_num;
+  int64_t num_tasks;
+  int64_t candidates_size;
+  int64_t buffer_size;
+
+  size_t TmpSize() const { return (candidates_size + num_tasks * buffer_size) * sizeof(int32_t); }
+};
 
 template<typename T>
-void ComputeTopK(const T* in_ptr, int32_t* indices_ptr, const Range& range, int32_t instance_size,
-                 int32_t k, bool sorted, int32_t* out_ptr) {
-  FOR_RANGE(int32_t, i, range.begin(), range.end()) {
-    const int32_t offset = i * instance_size;
-    const T* in_ptr_i = in_ptr + offset;
-    int32_t* indices_ptr_i = indices_ptr + offset;
-    std::iota(indices_ptr_i, indices_ptr_i + instance_size, 0);
-    auto comp = [&](const int32_t lhs, const int32_t rhs) {
-      const T l = in_ptr_i[lhs];
-      const T r = in_ptr_i[rhs];
-      if (l == r) {
-        return lhs < rhs;
-      } else {
-        return l > r;
-      }
-    };
-    std::nth_element(indices_ptr_i, indices_ptr_i + k, indices_ptr_i + instance_size, comp);
-    if (sorted) { std::sort(indices_ptr_i, indices_ptr_i + k, comp); }
-    std::copy(indices_ptr_i, indices_ptr_i + k, out_ptr + i * k);
+TopKCpuTmpLayout GetTopKCpuTmpLayout(int64_t instance_num, int64_t instance_size, int64_t k) {
+  TopKCpuTmpLayout layout{instance_size, 1, 0, 0, 0};
+  int64_t num_items = instance_num;
+  int64_t grain_size = std::max<int64_t>(kCpuSortParallelMinSize / instance_size, 1);
+  if (instance_size >= kCpuSortParallelMinSize) {
+    layout.part_size = std::max(kCpuSortParallelMinSize / 2, k * 2);
+    layout.part_num = (instance_size + layout.part_size - 1) / layout.part_size;
+    layout.candidates_size = layout.part_num * k;
+    num_items = layout.part_num;
+    grain_size = 1;
   }
+  layout.num_tasks = std::min((num_items + grain_size - 1) / grain_size,
+                              ParallelForMaxParallelism());
+  layout.buffer_size = TopKCpuKernelUtil<T>::BufferSize(layout.part_size, k);
+  return layout;
 }
 
 template<typename T>
-void CpuTopK(DeviceCtx* ctx, const T* in_ptr, int32_t* indices_ptr, int32_t instance_num,
-             int32_t instance_size, int32_t k, bool sorted, int32_t* out_ptr) {
-  const int32_t num_thread = std::min(instance_num, Global<ThreadPool>::Get()->thread_num());
-  const BalancedSplitter bs(instance_num, num_thread);
-  BlockingCounter bc(num_thread);
-  FOR_RANGE(int32_t, thread_id, 0, num_thread) {
-    const Range range = bs.At(thread_id);
-    Global<ThreadPool>::Get()->AddWork([=, &bc]() {
-      if (k == 1) {
-        ComputeTopOne(in_ptr, range, instance_size, out_ptr);
-      } else {
-        ComputeTopK(in_ptr, indices_ptr, range, instance_size, k, sorted, out_ptr);
-      }
-      bc.Decrease();
-    });
-  }
-  bc.WaitUntilCntEqualZero();
+size_t InferTopKCpuTmpSize(user_op::InferContext* ctx) {
+  const Shape* in_shape = ctx->Shape4ArgNameAndIndex("in", 0);
+  if (in_shape->elem_cnt() == 0) { return 0; }
+  const int64_t instance_size = in_shape->At(in_shape->NumAxes() - 1);
+  const int64_t k = std::min<int64_t>(ctx->Attr<int32_t>("k"), instance_size);
+  return GetTopKCpuTmpLayout<T>(in_shape->elem_cnt() / instance_size, instance_size, k)
+      .TmpSize();
 }
 
 }  // namespace
@@ -85,26 +75,74 @@ class TopKCpuKernel final : public user_op::OpKernel {
     const user_op::Tensor* in = ctx->Tensor4ArgNameAndIndex("in", 0);
     user_op::Tensor* out = ctx->Tensor4ArgNameAndIndex("out", 0);
     user_op::Tensor* tmp_buffer = ctx->Tensor4ArgNameAndIndex("tmp_buffer", 0);
-
-    const int32_t instance_size = in->shape().At(in->shape().NumAxes() - 1);
-    const int32_t instance_num = in->shape().elem_cnt() / instance_size;
-    const int32_t k = std::min(ctx->Attr<int32_t>("k"), instance_size);
-    int32_t* indices_ptr = tmp_buffer ? tmp_buffer->mut_dptr<int32_t>() : nullptr;
-    CpuTopK(ctx->device_ctx(), in->dptr<T>(), indices_ptr, instance_num, instance_size, k,
-            ctx->Attr<bool>("sorted"), out->mut_dptr<int32_t>());
+    if (in->shape().elem_cnt() == 0) { return; }
+    const int64_t instance_size = in->shape().At(in->shape().NumAxes() - 1);
+    const int64_t instance_num = in->shape().elem_cnt() / instance_size;
+    const int64_t k = std::min<int64_t>(ctx->Attr<int32_t>("k"), instance_size);
+    const bool sorted = ctx->Attr<bool>("sorted");
+    const T* in_ptr = in->dptr<T>();
+    int32_t* out_ptr = out->mut_dptr<int32_t>();
+    TopKCpuTmpLayout layout = GetTopKCpuTmpLayout<T>(instance_num, instance_size, k);
+    int32_t* tmp_ptr = tmp_buffer ? tmp_buffer->mut_dptr<int32_t>() : nullptr;
+    const int64_t tmp_size = tmp_buffer ? tmp_buffer->shape().elem_cnt() / sizeof(int32_t) : 0;
+    CHECK_GE(tmp_size, layout.candidates_size);
+    if (layout.buffer_size > 0) {
+      // no more tasks than the buffers in the tmp buffer
+      layout.num_tasks = std::min(layout.num_tasks,
+                                  (tmp_size - layout.candidates_size) / layout.buffer_size);
+      CHECK_GT(layout.num_tasks, 0);
+    }
+    int32_t* candidates = tmp_ptr;
+    int32_t* buffers = tmp_ptr + layout.candidates_size;
+    // runs DoEach(buffer, item) for each item, by the tasks
+    const auto ForEachItem = [&](int64_t num_items,
+                                 const std::function<void(int32_t*, int64_t)>& DoEach) {
+      const BalancedSplitter splitter(num_items, layout.num_tasks);
+      ParallelFor(layout.num_tasks, 1, [&](int64_t begin, int64_t end) {
+        FOR_RANGE(int64_t, task, begin, end) {
+          int32_t* buffer = layout.buffer_size > 0 ? buffers + task * layout.buffer_size : nullptr;
+          const Range range = splitter.At(task);
+          FOR_RANGE(int64_t, item, range.begin(), range.end()) { DoEach(buffer, item); }
+        }
+      });
+    };
+    if (instance_size < kCpuSortParallelMinSize) {
+      ForEachItem(instance_num, [&](int32_t* buffer, int64_t i) {
+        TopKCpuKernelUtil<T>::TopK(in_ptr + i * instance_size, 0, instance_size, k, sorted,
+                                   buffer, out_ptr + i * k);
+      });
+      return;
+    }
+    // the top k of each part of a large instance, then the top k of those
+    FOR_RANGE(int64_t, i, 0, instance_num) {
+      const T* in_ptr_i = in_ptr + i * instance_size;
+      ForEachItem(layout.part_num, [&](int32_t* buffer, int64_t j) {
+        const int64_t part_end = std::min((j + 1) * layout.part_size, instance_size);
+        TopKCpuKernelUtil<T>::TopK(in_ptr_i, j * layout.part_size, part_end, k, false, buffer,
+                                   candidates + j * k);
+      });
+      // parts shorter than k leave gaps
+      int64_t num_candidates = 0;
+      FOR_RANGE(int64_t, j, 0, layout.part_num) {
+        const int64_t candidate_num =
+            std::min(k, std::min((j + 1) * layout.part_size, instance_size) - j * layout.part_size);
+        std::copy(candidates + j * k, candidates + j * k + candidate_num,
+                  candidates + num_candidates);
+        num_candidates += candidate_num;
+      }
+      TopKCpuKernelUtil<T>::TopKOfCandidates(in_ptr_i, candidates, num_candidates, k, sorted,
+                                             out_ptr + i * k);
+    }
   }
   bool AlwaysComputeWhenAllOutputsEmpty() const override { return false; }
 };
 
-#define REGISTER_CPU_TOP_K_KERNEL(dtype)                                                 \
-  REGISTER_USER_KERNEL("top_k")                                                          \
-      .SetCreateFn<TopKCpuKernel<dtype>>()                                               \
-      .SetIsMatchedHob((user_op::HobDeviceTag() == "cpu")                                \
-                       & (user_op::HobDataType("in", 0) == GetDataType<dtype>::value))   \
-      .SetInferTmpSizeFn([](user_op::InferContext* ctx) {                                \
-        const Shape* in_shape = ctx->Shape4ArgNameAndIndex("in", 0);                     \
-        return ctx->Attr<int32_t>("k") > 1 ? in_shape->elem_cnt() * sizeof(int32_t) : 0; \
-      });
+#define REGISTER_CPU_TOP_K_KERNEL(dtype)                                               \
+  REGISTER_USER_KERNEL("top_k")                                                        \
+      .SetCreateFn<TopKCpuKernel<dtype>>()                                             \
+      .SetIsMatchedHob((user_op::HobDeviceTag() == "cpu")                              \
+                       & (user_op::HobDataType("in", 0) == GetDataType<dtype>::value)) \
+      .SetInferTmpSizeFn(InferTopKCpuTmpSize<dtype>);
 
 REGISTER_CPU_TOP_K_KERNEL(float)
 REGISTER_CPU_TOP_K_KERNEL(double)
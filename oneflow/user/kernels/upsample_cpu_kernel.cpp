@@ -0,0 +1,157 @@
+/*
+Copyright 2020 The OneFlow Authors. All rights reserved.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+*/
+#include "oneflow/core/framework/framework.h"
+#include "oneflow/user/kernels/upsample_cpu_kernel_util.h"
+#include "oneflow/core/thread/thread_manager.h"
+
+namespace oneflow {
+
+namespace {
+
+// the source and weight tables of the height and the width, made for the shape of the last run
+class UpsampleCpuOpKernelState final : public user_op::OpKernelState {
+ public:
+  UpsampleCpuOpKernelState(const std::string& interpolation, float height_scale,
+                           float width_scale, bool is_backward)
+      : interpolation_(interpolation),
+        height_scale_(height_scale),
+        width_scale_(width_scale),
+        is_backward_(is_backward),
+        in_h_(-1),
+        in_w_(-1) {}
+  ~UpsampleCpuOpKernelState() = default;
+
+  // in is x of the forward and dx of the backward
+  void Update(int64_t in_h, int64_t in_w, int64_t out_h, int64_t out_w) {
+    if (in_h == in_h_ && in_w == in_w_ && out_h == out_h_ && out_w == out_w_) { return; }
+    in_h_ = in_h;
+    in_w_ = in_w;
+    out_h_ = out_h;
+    out_w_ = out_w;
+    h_table_ = MakeUpsampleAxisTable(interpolation_, in_h, out_h, 1.f / height_scale_);
+    w_table_ = MakeUpsampleAxisTable(interpolation_, in_w, out_w, 1.f / width_scale_);
+    if (is_backward_) {
+      h_table_ = TransposeUpsampleAxisTable(h_table_, in_h);
+      w_table_ = TransposeUpsampleAxisTable(w_table_, in_w);
+    }
+  }
+  const UpsampleAxisTable& h_table() const { return h_table_; }
+  const UpsampleAxisTable& w_table() const { return w_table_; }
+
+ private:
+  std::string interpolation_;
+  float height_scale_;
+  float width_scale_;
+  bool is_backward_;
+  int64_t in_h_;
+  int64_t in_w_;
+  int64_t out_h_;
+  int64_t out_w_;
+  UpsampleAxisTable h_table_;
+  UpsampleAxisTable w_table_;
+};
+
+std::shared_ptr<user_op::OpKernelState> CreateUpsampleCpuOpKernelState(
+    user_op::KernelInitContext* ctx, bool is_backward) {
+  return std::make_shared<UpsampleCpuOpKernelState>(
+      ctx->Attr<std::string>("interpolation"), ctx->Attr<float>("height_scale"),
+      ctx->Attr<float>("width_scale"), is_backward);
+}
+
+// in is the smaller image, x of the forward and dx of the backward, and out the larger one
+template<typename T>
+void UpsampleCpuCompute(user_op::KernelComputeContext* ctx, user_op::OpKernelState* state,
+                        const ShapeView& in_shape, const ShapeView& out_shape,
+                        const user_op::Tensor* src, user_op::Tensor* dst) {
+  auto* upsample_state = dynamic_cast<UpsampleCpuOpKernelState*>(state);
+  CHECK_NOTNULL(upsample_state);
+  const bool channels_last = ctx->Attr<std::string>("data_format") == "channels_last";
+  const int32_t h_axis = channels_last ? 1 : 2;
+  const int64_t channels = channels_last ? in_shape.At(3) : in_shape.At(1);
+  upsample_state->Update(in_shape.At(h_axis), in_shape.At(h_axis + 1), out_shape.At(h_axis),
+                         out_shape.At(h_axis + 1));
+  const ShapeView& src_shape = src->shape();
+  const ShapeView& dst_shape = dst->shape();
+  const int64_t num_rows =
+      UpsampleCpuKernelUtil<T>::NumRows(channels_last, dst_shape.At(0), channels,
+                                        dst_shape.At(h_axis));
+  const int64_t row_size = dst_shape.elem_cnt() / std::max<int64_t>(num_rows, 1);
+  ctx->ParallelFor(num_rows, ParallelForGrainSize(row_size), [&](int64_t begin, int64_t end) {
+    UpsampleCpuKernelUtil<T>::Resample(
+        begin, end, channels_last, channels, src_shape.At(h_axis), src_shape.At(h_axis + 1),
+        dst_shape.At(h_axis), dst_shape.At(h_axis + 1), upsample_state->h_table(),
+        upsample_state->w_table(), src->dptr<T>(), dst->mut_dptr<T>());
+  });
+}
+
+}  // namespace
+
+template<typename T>
+class UpsampleCpuKernel final : public user_op::OpKernel {
+ public:
+  UpsampleCpuKernel() = default;
+  ~UpsampleCpuKernel() = default;
+
+  std::shared_ptr<user_op::OpKernelState> CreateOpKernelState(
+      user_op::KernelInitContext* ctx) const {
+    return CreateUpsampleCpuOpKernelState(ctx, false);
+  }
+
+ private:
+  void Compute(user_op::KernelComputeContext* ctx, user_op::OpKernelState* state) const override {
+    const user_op::Tensor* x = ctx->Tensor4ArgNameAndIndex("x", 0);
+    user_op::Tensor* y = ctx->Tensor4ArgNameAndIndex("y", 0);
+    UpsampleCpuCompute<T>(ctx, state, x->shape(), y->shape(), x, y);
+  }
+  bool AlwaysComputeWhenAllOutputsEmpty() const override { return false; }
+};
+
+template<typename T>
+class UpsampleGradCpuKernel final : public user_op::OpKernel {
+ public:
+  UpsampleGradCpuKernel() = default;
+  ~UpsampleGradCpuKernel() = default;
+
+  std::shared_ptr<user_op::OpKernelState> CreateOpKernelState(
+      user_op::KernelInitContext* ctx) const {
+    return CreateUpsampleCpuOpKernelState(ctx, true);
+  }
+
+ private:
+  void Compute(user_op::KernelComputeContext* ctx, user_op::OpKernelState* state) const override {
+    user_op::Tensor* dx = ctx->Tensor4ArgNameAndIndex("dx", 0);
+    if (dx == nullptr) { return; }
+    const user_op::Tensor* dy = ctx->Tensor4ArgNameAndIndex("dy", 0);
+    // a gather through the transposed tables, every element of dx is written once
+    UpsampleCpuCompute<T>(ctx, state, dx->shape(), dy->shape(), dy, dx);
+  }
+  bool AlwaysComputeWhenAllOutputsEmpty() const override { return false; }
+};
+
+#define REGISTER_UPSAMPLE_CPU_KERNEL(dtype)                                            \
+  REGISTER_USER_KERNEL("upsample")                                                     \
+      .SetCreateFn<UpsampleCpuKernel<dtype>>()                                         \
+      .SetIsMatchedHob((user_op::HobDeviceTag() == "cpu")                              \
+                       & (user_op::HobDataType("y", 0) == GetDataType<dtype>::value)); \
+  REGISTER_USER_KERNEL("upsample_grad")                                                \
+      .SetCreateFn<UpsampleGradCpuKernel<dtype>>()                                     \
+      .SetIsMatchedHob((user_op::HobDeviceTag() == "cpu")                              \
+                       & (user_op::HobDataType("dx", 0) == GetDataType<dtype>::value));
+
+REGISTER_UPSAMPLE_CPU_KERNEL(float)
+REGISTER_UPSAMPLE_CPU_KERNEL(double)
+
+}  // namespace oneflow
@@ -0,0 +1,157 @@
+/*
+Copyright 2020 The OneFlow Authors. All rights reserved.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+*/
+#include "oneflow/user/kernels/upsample_cpu_kernel_util.h"
+#include "oneflow/core/common/cpu_simd.h"
+
+namespace oneflow {
+
+namespace {
+
+void AddEntry(int64_t index, float weight, UpsampleAxisTable* table) {
+  table->indices.push_back(index);
+  table->weights.push_back(weight);
+}
+
+// one output pixel of channels last, dst = sum(weight * src pixel) over the entries
+template<typename T>
+void ResamplePixel(int64_t channels, const T* src_image, int64_t src_w,
+                   const UpsampleAxisTable& h_table, int64_t h_begin, int64_t h_end,
+                   const UpsampleAxisTable& w_table, int64_t w_begin, int64_t w_end, T* dst) {
+  using Vec = simd::SimdVec<T>;
+  constexpr int64_t kWidth = Vec::kWidth;
+  const int64_t vec_channels = channels / kWidth * kWidth;
+  for (int64_t c = 0; c < vec_channels; c += kWidth) {
+    typename Vec::Reg sum = Vec::Zero();
+    FOR_RANGE(int64_t, i, h_begin, h_end) {
+      const T* src_row = src_image + h_table.indices[i] * src_w * channels + c;
+      FOR_RANGE(int64_t, j, w_begin, w_end) {
+        const T weight = h_table.weights[i] * w_table.weights[j];
+        sum = Vec::Fma(Vec::Set1(weight), Vec::Load(src_row + w_table.indices[j] * channels), sum);
+      }
+    }
+    Vec::Store(dst + c, sum);
+  }
+  FOR_RANGE(int64_t, c, vec_channels, channels) {
+    T sum = 0;
+    FOR_RANGE(int64_t, i, h_begin, h_end) {
+      const T* src_row = src_image + h_table.indices[i] * src_w * channels + c;
+      FOR_RANGE(int64_t, j, w_begin, w_end) {
+        sum += static_cast<T>(h_table.weights[i] * w_table.weights[j])
+               * src_row[w_table.indices[j] * channels];
+      }
+    }
+    dst[c] = sum;
+  }
+}
+
+}  // namespace
+
+UpsampleAxisTable MakeUpsampleAxisTable(const std::string& interpolation, int64_t in_size,
+                                        int64_t out_size, float scale) {
+  UpsampleAxisTable table;
+  table.offsets.reserve(out_size + 1);
+  table.offsets.push_back(0);
+  FOR_RANGE(int64_t, i, 0, out_size) {
+    if (interpolation == "nearest") {
+      const int64_t index =
+          static_cast<int64_t>(std::floor((static_cast<float>(i) + 0.5f) * scale));
+      AddEntry(std::max<int64_t>(std::min(index, in_size - 1), 0), 1, &table);
+    } else if (interpolation == "bilinear") {
+      const float in_pos = (static_cast<float>(i) + 0.5f) * scale - 0.5f;
+      const int64_t lower = in_pos > 0 ? static_cast<int64_t>(std::floor(in_pos)) : 0;
+      const int64_t upper =
+          in_pos < in_size - 1 ? static_cast<int64_t>(std::ceil(in_pos)) : in_size - 1;
+      const float lerp = in_pos - std::floor(in_pos);
+      if (lower == upper) {
+        AddEntry(lower, 1, &table);
+      } else {
+        AddEntry(lower, 1 - lerp, &table);
+        AddEntry(upper, lerp, &table);
+      }
+    } else {
+      UNIMPLEMENTED() << interpolation;
+    }
+    table.offsets.push_back(table.indices.size());
+  }
+  return table;
+}
+
+UpsampleAxisTable TransposeUpsampleAxisTable(const UpsampleAxisTable& table, int64_t in_size) {
+  const int64_t out_size = table.offsets.size() - 1;
+  UpsampleAxisTable transposed;
+  transposed.offsets.assign(in_size + 1, 0);
+  for (int64_t index : table.indices) { transposed.offsets.at(index + 1) += 1; }
+  FOR_RANGE(int64_t, i, 0, in_size) { transposed.offsets[i + 1] += transposed.offsets[i]; }
+  transposed.indices.resize(table.indices.size());
+  transposed.weights.resize(table.weights.size());
+  std::vector<int64_t> cursors(transposed.offsets.begin(), transposed.offsets.end() - 1);
+  FOR_RANGE(int64_t, o, 0, out_size) {
+    FOR_RANGE(int64_t, e, table.offsets[o], table.offsets[o + 1]) {
+      const int64_t pos = cursors[table.indices[e]]++;
+      transposed.indices[pos] = o;
+      transposed.weights[pos] = table.weights[e];
+    }
+  }
+  return transposed;
+}
+
+template<typename T>
+int64_t UpsampleCpuKernelUtil<T>::NumRows(bool channels_last, int64_t batch, int64_t channels,
+                                          int64_t dst_h) {
+  return channels_last ? batch * dst_h : batch * channels * dst_h;
+}
+
+template<typename T>
+void UpsampleCpuKernelUtil<T>::Resample(int64_t row_begin, int64_t row_end, bool channels_last,
+                                        int64_t channels, int64_t src_h, int64_t src_w,
+                                        int64_t dst_h, int64_t dst_w,
+                                        const UpsampleAxisTable& h_table,
+                                        const UpsampleAxisTable& w_table, const T* src, T* dst) {
+  FOR_RANGE(int64_t, row, row_begin, row_end) {
+    // an image of channels last, a plane of one channel of channels first
+    const int64_t image = row / dst_h;
+    const int64_t h = row % dst_h;
+    const int64_t h_begin = h_table.offsets[h];
+    const int64_t h_end = h_table.offsets[h + 1];
+    if (channels_last) {
+      const T* src_image = src + image * src_h * src_w * channels;
+      T* dst_row = dst + row * dst_w * channels;
+      FOR_RANGE(int64_t, w, 0, dst_w) {
+        ResamplePixel<T>(channels, src_image, src_w, h_table, h_begin, h_end, w_table,
+                         w_table.offsets[w], w_table.offsets[w + 1], dst_row + w * channels);
+      }
+    } else {
+      const T* src_plane = src + image * src_h * src_w;
+      T* dst_row = dst + row * dst_w;
+      FOR_RANGE(int64_t, w, 0, dst_w) {
+        T sum = 0;
+        FOR_RANGE(int64_t, i, h_begin, h_end) {
+          const T* src_row = src_plane + h_table.indices[i] * src_w;
+          FOR_RANGE(int64_t, j, w_table.offsets[w], w_table.offsets[w + 1]) {
+            sum += static_cast<T>(h_table.weights[i] * w_table.weights[j])
+                   * src_row[w_table.indices[j]];
+          }
+        }
+        dst_row[w] = sum;
+      }
+    }
+  }
+}
+
+template struct UpsampleCpuKernelUtil<float>;
+template struct UpsampleCpuKernelUtil<double>;
+
+}  // namespace oneflow
@@ -0,0 +1,54 @@
+/*
+Copyright 2020 The OneFlow Authors. All rights reserved.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+*/
+#ifndef ONEFLOW_USER_KERNELS_UPSAMPLE_CPU_KERNEL_UTIL_H_
+#define ONEFLOW_USER_KERNELS_UPSAMPLE_CPU_KERNEL_UTIL_H_
+
+#include "oneflow/core/common/util.h"
+
+namespace oneflow {
+
+// The sources of each destination row or column along one axis, with their weights. Entries
+// [offsets[i], offsets[i + 1]) belong to destination i.
+struct UpsampleAxisTable {
+  std::vector<int64_t> offsets;
+  std::vector<int64_t> indices;
+  std::vector<float> weights;
+};
+
+// the forward of "nearest" or "bilinear" from in_size to out_size, scale is in_size / out_size
+// as the gpu kernels compute it
+UpsampleAxisTable MakeUpsampleAxisTable(const std::string& interpolation, int64_t in_size,
+                                        int64_t out_size, float scale);
+// the backward of a forward table, from out_size back to in_size
+UpsampleAxisTable TransposeUpsampleAxisTable(const UpsampleAxisTable& table, int64_t in_size);
+
+// dst[h][w] = sum(h_weight * w_weight * src[h_index][w_index]) over the entries of h in h_table and
+// of w in w_table, for each image and channel. The forward resamples x to y, the backward dy to
+// dx with the transposed tables.
+template<typename T>
+struct UpsampleCpuKernelUtil {
+  // rows are channels first batch * channels * dst_h rows of dst_w elements, and channels last
+  // batch * dst_h rows of dst_w * channels elements
+  static int64_t NumRows(bool channels_last, int64_t batch, int64_t channels, int64_t dst_h);
+  static void Resample(int64_t row_begin, int64_t row_end, bool channels_last, int64_t channels,
+                       int64_t src_h, int64_t src_w, int64_t dst_h, int64_t dst_w,
+                       const UpsampleAxisTable& h_table, const UpsampleAxisTable& w_table,
+                       const T* src, T* dst);
+};
+
+}  // namespace oneflow
+
+#endif  // ONEFLOW_USER_KERNELS_UPSAMPLE_CPU_KERNEL_UTIL_H_
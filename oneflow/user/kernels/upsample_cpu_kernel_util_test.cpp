@@ -0,0 +1,140 @@
+/*
+Copyright 2020 The OneFlow Authors. All rights reserved.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+*/
+#include "oneflow/core/common/cpu_test_util.h"
+#include "oneflow/user/kernels/upsample_cpu_kernel_util.h"
+
+namespace oneflow {
+
+namespace {
+
+using test::ExpectNear;
+using test::RandomData;
+using test::TwoParts;
+
+int64_t Offset(bool channels_last, int64_t channels, int64_t height, int64_t width, int64_t n,
+               int64_t c, int64_t h, int64_t w) {
+  return channels_last ? ((n * height + h) * width + w) * channels + c
+                       : ((n * channels + c) * height + h) * width + w;
+}
+
+// the computation of the gpu kernels, element by element, the backward scatters dy into dx
+template<typename T>
+void NaiveUpsample(const std::string& interpolation, bool channels_last, int64_t batch,
+                   int64_t channels, int64_t in_h, int64_t in_w, int64_t out_h, int64_t out_w,
+                   const T* x, const T* dy, T* y, T* dx) {
+  const float scale_h = static_cast<float>(in_h) / out_h;
+  const float scale_w = static_cast<float>(in_w) / out_w;
+  std::fill(dx, dx + batch * channels * in_h * in_w, static_cast<T>(0));
+  const auto InOffset = [&](int64_t n, int64_t c, int64_t h, int64_t w) {
+    return Offset(channels_last, channels, in_h, in_w, n, c, h, w);
+  };
+  FOR_RANGE(int64_t, n, 0, batch) {
+    FOR_RANGE(int64_t, c, 0, channels) {
+      FOR_RANGE(int64_t, h, 0, out_h) {
+        FOR_RANGE(int64_t, w, 0, out_w) {
+          const int64_t out_offset = Offset(channels_last, channels, out_h, out_w, n, c, h, w);
+          if (interpolation == "nearest") {
+            const int64_t ih = std::max<int64_t>(
+                std::min<int64_t>(std::floor((h + 0.5f) * scale_h), in_h - 1), 0);
+            const int64_t iw = std::max<int64_t>(
+                std::min<int64_t>(std::floor((w + 0.5f) * scale_w), in_w - 1), 0);
+            y[out_offset] = x[InOffset(n, c, ih, iw)];
+            dx[InOffset(n, c, ih, iw)] += dy[out_offset];
+          } else {
+            const float fh = (h + 0.5f) * scale_h - 0.5f;
+            const float fw = (w + 0.5f) * scale_w - 0.5f;
+            const int64_t top = fh > 0 ? std::floor(fh) : 0;
+            const int64_t bottom = fh < in_h - 1 ? std::ceil(fh) : in_h - 1;
+            const int64_t left = fw > 0 ? std::floor(fw) : 0;
+            const int64_t right = fw < in_w - 1 ? std::ceil(fw) : in_w - 1;
+            const float h_lerp = fh - std::floor(fh);
+            const float w_lerp = fw - std::floor(fw);
+            const T top_value = x[InOffset(n, c, top, left)]
+                                + (x[InOffset(n, c, top, right)] - x[InOffset(n, c, top, left)])
+                                      * w_lerp;
+            const T bottom_value =
+                x[InOffset(n, c, bottom, left)]
+                + (x[InOffset(n, c, bottom, right)] - x[InOffset(n, c, bottom, left)]) * w_lerp;
+            y[out_offset] = top_value + (bottom_value - top_value) * h_lerp;
+            const T d_bottom = h_lerp * dy[out_offset];
+            const T d_top = dy[out_offset] - d_bottom;
+            dx[InOffset(n, c, top, left)] += (1 - w_lerp) * d_top;
+            dx[InOffset(n, c, top, right)] += w_lerp * d_top;
+            dx[InOffset(n, c, bottom, left)] += (1 - w_lerp) * d_bottom;
+            dx[InOffset(n, c, bottom, right)] += w_lerp * d_bottom;
+          }
+        }
+      }
+    }
+  }
+}
+
+template<typename T>
+void TestUpsample(const std::string& interpolation, bool channels_last, int64_t channels,
+                  int64_t height_scale, int64_t width_scale, double tolerance) {
+  using Util = UpsampleCpuKernelUtil<T>;
+  const int64_t batch = 2;
+  const int64_t in_h = 5;
+  const int64_t in_w = 7;
+  const int64_t out_h = in_h * height_scale;
+  const int64_t out_w = in_w * width_scale;
+  const std::vector<T> x = RandomData<T>(batch * channels * in_h * in_w, -1, 1);
+  const std::vector<T> dy = RandomData<T>(batch * channels * out_h * out_w, -1, 1);
+  std::vector<T> expected_y(dy.size());
+  std::vector<T> expected_dx(x.size());
+  NaiveUpsample<T>(interpolation, channels_last, batch, channels, in_h, in_w, out_h, out_w,
+                   x.data(), dy.data(), expected_y.data(), expected_dx.data());
+
+  // the scales as the kernels compute them from the attrs
+  const UpsampleAxisTable h_table =
+      MakeUpsampleAxisTable(interpolation, in_h, out_h, 1.f / height_scale);
+  const UpsampleAxisTable w_table =
+      MakeUpsampleAxisTable(interpolation, in_w, out_w, 1.f / width_scale);
+  std::vector<T> y(dy.size(), -1);
+  const int64_t num_y_rows = Util::NumRows(channels_last, batch, channels, out_h);
+  TwoParts(num_y_rows, [&](int64_t begin, int64_t end) {
+    Util::Resample(begin, end, channels_last, channels, in_h, in_w, out_h, out_w, h_table, w_table,
+                   x.data(), y.data());
+  });
+  const UpsampleAxisTable h_grad_table = TransposeUpsampleAxisTable(h_table, in_h);
+  const UpsampleAxisTable w_grad_table = TransposeUpsampleAxisTable(w_table, in_w);
+  std::vector<T> dx(x.size(), -1);
+  const int64_t num_dx_rows = Util::NumRows(channels_last, batch, channels, in_h);
+  TwoParts(num_dx_rows, [&](int64_t begin, int64_t end) {
+    Util::Resample(begin, end, channels_last, channels, out_h, out_w, in_h, in_w, h_grad_table,
+                   w_grad_table, dy.data(), dx.data());
+  });
+  ExpectNear(expected_y, y, tolerance);
+  ExpectNear(expected_dx, dx, tolerance);
+}
+
+}  // namespace
+
+TEST(UpsampleCpuKernelUtil, forward_backward) {
+  for (const std::string interpolation : {"nearest", "bilinear"}) {
+    for (const bool channels_last : {false, true}) {
+      // channels with and without a tail after the last vector
+      for (const int64_t channels : {1, 3, 16, 19}) {
+        for (const int64_t scale : {1, 2, 3}) {
+          TestUpsample<float>(interpolation, channels_last, channels, scale, scale + 1, 1e-5);
+          TestUpsample<double>(interpolation, channels_last, channels, scale, 2, 1e-6);
+        }
+      }
+    }
+  }
+}
+
+}  // namespace oneflow
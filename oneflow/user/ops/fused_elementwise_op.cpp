@@ -0,0 +1,94 @@
+/*
+Copyright 2020 The OneFlow Authors. All rights reserved.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+*/
+#include "oneflow/core/framework/framework.h"
+#include "oneflow/user/kernels/fused_elementwise_kernel_util.h"
+
+namespace oneflow {
+
+REGISTER_CPU_ONLY_USER_OP("fused_elementwise")
+    .InputWithMinimum("in", 1)
+    .Output("out")
+    .Attr<std::vector<std::string>>("program")
+    .SetTensorDescInferFn([](user_op::InferContext* ctx) -> Maybe<void> {
+      const user_op::TensorDesc* in_0 = ctx->TensorDesc4ArgNameAndIndex("in", 0);
+      int64_t num_axes = 0;
+      for (const auto& pair : ctx->inputs()) {
+        const user_op::TensorDesc* in = ctx->TensorDesc4ArgNameAndIndex(pair.first, pair.second);
+        CHECK_EQ_OR_RETURN(in->data_type(), in_0->data_type());
+        num_axes = std::max(num_axes, in->shape().NumAxes());
+      }
+      // numpy broadcasting of all the inputs
+      DimVector dim_vec(num_axes, 1);
+      for (const auto& pair : ctx->inputs()) {
+        const Shape& shape = ctx->TensorDesc4ArgNameAndIndex(pair.first, pair.second)->shape();
+        const int64_t offset = num_axes - shape.NumAxes();
+        FOR_RANGE(int64_t, i, 0, shape.NumAxes()) {
+          int64_t& dim = dim_vec.at(offset + i);
+          CHECK_OR_RETURN(dim == 1 || shape.At(i) == 1 || shape.At(i) == dim);
+          if (dim == 1) { dim = shape.At(i); }
+        }
+      }
+      const Shape out_shape(dim_vec);
+      for (const auto& pair : ctx->inputs()) {
+        FusedElementwiseBroadcast broadcast;
+        JUST(GetFusedElementwiseBroadcast(
+            ctx->TensorDesc4ArgNameAndIndex(pair.first, pair.second)->shape(), out_shape,
+            &broadcast));
+      }
+      user_op::TensorDesc* out = ctx->TensorDesc4ArgNameAndIndex("out", 0);
+      *out = *in_0;
+      *out->mut_shape() = out_shape;
+      return Maybe<void>::Ok();
+    })
+    .SetGetSbpFn([](user_op::SbpContext* ctx) -> Maybe<void> {
+      int64_t num_axes = 0;
+      for (const auto& pair : ctx->inputs()) {
+        num_axes = std::max(
+            num_axes,
+            ctx->LogicalTensorDesc4InputArgNameAndIndex(pair.first, pair.second).shape().NumAxes());
+      }
+      FOR_RANGE(int64_t, axis, 0, num_axes) {
+        // inputs with the axis are split with the output, the others broadcast
+        int64_t dim = 1;
+        for (const auto& pair : ctx->inputs()) {
+          const Shape& shape =
+              ctx->LogicalTensorDesc4InputArgNameAndIndex(pair.first, pair.second).shape();
+          const int64_t in_axis = axis - (num_axes - shape.NumAxes());
+          if (in_axis >= 0) { dim = std::max(dim, shape.At(in_axis)); }
+        }
+        if (dim == 1) { continue; }
+        auto builder = ctx->NewBuilder();
+        for (const auto& pair : ctx->inputs()) {
+          const Shape& shape =
+              ctx->LogicalTensorDesc4InputArgNameAndIndex(pair.first, pair.second).shape();
+          const int64_t in_axis = axis - (num_axes - shape.NumAxes());
+          if (in_axis >= 0 && shape.At(in_axis) == dim) {
+            builder.Split(user_op::OpArg(pair.first, pair.second), in_axis);
+          } else {
+            builder.Broadcast(user_op::OpArg(pair.first, pair.second));
+          }
+        }
+        builder.Split(ctx->outputs(), axis).Build();
+      }
+      return Maybe<void>::Ok();
+    })
+    .SetCheckAttrFn([](const user_op::UserOpDefWrapper& op_def,
+                       const user_op::UserOpConfWrapper& op_conf) -> Maybe<void> {
+      return FusedElementwiseProgram::Check(op_conf.attr<std::vector<std::string>>("program"),
+                                            op_conf.input_size("in"));
+    });
+
+}  // namespace oneflow
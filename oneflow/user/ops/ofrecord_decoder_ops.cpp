@@ -18,6 +18,15 @@ limitations under the License.
 
 namespace oneflow {
 
+namespace {
+
+// OFRecord messages, or the serialized records from a reader decoding lazily
+bool IsOFRecordDataType(DataType data_type) {
+  return data_type == DataType::kOFRecord || data_type == DataType::kTensorBuffer;
+}
+
+}  // namespace
+
 REGISTER_CPU_ONLY_USER_OP("ofrecord_raw_decoder")
     .Input("in")
     .Output("out")
@@ -29,7 +38,7 @@ REGISTER_CPU_ONLY_USER_OP("ofrecord_raw_decoder")
     .SetTensorDescInferFn([](user_op::InferContext* ctx) -> Maybe<void> {
       user_op::TensorDesc* in_tensor = ctx->TensorDesc4ArgNameAndIndex("in", 0);
       user_op::TensorDesc* out_tensor = ctx->TensorDesc4ArgNameAndIndex("out", 0);
-      CHECK_OR_RETURN(in_tensor->data_type() == DataType::kOFRecord);
+      CHECK_OR_RETURN(IsOFRecordDataType(in_tensor->data_type()));
       CHECK_OR_RETURN(in_tensor->shape().NumAxes() == 1 && in_tensor->shape().At(0) >= 1);
       Shape conf_shape = ctx->Attr<Shape>("shape");
       DimVector dim_vec(1 + conf_shape.NumAxes());
@@ -65,7 +74,7 @@ REGISTER_CPU_ONLY_USER_OP("ofrecord_bytes_decoder")
     .SetTensorDescInferFn([](user_op::InferContext* ctx) -> Maybe<void> {
       const user_op::TensorDesc* in = ctx->TensorDesc4ArgNameAndIndex("in", 0);
       user_op::TensorDesc* out = ctx->TensorDesc4ArgNameAndIndex("out", 0);
-      CHECK_OR_RETURN(in->data_type() == DataType::kOFRecord);
+      CHECK_OR_RETURN(IsOFRecordDataType(in->data_type()));
       *out = *in;
       *out->mut_data_type() = DataType::kTensorBuffer;
       return Maybe<void>::Ok();
@@ -87,7 +96,7 @@ REGISTER_CPU_ONLY_USER_OP("ofrecord_image_decoder")
     .SetTensorDescInferFn([](user_op::InferContext* ctx) -> Maybe<void> {
       user_op::TensorDesc* in_tensor = ctx->TensorDesc4ArgNameAndIndex("in", 0);
       user_op::TensorDesc* out_tensor = ctx->TensorDesc4ArgNameAndIndex("out", 0);
-      CHECK_OR_RETURN(in_tensor->data_type() == DataType::kOFRecord);
+      CHECK_OR_RETURN(IsOFRecordDataType(in_tensor->data_type()));
       CHECK_OR_RETURN(in_tensor->shape().NumAxes() == 1 && in_tensor->shape().At(0) >= 1);
       *out_tensor->mut_shape() = in_tensor->shape();
       *out_tensor->mut_data_type() = DataType::kTensorBuffer;
@@ -125,7 +134,7 @@ REGISTER_CPU_ONLY_USER_OP("ofrecord_image_decoder_random_crop")
     .SetTensorDescInferFn([](user_op::InferContext* ctx) -> Maybe<void> {
       user_op::TensorDesc* in_tensor = ctx->TensorDesc4ArgNameAndIndex("in", 0);
       user_op::TensorDesc* out_tensor = ctx->TensorDesc4ArgNameAndIndex("out", 0);
-      CHECK_OR_RETURN(in_tensor->data_type() == DataType::kOFRecord);
+      CHECK_OR_RETURN(IsOFRecordDataType(in_tensor->data_type()));
       CHECK_OR_RETURN(in_tensor->shape().NumAxes() == 1 && in_tensor->shape().At(0) >= 1);
       *out_tensor->mut_shape() = in_tensor->shape();
       *out_tensor->mut_data_type() = DataType::kTensorBuffer;
@@ -29,6 +29,7 @@ REGISTER_CPU_ONLY_USER_OP("ofrecord_image_classification_reader")
     .Attr<int64_t>("seed", -1)
     .Attr<int32_t>("shuffle_buffer_size", 1024)
     .Attr<bool>("shuffle_after_epoch", false)
+    .Attr<bool>("use_mmap", false)
     .Attr<std::string>("color_space", "BGR")
     .Attr<std::string>("image_feature_name", "encoded")
     .Attr<std::string>("label_feature_name", "class/label")
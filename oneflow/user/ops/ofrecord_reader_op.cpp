@@ -28,6 +28,8 @@ REGISTER_CPU_ONLY_USER_OP("OFRecordReader")
     .Attr<int64_t>("seed", -1)
     .Attr<int32_t>("shuffle_buffer_size", 1024)
     .Attr<bool>("shuffle_after_epoch", false)
+    .Attr<bool>("use_mmap", false)
+    .Attr<bool>("lazy_decoding", false)
     .SetTensorDescInferFn([](user_op::InferContext* ctx) -> Maybe<void> {
       user_op::TensorDesc* out_tensor = ctx->TensorDesc4ArgNameAndIndex("out", 0);
       int32_t local_batch_size = ctx->Attr<int32_t>("batch_size");
@@ -38,7 +40,9 @@ REGISTER_CPU_ONLY_USER_OP("OFRecordReader")
         local_batch_size /= parallel_num;
       }
       *out_tensor->mut_shape() = Shape({local_batch_size});
-      *out_tensor->mut_data_type() = DataType::kOFRecord;
+      // lazy decoding leaves the records serialized, the decoders read what they need in place
+      *out_tensor->mut_data_type() =
+          ctx->Attr<bool>("lazy_decoding") ? DataType::kTensorBuffer : DataType::kOFRecord;
       return Maybe<void>::Ok();
     })
     .SetGetSbpFn([](user_op::SbpContext* ctx) -> Maybe<void> {